@@ -0,0 +1,79 @@
+/************************************************************************
+
+    ld-ldf-reader.cpp
+
+    ld-ldf-reader - random-access reader for .ldf compressed RF captures
+    Copyright (C) 2020 The ld-decode project
+
+    This file is part of ld-decode.
+
+    ld-decode is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+// Command-line wrapper for LdfReader: decode an .ldf file from a given
+// sample onwards, writing 16-bit samples to stdout.
+
+#include "ldfreader.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <unistd.h>
+
+// Number of samples to decode at a time
+static const int64_t BLOCK_SAMPLES = 4 * 1024 * 1024;
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || !strcmp(argv[1], "--help") || !strcmp(argv[1], "-h")) {
+        fprintf(stderr, "%s: Extract 16-bit unsigned data from .ldf (.oga compressed) files\n", argv[0]);
+        fprintf(stderr, "usage: %s [filename] [seek location]\n", argv[0]);
+        fprintf(stderr, "(output is streamed to standard output)\n");
+        return 1;
+    }
+
+    const char *filename = argv[1];
+    int64_t sample = (argc >= 3) ? atoll(argv[2]) : 0;
+
+    LdfReader reader;
+    if (!reader.open(filename)) return 1;
+
+    fprintf(stderr, "RATE:%lld\n", static_cast<long long>(reader.getSampleRate()));
+
+    std::vector<int16_t> buffer(BLOCK_SAMPLES);
+    while (true) {
+        const int64_t count = reader.read(sample, buffer.data(), BLOCK_SAMPLES);
+        if (count < 0) return 1;
+        if (count == 0) break;
+        sample += count;
+
+        // Write the block to stdout
+        const char *data = reinterpret_cast<const char *>(buffer.data());
+        size_t remaining = count * sizeof(int16_t);
+        while (remaining > 0) {
+            const ssize_t written = write(1, data, remaining);
+            if (written <= 0) {
+                // The reader has probably closed the pipe
+                return 1;
+            }
+            data += written;
+            remaining -= written;
+        }
+    }
+
+    return 0;
+}
@@ -197,10 +197,13 @@ def make_loader(filename, inputfreq=None):
         return load_unpacked_data_u8
     elif filename.endswith('raw.oga') or filename.endswith('.ldf'):
         try:
-            rv = LoadLDF(filename)
+            rv = LoadLDFLibrary(filename)
         except:
-            #print("Please build and install ld-ldf-reader in your PATH for improved performance", file=sys.stderr)
-            rv = LoadFFmpeg()
+            try:
+                rv = LoadLDF(filename)
+            except:
+                #print("Please build and install ld-ldf-reader in your PATH for improved performance", file=sys.stderr)
+                rv = LoadFFmpeg()
 
         return rv
     else:
@@ -399,6 +402,53 @@ class LoadFFmpeg:
         assert len(data) == readlen * 2
         return np.fromstring(data, '<i2')
 
+class LoadLDFLibrary:
+    """Load samples from an .ldf file using libldfreader, which decodes
+    directly into the returned array and can seek to any sample."""
+
+    def __init__(self, filename):
+        import ctypes
+        import ctypes.util
+
+        # Prefer a copy built in the source tree (the Makefile builds it in
+        # the top-level directory, next to the lddecode package), then an
+        # installed copy
+        moduledir = os.path.dirname(os.path.abspath(__file__))
+        libname = None
+        for path in [os.path.join(moduledir, "libldfreader.so"),
+                     os.path.join(moduledir, "..", "libldfreader.so")]:
+            if os.path.exists(path):
+                libname = path
+                break
+        if libname is None:
+            libname = ctypes.util.find_library("ldfreader") or "libldfreader.so"
+        self.lib = ctypes.CDLL(libname)
+
+        self.lib.ldf_open.argtypes = [ctypes.c_char_p, ctypes.c_int]
+        self.lib.ldf_open.restype = ctypes.c_void_p
+        self.lib.ldf_close.argtypes = [ctypes.c_void_p]
+        self.lib.ldf_close.restype = None
+        self.lib.ldf_read.argtypes = [ctypes.c_void_p, ctypes.c_int64, ctypes.c_void_p, ctypes.c_int64]
+        self.lib.ldf_read.restype = ctypes.c_int64
+
+        self.reader = self.lib.ldf_open(filename.encode(), 0)
+        if not self.reader:
+            raise IOError("libldfreader could not open " + filename)
+
+    def __del__(self):
+        if getattr(self, "reader", None):
+            self.lib.ldf_close(self.reader)
+            self.reader = None
+
+    def __call__(self, infile, sample, readlen):
+        data = np.empty(readlen, dtype=np.int16)
+        count = self.lib.ldf_read(self.reader, sample, data.ctypes.data, readlen)
+        if count < readlen:
+            # Short read - end of file (or error)
+            return None
+
+        return data
+
 class LoadLDF:
     """Load samples from a wide variety of formats using ffmpeg."""
 
@@ -0,0 +1,558 @@
+/************************************************************************
+
+    ldfreader.cpp
+
+    ld-ldf-reader - random-access reader for .ldf compressed RF captures
+    Copyright (C) 2020 The ld-decode project
+
+    This file is part of ld-decode.
+
+    ld-decode is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "ldfreader.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+#include <libavutil/mem.h>
+}
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Size of an Ogg page header, before the segment table
+const int64_t OGG_HEADER_SIZE = 27;
+// Ogg page flag indicating that the first packet continues from the previous page
+const uint8_t OGG_CONTINUED = 0x01;
+
+// Size of a FLAC STREAMINFO block, and its offset within the first Ogg packet
+const size_t STREAMINFO_SIZE = 34;
+const size_t STREAMINFO_OFFSET = 17;
+
+// Size of the window used when scanning the file to build the index.
+// This must be larger than the biggest possible Ogg page (65307 bytes).
+const size_t SCAN_WINDOW_SIZE = 1024 * 1024;
+
+// Minimum number of pages to give each decoding thread. Smaller reads are
+// decoded on one thread, as the threading overhead isn't worth it.
+const size_t MIN_PAGES_PER_JOB = 64;
+
+// The index cache file starts with INDEX_MAGIC, followed by INDEX_HEADER_FIELDS
+// 64-bit fields (file size, mtime in ns, sample rate, number of samples,
+// number of entries), STREAMINFO, and then two 64-bit fields (offset, first
+// sample) for each entry. All fields are little-endian.
+const char INDEX_MAGIC[8] = {'L', 'D', 'F', 'I', 'D', 'X', '2', '\0'};
+const size_t INDEX_HEADER_FIELDS = 5;
+const size_t INDEX_HEADER_SIZE = sizeof INDEX_MAGIC + (INDEX_HEADER_FIELDS * 8) + STREAMINFO_SIZE;
+const size_t INDEX_ENTRY_SIZE = 2 * 8;
+
+int64_t readLE64(const uint8_t *p)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return static_cast<int64_t>(value);
+}
+
+void writeLE64(uint8_t *p, int64_t value)
+{
+    uint64_t bits = static_cast<uint64_t>(value);
+    for (int i = 0; i < 8; i++) {
+        p[i] = static_cast<uint8_t>(bits);
+        bits >>= 8;
+    }
+}
+
+// Get a file's modification time in nanoseconds
+int64_t getMtime(const struct stat &st)
+{
+    return (static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000) + st.st_mtim.tv_nsec;
+}
+
+// Read exactly size bytes from offset in fd, returning false on error or EOF
+bool preadAll(int fd, void *buffer, size_t size, int64_t offset)
+{
+    uint8_t *p = static_cast<uint8_t *>(buffer);
+    while (size > 0) {
+        ssize_t count = pread(fd, p, size, offset);
+        if (count <= 0) return false;
+        p += count;
+        size -= count;
+        offset += count;
+    }
+    return true;
+}
+
+// Parse the header of the Ogg page at p, which has at least available bytes.
+// Returns the total size of the page, or -1 if it isn't a valid page.
+int64_t getPageSize(const uint8_t *p, int64_t available)
+{
+    if (available < OGG_HEADER_SIZE || memcmp(p, "OggS", 4) != 0 || p[4] != 0) return -1;
+
+    const int numSegments = p[26];
+    if (available < OGG_HEADER_SIZE + numSegments) return -1;
+
+    int64_t dataSize = 0;
+    for (int i = 0; i < numSegments; i++) {
+        dataSize += p[OGG_HEADER_SIZE + i];
+    }
+    return OGG_HEADER_SIZE + numSegments + dataSize;
+}
+
+}
+
+LdfReader::LdfReader()
+    : fd(-1), fileSize(0), sampleRate(0), numSamples(0)
+{
+}
+
+LdfReader::~LdfReader()
+{
+    close();
+}
+
+bool LdfReader::open(const std::string &filename, int numThreads)
+{
+    close();
+
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Could not open source file %s\n", filename.c_str());
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        fprintf(stderr, "Could not stat source file %s\n", filename.c_str());
+        close();
+        return false;
+    }
+    fileSize = st.st_size;
+
+    // Use the cached index if it's valid, otherwise build and cache a new one
+    const std::string indexFilename = filename + ".ldfidx";
+    const int64_t mtime = getMtime(st);
+    if (!loadIndex(indexFilename, mtime)) {
+        fprintf(stderr, "Building index of %s\n", filename.c_str());
+        if (!buildIndex()) {
+            close();
+            return false;
+        }
+        saveIndex(indexFilename, mtime);
+    }
+
+    // Create a FLAC decoder for each thread
+    if (numThreads <= 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+    avcodec_register_all();
+#endif
+    const AVCodec *codec = avcodec_find_decoder(AV_CODEC_ID_FLAC);
+    if (codec == nullptr) {
+        fprintf(stderr, "Failed to find FLAC codec\n");
+        close();
+        return false;
+    }
+
+    for (int i = 0; i < numThreads; i++) {
+        AVCodecContext *decoder = avcodec_alloc_context3(codec);
+        if (decoder == nullptr) {
+            fprintf(stderr, "Failed to allocate FLAC codec context\n");
+            close();
+            return false;
+        }
+        decoders.push_back(decoder);
+
+        decoder->extradata = static_cast<uint8_t *>(av_mallocz(STREAMINFO_SIZE + AV_INPUT_BUFFER_PADDING_SIZE));
+        if (decoder->extradata == nullptr) {
+            close();
+            return false;
+        }
+        memcpy(decoder->extradata, streamInfo.data(), STREAMINFO_SIZE);
+        decoder->extradata_size = STREAMINFO_SIZE;
+
+        if (avcodec_open2(decoder, codec, nullptr) < 0) {
+            fprintf(stderr, "Failed to open FLAC codec\n");
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void LdfReader::close()
+{
+    for (AVCodecContext *decoder: decoders) {
+        avcodec_free_context(&decoder);
+    }
+    decoders.clear();
+
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+
+    fileSize = 0;
+    sampleRate = 0;
+    numSamples = 0;
+    streamInfo.clear();
+    index.clear();
+}
+
+int64_t LdfReader::getSampleRate() const
+{
+    return sampleRate;
+}
+
+int64_t LdfReader::getNumSamples() const
+{
+    return numSamples;
+}
+
+int64_t LdfReader::read(int64_t startSample, int16_t *output, int64_t count)
+{
+    if (fd < 0 || startSample < 0 || count < 0) return -1;
+
+    // Clip the read to the end of the file
+    count = std::max(int64_t(0), std::min(count, numSamples - startSample));
+    if (count == 0 || index.empty()) return 0;
+    const int64_t endSample = startSample + count;
+
+    // Find the range of pages [firstEntry, lastEntry) that contains the samples
+    auto compare = [](int64_t sample, const IndexEntry &entry) { return sample < entry.firstSample; };
+    const size_t firstEntry = std::max(std::upper_bound(index.begin(), index.end(), startSample, compare) - index.begin(),
+                                       ptrdiff_t(1)) - 1;
+    const size_t lastEntry = std::upper_bound(index.begin(), index.end(), endSample - 1, compare) - index.begin();
+    const size_t numPages = lastEntry - firstEntry;
+
+    const size_t numJobs = std::min(decoders.size(), std::max(size_t(1), numPages / MIN_PAGES_PER_JOB));
+    if (numJobs == 1) {
+        return decodePages(decoders[0], firstEntry, lastEntry, startSample, output, count) ? count : -1;
+    }
+
+    // Split the pages between the decoding threads. Each thread writes a
+    // separate part of the output buffer.
+    std::atomic<bool> success(true);
+    std::vector<std::thread> threads;
+    for (size_t job = 0; job < numJobs; job++) {
+        const size_t jobFirst = firstEntry + ((numPages * job) / numJobs);
+        const size_t jobLast = firstEntry + ((numPages * (job + 1)) / numJobs);
+        AVCodecContext *decoder = decoders[job];
+
+        threads.emplace_back([=, &success] {
+            if (!decodePages(decoder, jobFirst, jobLast, startSample, output, count)) success = false;
+        });
+    }
+    for (std::thread &thread: threads) {
+        thread.join();
+    }
+
+    return success ? count : -1;
+}
+
+// Scan through the file, building the index of pages
+bool LdfReader::buildIndex()
+{
+    index.clear();
+    streamInfo.clear();
+
+    std::vector<uint8_t> window(SCAN_WINDOW_SIZE);
+    int64_t windowStart = 0;
+    int64_t windowSize = 0;
+
+    // Get a pointer to size bytes at offset, reading a new window if needed
+    auto getData = [&](int64_t offset, int64_t size) -> const uint8_t * {
+        if (offset < windowStart || (offset + size) > (windowStart + windowSize)) {
+            windowStart = offset;
+            windowSize = std::min(static_cast<int64_t>(window.size()), fileSize - offset);
+            if (!preadAll(fd, window.data(), windowSize, offset)) windowSize = 0;
+        }
+        if ((offset + size) > (windowStart + windowSize)) return nullptr;
+        return window.data() + (offset - windowStart);
+    };
+
+    // The number of samples in all the packets that ended before this page
+    int64_t lastGranule = 0;
+
+    int64_t offset = 0;
+    while (offset < fileSize) {
+        const uint8_t *header = getData(offset, std::min(OGG_HEADER_SIZE + 255, fileSize - offset));
+        const int64_t pageSize = (header == nullptr) ? -1 : getPageSize(header, fileSize - offset);
+        const uint8_t *page = (pageSize < 0) ? nullptr : getData(offset, pageSize);
+        if (page == nullptr) {
+            fprintf(stderr, "Invalid Ogg page at offset %lld\n", static_cast<long long>(offset));
+            return false;
+        }
+
+        const uint8_t flags = page[5];
+        const int64_t granule = readLE64(page + 6);
+        const int numSegments = page[26];
+        const uint8_t *data = page + OGG_HEADER_SIZE + numSegments;
+        const int64_t dataSize = pageSize - (OGG_HEADER_SIZE + numSegments);
+
+        if (streamInfo.empty()) {
+            // The first packet is the Ogg FLAC mapping header, which contains STREAMINFO
+            if (dataSize < static_cast<int64_t>(STREAMINFO_OFFSET + STREAMINFO_SIZE)
+                || data[0] != 0x7F || memcmp(data + 1, "FLAC", 4) != 0 || memcmp(data + 9, "fLaC", 4) != 0) {
+                fprintf(stderr, "Source file is not Ogg FLAC\n");
+                return false;
+            }
+            streamInfo.assign(data + STREAMINFO_OFFSET, data + STREAMINFO_OFFSET + STREAMINFO_SIZE);
+            sampleRate = (streamInfo[10] << 12) | (streamInfo[11] << 4) | (streamInfo[12] >> 4);
+        } else if ((flags & OGG_CONTINUED) == 0 && dataSize > 0 && data[0] == 0xFF) {
+            // This page starts with a new FLAC frame (which begins with a sync code)
+            index.push_back(IndexEntry {offset, lastGranule});
+        }
+
+        // The granule position is -1 if no packets end on this page
+        if (granule != -1) lastGranule = granule;
+
+        offset += pageSize;
+    }
+
+    if (streamInfo.empty()) {
+        fprintf(stderr, "Source file is not Ogg FLAC\n");
+        return false;
+    }
+
+    numSamples = lastGranule;
+    return true;
+}
+
+// Load a cached index, returning false if it's missing or out of date
+bool LdfReader::loadIndex(const std::string &indexFilename, int64_t mtime)
+{
+    FILE *f = fopen(indexFilename.c_str(), "rb");
+    if (f == nullptr) return false;
+
+    uint8_t header[INDEX_HEADER_SIZE];
+    const uint8_t *fields = header + sizeof INDEX_MAGIC;
+    bool valid = fread(header, sizeof header, 1, f) == 1
+                 && memcmp(header, INDEX_MAGIC, sizeof INDEX_MAGIC) == 0
+                 && readLE64(fields) == fileSize && readLE64(fields + 8) == mtime
+                 && readLE64(fields + 32) >= 0 && readLE64(fields + 32) <= fileSize;
+
+    std::vector<uint8_t> entries;
+    if (valid) {
+        entries.resize(readLE64(fields + 32) * INDEX_ENTRY_SIZE);
+        valid = entries.empty() || fread(entries.data(), entries.size(), 1, f) == 1;
+    }
+    fclose(f);
+    if (!valid) return false;
+
+    sampleRate = readLE64(fields + 16);
+    numSamples = readLE64(fields + 24);
+    streamInfo.assign(fields + (INDEX_HEADER_FIELDS * 8), fields + (INDEX_HEADER_FIELDS * 8) + STREAMINFO_SIZE);
+    index.resize(entries.size() / INDEX_ENTRY_SIZE);
+    for (size_t i = 0; i < index.size(); i++) {
+        index[i].offset = readLE64(entries.data() + (i * INDEX_ENTRY_SIZE));
+        index[i].firstSample = readLE64(entries.data() + (i * INDEX_ENTRY_SIZE) + 8);
+    }
+
+    return true;
+}
+
+// Save the index to a cache file. If the file can't be written (e.g. the
+// capture is on read-only media), print a warning and just keep the index in
+// memory.
+void LdfReader::saveIndex(const std::string &indexFilename, int64_t mtime) const
+{
+    std::vector<uint8_t> data(INDEX_HEADER_SIZE + (index.size() * INDEX_ENTRY_SIZE));
+    uint8_t *p = data.data();
+    memcpy(p, INDEX_MAGIC, sizeof INDEX_MAGIC);
+    p += sizeof INDEX_MAGIC;
+    for (int64_t field: {fileSize, mtime, sampleRate, numSamples, static_cast<int64_t>(index.size())}) {
+        writeLE64(p, field);
+        p += 8;
+    }
+    memcpy(p, streamInfo.data(), STREAMINFO_SIZE);
+    p += STREAMINFO_SIZE;
+    for (const IndexEntry &entry: index) {
+        writeLE64(p, entry.offset);
+        writeLE64(p + 8, entry.firstSample);
+        p += INDEX_ENTRY_SIZE;
+    }
+
+    // Write to a temporary file first, so a partial index is never seen
+    const std::string tempFilename = indexFilename + ".tmp";
+    FILE *f = fopen(tempFilename.c_str(), "wb");
+    bool success = f != nullptr;
+    if (success) {
+        success = fwrite(data.data(), data.size(), 1, f) == 1;
+        success = (fclose(f) == 0) && success;
+        success = success && rename(tempFilename.c_str(), indexFilename.c_str()) == 0;
+    }
+    const int error = errno;
+
+    if (!success) {
+        if (f != nullptr) unlink(tempFilename.c_str());
+        fprintf(stderr, "Could not write index file %s: %s\n", indexFilename.c_str(), strerror(error));
+        return;
+    }
+    fprintf(stderr, "Saved index to %s\n", indexFilename.c_str());
+}
+
+// Decode the pages [firstEntry, lastEntry), writing the samples that fall
+// within [startSample, startSample + count) into the corresponding part of
+// output. Returns false on error.
+bool LdfReader::decodePages(AVCodecContext *decoder, size_t firstEntry, size_t lastEntry,
+                            int64_t startSample, int16_t *output, int64_t count) const
+{
+    const int64_t endSample = startSample + count;
+
+    // Read all the pages at once. Every page in the index starts with a new
+    // packet, so the last packet in the range ends before lastEntry.
+    const int64_t beginOffset = index[firstEntry].offset;
+    const int64_t endOffset = (lastEntry < index.size()) ? index[lastEntry].offset : fileSize;
+    std::vector<uint8_t> pages(endOffset - beginOffset);
+    if (!preadAll(fd, pages.data(), pages.size(), beginOffset)) {
+        fprintf(stderr, "Error reading source file\n");
+        return false;
+    }
+
+    // The sample we need to decode up to
+    const int64_t rangeEnd = std::min(endSample, (lastEntry < index.size()) ? index[lastEntry].firstSample : numSamples);
+
+    AVPacket *packet = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    if (packet == nullptr || frame == nullptr) {
+        av_packet_free(&packet);
+        av_frame_free(&frame);
+        return false;
+    }
+    avcodec_flush_buffers(decoder);
+
+    // Receive decoded frames, copying the part of each that we want into output
+    int64_t sample = index[firstEntry].firstSample;
+    auto receiveFrames = [&]() -> bool {
+        while (true) {
+            const int ret = avcodec_receive_frame(decoder, frame);
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) return true;
+            if (ret < 0) return false;
+
+            if (frame->format != AV_SAMPLE_FMT_S16 && frame->format != AV_SAMPLE_FMT_S16P) {
+                fprintf(stderr, "Source file does not contain 16-bit samples\n");
+                return false;
+            }
+
+            const int64_t copyStart = std::max(sample, startSample);
+            const int64_t copyEnd = std::min(sample + frame->nb_samples, endSample);
+            if (copyEnd > copyStart) {
+                const int16_t *frameData = reinterpret_cast<const int16_t *>(frame->data[0]);
+                memcpy(output + (copyStart - startSample), frameData + (copyStart - sample),
+                       (copyEnd - copyStart) * sizeof(int16_t));
+            }
+            sample += frame->nb_samples;
+        }
+    };
+
+    // Reassemble packets from the pages' segments, and decode them
+    std::vector<uint8_t> packetData;
+    bool success = true;
+    int64_t offset = 0;
+    const int64_t pagesSize = pages.size();
+    while (success && offset < pagesSize && sample < rangeEnd) {
+        const uint8_t *page = pages.data() + offset;
+        const int64_t pageSize = getPageSize(page, pagesSize - offset);
+        if (pageSize < 0 || pageSize > (pagesSize - offset)) {
+            fprintf(stderr, "Invalid Ogg page at offset %lld\n", static_cast<long long>(beginOffset + offset));
+            success = false;
+            break;
+        }
+
+        const int numSegments = page[26];
+        const uint8_t *data = page + OGG_HEADER_SIZE + numSegments;
+        for (int i = 0; i < numSegments && success; i++) {
+            const int segmentSize = page[OGG_HEADER_SIZE + i];
+            packetData.insert(packetData.end(), data, data + segmentSize);
+            data += segmentSize;
+
+            // A segment shorter than 255 bytes ends the packet
+            if (segmentSize == 255) continue;
+
+            // Decode FLAC frames, ignoring any other packets
+            if (!packetData.empty() && packetData[0] == 0xFF) {
+                const int packetSize = static_cast<int>(packetData.size());
+                packetData.resize(packetSize + AV_INPUT_BUFFER_PADDING_SIZE, 0);
+                packet->data = packetData.data();
+                packet->size = packetSize;
+
+                success = avcodec_send_packet(decoder, packet) >= 0 && receiveFrames();
+            }
+            packetData.clear();
+        }
+
+        offset += pageSize;
+    }
+
+    // Drain the decoder
+    if (success) success = avcodec_send_packet(decoder, nullptr) >= 0 && receiveFrames();
+
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+
+    if (success && sample < rangeEnd) {
+        fprintf(stderr, "Source file ended unexpectedly\n");
+        success = false;
+    }
+    return success;
+}
+
+// C interface
+
+struct ldf_reader {
+    LdfReader reader;
+};
+
+ldf_reader *ldf_open(const char *filename, int num_threads)
+{
+    ldf_reader *reader = new ldf_reader;
+    if (!reader->reader.open(filename, num_threads)) {
+        delete reader;
+        return nullptr;
+    }
+    return reader;
+}
+
+void ldf_close(ldf_reader *reader)
+{
+    delete reader;
+}
+
+int64_t ldf_sample_rate(const ldf_reader *reader)
+{
+    return reader->reader.getSampleRate();
+}
+
+int64_t ldf_num_samples(const ldf_reader *reader)
+{
+    return reader->reader.getNumSamples();
+}
+
+int64_t ldf_read(ldf_reader *reader, int64_t start_sample, int16_t *output, int64_t count)
+{
+    return reader->reader.read(start_sample, output, count);
+}
@@ -0,0 +1,107 @@
+/************************************************************************
+
+    ldfreader.h
+
+    ld-ldf-reader - random-access reader for .ldf compressed RF captures
+    Copyright (C) 2020 The ld-decode project
+
+    This file is part of ld-decode.
+
+    ld-decode is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef LDFREADER_H
+#define LDFREADER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+
+#include <string>
+#include <vector>
+
+struct AVCodecContext;
+
+// Reader for .ldf files, which contain 16-bit mono FLAC audio in an Ogg
+// container.
+//
+// On opening a file, the reader builds an index of the Ogg pages that start
+// new FLAC frames, which allows any range of samples to be decoded without
+// decoding the file from the start. The index is cached alongside the file
+// (as <file>.ldfidx) so it only needs to be built once; the cache is rebuilt
+// if the file's size or modification time changes.
+//
+// FLAC frames are independent, so large reads are split into blocks that are
+// decoded in parallel, each writing directly into the caller's buffer.
+class LdfReader
+{
+public:
+    LdfReader();
+    ~LdfReader();
+
+    // Open a file. numThreads is the number of decoding threads to use; 0
+    // means use the number of CPUs. Returns false on failure.
+    bool open(const std::string &filename, int numThreads = 0);
+    void close();
+
+    int64_t getSampleRate() const;
+    int64_t getNumSamples() const;
+
+    // Decode count samples starting at startSample into output. Returns the
+    // number of samples decoded, which is less than count only at the end of
+    // the file, or -1 on error. Only one read may be in progress at a time.
+    int64_t read(int64_t startSample, int16_t *output, int64_t count);
+
+private:
+    // An Ogg page that begins with a new packet
+    struct IndexEntry {
+        int64_t offset;
+        int64_t firstSample;
+    };
+
+    int fd;
+    int64_t fileSize;
+    int64_t sampleRate;
+    int64_t numSamples;
+    std::vector<uint8_t> streamInfo;
+    std::vector<IndexEntry> index;
+    std::vector<AVCodecContext *> decoders;
+
+    bool buildIndex();
+    bool loadIndex(const std::string &indexFilename, int64_t mtime);
+    void saveIndex(const std::string &indexFilename, int64_t mtime) const;
+    bool decodePages(AVCodecContext *decoder, size_t firstEntry, size_t lastEntry,
+                     int64_t startSample, int16_t *output, int64_t count) const;
+};
+
+extern "C" {
+#endif
+
+// C interface, for use from Python (via ctypes) and other languages
+typedef struct ldf_reader ldf_reader;
+
+// Open a file, returning NULL on failure
+ldf_reader *ldf_open(const char *filename, int num_threads);
+void ldf_close(ldf_reader *reader);
+int64_t ldf_sample_rate(const ldf_reader *reader);
+int64_t ldf_num_samples(const ldf_reader *reader);
+// Decode samples into output, returning the number decoded or -1 on error
+int64_t ldf_read(ldf_reader *reader, int64_t start_sample, int16_t *output, int64_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LDFREADER_H
@@ -31,6 +31,7 @@ CaptureQualityIndexDialog::CaptureQualityIndexDialog(QWidget *parent) :
 {
     ui->setupUi(this);
     setWindowFlags(Qt::Window);
+    numberOfFields = 0;
     maxY = 0;
     minY = 100;
 
@@ -38,9 +39,15 @@ CaptureQualityIndexDialog::CaptureQualityIndexDialog(QWidget *parent) :
     plot = new QwtPlot();
     grid = new QwtPlotGrid();
     curve = new QwtPlotCurve();
+    rangeCurve = new QwtPlotIntervalCurve();
     points = new QPolygonF();
 
     ui->verticalLayout->addWidget(plot);
+
+    // Zoom and pan along the field axis, redrawing the graph at the matching
+    // resolution when the axis changes
+    graphView = new GraphPyramidView(plot, this);
+    connect(graphView, SIGNAL(visibleRangeChanged()), this, SLOT(scaleDivChanged()));
 }
 
 CaptureQualityIndexDialog::~CaptureQualityIndexDialog()
@@ -49,36 +56,19 @@ CaptureQualityIndexDialog::~CaptureQualityIndexDialog()
     delete ui;
 }
 
-// Get ready for an update
-void CaptureQualityIndexDialog::startUpdate()
-{
-    removeChartContents();
-    maxY = 0;
-    minY = 100;
-}
-
 // Remove the axes and series from the chart, giving ownership back to this object
 void CaptureQualityIndexDialog::removeChartContents()
 {
     points->clear();
+    ranges.clear();
     plot->replot();
 }
 
-// Add a data point to the chart
-void CaptureQualityIndexDialog::addDataPoint(qint32 fieldNumber, qreal cqi)
+// Set the source of the graph data, and show the whole source
+void CaptureQualityIndexDialog::setGraphPyramid(const GraphPyramid *_graphPyramid, qint32 _numberOfFields)
 {
-    points->append(QPointF(fieldNumber, cqi));
-
-    // Keep track of the maximum and minimum Y values
-    if (cqi > maxY) maxY = cqi;
-    if (cqi < minY) minY = cqi;
-}
-
-// Finish the update and render the graph
-void CaptureQualityIndexDialog::finishUpdate(qint32 numberOfFields, qint32 fieldsPerDataPoint)
-{
-    // Set the chart title
-    plot->setTitle("Capture Quality Index (averaged over " + QString::number(fieldsPerDataPoint) + " fields)");
+    graphView->setGraphPyramid(_graphPyramid);
+    numberOfFields = _numberOfFields;
 
     // Set the background and grid
     plot->setCanvasBackground(Qt::white);
@@ -89,21 +79,54 @@ void CaptureQualityIndexDialog::finishUpdate(qint32 numberOfFields, qint32 field
     plot->setAxisTitle(QwtPlot::xBottom, "Field number");
 
     // Define the y-axis
-    if (maxY < 10) plot->setAxisScale(QwtPlot::yLeft, minY, minY + 10);
-    else plot->setAxisScale(QwtPlot::yLeft, minY, maxY);
     plot->setAxisTitle(QwtPlot::yLeft, "Capture Quality Index (%)");
 
-    // Attach the curve data to the chart
+    // Attach the range and curve data to the chart
+    rangeCurve->setTitle("Capture Quality Index range");
+    rangeCurve->setPen(Qt::NoPen);
+    rangeCurve->setBrush(QColor(255, 0, 255, 48));
+    rangeCurve->attach(plot);
+
     curve->setTitle("Capture Quality Index");
     curve->setPen(Qt::magenta, 1);
     curve->setRenderHint(QwtPlotItem::RenderAntialiased, true);
-    curve->setSamples(*points);
     curve->attach(plot);
 
-    // Update the axis
-    plot->updateAxes();
+    updateGraph();
 
     // Render the chart
     plot->maximumSize();
     plot->show();
 }
+
+// Redraw the graph for the visible range of fields, using the pyramid level
+// that gives about one point per pixel
+void CaptureQualityIndexDialog::updateGraph()
+{
+    points->clear();
+    ranges.clear();
+    maxY = 0;
+    minY = 100;
+
+    const qint32 level = graphView->chooseLevel();
+    if (level != -1) {
+        graphView->addSeriesPoints(GraphPyramid::cqiSeries, level, *points, ranges, minY, maxY);
+
+        // Set the chart title
+        plot->setTitle("Capture Quality Index (averaged over " + QString::number(graphView->getFieldsPerBucket(level)) + " fields)");
+    }
+
+    // Define the y-axis
+    if (maxY < 10) plot->setAxisScale(QwtPlot::yLeft, minY, minY + 10);
+    else plot->setAxisScale(QwtPlot::yLeft, minY, maxY);
+
+    curve->setSamples(*points);
+    rangeCurve->setSamples(ranges);
+    plot->replot();
+}
+
+// The visible range of fields has changed
+void CaptureQualityIndexDialog::scaleDivChanged()
+{
+    updateGraph();
+}
@@ -31,8 +31,11 @@
 #include <qwt_legend.h>
 #include <qwt_plot_grid.h>
 #include <qwt_plot_curve.h>
+#include <qwt_plot_intervalcurve.h>
 
 #include "lddecodemetadata.h"
+#include "graphpyramid.h"
+#include "graphpyramidview.h"
 
 namespace Ui {
 class CaptureQualityIndexDialog;
@@ -46,9 +49,11 @@ public:
     explicit CaptureQualityIndexDialog(QWidget *parent = nullptr);
     ~CaptureQualityIndexDialog();
 
-    void startUpdate();
-    void addDataPoint(qint32 fieldNumber, qreal cqi);
-    void finishUpdate(qint32 numberOfFields, qint32 fieldsPerDataPoint);
+    void setGraphPyramid(const GraphPyramid *_graphPyramid, qint32 _numberOfFields);
+    void updateGraph();
+
+private slots:
+    void scaleDivChanged();
 
 private:
     void removeChartContents();
@@ -59,7 +64,11 @@ private:
     QwtPlotGrid *grid;
     QPolygonF *points;
     QwtPlotCurve *curve;
+    QVector<QwtIntervalSample> ranges;
+    QwtPlotIntervalCurve *rangeCurve;
+    GraphPyramidView *graphView;
 
+    qint32 numberOfFields;
     qreal maxY;
     qreal minY;
 };
@@ -31,15 +31,22 @@ DropoutAnalysisDialog::DropoutAnalysisDialog(QWidget *parent) :
 {
     ui->setupUi(this);
     setWindowFlags(Qt::Window);
+    numberOfFields = 0;
     maxY = 0;
 
     // Set up the chart view
     plot = new QwtPlot();
     grid = new QwtPlotGrid();
     curve = new QwtPlotCurve();
+    rangeCurve = new QwtPlotIntervalCurve();
     points = new QPolygonF();
 
     ui->verticalLayout->addWidget(plot);
+
+    // Zoom and pan along the field axis, redrawing the graph at the matching
+    // resolution when the axis changes
+    graphView = new GraphPyramidView(plot, this);
+    connect(graphView, SIGNAL(visibleRangeChanged()), this, SLOT(scaleDivChanged()));
 }
 
 DropoutAnalysisDialog::~DropoutAnalysisDialog()
@@ -48,34 +55,19 @@ DropoutAnalysisDialog::~DropoutAnalysisDialog()
     delete ui;
 }
 
-// Get ready for an update
-void DropoutAnalysisDialog::startUpdate()
-{
-    removeChartContents();
-    maxY = 0;
-}
-
 // Remove the axes and series from the chart, giving ownership back to this object
 void DropoutAnalysisDialog::removeChartContents()
 {
     points->clear();
+    ranges.clear();
     plot->replot();
 }
 
-// Add a data point to the chart
-void DropoutAnalysisDialog::addDataPoint(qint32 fieldNumber, qreal doLength)
+// Set the source of the graph data, and show the whole source
+void DropoutAnalysisDialog::setGraphPyramid(const GraphPyramid *_graphPyramid, qint32 _numberOfFields)
 {
-    points->append(QPointF(fieldNumber, doLength));
-
-    // Keep track of the maximum Y value
-    if (doLength > maxY) maxY = doLength;
-}
-
-// Finish the update and render the graph
-void DropoutAnalysisDialog::finishUpdate(qint32 numberOfFields, qint32 fieldsPerDataPoint)
-{
-    // Set the chart title
-    plot->setTitle("Dropout loss analysis (averaged over " + QString::number(fieldsPerDataPoint) + " fields)");
+    graphView->setGraphPyramid(_graphPyramid);
+    numberOfFields = _numberOfFields;
 
     // Set the background and grid
     plot->setCanvasBackground(Qt::white);
@@ -86,23 +78,55 @@ void DropoutAnalysisDialog::finishUpdate(qint32 numberOfFields, qint32 fieldsPer
     plot->setAxisTitle(QwtPlot::xBottom, "Field number");
 
     // Define the y-axis
-    if (maxY < 10) plot->setAxisScale(QwtPlot::yLeft, 0, 10);
-    else plot->setAxisScale(QwtPlot::yLeft, 0, maxY);
     plot->setAxisTitle(QwtPlot::yLeft, "Dropout length (in dots)");
 
-    // Attach the curve data to the chart
+    // Attach the range and curve data to the chart
+    rangeCurve->setTitle("Dropout length range");
+    rangeCurve->setPen(Qt::NoPen);
+    rangeCurve->setBrush(QColor(0, 0, 255, 48));
+    rangeCurve->attach(plot);
+
     curve->setTitle("Dropout length");
     curve->setPen(Qt::blue, 1);
     curve->setRenderHint(QwtPlotItem::RenderAntialiased, true);
-    curve->setSamples(*points);
     curve->attach(plot);
 
-    // Update the axis
-    plot->updateAxes();
+    updateGraph();
 
     // Render the chart
     plot->maximumSize();
     plot->show();
 }
 
+// Redraw the graph for the visible range of fields, using the pyramid level
+// that gives about one point per pixel
+void DropoutAnalysisDialog::updateGraph()
+{
+    points->clear();
+    ranges.clear();
+    maxY = 0;
+
+    const qint32 level = graphView->chooseLevel();
+    if (level != -1) {
+        // The y-axis always starts from 0, so only the maximum is needed
+        qreal minY = 0;
+        graphView->addSeriesPoints(GraphPyramid::dropoutSeries, level, *points, ranges, minY, maxY);
+
+        // Set the chart title
+        plot->setTitle("Dropout loss analysis (averaged over " + QString::number(graphView->getFieldsPerBucket(level)) + " fields)");
+    }
+
+    // Define the y-axis
+    if (maxY < 10) plot->setAxisScale(QwtPlot::yLeft, 0, 10);
+    else plot->setAxisScale(QwtPlot::yLeft, 0, maxY);
 
+    curve->setSamples(*points);
+    rangeCurve->setSamples(ranges);
+    plot->replot();
+}
+
+// The visible range of fields has changed
+void DropoutAnalysisDialog::scaleDivChanged()
+{
+    updateGraph();
+}
@@ -0,0 +1,303 @@
+/************************************************************************
+
+    fieldsummaryindex.cpp
+
+    ld-analyse - TBC output analysis
+    Copyright (C) 2020 Simon Inns
+
+    This file is part of ld-decode-tools.
+
+    ld-analyse is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "fieldsummaryindex.h"
+
+#include <cstring>
+
+// Definitions of static constexpr data members, for compatibility with
+// pre-C++17 compilers
+constexpr qint32 FieldSummaryIndex::CHAPTER_CHECK_FRAMES;
+
+// Sidecar file identifier; change the last character if the format changes
+static const char INDEX_MAGIC[8] = {'L', 'D', 'A', 'I', 'D', 'X', '0', '1'};
+
+FieldSummaryIndex::FieldSummaryIndex()
+{
+    mappedIndex = nullptr;
+    fieldSummaries = nullptr;
+    numberOfFields = 0;
+}
+
+FieldSummaryIndex::~FieldSummaryIndex()
+{
+    close();
+}
+
+// Load the index for a JSON metadata file from its sidecar, or build it from
+// the metadata (and save the sidecar) if the sidecar is missing or out of date
+void FieldSummaryIndex::open(QString jsonFileName, LdDecodeMetaData &ldDecodeMetaData)
+{
+    close();
+
+    QFileInfo jsonFileInfo(jsonFileName);
+    const qint64 jsonSize = jsonFileInfo.size();
+    const qint64 jsonModified = jsonFileInfo.lastModified().toMSecsSinceEpoch();
+    const QString indexFileName = jsonFileName + ".ldaidx";
+
+    if (loadIndex(indexFileName, jsonSize, jsonModified, ldDecodeMetaData.getNumberOfFields())) {
+        qDebug() << "FieldSummaryIndex::open(): Using field summary index" << indexFileName;
+        return;
+    }
+
+    qDebug() << "FieldSummaryIndex::open(): Building field summary index from metadata";
+    buildIndex(ldDecodeMetaData);
+    saveIndex(indexFileName, jsonSize, jsonModified);
+}
+
+void FieldSummaryIndex::close()
+{
+    if (mappedIndex != nullptr) {
+        indexFile.unmap(mappedIndex);
+        mappedIndex = nullptr;
+    }
+    if (indexFile.isOpen()) indexFile.close();
+
+    builtSummaries.clear();
+    chapterMap.clear();
+    fieldSummaries = nullptr;
+    numberOfFields = 0;
+}
+
+qint32 FieldSummaryIndex::getNumberOfFields() const
+{
+    return numberOfFields;
+}
+
+// Get the summary for a field (numbered from 1, as in the metadata)
+const FieldSummaryIndex::FieldSummary &FieldSummaryIndex::getFieldSummary(qint32 fieldNumber) const
+{
+    return fieldSummaries[fieldNumber - 1];
+}
+
+// Get the frame numbers at which chapters start
+const QVector<qint32> &FieldSummaryIndex::getChapterMap() const
+{
+    return chapterMap;
+}
+
+// Map an existing sidecar file, returning false if it doesn't exist or
+// doesn't match the JSON metadata
+bool FieldSummaryIndex::loadIndex(QString indexFileName, qint64 jsonSize, qint64 jsonModified, qint32 expectedFields)
+{
+    indexFile.setFileName(indexFileName);
+    if (!indexFile.open(QIODevice::ReadOnly)) return false;
+
+    const qint64 indexSize = indexFile.size();
+    if (indexSize < static_cast<qint64>(sizeof(IndexHeader))) {
+        indexFile.close();
+        return false;
+    }
+
+    mappedIndex = indexFile.map(0, indexSize);
+    if (mappedIndex == nullptr) {
+        indexFile.close();
+        return false;
+    }
+
+    IndexHeader header;
+    memcpy(&header, mappedIndex, sizeof(IndexHeader));
+
+    const qint64 expectedSize = static_cast<qint64>(sizeof(IndexHeader))
+                                + (static_cast<qint64>(header.numberOfFields) * static_cast<qint64>(sizeof(FieldSummary)))
+                                + (static_cast<qint64>(header.numberOfChapters) * static_cast<qint64>(sizeof(qint32)));
+
+    if (memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0
+        || header.jsonSize != jsonSize || header.jsonModified != jsonModified
+        || header.numberOfFields != expectedFields || header.numberOfChapters < 0
+        || expectedSize != indexSize) {
+        qDebug() << "FieldSummaryIndex::loadIndex(): Field summary index" << indexFileName << "is out of date";
+        indexFile.unmap(mappedIndex);
+        mappedIndex = nullptr;
+        indexFile.close();
+        return false;
+    }
+
+    // The summaries are used in place; the chapter map is small, so copy it
+    numberOfFields = header.numberOfFields;
+    fieldSummaries = reinterpret_cast<const FieldSummary *>(mappedIndex + sizeof(IndexHeader));
+
+    const uchar *chapterData = mappedIndex + sizeof(IndexHeader) + (numberOfFields * sizeof(FieldSummary));
+    chapterMap.resize(header.numberOfChapters);
+    memcpy(chapterMap.data(), chapterData, header.numberOfChapters * sizeof(qint32));
+
+    return true;
+}
+
+// Write the sidecar file. Failing to write it isn't an error (the directory
+// may be read-only); the index will just be rebuilt next time.
+void FieldSummaryIndex::saveIndex(QString indexFileName, qint64 jsonSize, qint64 jsonModified)
+{
+    IndexHeader header;
+    memset(&header, 0, sizeof(IndexHeader));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.jsonSize = jsonSize;
+    header.jsonModified = jsonModified;
+    header.numberOfFields = numberOfFields;
+    header.numberOfChapters = chapterMap.size();
+
+    QFile outputFile(indexFileName);
+    if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "FieldSummaryIndex::saveIndex(): Could not create" << indexFileName << "- not saving field summary index";
+        return;
+    }
+
+    const qint64 summariesLength = static_cast<qint64>(numberOfFields) * static_cast<qint64>(sizeof(FieldSummary));
+    const qint64 chaptersLength = static_cast<qint64>(chapterMap.size()) * static_cast<qint64>(sizeof(qint32));
+
+    if (outputFile.write(reinterpret_cast<const char *>(&header), sizeof(IndexHeader)) != sizeof(IndexHeader)
+        || outputFile.write(reinterpret_cast<const char *>(builtSummaries.constData()), summariesLength) != summariesLength
+        || outputFile.write(reinterpret_cast<const char *>(chapterMap.constData()), chaptersLength) != chaptersLength) {
+        // Remove the partial file, so it isn't mistaken for a valid index
+        qDebug() << "FieldSummaryIndex::saveIndex(): Writing" << indexFileName << "failed";
+        outputFile.close();
+        outputFile.remove();
+        return;
+    }
+
+    outputFile.close();
+}
+
+// Build the index from the metadata, spreading the work across all CPUs
+void FieldSummaryIndex::buildIndex(LdDecodeMetaData &ldDecodeMetaData)
+{
+    numberOfFields = ldDecodeMetaData.getNumberOfFields();
+    const qint32 numberOfFrames = ldDecodeMetaData.getNumberOfFrames();
+    const qint32 numberOfThreads = qMax(1, QThread::idealThreadCount());
+
+    // Reading from LdDecodeMetaData doesn't modify it, so the workers can
+    // share it. Each worker writes to its own range of the output vectors.
+    builtSummaries.resize(numberOfFields);
+    fieldSummaries = builtSummaries.constData();
+    QVector<qint32> frameChapters(numberOfFrames, -1);
+
+    // Summarise the fields, and meanwhile look for chapter numbers at the
+    // start of the disc
+    QVector<QFuture<void>> futures;
+    for (qint32 i = 0; i < numberOfThreads; i++) {
+        const qint32 firstField = 1 + static_cast<qint32>((static_cast<qint64>(numberOfFields) * i) / numberOfThreads);
+        const qint32 lastField = static_cast<qint32>((static_cast<qint64>(numberOfFields) * (i + 1)) / numberOfThreads);
+        if (firstField > lastField) continue;
+
+        futures.append(QtConcurrent::run(&FieldSummaryIndex::summariseFields, &ldDecodeMetaData,
+                                         builtSummaries.data(), firstField, lastField));
+    }
+    const qint32 checkFrames = qMin(CHAPTER_CHECK_FRAMES, numberOfFrames);
+    futures.append(QtConcurrent::run(&FieldSummaryIndex::findChapterNumbers, &ldDecodeMetaData,
+                                     frameChapters.data(), 1, checkFrames));
+    for (qint32 i = 0; i < futures.size(); i++) futures[i].waitForFinished();
+    futures.clear();
+
+    // Count repeated chapter numbers at the start of the disc; if there
+    // aren't enough, the disc doesn't have a usable chapter map
+    qint32 lastChapter = -1;
+    qint32 giveUpCounter = 0;
+    for (qint32 i = 1; i <= checkFrames; i++) {
+        qint32 currentChapter = frameChapters[i - 1];
+        if (currentChapter != -1) {
+            if (currentChapter != lastChapter) lastChapter = currentChapter;
+            else giveUpCounter++;
+        }
+    }
+    const bool haveChapters = checkFrames < CHAPTER_CHECK_FRAMES || giveUpCounter >= 50;
+
+    // Find the chapter numbers for the rest of the disc
+    if (haveChapters && numberOfFrames > checkFrames) {
+        const qint32 remainingFrames = numberOfFrames - checkFrames;
+        for (qint32 i = 0; i < numberOfThreads; i++) {
+            const qint32 firstFrame = checkFrames + 1 + static_cast<qint32>((static_cast<qint64>(remainingFrames) * i) / numberOfThreads);
+            const qint32 lastFrame = checkFrames + static_cast<qint32>((static_cast<qint64>(remainingFrames) * (i + 1)) / numberOfThreads);
+            if (firstFrame > lastFrame) continue;
+
+            futures.append(QtConcurrent::run(&FieldSummaryIndex::findChapterNumbers, &ldDecodeMetaData,
+                                             frameChapters.data(), firstFrame, lastFrame));
+        }
+        for (qint32 i = 0; i < futures.size(); i++) futures[i].waitForFinished();
+    }
+
+    // Generate the chapter map
+    lastChapter = -1;
+    giveUpCounter = 0;
+    chapterMap.clear();
+    for (qint32 i = 1; i <= numberOfFrames; i++) {
+        qint32 currentChapter = frameChapters[i - 1];
+        if (currentChapter != -1) {
+            if (currentChapter != lastChapter) {
+                lastChapter = currentChapter;
+                chapterMap.append(i);
+            } else giveUpCounter++;
+        }
+
+        if (i == CHAPTER_CHECK_FRAMES && giveUpCounter < 50) {
+            qDebug() << "Not seeing valid chapter numbers, giving up chapter mapping";
+            break;
+        }
+    }
+}
+
+// Worker: summarise fields firstField to lastField (inclusive)
+void FieldSummaryIndex::summariseFields(LdDecodeMetaData *ldDecodeMetaData, FieldSummary *summaries,
+                                        qint32 firstField, qint32 lastField)
+{
+    for (qint32 fieldNumber = firstField; fieldNumber <= lastField; fieldNumber++) {
+        LdDecodeMetaData::Field field = ldDecodeMetaData->getField(fieldNumber);
+        FieldSummary &summary = summaries[fieldNumber - 1];
+
+        // Calculate the total length of the dropouts
+        summary.dropoutLength = 0;
+        for (qint32 i = 0; i < field.dropOuts.startx.size(); i++) {
+            summary.dropoutLength += field.dropOuts.endx[i] - field.dropOuts.startx[i];
+        }
+
+        // Get the SNRs
+        summary.blackSnr = 0;
+        summary.whiteSnr = 0;
+        if (field.vitsMetrics.inUse) {
+            if (field.vitsMetrics.bPSNR > 0) summary.blackSnr = field.vitsMetrics.bPSNR;
+            if (field.vitsMetrics.wSNR > 0) summary.whiteSnr = field.vitsMetrics.wSNR;
+        }
+
+        summary.syncConf = static_cast<double>(field.syncConf);
+    }
+}
+
+// Worker: find the chapter numbers for frames firstFrame to lastFrame
+// (inclusive), or -1 where there isn't one
+void FieldSummaryIndex::findChapterNumbers(LdDecodeMetaData *ldDecodeMetaData, qint32 *frameChapters,
+                                           qint32 firstFrame, qint32 lastFrame)
+{
+    VbiDecoder vbiDecoder;
+
+    for (qint32 frameNumber = firstFrame; frameNumber <= lastFrame; frameNumber++) {
+        qint32 firstFieldNumber = ldDecodeMetaData->getFirstFieldNumber(frameNumber);
+        qint32 secondFieldNumber = ldDecodeMetaData->getSecondFieldNumber(frameNumber);
+        if (firstFieldNumber == -1 || secondFieldNumber == -1) continue;
+
+        LdDecodeMetaData::Vbi firstField = ldDecodeMetaData->getFieldVbi(firstFieldNumber);
+        LdDecodeMetaData::Vbi secondField = ldDecodeMetaData->getFieldVbi(secondFieldNumber);
+
+        frameChapters[frameNumber - 1] = vbiDecoder.decodeFrame(firstField.vbiData[0], firstField.vbiData[1], firstField.vbiData[2],
+                                                                secondField.vbiData[0], secondField.vbiData[1], secondField.vbiData[2]).chNo;
+    }
+}
@@ -0,0 +1,100 @@
+/************************************************************************
+
+    fieldsummaryindex.h
+
+    ld-analyse - TBC output analysis
+    Copyright (C) 2020 Simon Inns
+
+    This file is part of ld-decode-tools.
+
+    ld-analyse is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef FIELDSUMMARYINDEX_H
+#define FIELDSUMMARYINDEX_H
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QVector>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+#include <QDebug>
+
+// TBC library includes
+#include "lddecodemetadata.h"
+#include "vbidecoder.h"
+
+// Per-field statistics used by the analysis graphs, and the disc's chapter
+// map, computed from the JSON metadata.
+//
+// Gathering these means reading every field from the metadata, which is slow
+// for long captures, so the results are saved in a sidecar file next to the
+// JSON (<file>.json.ldaidx). The sidecar records the size and modification
+// time of the JSON it was built from; when these match, it is memory-mapped
+// rather than rebuilt.
+class FieldSummaryIndex
+{
+public:
+    FieldSummaryIndex();
+    ~FieldSummaryIndex();
+
+    struct FieldSummary {
+        double dropoutLength;
+        double blackSnr;    // 0 if not available
+        double whiteSnr;    // 0 if not available
+        double syncConf;
+    };
+
+    void open(QString jsonFileName, LdDecodeMetaData &ldDecodeMetaData);
+    void close();
+
+    qint32 getNumberOfFields() const;
+    const FieldSummary &getFieldSummary(qint32 fieldNumber) const;
+    const QVector<qint32> &getChapterMap() const;
+
+private:
+    // Sidecar file header; followed by numberOfFields FieldSummary entries
+    // and numberOfChapters qint32 chapter start frames
+    struct IndexHeader {
+        char magic[8];
+        qint64 jsonSize;
+        qint64 jsonModified;
+        qint32 numberOfFields;
+        qint32 numberOfChapters;
+    };
+
+    // Number of frames to check for chapter numbers before giving up
+    static constexpr qint32 CHAPTER_CHECK_FRAMES = 100;
+
+    QFile indexFile;
+    uchar *mappedIndex;
+    const FieldSummary *fieldSummaries;
+    qint32 numberOfFields;
+    QVector<qint32> chapterMap;
+
+    // Storage for summaries built in memory (rather than mapped)
+    QVector<FieldSummary> builtSummaries;
+
+    bool loadIndex(QString indexFileName, qint64 jsonSize, qint64 jsonModified, qint32 expectedFields);
+    void saveIndex(QString indexFileName, qint64 jsonSize, qint64 jsonModified);
+    void buildIndex(LdDecodeMetaData &ldDecodeMetaData);
+    static void summariseFields(LdDecodeMetaData *ldDecodeMetaData, FieldSummary *summaries,
+                                qint32 firstField, qint32 lastField);
+    static void findChapterNumbers(LdDecodeMetaData *ldDecodeMetaData, qint32 *frameChapters,
+                                   qint32 firstFrame, qint32 lastFrame);
+};
+
+#endif // FIELDSUMMARYINDEX_H
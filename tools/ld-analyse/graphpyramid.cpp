@@ -0,0 +1,174 @@
+/************************************************************************
+
+    graphpyramid.cpp
+
+    ld-analyse - TBC output analysis
+    Copyright (C) 2020 Simon Inns
+
+    This file is part of ld-decode-tools.
+
+    ld-analyse is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "graphpyramid.h"
+
+#include <cmath>
+
+// Definitions of static constexpr data members, for compatibility with
+// pre-C++17 compilers
+constexpr qint32 GraphPyramid::FANOUT;
+
+GraphPyramid::GraphPyramid(QObject *parent) : QObject(parent)
+{
+    numberOfLevels = 0;
+}
+
+// Calculate the Capture Quality Index for a single field
+static qreal fieldCaptureQualityIndex(const FieldSummaryIndex::FieldSummary &summary, qint32 totalDotsPerField)
+{
+    qreal fieldDoPercent = 100.0 - (summary.dropoutLength / static_cast<qreal>(totalDotsPerField));
+    qreal snrPercent = 0;
+
+    // Convert SNR to linear
+    qreal whiteSnrLinear = pow(summary.whiteSnr / 20, 10);
+    qreal blackSnrLinear = pow(summary.blackSnr / 20, 10);
+    qreal snrReferenceLinear = pow(43.0 / 20, 10); // Note: 43 dB is the expected maximum
+
+    if (summary.whiteSnr != 0) snrPercent = (100.0 / (snrReferenceLinear * 2)) * (blackSnrLinear + whiteSnrLinear);
+    else snrPercent = (100.0 / snrReferenceLinear) * blackSnrLinear;
+    if (snrPercent > 100.0) snrPercent = 100.0;
+
+    // Note: The weighting is 1000:1:1 - this is just because dropouts have a greater visual effect
+    // on the resulting capture than SNR.
+    return ((fieldDoPercent * 1000.0) + snrPercent + summary.syncConf) / 1002.0;
+}
+
+// Make a level 0 bucket for a single value
+static GraphPyramid::Bucket singleBucket(qreal value, bool isPresent)
+{
+    GraphPyramid::Bucket bucket;
+    bucket.min = isPresent ? static_cast<float>(value) : 0;
+    bucket.max = bucket.min;
+    bucket.sum = bucket.min;
+    bucket.count = isPresent ? 1 : 0;
+    return bucket;
+}
+
+// Build the pyramid from the per-field summaries. This is intended to be
+// run in a background thread; each level is published as it's completed.
+void GraphPyramid::build(const FieldSummaryIndex *fieldSummaryIndex, qint32 totalDotsPerField)
+{
+    const qint32 numberOfFields = fieldSummaryIndex->getNumberOfFields();
+
+    // Work out how many levels are needed to get down to a single bucket
+    qint32 totalLevels = 1;
+    for (qint64 fieldsPerBucket = 1; fieldsPerBucket < numberOfFields; fieldsPerBucket *= FANOUT) totalLevels++;
+
+    for (qint32 series = 0; series < numberOfSeries; series++) {
+        levels[series].resize(totalLevels);
+    }
+
+    // Level 0: one bucket per field
+    for (qint32 series = 0; series < numberOfSeries; series++) {
+        levels[series][0].resize(numberOfFields);
+    }
+    for (qint32 i = 0; i < numberOfFields; i++) {
+        const FieldSummaryIndex::FieldSummary &summary = fieldSummaryIndex->getFieldSummary(i + 1);
+
+        levels[dropoutSeries][0][i] = singleBucket(summary.dropoutLength, true);
+        levels[blackSnrSeries][0][i] = singleBucket(summary.blackSnr, summary.blackSnr > 0);
+        levels[whiteSnrSeries][0][i] = singleBucket(summary.whiteSnr, summary.whiteSnr > 0);
+        levels[cqiSeries][0][i] = singleBucket(fieldCaptureQualityIndex(summary, totalDotsPerField), true);
+    }
+    numberOfLevels.storeRelease(1);
+    emit levelsChanged();
+
+    // Higher levels: combine FANOUT buckets from the level below
+    for (qint32 level = 1; level < totalLevels; level++) {
+        for (qint32 series = 0; series < numberOfSeries; series++) {
+            const QVector<Bucket> &below = levels[series][level - 1];
+            QVector<Bucket> &current = levels[series][level];
+            current.resize((below.size() + FANOUT - 1) / FANOUT);
+
+            for (qint32 i = 0; i < current.size(); i++) {
+                Bucket bucket;
+                bucket.min = 0;
+                bucket.max = 0;
+                bucket.sum = 0;
+                bucket.count = 0;
+
+                const qint32 end = qMin((i + 1) * FANOUT, below.size());
+                for (qint32 j = i * FANOUT; j < end; j++) {
+                    const Bucket &source = below[j];
+                    if (source.count == 0) continue;
+
+                    if (bucket.count == 0 || source.min < bucket.min) bucket.min = source.min;
+                    if (bucket.count == 0 || source.max > bucket.max) bucket.max = source.max;
+                    bucket.sum += source.sum;
+                    bucket.count += source.count;
+                }
+
+                current[i] = bucket;
+            }
+        }
+
+        numberOfLevels.storeRelease(level + 1);
+        emit levelsChanged();
+    }
+}
+
+// Discard the pyramid. This must not be called while build() is running.
+void GraphPyramid::clear()
+{
+    numberOfLevels.storeRelease(0);
+    for (qint32 series = 0; series < numberOfSeries; series++) {
+        levels[series].clear();
+    }
+}
+
+// Get the number of levels that are ready for use
+qint32 GraphPyramid::getNumberOfLevels() const
+{
+    return numberOfLevels.loadAcquire();
+}
+
+qint32 GraphPyramid::getFieldsPerBucket(qint32 level) const
+{
+    qint32 fieldsPerBucket = 1;
+    for (qint32 i = 0; i < level; i++) fieldsPerBucket *= FANOUT;
+    return fieldsPerBucket;
+}
+
+// Choose the finest level that shows the fields from firstField to lastField
+// in no more than targetBuckets buckets (or the coarsest level available, if
+// none do). Returns -1 if no levels are ready yet.
+qint32 GraphPyramid::chooseLevel(qreal firstField, qreal lastField, qint32 targetBuckets) const
+{
+    const qint32 availableLevels = getNumberOfLevels();
+    if (availableLevels == 0) return -1;
+
+    const qreal visibleFields = lastField - firstField;
+    qint32 level = 0;
+    while (level + 1 < availableLevels && (visibleFields / getFieldsPerBucket(level)) > targetBuckets) level++;
+
+    return level;
+}
+
+// Get the buckets for a level; bucket n covers fields from
+// (n * getFieldsPerBucket(level)) + 1
+const QVector<GraphPyramid::Bucket> &GraphPyramid::getBuckets(Series series, qint32 level) const
+{
+    return levels[series][level];
+}
@@ -0,0 +1,89 @@
+/************************************************************************
+
+    graphpyramid.h
+
+    ld-analyse - TBC output analysis
+    Copyright (C) 2020 Simon Inns
+
+    This file is part of ld-decode-tools.
+
+    ld-analyse is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef GRAPHPYRAMID_H
+#define GRAPHPYRAMID_H
+
+#include <QObject>
+#include <QVector>
+#include <QAtomicInt>
+#include <QDebug>
+
+#include "fieldsummaryindex.h"
+
+// Multi-resolution min/max/mean statistics for the analysis graphs.
+//
+// Level 0 has one bucket per field; each level above it combines FANOUT
+// buckets from the level below, so level n has FANOUT^n fields per bucket.
+// A graph showing a range of fields can then pick the level that gives
+// about one bucket per pixel, whatever the zoom.
+//
+// The pyramid is built in a background thread, one level at a time.
+// levelsChanged() is emitted each time a level becomes available.
+class GraphPyramid : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GraphPyramid(QObject *parent = nullptr);
+
+    enum Series {
+        dropoutSeries = 0,
+        blackSnrSeries,
+        whiteSnrSeries,
+        cqiSeries,
+        numberOfSeries
+    };
+
+    // Statistics for a range of fields. Fields without a value for a series
+    // (e.g. missing SNR) aren't counted.
+    struct Bucket {
+        float min;
+        float max;
+        float sum;
+        qint32 count;
+
+        qreal mean() const { return static_cast<qreal>(sum) / count; }
+    };
+
+    static constexpr qint32 FANOUT = 4;
+
+    void build(const FieldSummaryIndex *fieldSummaryIndex, qint32 totalDotsPerField);
+    void clear();
+
+    qint32 getNumberOfLevels() const;
+    qint32 getFieldsPerBucket(qint32 level) const;
+    qint32 chooseLevel(qreal firstField, qreal lastField, qint32 targetBuckets) const;
+    const QVector<Bucket> &getBuckets(Series series, qint32 level) const;
+
+signals:
+    void levelsChanged();
+
+private:
+    // levels[series][level]; the outer vectors are sized before any level is
+    // published, so readers never see them reallocated
+    QVector<QVector<Bucket>> levels[numberOfSeries];
+    QAtomicInt numberOfLevels;
+};
+
+#endif // GRAPHPYRAMID_H
@@ -0,0 +1,94 @@
+/************************************************************************
+
+    graphpyramidview.cpp
+
+    ld-analyse - TBC output analysis
+    Copyright (C) 2020 Simon Inns
+
+    This file is part of ld-decode-tools.
+
+    ld-analyse is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "graphpyramidview.h"
+
+#include <qwt_scale_widget.h>
+
+GraphPyramidView::GraphPyramidView(QwtPlot *_plot, QObject *parent)
+    : QObject(parent), plot(_plot), graphPyramid(nullptr)
+{
+    // Zoom (with the mouse wheel) and pan (by dragging) along the field axis.
+    // The magnifier and panner are owned by the canvas.
+    magnifier = new QwtPlotMagnifier(plot->canvas());
+    magnifier->setAxisEnabled(QwtPlot::yLeft, false);
+    panner = new QwtPlotPanner(plot->canvas());
+    panner->setAxisEnabled(QwtPlot::yLeft, false);
+
+    // Tell the dialog to redraw the graph at the matching resolution when the
+    // axis changes. This is queued, so the redraw doesn't happen while the
+    // plot is still updating the axis.
+    connect(plot->axisWidget(QwtPlot::xBottom), SIGNAL(scaleDivChanged()), this, SIGNAL(visibleRangeChanged()),
+            Qt::QueuedConnection);
+}
+
+// Set the source of the graph data (which may be nullptr)
+void GraphPyramidView::setGraphPyramid(const GraphPyramid *_graphPyramid)
+{
+    graphPyramid = _graphPyramid;
+}
+
+// Return the pyramid level for the visible range of fields that gives about
+// one point per pixel, or -1 if there's no data to show yet
+qint32 GraphPyramidView::chooseLevel() const
+{
+    if (graphPyramid == nullptr) return -1;
+
+    const QwtScaleDiv &xScale = plot->axisScaleDiv(QwtPlot::xBottom);
+    const qint32 targetPoints = qMax(plot->canvas()->width(), 1000);
+    return graphPyramid->chooseLevel(xScale.lowerBound(), xScale.upperBound(), targetPoints);
+}
+
+qint32 GraphPyramidView::getFieldsPerBucket(qint32 level) const
+{
+    return graphPyramid->getFieldsPerBucket(level);
+}
+
+// Add the means and ranges for the visible range of fields from one series,
+// at a level returned by chooseLevel. minY and maxY are extended to cover the
+// ranges added.
+void GraphPyramidView::addSeriesPoints(GraphPyramid::Series series, qint32 level, QPolygonF &points,
+                                       QVector<QwtIntervalSample> &ranges, qreal &minY, qreal &maxY) const
+{
+    const QwtScaleDiv &xScale = plot->axisScaleDiv(QwtPlot::xBottom);
+    const qint32 fieldsPerBucket = graphPyramid->getFieldsPerBucket(level);
+    const QVector<GraphPyramid::Bucket> &buckets = graphPyramid->getBuckets(series, level);
+
+    // Include a bucket either side, so the curve runs off the edges of the plot
+    const qint32 firstBucket = qMax(static_cast<qint32>(xScale.lowerBound() / fieldsPerBucket) - 1, 0);
+    const qint32 lastBucket = qMin(static_cast<qint32>(xScale.upperBound() / fieldsPerBucket) + 1, buckets.size() - 1);
+
+    for (qint32 i = firstBucket; i <= lastBucket; i++) {
+        // Skip buckets with no values (e.g. where the SNR wasn't measured)
+        const GraphPyramid::Bucket &bucket = buckets[i];
+        if (bucket.count == 0) continue;
+
+        qint32 fieldNumber = (i * fieldsPerBucket) + 1;
+        points.append(QPointF(fieldNumber, bucket.mean()));
+        ranges.append(QwtIntervalSample(fieldNumber, bucket.min, bucket.max));
+
+        if (bucket.min < minY) minY = bucket.min;
+        if (bucket.max > maxY) maxY = bucket.max;
+    }
+}
@@ -0,0 +1,67 @@
+/************************************************************************
+
+    graphpyramidview.h
+
+    ld-analyse - TBC output analysis
+    Copyright (C) 2020 Simon Inns
+
+    This file is part of ld-decode-tools.
+
+    ld-analyse is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef GRAPHPYRAMIDVIEW_H
+#define GRAPHPYRAMIDVIEW_H
+
+#include <QObject>
+#include <QPolygonF>
+#include <QVector>
+#include <qwt_plot.h>
+#include <qwt_plot_magnifier.h>
+#include <qwt_plot_panner.h>
+#include <qwt_samples.h>
+
+#include "graphpyramid.h"
+
+// Shows series from a GraphPyramid in a QwtPlot, for the analysis dialogs.
+//
+// The mouse wheel zooms and dragging pans along the field axis.
+// visibleRangeChanged() is emitted when the axis changes; the dialog should
+// then redraw its graph, using chooseLevel() and addSeriesPoints() to get
+// the points for the visible range of fields at the matching resolution.
+class GraphPyramidView : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GraphPyramidView(QwtPlot *_plot, QObject *parent = nullptr);
+
+    void setGraphPyramid(const GraphPyramid *_graphPyramid);
+
+    qint32 chooseLevel() const;
+    qint32 getFieldsPerBucket(qint32 level) const;
+    void addSeriesPoints(GraphPyramid::Series series, qint32 level, QPolygonF &points,
+                         QVector<QwtIntervalSample> &ranges, qreal &minY, qreal &maxY) const;
+
+signals:
+    void visibleRangeChanged();
+
+private:
+    QwtPlot *plot;
+    QwtPlotMagnifier *magnifier;
+    QwtPlotPanner *panner;
+    const GraphPyramid *graphPyramid;
+};
+
+#endif // GRAPHPYRAMIDVIEW_H
@@ -7,6 +7,7 @@
 QT       += core gui
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+QT += concurrent
 
 TARGET = ld-analyse
 TEMPLATE = app
@@ -38,9 +39,15 @@ SOURCES += \
     vbidialog.cpp \
     configuration.cpp \
     dropoutanalysisdialog.cpp \
+    fieldsummaryindex.cpp \
+    graphpyramid.cpp \
+    graphpyramidview.cpp \
+    ../ld-chroma-decoder/bandrunner.cpp \
     ../ld-chroma-decoder/palcolour.cpp \
     ../ld-chroma-decoder/comb.cpp \
+    ../ld-chroma-decoder/combkernels.cpp \
     ../ld-chroma-decoder/rgb.cpp \
+    ../ld-chroma-decoder/rgbconversion.cpp \
     ../ld-chroma-decoder/yiq.cpp \
     ../ld-chroma-decoder/transformpal.cpp \
     ../ld-chroma-decoder/transformpal2d.cpp \
@@ -48,6 +55,7 @@ SOURCES += \
     ../ld-chroma-decoder/framecanvas.cpp \
     ../ld-chroma-decoder/sourcefield.cpp \
     ../library/tbc/lddecodemetadata.cpp \
+    ../library/tbc/metadatareader.cpp \
     ../library/tbc/sourcevideo.cpp \
     ../library/tbc/vbidecoder.cpp \
     ../library/tbc/filters.cpp \
@@ -66,9 +74,15 @@ HEADERS += \
     vbidialog.h \
     configuration.h \
     dropoutanalysisdialog.h \
+    fieldsummaryindex.h \
+    graphpyramid.h \
+    graphpyramidview.h \
+    ../ld-chroma-decoder/bandrunner.h \
     ../ld-chroma-decoder/palcolour.h \
     ../ld-chroma-decoder/comb.h \
+    ../ld-chroma-decoder/combkernels.h \
     ../ld-chroma-decoder/rgb.h \
+    ../ld-chroma-decoder/rgbconversion.h \
     ../ld-chroma-decoder/rgbframe.h \
     ../ld-chroma-decoder/yiq.h \
     ../ld-chroma-decoder/transformpal.h \
@@ -78,7 +92,9 @@ HEADERS += \
     ../ld-chroma-decoder/yiqbuffer.h \
     ../ld-chroma-decoder/sourcefield.h \
     ../library/filter/firfilter.h \
+    ../library/tbc/cpufeatures.h \
     ../library/tbc/lddecodemetadata.h \
+    ../library/tbc/metadatareader.h \
     ../library/tbc/sourcevideo.h \
     ../library/tbc/vbidecoder.h \
     ../library/tbc/filters.h \
@@ -130,7 +146,7 @@ INCLUDEPATH += "/usr/local/include"
 # Normal open-source OS goodness
 INCLUDEPATH += "/usr/local/include/opencv"
 LIBS += -L"/usr/local/lib"
-LIBS += -lfftw3
+LIBS += -lfftw3 -lfftw3f
 
 # Include the QWT library (used for charting)
 unix:!macx {
@@ -62,6 +62,7 @@ MainWindow::MainWindow(QString inputFilenameParam, QWidget *parent) :
     // Connect to the TbcSource signals (busy loading and finished loading)
     connect(&tbcSource, &TbcSource::busyLoading, this, &MainWindow::on_busyLoading);
     connect(&tbcSource, &TbcSource::finishedLoading, this, &MainWindow::on_finishedLoading);
+    connect(&tbcSource, &TbcSource::graphDataChanged, this, &MainWindow::on_graphDataChanged);
 
     // Load the window geometry and settings from the configuration
     restoreGeometry(configuration.getMainWindowGeometry());
@@ -848,22 +849,11 @@ void MainWindow::on_finishedLoading()
 
     // Ensure source loaded ok
     if (tbcSource.getIsSourceLoaded()) {
-        // Generate the graph data
-        dropoutAnalysisDialog->startUpdate();
-        snrAnalysisDialog->startUpdate();
-        captureQualityIndexDialog->startUpdate();
-
-        qint32 fieldNumber = 1;
-        for (qint32 i = 0; i < tbcSource.getGraphDataSize(); i++) {
-            dropoutAnalysisDialog->addDataPoint(fieldNumber, tbcSource.getDropOutGraphData()[i]);
-            snrAnalysisDialog->addDataPoint(fieldNumber, tbcSource.getBlackSnrGraphData()[i], tbcSource.getWhiteSnrGraphData()[i]);
-            captureQualityIndexDialog->addDataPoint(fieldNumber, tbcSource.getCaptureQualityIndexGraphData()[i]);
-            fieldNumber += tbcSource.getFieldsPerGraphDataPoint();
-        }
-
-        dropoutAnalysisDialog->finishUpdate(tbcSource.getNumberOfFields(), tbcSource.getFieldsPerGraphDataPoint());
-        snrAnalysisDialog->finishUpdate(tbcSource.getNumberOfFields(), tbcSource.getFieldsPerGraphDataPoint());
-        captureQualityIndexDialog->finishUpdate(tbcSource.getNumberOfFields(), tbcSource.getFieldsPerGraphDataPoint());
+        // Show the graph data (which is still being generated in the
+        // background; the graphs are updated as it becomes available)
+        dropoutAnalysisDialog->setGraphPyramid(tbcSource.getGraphPyramid(), tbcSource.getNumberOfFields());
+        snrAnalysisDialog->setGraphPyramid(tbcSource.getGraphPyramid(), tbcSource.getNumberOfFields());
+        captureQualityIndexDialog->setGraphPyramid(tbcSource.getGraphPyramid(), tbcSource.getNumberOfFields());
 
         // Update the GUI
         updateGuiLoaded();
@@ -890,3 +880,11 @@ void MainWindow::on_finishedLoading()
     busyDialog->hide();
     this->setEnabled(true);
 }
+
+// Signal handler for graphDataChanged signal from TbcSource class
+void MainWindow::on_graphDataChanged()
+{
+    dropoutAnalysisDialog->updateGraph();
+    snrAnalysisDialog->updateGraph();
+    captureQualityIndexDialog->updateGraph();
+}
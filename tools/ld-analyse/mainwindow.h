@@ -102,6 +102,7 @@ private slots:
     // Tbc Source signal handlers
     void on_busyLoading(QString infoMessage);
     void on_finishedLoading();    
+    void on_graphDataChanged();
 
 private:
     Ui::MainWindow *ui;
@@ -31,6 +31,7 @@ SnrAnalysisDialog::SnrAnalysisDialog(QWidget *parent) :
 {
     ui->setupUi(this);
     setWindowFlags(Qt::Window);
+    numberOfFields = 0;
     maxSnr = 0;
     minSnr = 1000;
 
@@ -39,10 +40,17 @@ SnrAnalysisDialog::SnrAnalysisDialog(QWidget *parent) :
     grid = new QwtPlotGrid();
     blackCurve = new QwtPlotCurve();
     whiteCurve = new QwtPlotCurve();
+    blackRangeCurve = new QwtPlotIntervalCurve();
+    whiteRangeCurve = new QwtPlotIntervalCurve();
     blackPoints = new QPolygonF();
     whitePoints = new QPolygonF();
 
     ui->verticalLayout->addWidget(plot);
+
+    // Zoom and pan along the field axis, redrawing the graph at the matching
+    // resolution when the axis changes
+    graphView = new GraphPyramidView(plot, this);
+    connect(graphView, SIGNAL(visibleRangeChanged()), this, SLOT(scaleDivChanged()));
 }
 
 SnrAnalysisDialog::~SnrAnalysisDialog()
@@ -51,40 +59,21 @@ SnrAnalysisDialog::~SnrAnalysisDialog()
     delete ui;
 }
 
-// Get ready for an update
-void SnrAnalysisDialog::startUpdate()
-{
-    removeChartContents();
-    maxSnr = 0;
-    minSnr = 1000;
-}
-
 // Remove the axes and series from the chart, giving ownership back to this object
 void SnrAnalysisDialog::removeChartContents()
 {
     blackPoints->clear();
     whitePoints->clear();
+    blackRanges.clear();
+    whiteRanges.clear();
     plot->replot();
 }
 
-// Add a data point to the chart
-void SnrAnalysisDialog::addDataPoint(qint32 fieldNumber, qreal blackSnr, qreal whiteSnr)
-{
-    if (!std::isnan(static_cast<float>(blackSnr))) blackPoints->append(QPointF(fieldNumber, blackSnr));
-    if (!std::isnan(static_cast<float>(whiteSnr))) whitePoints->append(QPointF(fieldNumber, whiteSnr));
-
-    // Keep track of the minimum and maximum SNR values
-    if (blackSnr < minSnr) minSnr = blackSnr;
-    if (whiteSnr < minSnr) minSnr = whiteSnr;
-    if (blackSnr > maxSnr) maxSnr = blackSnr;
-    if (whiteSnr > maxSnr) maxSnr = whiteSnr;
-}
-
-// Finish the update and render the graph
-void SnrAnalysisDialog::finishUpdate(qint32 numberOfFields, qint32 fieldsPerDataPoint)
+// Set the source of the graph data, and show the whole source
+void SnrAnalysisDialog::setGraphPyramid(const GraphPyramid *_graphPyramid, qint32 _numberOfFields)
 {
-    // Set the chart title
-    plot->setTitle("SNR analysis (averaged over " + QString::number(fieldsPerDataPoint) + " fields)");
+    graphView->setGraphPyramid(_graphPyramid);
+    numberOfFields = _numberOfFields;
 
     // Set the background and grid
     plot->setCanvasBackground(Qt::white);
@@ -95,43 +84,92 @@ void SnrAnalysisDialog::finishUpdate(qint32 numberOfFields, qint32 fieldsPerData
     plot->setAxisTitle(QwtPlot::xBottom, "Field number");
 
     // Define the y-axis
-    plot->setAxisScale(QwtPlot::yLeft, floor(minSnr - 1), ceil(maxSnr + 1),
-                       static_cast<qint32>(ceil(maxSnr + 1) - floor(minSnr - 1) + 1) / 10);
     plot->setAxisTitle(QwtPlot::yLeft, "SNR (in dB)");
 
-    // Attach the black curve data to the chart
+    // Set up the black range and curve
+    blackRangeCurve->setTitle("Black SNR range");
+    blackRangeCurve->setPen(Qt::NoPen);
+    blackRangeCurve->setBrush(QColor(0, 0, 0, 40));
     blackCurve->setTitle("Black SNR");
     blackCurve->setPen(Qt::black, 1);
     blackCurve->setRenderHint(QwtPlotItem::RenderAntialiased, true);
-    blackCurve->setSamples(*blackPoints);
-    blackCurve->attach(plot);
 
-    // Attach the white curve data to the chart
+    // Set up the white range and curve
+    whiteRangeCurve->setTitle("White SNR range");
+    whiteRangeCurve->setPen(Qt::NoPen);
+    whiteRangeCurve->setBrush(QColor(128, 128, 128, 40));
     whiteCurve->setTitle("White SNR");
     whiteCurve->setPen(Qt::gray, 1);
     whiteCurve->setRenderHint(QwtPlotItem::RenderAntialiased, true);
-    whiteCurve->setSamples(*whitePoints);
-    whiteCurve->attach(plot);
 
-    // Update the axis
-    plot->updateAxes();
+    // Attach the data to the chart
+    on_blackPSNR_checkBox_clicked();
+    on_whiteSNR_checkBox_clicked();
+
+    updateGraph();
 
     // Render the chart
     plot->maximumSize();
     plot->show();
 }
 
+// Redraw the graph for the visible range of fields, using the pyramid level
+// that gives about one point per pixel
+void SnrAnalysisDialog::updateGraph()
+{
+    blackPoints->clear();
+    whitePoints->clear();
+    blackRanges.clear();
+    whiteRanges.clear();
+    maxSnr = 0;
+    minSnr = 1000;
+
+    const qint32 level = graphView->chooseLevel();
+    if (level != -1) {
+        graphView->addSeriesPoints(GraphPyramid::blackSnrSeries, level, *blackPoints, blackRanges, minSnr, maxSnr);
+        graphView->addSeriesPoints(GraphPyramid::whiteSnrSeries, level, *whitePoints, whiteRanges, minSnr, maxSnr);
+
+        // Set the chart title
+        plot->setTitle("SNR analysis (averaged over " + QString::number(graphView->getFieldsPerBucket(level)) + " fields)");
+    }
+
+    // Define the y-axis
+    if (minSnr > maxSnr) {
+        // No data to show
+        minSnr = 0;
+        maxSnr = 0;
+    }
+    plot->setAxisScale(QwtPlot::yLeft, floor(minSnr - 1), ceil(maxSnr + 1),
+                       static_cast<qint32>(ceil(maxSnr + 1) - floor(minSnr - 1) + 1) / 10);
+
+    blackCurve->setSamples(*blackPoints);
+    whiteCurve->setSamples(*whitePoints);
+    blackRangeCurve->setSamples(blackRanges);
+    whiteRangeCurve->setSamples(whiteRanges);
+    plot->replot();
+}
+
 void SnrAnalysisDialog::on_blackPSNR_checkBox_clicked()
 {
-    if (ui->blackPSNR_checkBox->isChecked()) blackCurve->attach(plot);
-    else blackCurve->detach();
+    if (ui->blackPSNR_checkBox->isChecked()) {
+        blackRangeCurve->attach(plot);
+        blackCurve->attach(plot);
+    } else {
+        blackRangeCurve->detach();
+        blackCurve->detach();
+    }
     plot->replot();
 }
 
 void SnrAnalysisDialog::on_whiteSNR_checkBox_clicked()
 {
-    if (ui->whiteSNR_checkBox->isChecked()) whiteCurve->attach(plot);
-    else whiteCurve->detach();
+    if (ui->whiteSNR_checkBox->isChecked()) {
+        whiteRangeCurve->attach(plot);
+        whiteCurve->attach(plot);
+    } else {
+        whiteRangeCurve->detach();
+        whiteCurve->detach();
+    }
     plot->replot();
 }
 
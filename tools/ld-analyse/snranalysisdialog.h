@@ -33,8 +33,11 @@
 #include <qwt_legend.h>
 #include <qwt_plot_grid.h>
 #include <qwt_plot_curve.h>
+#include <qwt_plot_intervalcurve.h>
 
 #include "lddecodemetadata.h"
+#include "graphpyramid.h"
+#include "graphpyramidview.h"
 
 namespace Ui {
 class SnrAnalysisDialog;
@@ -48,13 +51,13 @@ public:
     explicit SnrAnalysisDialog(QWidget *parent = nullptr);
     ~SnrAnalysisDialog();
 
-    void startUpdate();
-    void addDataPoint(qint32 fieldNumber, qreal blackSnr, qreal whiteSnr);
-    void finishUpdate(qint32 numberOfFields, qint32 fieldsPerDataPoint);
+    void setGraphPyramid(const GraphPyramid *_graphPyramid, qint32 _numberOfFields);
+    void updateGraph();
 
 private slots:
     void on_blackPSNR_checkBox_clicked();
     void on_whiteSNR_checkBox_clicked();
+    void scaleDivChanged();
 
 private:
     void removeChartContents();
@@ -67,7 +70,13 @@ private:
     QPolygonF *whitePoints;
     QwtPlotCurve *blackCurve;
     QwtPlotCurve *whiteCurve;
+    QVector<QwtIntervalSample> blackRanges;
+    QVector<QwtIntervalSample> whiteRanges;
+    QwtPlotIntervalCurve *blackRangeCurve;
+    QwtPlotIntervalCurve *whiteRangeCurve;
+    GraphPyramidView *graphView;
 
+    qint32 numberOfFields;
     qreal maxSnr;
     qreal minSnr;
 };
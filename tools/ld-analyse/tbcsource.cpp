@@ -26,6 +26,11 @@
 
 #include "sourcefield.h"
 
+// Definitions of static constexpr data members, for compatibility with
+// pre-C++17 compilers
+constexpr qint32 TbcSource::FRAME_CACHE_SIZE;
+constexpr qint32 TbcSource::PREFETCH_DISTANCE;
+
 TbcSource::TbcSource(QObject *parent) : QObject(parent)
 {
     // Default frame image options
@@ -34,14 +39,28 @@ TbcSource::TbcSource(QObject *parent) : QObject(parent)
     dropoutsOn = false;
     reverseFoOn = false;
     sourceReady = false;
-    fieldsPerGraphDataPoint = 0;
-    frameCacheFrameNumber = -1;
+
+    // Pass on notifications that more graph data is available
+    connect(&graphPyramid, SIGNAL(levelsChanged()), this, SIGNAL(graphDataChanged()));
+
+    // Set up the frame image cache and prefetcher
+    frameImageCache.setMaxCost(FRAME_CACHE_SIZE);
+    prefetchReady = false;
+    prefetchFrameNumber = -1;
+    pendingPrefetchFrameNumber = -1;
+    connect(&prefetchWatcher, SIGNAL(finished()), this, SLOT(finishPrefetch()));
 
     // Set the chroma decoder configuration to default
     palConfiguration = palColour.getConfiguration();
     palConfiguration.chromaFilter = PalColour::transform2DFilter;
     ntscConfiguration = ntscColour.getConfiguration();
-    decoderConfigurationChanged = false;
+}
+
+TbcSource::~TbcSource()
+{
+    // The background threads use this object's members, so they must finish first
+    stopPrefetch();
+    stopGraphPyramid();
 }
 
 // Public methods -----------------------------------------------------------------------------------------------------
@@ -55,8 +74,12 @@ void TbcSource::loadSource(QString sourceFilename)
     dropoutsOn = false;
     reverseFoOn = false;
     sourceReady = false;
-    fieldsPerGraphDataPoint = 0;
-    frameCacheFrameNumber = -1;
+
+    // Discard any frames and graph data from the previous source
+    stopPrefetch();
+    prefetchReady = false;
+    frameImageCache.clear();
+    stopGraphPyramid();
 
     // Set the current file name
     QFileInfo inFileInfo(sourceFilename);
@@ -73,7 +96,14 @@ void TbcSource::loadSource(QString sourceFilename)
 // Method to unload a TBC source file
 void TbcSource::unloadSource()
 {
+    stopPrefetch();
+    frameImageCache.clear();
+    stopGraphPyramid();
+
     sourceVideo.close();
+    prefetchSourceVideo.close();
+    prefetchReady = false;
+    fieldSummaryIndex.close();
     sourceReady = false;
 }
 
@@ -94,14 +124,12 @@ QString TbcSource::getCurrentSourceFilename()
 // Method to set the highlight dropouts mode (true = dropouts highlighted)
 void TbcSource::setHighlightDropouts(bool _state)
 {
-    frameCacheFrameNumber = -1;
     dropoutsOn = _state;
 }
 
 // Method to set the chroma decoder mode (true = on)
 void TbcSource::setChromaDecoder(bool _state)
 {
-    frameCacheFrameNumber = -1;
     chromaOn = _state;
 
     // Turn off LPF if chroma is selected
@@ -111,7 +139,6 @@ void TbcSource::setChromaDecoder(bool _state)
 // Method to set the LPF mode (true = on)
 void TbcSource::setLpfMode(bool _state)
 {
-    frameCacheFrameNumber = -1;
     lpfOn = _state;
 
     // Turn off chroma if LPF is selected
@@ -121,7 +148,6 @@ void TbcSource::setLpfMode(bool _state)
 // Method to set the field order (true = reversed, false = normal)
 void TbcSource::setFieldOrder(bool _state)
 {
-    frameCacheFrameNumber = -1;
     reverseFoOn = _state;
 
     if (reverseFoOn) ldDecodeMetaData.setIsFirstFieldFirst(false);
@@ -157,69 +183,37 @@ QImage TbcSource::getFrameImage(qint32 frameNumber)
 {
     if (!sourceReady) return QImage();
 
-    // Check cached QImage
-    if (frameCacheFrameNumber == frameNumber && !decoderConfigurationChanged) return frameCache;
-    else {
-        frameCacheFrameNumber = frameNumber;
-        decoderConfigurationChanged = false;
-    }
-
-    // Get the required field numbers
-    qint32 firstFieldNumber = ldDecodeMetaData.getFirstFieldNumber(frameNumber);
-    qint32 secondFieldNumber = ldDecodeMetaData.getSecondFieldNumber(frameNumber);
-
     // Make sure we have a valid response from the frame determination
-    if (firstFieldNumber == -1 || secondFieldNumber == -1) {
+    if (ldDecodeMetaData.getFirstFieldNumber(frameNumber) == -1 || ldDecodeMetaData.getSecondFieldNumber(frameNumber) == -1) {
         qCritical() << "Could not determine field numbers!";
 
         // Jump back one frame
-        if (frameNumber != 1) {
-            frameNumber--;
-
-            firstFieldNumber = ldDecodeMetaData.getFirstFieldNumber(frameNumber);
-            secondFieldNumber = ldDecodeMetaData.getSecondFieldNumber(frameNumber);
-        }
+        if (frameNumber != 1) frameNumber--;
         qDebug() << "TbcSource::getFrameImage(): Jumping back one frame due to error";
     }
 
-    // Get a QImage for the frame
-    QImage frameImage = generateQImage(firstFieldNumber, secondFieldNumber);
+    FrameImageRequest request = makeFrameImageRequest(frameNumber);
 
-    // Get the field metadata
-    LdDecodeMetaData::Field firstField = ldDecodeMetaData.getField(firstFieldNumber);
-    LdDecodeMetaData::Field secondField = ldDecodeMetaData.getField(secondFieldNumber);
+    // Check the cache (which the prefetcher may have filled already)
+    QImage frameImage;
+    frameImageCacheMutex.lock();
+    QImage *cachedImage = frameImageCache.object(request.cacheKey);
+    if (cachedImage != nullptr) frameImage = *cachedImage;
+    frameImageCacheMutex.unlock();
 
-    // Highlight dropouts
-    if (dropoutsOn) {
-        // Create a painter object
-        QPainter imagePainter;
-        imagePainter.begin(&frameImage);
-
-        // Draw the drop out data for the first field
-        imagePainter.setPen(Qt::red);
-        for (qint32 dropOutIndex = 0; dropOutIndex < firstField.dropOuts.startx.size(); dropOutIndex++) {
-            qint32 startx = firstField.dropOuts.startx[dropOutIndex];
-            qint32 endx = firstField.dropOuts.endx[dropOutIndex];
-            qint32 fieldLine = firstField.dropOuts.fieldLine[dropOutIndex];
-
-            imagePainter.drawLine(startx, ((fieldLine - 1) * 2), endx, ((fieldLine - 1) * 2));
-        }
-
-        // Draw the drop out data for the second field
-        imagePainter.setPen(Qt::blue);
-        for (qint32 dropOutIndex = 0; dropOutIndex < secondField.dropOuts.startx.size(); dropOutIndex++) {
-            qint32 startx = secondField.dropOuts.startx[dropOutIndex];
-            qint32 endx = secondField.dropOuts.endx[dropOutIndex];
-            qint32 fieldLine = secondField.dropOuts.fieldLine[dropOutIndex];
+    if (frameImage.isNull()) {
+        // Not cached, so render it now
+        frameImage = generateQImage(request, sourceVideo, palColour, ntscColour);
 
-            imagePainter.drawLine(startx, ((fieldLine - 1) * 2) + 1, endx, ((fieldLine - 1) * 2) + 1);
-        }
-
-        // End the painter object
-        imagePainter.end();
+        frameImageCacheMutex.lock();
+        frameImageCache.insert(request.cacheKey, new QImage(frameImage));
+        frameImageCacheMutex.unlock();
     }
 
-    frameCache = frameImage;
+    // Render the frames either side in the background, ready for the user
+    // stepping or scrubbing onto them
+    startPrefetch(frameNumber);
+
     return frameImage;
 }
 
@@ -268,41 +262,10 @@ qint32 TbcSource::getFrameWidth()
     return (videoParameters.fieldWidth);
 }
 
-// Get black SNR data for graphing
-QVector<qreal> TbcSource::getBlackSnrGraphData()
-{
-    return blackSnrGraphData;
-}
-
-// Get white SNR data for graphing
-QVector<qreal> TbcSource::getWhiteSnrGraphData()
-{
-    return whiteSnrGraphData;
-}
-
-// Get dropout data for graphing
-QVector<qreal> TbcSource::getDropOutGraphData()
-{
-    return dropoutGraphData;
-}
-
-// Get CQI data for graphing
-QVector<qreal> TbcSource::getCaptureQualityIndexGraphData()
-{
-    return cqiGraphData;
-}
-
-// Method to get the size of the graphing data
-qint32 TbcSource::getGraphDataSize()
-{
-    // All data vectors are the same size, just return the size on one
-    return dropoutGraphData.size();
-}
-
-// Method to get the number of fields averaged into each graphing data point
-qint32 TbcSource::getFieldsPerGraphDataPoint()
+// Get the multi-resolution data for the analysis graphs
+const GraphPyramid *TbcSource::getGraphPyramid()
 {
-    return fieldsPerGraphDataPoint;
+    return &graphPyramid;
 }
 
 // Method returns true if frame contains dropouts
@@ -457,15 +420,13 @@ void TbcSource::setChromaConfiguration(const PalColour::Configuration &_palConfi
     palConfiguration = _palConfiguration;
     ntscConfiguration = _ntscConfiguration;
 
-    // Configure the chroma decoder
-    LdDecodeMetaData::VideoParameters videoParameters = ldDecodeMetaData.getVideoParameters();
-    if (videoParameters.isSourcePal) {
-        palColour.updateConfiguration(videoParameters, palConfiguration);
-    } else {
-        ntscColour.updateConfiguration(videoParameters, ntscConfiguration);
-    }
+    // The prefetcher's decoders are about to be reconfigured, and any
+    // frames it has already rendered are now out of date
+    stopPrefetch();
+    frameImageCache.clear();
 
-    decoderConfigurationChanged = true;
+    // Configure the chroma decoders
+    configureChromaDecoders();
 }
 
 const PalColour::Configuration &TbcSource::getPalConfiguration()
@@ -525,21 +486,46 @@ qint32 TbcSource::startOfChapter(qint32 currentFrameNumber)
 
 // Private methods ----------------------------------------------------------------------------------------------------
 
-// Method to create a QImage for a source video frame
-QImage TbcSource::generateQImage(qint32 firstFieldNumber, qint32 secondFieldNumber)
+// Method to gather the information needed to render a frame image
+TbcSource::FrameImageRequest TbcSource::makeFrameImageRequest(qint32 frameNumber)
 {
-    // Get the metadata for the video parameters
-    LdDecodeMetaData::VideoParameters videoParameters = ldDecodeMetaData.getVideoParameters();
+    FrameImageRequest request;
+
+    // The key includes every option that affects the rendered image
+    qint64 options = (chromaOn ? 1 : 0) | (lpfOn ? 2 : 0) | (dropoutsOn ? 4 : 0) | (reverseFoOn ? 8 : 0);
+    request.cacheKey = (static_cast<qint64>(frameNumber) << 4) | options;
+
+    request.videoParameters = ldDecodeMetaData.getVideoParameters();
+    request.firstFieldNumber = ldDecodeMetaData.getFirstFieldNumber(frameNumber);
+    request.secondFieldNumber = ldDecodeMetaData.getSecondFieldNumber(frameNumber);
+    request.firstField = ldDecodeMetaData.getField(request.firstFieldNumber);
+    request.secondField = ldDecodeMetaData.getField(request.secondFieldNumber);
+    request.chromaOn = chromaOn;
+    request.lpfOn = lpfOn;
+    request.dropoutsOn = dropoutsOn;
+
+    return request;
+}
+
+// Method to create a QImage for a source video frame.
+// This is static so that it can safely be called from the prefetcher, using
+// its own SourceVideo and chroma decoders.
+QImage TbcSource::generateQImage(const FrameImageRequest &request, SourceVideo &video,
+                                 PalColour &palDecoder, Comb &ntscDecoder)
+{
+    const LdDecodeMetaData::VideoParameters &videoParameters = request.videoParameters;
+    const qint32 firstFieldNumber = request.firstFieldNumber;
+    const qint32 secondFieldNumber = request.secondFieldNumber;
 
     // Calculate the frame height
     qint32 frameHeight = (videoParameters.fieldHeight * 2) - 1;
 
     // Show debug information
-    if (chromaOn) {
+    if (request.chromaOn) {
         qDebug().nospace() << "TbcSource::generateQImage(): Generating a chroma image from field pair " << firstFieldNumber <<
                     "/" << secondFieldNumber << " (" << videoParameters.fieldWidth << "x" <<
                     frameHeight << ")";
-    } else if (lpfOn) {
+    } else if (request.lpfOn) {
         qDebug().nospace() << "TbcSource::generateQImage(): Generating a LPF image from field pair " << firstFieldNumber <<
                     "/" << secondFieldNumber << " (" << videoParameters.fieldWidth << "x" <<
                     frameHeight << ")";
@@ -556,25 +542,25 @@ QImage TbcSource::generateQImage(qint32 firstFieldNumber, qint32 secondFieldNumb
     QByteArray firstLineData;
     QByteArray secondLineData;
 
-    if (chromaOn) {
+    if (request.chromaOn) {
         // Chroma decode the current frame and display
 
         // Get the two fields and their metadata and contain in the chroma-decoder's
         // source field class
         SourceField firstField, secondField;
-        firstField.field = ldDecodeMetaData.getField(firstFieldNumber);
-        secondField.field = ldDecodeMetaData.getField(secondFieldNumber);
-        firstField.data = sourceVideo.getVideoField(firstFieldNumber);
-        secondField.data = sourceVideo.getVideoField(secondFieldNumber);
+        firstField.field = request.firstField;
+        secondField.field = request.secondField;
+        firstField.data = video.getVideoField(firstFieldNumber);
+        secondField.data = video.getVideoField(secondFieldNumber);
 
         // Decode colour for the current frame, to RGB 16-16-16 interlaced output
         RGBFrame rgbFrame;
         if (videoParameters.isSourcePal) {
             // PAL source
-            rgbFrame = palColour.decodeFrame(firstField, secondField);
+            rgbFrame = palDecoder.decodeFrame(firstField, secondField);
         } else {
             // NTSC source
-            rgbFrame = ntscColour.decodeFrame(firstField, secondField);
+            rgbFrame = ntscDecoder.decodeFrame(firstField, secondField);
         }
 
         // Get a pointer to the RGB data
@@ -595,12 +581,12 @@ QImage TbcSource::generateQImage(qint32 firstFieldNumber, qint32 secondFieldNumb
                 *(frameImage.scanLine(y) + xpp + 2) = static_cast<uchar>(rgbPointer[pixelOffset + 2] / 256); // B
             }
         }
-    } else if (lpfOn) {
+    } else if (request.lpfOn) {
         // Display the current frame as LPF only
 
         // Get the field data
-        SourceVideo::Data firstField = sourceVideo.getVideoField(firstFieldNumber);
-        SourceVideo::Data secondField = sourceVideo.getVideoField(secondFieldNumber);
+        SourceVideo::Data firstField = video.getVideoField(firstFieldNumber);
+        SourceVideo::Data secondField = video.getVideoField(secondFieldNumber);
 
         // Generate pointers to the 16-bit greyscale data.
         // Since we're taking a non-const pointer here, this will detach from
@@ -656,8 +642,8 @@ QImage TbcSource::generateQImage(qint32 firstFieldNumber, qint32 secondFieldNumb
         // Display the current frame as source data
 
         // Get the field data
-        SourceVideo::Data firstField = sourceVideo.getVideoField(firstFieldNumber);
-        SourceVideo::Data secondField = sourceVideo.getVideoField(secondFieldNumber);
+        SourceVideo::Data firstField = video.getVideoField(firstFieldNumber);
+        SourceVideo::Data secondField = video.getVideoField(secondFieldNumber);
 
         // Get pointers to the 16-bit greyscale data
         const quint16 *firstFieldPointer = firstField.data();
@@ -683,106 +669,136 @@ QImage TbcSource::generateQImage(qint32 firstFieldNumber, qint32 secondFieldNumb
         }
     }
 
+    // Highlight dropouts
+    if (request.dropoutsOn) {
+        // Create a painter object
+        QPainter imagePainter;
+        imagePainter.begin(&frameImage);
+
+        // Draw the drop out data for the first field
+        imagePainter.setPen(Qt::red);
+        for (qint32 dropOutIndex = 0; dropOutIndex < request.firstField.dropOuts.startx.size(); dropOutIndex++) {
+            qint32 startx = request.firstField.dropOuts.startx[dropOutIndex];
+            qint32 endx = request.firstField.dropOuts.endx[dropOutIndex];
+            qint32 fieldLine = request.firstField.dropOuts.fieldLine[dropOutIndex];
+
+            imagePainter.drawLine(startx, ((fieldLine - 1) * 2), endx, ((fieldLine - 1) * 2));
+        }
+
+        // Draw the drop out data for the second field
+        imagePainter.setPen(Qt::blue);
+        for (qint32 dropOutIndex = 0; dropOutIndex < request.secondField.dropOuts.startx.size(); dropOutIndex++) {
+            qint32 startx = request.secondField.dropOuts.startx[dropOutIndex];
+            qint32 endx = request.secondField.dropOuts.endx[dropOutIndex];
+            qint32 fieldLine = request.secondField.dropOuts.fieldLine[dropOutIndex];
+
+            imagePainter.drawLine(startx, ((fieldLine - 1) * 2) + 1, endx, ((fieldLine - 1) * 2) + 1);
+        }
+
+        // End the painter object
+        imagePainter.end();
+    }
+
     return frameImage;
 }
 
-// Generate the data points for the Drop-out and SNR analysis graphs
-// We do these both at the same time to reduce calls to the metadata
-void TbcSource::generateData(qint32 _targetDataPoints)
-{
-    dropoutGraphData.clear();
-    blackSnrGraphData.clear();
-    whiteSnrGraphData.clear();
-    cqiGraphData.clear();
-
-    qreal targetDataPoints = static_cast<qreal>(_targetDataPoints);
-    qreal averageWidth = qRound(ldDecodeMetaData.getNumberOfFields() / targetDataPoints);
-    if (averageWidth < 1) averageWidth = 1; // Ensure we don't divide by zero
-    qint32 dataPoints = ldDecodeMetaData.getNumberOfFields() / static_cast<qint32>(averageWidth);
-    fieldsPerGraphDataPoint = ldDecodeMetaData.getNumberOfFields() / dataPoints;
-    if (fieldsPerGraphDataPoint < 1) fieldsPerGraphDataPoint = 1;
-
-    // Get the total number of dots per field
-    qint32 totalDotsPerField = ldDecodeMetaData.getVideoParameters().fieldHeight + ldDecodeMetaData.getVideoParameters().fieldWidth;
-
-    qint32 fieldNumber = 1;
-    for (qint32 dpCount = 0; dpCount < dataPoints; dpCount++) {
-        qreal doLength = 0;
-        qreal blackSnrTotal = 0;
-        qreal whiteSnrTotal = 0;
-        qreal syncConf = 0;
-
-        // SNR data may be missing in some fields, so we count the points to prevent
-        // the average from being thrown-off by missing data
-        qreal blackSnrPoints = 0;
-        qreal whiteSnrPoints = 0;
-        for (qint32 avCount = 0; avCount < fieldsPerGraphDataPoint; avCount++) {
-            LdDecodeMetaData::Field field = ldDecodeMetaData.getField(fieldNumber);
-
-            // Get the DOs
-            if (field.dropOuts.startx.size() > 0) {
-                // Calculate the total length of the dropouts
-                for (qint32 i = 0; i < field.dropOuts.startx.size(); i++) {
-                    doLength += field.dropOuts.endx[i] - field.dropOuts.startx[i];
-                }
-            }
+// Method to start rendering the frames either side of frameNumber in the
+// background. If the prefetcher is already busy, it's told to give up and
+// the new request is started when it finishes.
+void TbcSource::startPrefetch(qint32 frameNumber)
+{
+    // If the prefetcher's copy of the TBC file couldn't be opened, frames
+    // are only rendered on demand
+    if (!prefetchReady) return;
 
-            // Get the SNRs
-            if (field.vitsMetrics.inUse) {
-                if (field.vitsMetrics.bPSNR > 0) {
-                    blackSnrTotal += field.vitsMetrics.bPSNR;
-                    blackSnrPoints++;
-                }
-                if (field.vitsMetrics.wSNR > 0) {
-                    whiteSnrTotal += field.vitsMetrics.wSNR;
-                    whiteSnrPoints++;
-                }
-            }
+    prefetchFrameNumber = frameNumber;
+
+    if (prefetchWatcher.isRunning()) {
+        pendingPrefetchFrameNumber = frameNumber;
+        return;
+    }
+    pendingPrefetchFrameNumber = -1;
+
+    // Build requests for the nearest frames that aren't already cached
+    QVector<FrameImageRequest> requests;
+    const qint32 numberOfFrames = getNumberOfFrames();
+    for (qint32 distance = 1; distance <= PREFETCH_DISTANCE; distance++) {
+        for (qint32 neighbour : {frameNumber + distance, frameNumber - distance}) {
+            if (neighbour < 1 || neighbour > numberOfFrames) continue;
+            if (ldDecodeMetaData.getFirstFieldNumber(neighbour) == -1
+                || ldDecodeMetaData.getSecondFieldNumber(neighbour) == -1) continue;
 
-            // Get the sync confidence
-            syncConf += static_cast<qreal>(ldDecodeMetaData.getField(fieldNumber).syncConf);
+            FrameImageRequest request = makeFrameImageRequest(neighbour);
 
-            // Next field...
-            fieldNumber++;
+            frameImageCacheMutex.lock();
+            bool isCached = frameImageCache.contains(request.cacheKey);
+            frameImageCacheMutex.unlock();
+
+            if (!isCached) requests.append(request);
         }
+    }
+    if (requests.isEmpty()) return;
+
+    prefetchWatcher.setFuture(QtConcurrent::run(this, &TbcSource::prefetchFrameImages, frameNumber, requests));
+}
+
+// Method to stop the prefetcher, waiting for it to finish
+void TbcSource::stopPrefetch()
+{
+    prefetchFrameNumber = -1;
+    pendingPrefetchFrameNumber = -1;
+    prefetchWatcher.waitForFinished();
+}
+
+// Apply the chroma configuration to the decoders. The interactive decoders
+// render the frame the user is waiting for, so they split each frame across
+// all the CPUs; the prefetcher's decoders work in the background on one.
+void TbcSource::configureChromaDecoders()
+{
+    LdDecodeMetaData::VideoParameters videoParameters = ldDecodeMetaData.getVideoParameters();
+    const qint32 interactiveThreads = QThread::idealThreadCount();
+
+    if (videoParameters.isSourcePal) {
+        PalColour::Configuration interactiveConfiguration = palConfiguration;
+        interactiveConfiguration.intraFrameThreads = interactiveThreads;
+        palColour.updateConfiguration(videoParameters, interactiveConfiguration);
+        prefetchPalColour.updateConfiguration(videoParameters, palConfiguration);
+    } else {
+        Comb::Configuration interactiveConfiguration = ntscConfiguration;
+        interactiveConfiguration.intraFrameThreads = interactiveThreads;
+        ntscColour.updateConfiguration(videoParameters, interactiveConfiguration);
+        prefetchNtscColour.updateConfiguration(videoParameters, ntscConfiguration);
+    }
+}
+
+// Prefetcher thread: render the requested frames into the cache, giving up
+// if the user moves away from centreFrameNumber
+void TbcSource::prefetchFrameImages(qint32 centreFrameNumber, QVector<FrameImageRequest> requests)
+{
+    for (const FrameImageRequest &request : requests) {
+        if (prefetchFrameNumber.loadAcquire() != centreFrameNumber) return;
+
+        QImage frameImage = generateQImage(request, prefetchSourceVideo, prefetchPalColour, prefetchNtscColour);
 
-        // Calculate the average
-        doLength = doLength / static_cast<qreal>(fieldsPerGraphDataPoint);
-        blackSnrTotal = blackSnrTotal / blackSnrPoints;
-        whiteSnrTotal = whiteSnrTotal / whiteSnrPoints;
-        syncConf = syncConf / static_cast<qreal>(fieldsPerGraphDataPoint);
-
-        // Calculate the Capture Quality Index
-        qreal fieldDoPercent = 100.0 - (static_cast<qreal>(doLength) / static_cast<qreal>(totalDotsPerField * fieldsPerGraphDataPoint));
-        qreal snrPercent = 0;
-
-        // Convert SNR to linear
-        qreal whiteSnrLinear = pow(whiteSnrTotal / 20, 10);
-        qreal blackSnrLinear = pow(blackSnrTotal / 20, 10);
-        qreal snrReferenceLinear = pow(43.0 / 20, 10); // Note: 43 dB is the expected maximum
-
-        if (whiteSnrTotal != 0) snrPercent = (100.0 / (snrReferenceLinear * 2)) * (blackSnrLinear + whiteSnrLinear);
-        else snrPercent = (100.0 / snrReferenceLinear) * blackSnrLinear;
-        if (snrPercent > 100.0) snrPercent = 100.0;
-
-        // Note: The weighting is 1000:1:1 - this is just because dropouts have a greater visual effect
-        // on the resulting capture than SNR.
-        qreal captureQualityIndex = ((fieldDoPercent * 1000.0) + snrPercent + syncConf) / 1002.0;
-
-        // Add the result to the vectors
-        dropoutGraphData.append(doLength);
-        blackSnrGraphData.append(blackSnrTotal);
-        whiteSnrGraphData.append(whiteSnrTotal);
-        cqiGraphData.append(captureQualityIndex);
+        frameImageCacheMutex.lock();
+        frameImageCache.insert(request.cacheKey, new QImage(frameImage));
+        frameImageCacheMutex.unlock();
     }
 }
 
+// Method to wait for the graph pyramid to finish building, and discard it
+void TbcSource::stopGraphPyramid()
+{
+    graphPyramidFuture.waitForFinished();
+    graphPyramid.clear();
+}
+
 void TbcSource::startBackgroundLoad(QString sourceFilename)
 {
     // Open the TBC metadata file
     qDebug() << "TbcSource::startBackgroundLoad(): Processing JSON metadata...";
     emit busyLoading("Processing JSON metadata...");
-    if (!ldDecodeMetaData.read(sourceFilename + ".json")) {
+    if (!ldDecodeMetaData.read(sourceFilename + ".json", true)) {
         // Open failed
         qWarning() << "Open TBC JSON metadata failed for filename" << sourceFilename;
         currentSourceFilename.clear();
@@ -804,50 +820,49 @@ void TbcSource::startBackgroundLoad(QString sourceFilename)
             // Show an error to the user
             lastLoadError = "Could not open TBC data file!";
         } else {
+            // Open a second copy for the prefetcher
+            if (prefetchSourceVideo.open(sourceFilename, videoParameters.fieldWidth * videoParameters.fieldHeight)) {
+                prefetchReady = true;
+            } else {
+                qWarning() << "Open TBC file for prefetching failed for filename" << sourceFilename
+                           << "- prefetching disabled";
+            }
+
             // Both the video and metadata files are now open
             sourceReady = true;
             currentSourceFilename = sourceFilename;
         }
     }
 
-    // Get the video parameters
-    LdDecodeMetaData::VideoParameters videoParameters = ldDecodeMetaData.getVideoParameters();
-
-    // Configure the chroma decoder
-    if (videoParameters.isSourcePal) {
-        palColour.updateConfiguration(videoParameters, palConfiguration);
-    } else {
-        ntscColour.updateConfiguration(videoParameters, ntscConfiguration);
-    }
-
-    // Generate the graph data for the source
-    emit busyLoading("Generating graph data...");
-    generateData(2000);
-
-    // Generate a chapter map (used by the chapter skip
-    // forwards and backwards buttons)
-    emit busyLoading("Generating VBI chapter map...");
-    qint32 lastChapter = -1;
-    qint32 giveUpCounter = 0;
-    chapterMap.clear();
-    for (qint32 i = 1; i <= getNumberOfFrames(); i++) {
-        qint32 currentChapter = getFrameVbi(i).chNo;
-        if (currentChapter != -1) {
-            if (currentChapter != lastChapter) {
-                lastChapter = currentChapter;
-                chapterMap.append(i);
-            } else giveUpCounter++;
-        }
+    // Configure the chroma decoders
+    configureChromaDecoders();
 
-        if (i == 100 && giveUpCounter < 50) {
-            qDebug() << "Not seeing valid chapter numbers, giving up chapter mapping";
-            break;
-        }
+    // Summarise the fields for the graphs, and generate a chapter map
+    // (used by the chapter skip forwards and backwards buttons). This is
+    // cached in a sidecar file, so it's only slow the first time.
+    if (sourceReady) {
+        emit busyLoading("Generating graph data and VBI chapter map...");
+        fieldSummaryIndex.open(sourceFilename + ".json", ldDecodeMetaData);
+        chapterMap = fieldSummaryIndex.getChapterMap();
     }
 }
 
 void TbcSource::finishBackgroundLoad()
 {
+    // Start building the graph data; the graphs will be updated as each
+    // resolution becomes available
+    if (sourceReady) {
+        LdDecodeMetaData::VideoParameters videoParameters = ldDecodeMetaData.getVideoParameters();
+        qint32 totalDotsPerField = videoParameters.fieldHeight + videoParameters.fieldWidth;
+        graphPyramidFuture = QtConcurrent::run(&graphPyramid, &GraphPyramid::build, &fieldSummaryIndex, totalDotsPerField);
+    }
+
     // Send a finished loading message to the main window
     emit finishedLoading();
 }
+
+void TbcSource::finishPrefetch()
+{
+    // If the user moved while the prefetcher was busy, start again from the new position
+    if (pendingPrefetchFrameNumber != -1) startPrefetch(pendingPrefetchFrameNumber);
+}
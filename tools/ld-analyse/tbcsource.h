@@ -28,6 +28,10 @@
 #include <QObject>
 #include <QImage>
 #include <QPainter>
+#include <QCache>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QThread>
 #include <QtConcurrent/QtConcurrent>
 #include <QDebug>
 
@@ -37,6 +41,10 @@
 #include "vbidecoder.h"
 #include "filters.h"
 
+// Field summary index and graph data
+#include "fieldsummaryindex.h"
+#include "graphpyramid.h"
+
 // Chroma decoder includes
 #include "configuration.h"
 #include "palcolour.h"
@@ -47,6 +55,7 @@ class TbcSource : public QObject
     Q_OBJECT
 public:
     explicit TbcSource(QObject *parent = nullptr);
+    ~TbcSource() override;
 
     struct ScanLineData {
         QVector<qint32> data;
@@ -84,12 +93,7 @@ public:
     VbiDecoder::Vbi getFrameVbi(qint32 frameNumber);
     bool getIsFrameVbiValid(qint32 frameNumber);
 
-    QVector<qreal> getBlackSnrGraphData();
-    QVector<qreal> getWhiteSnrGraphData();
-    QVector<qreal> getDropOutGraphData();
-    QVector<qreal> getCaptureQualityIndexGraphData();
-    qint32 getGraphDataSize();
-    qint32 getFieldsPerGraphDataPoint();
+    const GraphPyramid *getGraphPyramid();
 
     bool getIsDropoutPresent(qint32 frameNumber);
     ScanLineData getScanLineData(qint32 frameNumber, qint32 scanLine);
@@ -110,20 +114,15 @@ public:
 signals:
     void busyLoading(QString information);
     void finishedLoading();
+    void graphDataChanged();
 
 private slots:
     void finishBackgroundLoad();
+    void finishPrefetch();
 
 private:
     bool sourceReady;
 
-    // Frame data
-    QVector<qreal> blackSnrGraphData;
-    QVector<qreal> whiteSnrGraphData;
-    QVector<qreal> dropoutGraphData;
-    QVector<qreal> cqiGraphData;
-    qint32 fieldsPerGraphDataPoint;
-
     // Frame image options
     bool chromaOn;
     bool lpfOn;
@@ -147,20 +146,62 @@ private:
     QFutureWatcher<void> watcher;
     QFuture <void> future;
 
-    // Cache of current frame QImage
-    QImage frameCache;
-    qint32 frameCacheFrameNumber;
+    // Everything needed to render a frame image. Requests are built on the
+    // GUI thread, so rendering doesn't need to touch the metadata.
+    struct FrameImageRequest {
+        qint64 cacheKey;
+        LdDecodeMetaData::VideoParameters videoParameters;
+        qint32 firstFieldNumber;
+        qint32 secondFieldNumber;
+        LdDecodeMetaData::Field firstField;
+        LdDecodeMetaData::Field secondField;
+        bool chromaOn;
+        bool lpfOn;
+        bool dropoutsOn;
+    };
+
+    // Number of rendered frame images to keep
+    static constexpr qint32 FRAME_CACHE_SIZE = 32;
+
+    // Number of frames either side of the current frame to prefetch
+    static constexpr qint32 PREFETCH_DISTANCE = 2;
+
+    // Cache of rendered frame images, keyed by frame number and image options.
+    // This is shared with the prefetcher, so must be accessed with the mutex held.
+    QCache<qint64, QImage> frameImageCache;
+    QMutex frameImageCacheMutex;
+
+    // Background prefetcher. SourceVideo and the chroma decoders aren't
+    // thread-safe, so the prefetcher has its own copies. prefetchReady is
+    // false if prefetchSourceVideo couldn't be opened.
+    SourceVideo prefetchSourceVideo;
+    bool prefetchReady;
+    PalColour prefetchPalColour;
+    Comb prefetchNtscColour;
+    QFutureWatcher<void> prefetchWatcher;
+    QAtomicInt prefetchFrameNumber;
+    qint32 pendingPrefetchFrameNumber;
 
     // Chroma decoder configuration
     PalColour::Configuration palConfiguration;
     Comb::Configuration ntscConfiguration;
-    bool decoderConfigurationChanged;
 
-    // Chapter map
+    // Per-field statistics and chapter map
+    FieldSummaryIndex fieldSummaryIndex;
     QVector<qint32> chapterMap;
 
-    QImage generateQImage(qint32 firstFieldNumber, qint32 secondFieldNumber);
-    void generateData(qint32 _targetDataPoints);
+    // Graph data, built in the background from the field summary index
+    GraphPyramid graphPyramid;
+    QFuture<void> graphPyramidFuture;
+
+    FrameImageRequest makeFrameImageRequest(qint32 frameNumber);
+    static QImage generateQImage(const FrameImageRequest &request, SourceVideo &video,
+                                 PalColour &palDecoder, Comb &ntscDecoder);
+    void startPrefetch(qint32 frameNumber);
+    void stopPrefetch();
+    void configureChromaDecoders();
+    void prefetchFrameImages(qint32 centreFrameNumber, QVector<FrameImageRequest> requests);
+    void stopGraphPyramid();
     void startBackgroundLoad(QString sourceFilename);
 };
 
@@ -0,0 +1,99 @@
+/************************************************************************
+
+    bandrunner.cpp
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "bandrunner.h"
+
+#include <QAtomicInt>
+#include <QRunnable>
+
+// A task for the thread pool that calls a function
+class BandTask : public QRunnable
+{
+public:
+    explicit BandTask(const std::function<void()> &_fn)
+        : fn(_fn)
+    {
+    }
+
+    void run() override
+    {
+        fn();
+    }
+
+private:
+    const std::function<void()> &fn;
+};
+
+BandRunner::BandRunner()
+    : threads(1)
+{
+}
+
+void BandRunner::setThreads(qint32 _threads)
+{
+    threads = qMax(_threads, 1);
+
+    // The calling thread does some of the work, so the pool needs one fewer
+    pool.setMaxThreadCount(qMax(threads - 1, 1));
+}
+
+qint32 BandRunner::getThreads() const
+{
+    return threads;
+}
+
+void BandRunner::run(qint32 firstLine, qint32 lastLine, qint32 alignment, const BandFunction &fn)
+{
+    // Work out how many bands to use
+    const qint32 numUnits = (lastLine - firstLine + alignment - 1) / alignment;
+    if (numUnits <= 0) return;
+    const qint32 numBands = qMin(threads, numUnits);
+
+    auto runBand = [&](qint32 band) {
+        const qint32 startLine = firstLine + (((band * numUnits) / numBands) * alignment);
+        const qint32 endLine = qMin(firstLine + ((((band + 1) * numUnits) / numBands) * alignment), lastLine);
+        fn(band, startLine, endLine);
+    };
+
+    if (numBands == 1) {
+        // Nothing to parallelise
+        runBand(0);
+        return;
+    }
+
+    // Each thread (including this one) takes bands until there are none left
+    QAtomicInt nextBand(0);
+    const std::function<void()> worker = [&] {
+        qint32 band;
+        while ((band = nextBand.fetchAndAddRelaxed(1)) < numBands) {
+            runBand(band);
+        }
+    };
+
+    for (qint32 i = 1; i < numBands; i++) {
+        pool.start(new BandTask(worker));
+    }
+    worker();
+    pool.waitForDone();
+}
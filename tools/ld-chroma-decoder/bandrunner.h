@@ -0,0 +1,65 @@
+/************************************************************************
+
+    bandrunner.h
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef BANDRUNNER_H
+#define BANDRUNNER_H
+
+#include <QThreadPool>
+
+#include <functional>
+
+// Runs work on horizontal bands of a frame in parallel, so that a single
+// frame can be decoded using several threads.
+//
+// Each call to run() divides a range of lines into at most one band per
+// thread. The calling thread works on bands too, and run() returns once
+// every band is finished. With one thread (the default), the whole range
+// is processed as a single band on the calling thread.
+class BandRunner
+{
+public:
+    BandRunner();
+    BandRunner(const BandRunner &) = delete;
+    BandRunner& operator=(const BandRunner &) = delete;
+
+    // Set the number of threads to use, including the calling thread
+    void setThreads(qint32 threads);
+    qint32 getThreads() const;
+
+    // Called for each band with the band's index (from 0 to getThreads() - 1)
+    // and the range of lines it covers
+    using BandFunction = std::function<void(qint32 band, qint32 startLine, qint32 endLine)>;
+
+    // Divide the lines from firstLine to lastLine into bands, and call fn for
+    // each one. Band boundaries are placed at multiples of alignment lines
+    // from firstLine. The division only depends on the arguments and the
+    // number of threads, so repeated calls give the same bands.
+    void run(qint32 firstLine, qint32 lastLine, qint32 alignment, const BandFunction &fn);
+
+private:
+    qint32 threads;
+    QThreadPool pool;
+};
+
+#endif // BANDRUNNER_H
@@ -27,6 +27,9 @@
 
 #include "deemp.h"
 
+#include <algorithm>
+#include <cassert>
+
 // Public methods -----------------------------------------------------------------------------------------------------
 
 Comb::Comb()
@@ -59,10 +62,12 @@ void Comb::updateConfiguration(const LdDecodeMetaData::VideoParameters &_videoPa
     // Set the frame height
     frameHeight = ((videoParameters.fieldHeight * 2) - 1);
 
+    bandRunner.setThreads(configuration.intraFrameThreads);
+
     configurationSet = true;
 }
 
-// Process the input buffer into the RGB output buffer
+// Process the input buffer into a full-frame RGB output buffer
 RGBFrame Comb::decodeFrame(const SourceField &firstField, const SourceField &secondField)
 {
     // Ensure the object has been configured
@@ -71,16 +76,37 @@ RGBFrame Comb::decodeFrame(const SourceField &firstField, const SourceField &sec
         return RGBFrame();
     }
 
+    // Allocate RGB output buffer
+    const RGBFrameLayout outputLayout = RGBFrameLayout::fullFrame(videoParameters);
+    RGBFrame rgbOutputBuffer(outputLayout.getFrameSize(), 0);
+
+    decodeFrame(firstField, secondField, outputLayout, rgbOutputBuffer);
+
+    // Return the output frame
+    return rgbOutputBuffer;
+}
+
+// Process the input buffer into the RGB output buffer
+void Comb::decodeFrame(const SourceField &firstField, const SourceField &secondField,
+                       const RGBFrameLayout &outputLayout, RGBFrame &outputFrame)
+{
+    // Ensure the object has been configured
+    if (!configurationSet) {
+        qDebug() << "Comb::process(): Called, but the object has not been configured";
+        return;
+    }
+    assert(outputFrame.size() == outputLayout.getFrameSize());
+
     // Allocate the frame buffer
     FrameBuffer currentFrameBuffer;
-    currentFrameBuffer.clpbuffer.resize(3);
+    const qint32 activeWidth = videoParameters.activeVideoEnd - videoParameters.activeVideoStart;
+    const qint32 activeHeight = videoParameters.lastActiveFrameLine - videoParameters.firstActiveFrameLine;
+    currentFrameBuffer.clpbuffer[0].resize(activeWidth, activeHeight);
+    currentFrameBuffer.clpbuffer[1].resize(activeWidth, activeHeight);
 
     // Allocate the temporary YIQ buffer
     YiqBuffer tempYiqBuffer;
 
-    // Allocate RGB output buffer
-    RGBFrame rgbOutputBuffer;
-
     // Interlace the input fields and place in the frame[0]'s raw buffer
     qint32 fieldLine = 0;
     currentFrameBuffer.rawbuffer.clear();
@@ -98,31 +124,53 @@ RGBFrame Comb::decodeFrame(const SourceField &firstField, const SourceField &sec
     // same output.  This needs to be replaced with a real 3D process
 
     // 2D comb filter processing
+    //
+    // The frame is processed in bands of lines, which may run in parallel.
+    // Each stage needs the results of the previous one for the neighbouring
+    // lines, so each stage runs as a separate pass over the whole frame.
+    const qint32 firstLine = videoParameters.firstActiveFrameLine;
+    const qint32 lastLine = videoParameters.lastActiveFrameLine;
 
     // Perform 1D processing
-    split1D(&currentFrameBuffer);
+    bandRunner.run(firstLine, lastLine, 1, [&](qint32, qint32 startLine, qint32 endLine) {
+        split1D(&currentFrameBuffer, startLine, endLine);
+    });
 
     // Perform 2D processing
-    split2D(&currentFrameBuffer);
-
-    // Split the IQ values
-    splitIQ(&currentFrameBuffer);
-
-    // Copy the current frame to a temporary buffer, so operations on the frame do not
-    // alter the original data
-    tempYiqBuffer = currentFrameBuffer.yiqBuffer;
-
-    // Process the copy of the current frame
-    adjustY(&currentFrameBuffer, tempYiqBuffer);
-    if (configuration.colorlpf) filterIQ(currentFrameBuffer.yiqBuffer);
-    doYNR(tempYiqBuffer);
-    doCNR(tempYiqBuffer);
-
-    // Convert the YIQ result to RGB
-    rgbOutputBuffer = yiqToRgbFrame(tempYiqBuffer);
-
-    // Return the output frame
-    return rgbOutputBuffer;
+    bandRunner.run(firstLine, lastLine, 1, [&](qint32, qint32 startLine, qint32 endLine) {
+        split2D(&currentFrameBuffer, startLine, endLine);
+    });
+
+    // The NR filters need each band's last line, as it was before NR, to
+    // start the next band
+    std::vector<YiqLine> lastLines(bandRunner.getThreads());
+
+    bandRunner.run(firstLine, lastLine, 1, [&](qint32 band, qint32 startLine, qint32 endLine) {
+        // Split the IQ values
+        splitIQ(&currentFrameBuffer, startLine, endLine);
+
+        // Copy the current frame to a temporary buffer, so operations on the frame do not
+        // alter the original data
+        std::copy(currentFrameBuffer.yiqBuffer.begin() + startLine, currentFrameBuffer.yiqBuffer.begin() + endLine,
+                  tempYiqBuffer.begin() + startLine);
+
+        // Process the copy of the current frame
+        adjustY(&currentFrameBuffer, tempYiqBuffer, startLine, endLine);
+        if (configuration.colorlpf) filterIQ(currentFrameBuffer.yiqBuffer, startLine, endLine);
+
+        lastLines[band] = tempYiqBuffer[endLine - 1];
+    });
+
+    // BandRunner divides the frame the same way each time, so band N starts
+    // on the line after band N - 1's last line
+    bandRunner.run(firstLine, lastLine, 1, [&](qint32 band, qint32 startLine, qint32 endLine) {
+        const YiqLine *previousLine = (band == 0) ? nullptr : &lastLines[band - 1];
+        doYNR(tempYiqBuffer, previousLine, startLine, endLine);
+        doCNR(tempYiqBuffer, previousLine, startLine, endLine);
+
+        // Convert the YIQ result to RGB
+        yiqToRgbFrame(tempYiqBuffer, startLine, endLine, outputLayout, outputFrame);
+    });
 }
 
 // Private methods ----------------------------------------------------------------------------------------------------
@@ -159,81 +207,48 @@ inline bool Comb::GetLinePhase(FrameBuffer *frameBuffer, qint32 lineNumber)
     return isEvenLine ? isPositivePhaseOnEvenLines : !isPositivePhaseOnEvenLines;
 }
 
-void Comb::split1D(FrameBuffer *frameBuffer)
+void Comb::split1D(FrameBuffer *frameBuffer, qint32 startLine, qint32 endLine)
 {
-    for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
+    const qint32 activeWidth = videoParameters.activeVideoEnd - videoParameters.activeVideoStart;
+
+    for (qint32 lineNumber = startLine; lineNumber < endLine; lineNumber++) {
         // Get a pointer to the line's data
         const quint16 *line = frameBuffer->rawbuffer.data() + (lineNumber * videoParameters.fieldWidth);
 
-        for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-            qreal tc1 = (((line[h + 2] + line[h - 2]) / 2) - line[h]);
-
-            // Record the 1D C value
-            frameBuffer->clpbuffer[0].pixel[lineNumber][h] = tc1;
-        }
+        // Record the 1D C values
+        combSplit1D(line + videoParameters.activeVideoStart, activeWidth,
+                    frameBuffer->clpbuffer[0].line(lineNumber - videoParameters.firstActiveFrameLine));
     }
 }
 
 // This could do with an explaination of what it is doing...
-void Comb::split2D(FrameBuffer *frameBuffer)
+void Comb::split2D(FrameBuffer *frameBuffer, qint32 startLine, qint32 endLine)
 {
-    // Dummy black line.
-    static constexpr qreal blackLine[911] = {0};
+    // Dummy black line (readable from [-1], like the lines in the buffer)
+    static constexpr float blackLineData[911] = {0};
+    const float *blackLine = blackLineData + 1;
+
+    const qint32 activeWidth = videoParameters.activeVideoEnd - videoParameters.activeVideoStart;
+    const float p_2drange = static_cast<float>(45 * irescale);
+
+    for (qint32 lineNumber = startLine; lineNumber < endLine; lineNumber++) {
+        const qint32 bufferLine = lineNumber - videoParameters.firstActiveFrameLine;
 
-    for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
         // Get pointers to the surrounding lines.
         // If a line we need is outside the active area, use blackLine instead.
-        const qreal *previousLine = blackLine;
+        const float *previousLine = blackLine;
         if (lineNumber - 2 >= videoParameters.firstActiveFrameLine) {
-            previousLine = frameBuffer->clpbuffer[0].pixel[lineNumber - 2];
+            previousLine = frameBuffer->clpbuffer[0].line(bufferLine - 2);
         }
-        const qreal *currentLine = frameBuffer->clpbuffer[0].pixel[lineNumber];
-        const qreal *nextLine = blackLine;
+        const float *currentLine = frameBuffer->clpbuffer[0].line(bufferLine);
+        const float *nextLine = blackLine;
         if (lineNumber + 2 < videoParameters.lastActiveFrameLine) {
-            nextLine = frameBuffer->clpbuffer[0].pixel[lineNumber + 2];
+            nextLine = frameBuffer->clpbuffer[0].line(bufferLine + 2);
         }
 
-        // 2D filtering.
-        for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-            qreal tc1;
-
-            qreal kp, kn;
-
-            kp  = fabs(fabs(currentLine[h]) - fabs(previousLine[h])); // - fabs(c1line[h] * .20);
-            kp += fabs(fabs(currentLine[h - 1]) - fabs(previousLine[h - 1]));
-            kp -= (fabs(currentLine[h]) + fabs(currentLine[h - 1])) * .10;
-            kn  = fabs(fabs(currentLine[h]) - fabs(nextLine[h])); // - fabs(c1line[h] * .20);
-            kn += fabs(fabs(currentLine[h - 1]) - fabs(nextLine[h - 1]));
-            kn -= (fabs(currentLine[h]) + fabs(nextLine[h - 1])) * .10;
-
-            kp /= 2;
-            kn /= 2;
-
-            qreal p_2drange = 45 * irescale;
-            kp = qBound(0.0, 1 - (kp / p_2drange), 1.0);
-            kn = qBound(0.0, 1 - (kn / p_2drange), 1.0);
-
-            qreal sc = 1.0;
-
-            if ((kn > 0) || (kp > 0)) {
-                if (kn > (3 * kp)) kp = 0;
-                else if (kp > (3 * kn)) kn = 0;
-
-                sc = (2.0 / (kn + kp));// * max(kn * kn, kp * kp);
-                if (sc < 1.0) sc = 1.0;
-            } else {
-                if ((fabs(fabs(previousLine[h]) - fabs(nextLine[h])) - fabs((nextLine[h] + previousLine[h]) * .2)) <= 0) {
-                    kn = kp = 1;
-                }
-            }
-
-            tc1  = ((frameBuffer->clpbuffer[0].pixel[lineNumber][h] - previousLine[h]) * kp * sc);
-            tc1 += ((frameBuffer->clpbuffer[0].pixel[lineNumber][h] - nextLine[h]) * kn * sc);
-            tc1 /= 8; //(2 * 2);
-
-            // Record the 2D C value
-            frameBuffer->clpbuffer[1].pixel[lineNumber][h] = tc1;
-        }
+        // 2D filtering, recording the 2D C values
+        combSplit2D(previousLine, currentLine, nextLine, activeWidth, p_2drange,
+                    frameBuffer->clpbuffer[1].line(bufferLine));
     }
 }
 
@@ -246,83 +261,100 @@ void Comb::split3D(FrameBuffer *currentFrame, FrameBuffer *previousFrame)
         previousFrame = currentFrame;
     }
 
+    currentFrame->clpbuffer[2].resize(currentFrame->clpbuffer[0].getWidth(), currentFrame->clpbuffer[0].getHeight());
+
     for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
         const quint16 *currentLine = currentFrame->rawbuffer.data() + (lineNumber * videoParameters.fieldWidth);
         const quint16 *previousLine = previousFrame->rawbuffer.data() + (lineNumber * videoParameters.fieldWidth);
+        float *outputLine = currentFrame->clpbuffer[2].line(lineNumber - videoParameters.firstActiveFrameLine);
 
         for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-            currentFrame->clpbuffer[2].pixel[lineNumber][h] = (previousLine[h] - currentLine[h]) / 2;
+            outputLine[h - videoParameters.activeVideoStart] = (previousLine[h] - currentLine[h]) / 2;
         }
     }
 }
 
 // Spilt the I and Q
-void Comb::splitIQ(FrameBuffer *frameBuffer)
+void Comb::splitIQ(FrameBuffer *frameBuffer, qint32 startLine, qint32 endLine)
 {
-    // Clear the target frame YIQ buffer
-    frameBuffer->yiqBuffer.clear();
-
-    for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
-        // Get a pointer to the line's data
-        const quint16 *line = frameBuffer->rawbuffer.data() + (lineNumber * videoParameters.fieldWidth);
-        bool linePhase = GetLinePhase(frameBuffer, lineNumber);
-
-        qreal si = 0, sq = 0;
-        for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-            qint32 phase = h % 4;
+    // Clear the target lines of the frame YIQ buffer
+    for (qint32 lineNumber = startLine; lineNumber < endLine; lineNumber++) {
+        frameBuffer->yiqBuffer[lineNumber].fill(YIQ());
+    }
 
-            // Take the 2D C
-            qreal cavg = frameBuffer->clpbuffer[1].pixel[lineNumber][h]; // 2D C average
+    // The kernel writes (Y, I, Q) triples directly into the YIQ buffer
+    static_assert(sizeof(YIQ) == 3 * sizeof(double), "YIQ must be three doubles");
 
-            if (configuration.use3D && frameBuffer->kValues.size() != 0) {
-                // The motionK map returns K (0 for stationary pixels to 1 for moving pixels)
-                cavg  = frameBuffer->clpbuffer[1].pixel[lineNumber][h] * frameBuffer->kValues[(lineNumber * 910) + h]; // 2D mix
-                cavg += frameBuffer->clpbuffer[2].pixel[lineNumber][h] * (1 - frameBuffer->kValues[(lineNumber * 910) + h]); // 3D mix
+    const qint32 activeWidth = videoParameters.activeVideoEnd - videoParameters.activeVideoStart;
+    const bool use3D = configuration.use3D && frameBuffer->kValues.size() != 0;
 
-                // Use only 3D (for testing!)
-                //cavg = frameBuffer->clpbuffer[2].pixel[lineNumber][h];
-            }
+    for (qint32 lineNumber = startLine; lineNumber < endLine; lineNumber++) {
+        const qint32 bufferLine = lineNumber - videoParameters.firstActiveFrameLine;
 
-            if (!linePhase) cavg = -cavg;
+        // Get a pointer to the line's data
+        const quint16 *line = frameBuffer->rawbuffer.data() + (lineNumber * videoParameters.fieldWidth);
+        bool linePhase = GetLinePhase(frameBuffer, lineNumber);
 
-            switch (phase) {
-                case 0: sq = cavg; break;
-                case 1: si = -cavg; break;
-                case 2: sq = -cavg; break;
-                case 3: si = cavg; break;
-                default: break;
+        // Take the 2D C
+        const float *cavg = frameBuffer->clpbuffer[1].line(bufferLine); // 2D C average
+
+        float mixedLine[911];
+        if (use3D) {
+            // The motionK map returns K (0 for stationary pixels to 1 for moving pixels)
+            const float *line2D = frameBuffer->clpbuffer[1].line(bufferLine);
+            const float *line3D = frameBuffer->clpbuffer[2].line(bufferLine);
+            for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
+                const qint32 pos = h - videoParameters.activeVideoStart;
+                const qreal k = frameBuffer->kValues[(lineNumber * 910) + h];
+                mixedLine[pos] = static_cast<float>(line2D[pos] * k + line3D[pos] * (1 - k)); // 2D/3D mix
             }
-
-            frameBuffer->yiqBuffer[lineNumber][h].y = line[h];
-            frameBuffer->yiqBuffer[lineNumber][h].i = si;
-            frameBuffer->yiqBuffer[lineNumber][h].q = sq;
+            cavg = mixedLine;
         }
+
+        combSplitIQ(line + videoParameters.activeVideoStart, cavg, activeWidth, videoParameters.activeVideoStart % 4,
+                    linePhase, &frameBuffer->yiqBuffer[lineNumber][videoParameters.activeVideoStart].y);
     }
 }
 
 // Filter the IQ from the input YIQ buffer
-void Comb::filterIQ(YiqBuffer &yiqBuffer)
+void Comb::filterIQ(YiqBuffer &yiqBuffer, qint32 startLine, qint32 endLine)
 {
     auto iFilter(f_colorlpi);
     auto qFilter(configuration.colorlpf_hq ? f_colorlpi : f_colorlpq);
 
-    for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
+    // I is sampled on even pixels and Q on odd pixels, so each filter sees
+    // half of the line. Gather the samples for each filter into contiguous
+    // arrays so the whole line can be filtered in one call.
+    const qint32 maxSamples = (videoParameters.activeVideoEnd - videoParameters.activeVideoStart) / 2 + 1;
+    std::vector<double> iIn(maxSamples), iOut(maxSamples);
+    std::vector<double> qIn(maxSamples), qOut(maxSamples);
+
+    for (qint32 lineNumber = startLine; lineNumber < endLine; lineNumber++) {
         iFilter.clear();
         qFilter.clear();
 
         qint32 qoffset = 2; // f_colorlpf_hq ? f_colorlpi_offset : f_colorlpq_offset;
 
-        qreal filti = 0, filtq = 0;
-
+        qint32 numI = 0, numQ = 0;
         for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-            qint32 phase = h % 4;
+            if ((h % 2) == 0) {
+                iIn[numI++] = yiqBuffer[lineNumber][h].i;
+            } else {
+                qIn[numQ++] = yiqBuffer[lineNumber][h].q;
+            }
+        }
 
-            switch (phase) {
-                case 0: filti = iFilter.feed(yiqBuffer[lineNumber][h].i); break;
-                case 1: filtq = qFilter.feed(yiqBuffer[lineNumber][h].q); break;
-                case 2: filti = iFilter.feed(yiqBuffer[lineNumber][h].i); break;
-                case 3: filtq = qFilter.feed(yiqBuffer[lineNumber][h].q); break;
-                default: break;
+        iFilter.process(iIn.data(), iOut.data(), numI);
+        qFilter.process(qIn.data(), qOut.data(), numQ);
+
+        // Each output pixel takes the most recent filtered I and Q values
+        qreal filti = 0, filtq = 0;
+        qint32 posI = 0, posQ = 0;
+        for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
+            if ((h % 2) == 0) {
+                filti = iOut[posI++];
+            } else {
+                filtq = qOut[posQ++];
             }
 
             yiqBuffer[lineNumber][h - qoffset].i = filti;
@@ -339,7 +371,7 @@ void Comb::filterIQ(YiqBuffer &yiqBuffer)
  * which removes small high frequency noise.
  */
 
-void Comb::doCNR(YiqBuffer &yiqBuffer)
+void Comb::doCNR(YiqBuffer &yiqBuffer, const YiqLine *previousLine, qint32 startLine, qint32 endLine)
 {
     if (configuration.cNRLevel == 0) return;
 
@@ -350,21 +382,38 @@ void Comb::doCNR(YiqBuffer &yiqBuffer)
     // nr_c is the coring level
     qreal nr_c = configuration.cNRLevel * irescale;
 
-    QVector<YIQ> hplinef;
-    hplinef.resize(videoParameters.fieldWidth + 32);
+    // Input samples and high-pass filtered output for each line.
+    // The output is padded so the filter delay can be read past the end.
+    const qint32 startH = videoParameters.activeVideoStart;
+    const qint32 numSamples = videoParameters.activeVideoEnd - startH + 1;
+    std::vector<double> iLine(numSamples), qLine(numSamples);
+    std::vector<double> hplineI(numSamples + 32), hplineQ(numSamples + 32);
+
+    if (previousLine != nullptr) {
+        for (qint32 h = 0; h < numSamples; h++) {
+            iLine[h] = (*previousLine)[startH + h].i;
+            qLine[h] = (*previousLine)[startH + h].q;
+        }
+
+        iFilter.process(iLine.data(), hplineI.data(), numSamples);
+        qFilter.process(qLine.data(), hplineQ.data(), numSamples);
+    }
 
-    for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
+    for (qint32 lineNumber = startLine; lineNumber < endLine; lineNumber++) {
         // Filters not cleared from previous line
 
-        for (qint32 h = videoParameters.activeVideoStart; h <= videoParameters.activeVideoEnd; h++) {
-            hplinef[h].i = iFilter.feed(yiqBuffer[lineNumber][h].i);
-            hplinef[h].q = qFilter.feed(yiqBuffer[lineNumber][h].q);
+        for (qint32 h = 0; h < numSamples; h++) {
+            iLine[h] = yiqBuffer[lineNumber][startH + h].i;
+            qLine[h] = yiqBuffer[lineNumber][startH + h].q;
         }
 
-        for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
+        iFilter.process(iLine.data(), hplineI.data(), numSamples);
+        qFilter.process(qLine.data(), hplineQ.data(), numSamples);
+
+        for (qint32 h = 0; h < numSamples - 1; h++) {
             // Offset by 12 to cover the filter delay
-            qreal ai = hplinef[h + 12].i;
-            qreal aq = hplinef[h + 12].q;
+            qreal ai = hplineI[h + 12];
+            qreal aq = hplineQ[h + 12];
 
             if (fabs(ai) > nr_c) {
                 ai = (ai > 0) ? nr_c : -nr_c;
@@ -374,13 +423,13 @@ void Comb::doCNR(YiqBuffer &yiqBuffer)
                 aq = (aq > 0) ? nr_c : -nr_c;
             }
 
-            yiqBuffer[lineNumber][h].i -= ai;
-            yiqBuffer[lineNumber][h].q -= aq;
+            yiqBuffer[lineNumber][startH + h].i -= ai;
+            yiqBuffer[lineNumber][startH + h].q -= aq;
         }
     }
 }
 
-void Comb::doYNR(YiqBuffer &yiqBuffer)
+void Comb::doYNR(YiqBuffer &yiqBuffer, const YiqLine *previousLine, qint32 startLine, qint32 endLine)
 {
     if (configuration.yNRLevel == 0) return;
 
@@ -390,63 +439,73 @@ void Comb::doYNR(YiqBuffer &yiqBuffer)
     // nr_y is the coring level
     qreal nr_y = configuration.yNRLevel * irescale;
 
-    QVector<YIQ> hplinef;
-    hplinef.resize(videoParameters.fieldWidth + 32);
+    // Input samples and high-pass filtered output for each line.
+    // The output is padded so the filter delay can be read past the end.
+    const qint32 startH = videoParameters.activeVideoStart;
+    const qint32 numSamples = videoParameters.activeVideoEnd - startH + 1;
+    std::vector<double> yLine(numSamples);
+    std::vector<double> hplineY(numSamples + 32);
 
-    for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
+    if (previousLine != nullptr) {
+        for (qint32 h = 0; h < numSamples; h++) {
+            yLine[h] = (*previousLine)[startH + h].y;
+        }
+
+        yFilter.process(yLine.data(), hplineY.data(), numSamples);
+    }
+
+    for (qint32 lineNumber = startLine; lineNumber < endLine; lineNumber++) {
         // Filter not cleared from previous line
 
-        for (qint32 h = videoParameters.activeVideoStart; h <= videoParameters.activeVideoEnd; h++) {
-            hplinef[h].y = yFilter.feed(yiqBuffer[lineNumber][h].y);
+        for (qint32 h = 0; h < numSamples; h++) {
+            yLine[h] = yiqBuffer[lineNumber][startH + h].y;
         }
 
-        for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
-            qreal a = hplinef[h + 12].y;
+        yFilter.process(yLine.data(), hplineY.data(), numSamples);
+
+        for (qint32 h = 0; h < numSamples - 1; h++) {
+            qreal a = hplineY[h + 12];
 
             if (fabs(a) > nr_y) {
                 a = (a > 0) ? nr_y : -nr_y;
             }
 
-            yiqBuffer[lineNumber][h].y -= a;
+            yiqBuffer[lineNumber][startH + h].y -= a;
         }
     }
 }
 
-// Convert buffer from YIQ to RGB 16-16-16
-RGBFrame Comb::yiqToRgbFrame(const YiqBuffer &yiqBuffer)
+// Convert buffer from YIQ to RGB 16-16-16, writing the active area of rgbOutputFrame
+void Comb::yiqToRgbFrame(const YiqBuffer &yiqBuffer, qint32 startLine, qint32 endLine,
+                         const RGBFrameLayout &outputLayout, RGBFrame &rgbOutputFrame)
 {
-    RGBFrame rgbOutputFrame;
-    rgbOutputFrame.resize(videoParameters.fieldWidth * frameHeight * 3); // for RGB 16-16-16
-
-    // Initialise the output frame
-    rgbOutputFrame.fill(0);
-
     // Initialise YIQ to RGB converter
     RGB rgb(videoParameters.white16bIre, videoParameters.black16bIre, configuration.whitePoint75, configuration.chromaGain);
 
+    // The output is shifted 2 pixels to the right to keep the output frame in
+    // the same x position as the input video frame (not sure where the 2 pixel
+    // offset is coming from, but it's really not important). The first two
+    // pixels of each line are black, and the last two YIQ samples fall
+    // outside the active area.
+    const qint32 outputOffset = 2;
+
     // Perform YIQ to RGB conversion
-    for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
+    for (qint32 lineNumber = startLine; lineNumber < endLine; lineNumber++) {
         // Get a pointer to the line
-        quint16 *linePointer = rgbOutputFrame.data() + (videoParameters.fieldWidth * 3 * lineNumber);
+        quint16 *linePointer = rgbOutputFrame.data() + outputLayout.getOffset(videoParameters.activeVideoStart, lineNumber);
 
-        // Offset the output by the activeVideoStart to keep the output frame
-        // in the same x position as the input video frame (the +6 realigns the output
-        // to the source frame; not sure where the 2 pixel offset is coming from, but
-        // it's really not important)
-        qint32 o = (videoParameters.activeVideoStart * 3) + 6;
+        // Clear the pixels to the left of the output
+        std::fill_n(linePointer, outputOffset * 3, 0);
 
         // Fill the output line with the RGB values
         rgb.convertLine(&yiqBuffer[lineNumber][videoParameters.activeVideoStart],
-                        &yiqBuffer[lineNumber][videoParameters.activeVideoEnd],
-                        &linePointer[o]);
+                        &yiqBuffer[lineNumber][videoParameters.activeVideoEnd - outputOffset],
+                        &linePointer[outputOffset * 3]);
     }
-
-    // Return the RGB frame data
-    return rgbOutputFrame;
 }
 
 // Convert buffer from YIQ to RGB
-void Comb::overlayOpticalFlowMap(const FrameBuffer &frameBuffer, RGBFrame &rgbFrame)
+void Comb::overlayOpticalFlowMap(const FrameBuffer &frameBuffer, const RGBFrameLayout &outputLayout, RGBFrame &rgbFrame)
 {
     qDebug() << "Comb::overlayOpticalFlowMap(): Overlaying optical flow map onto RGB output";
 //    QVector<qreal> motionKMap;
@@ -455,32 +514,33 @@ void Comb::overlayOpticalFlowMap(const FrameBuffer &frameBuffer, RGBFrame &rgbFr
     // Overlay the optical flow map on the output RGB
     for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
         // Get a pointer to the line
-        quint16 *linePointer = rgbFrame.data() + (videoParameters.fieldWidth * 3 * lineNumber);
+        quint16 *linePointer = rgbFrame.data() + outputLayout.getOffset(videoParameters.activeVideoStart, lineNumber);
 
         // Fill the output frame with the RGB values
         for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
+            const qint32 pp = (h - videoParameters.activeVideoStart) * 3;
             qint32 intensity = static_cast<qint32>(frameBuffer.kValues[(lineNumber * 910) + h] * 65535);
             // Make the RGB more purple to show where motion was detected
-            qint32 red = linePointer[(h * 3)] + intensity;
-            qint32 green = linePointer[(h * 3) + 1];
-            qint32 blue = linePointer[(h * 3) + 2] + intensity;
+            qint32 red = linePointer[pp] + intensity;
+            qint32 green = linePointer[pp + 1];
+            qint32 blue = linePointer[pp + 2] + intensity;
 
             if (red > 65535) red = 65535;
             if (green > 65535) green = 65535;
             if (blue > 65535) blue = 65535;
 
-            linePointer[(h * 3)] = static_cast<quint16>(red);
-            linePointer[(h * 3) + 1] = static_cast<quint16>(green);
-            linePointer[(h * 3) + 2] = static_cast<quint16>(blue);
+            linePointer[pp] = static_cast<quint16>(red);
+            linePointer[pp + 1] = static_cast<quint16>(green);
+            linePointer[pp + 2] = static_cast<quint16>(blue);
         }
     }
 }
 
 // Remove the colour data from the baseband (Y)
-void Comb::adjustY(FrameBuffer *frameBuffer, YiqBuffer &yiqBuffer)
+void Comb::adjustY(FrameBuffer *frameBuffer, YiqBuffer &yiqBuffer, qint32 startLine, qint32 endLine)
 {
     // remove color data from baseband (Y)
-    for (qint32 lineNumber = videoParameters.firstActiveFrameLine; lineNumber < videoParameters.lastActiveFrameLine; lineNumber++) {
+    for (qint32 lineNumber = startLine; lineNumber < endLine; lineNumber++) {
         bool linePhase = GetLinePhase(frameBuffer, lineNumber);
 
         for (qint32 h = videoParameters.activeVideoStart; h < videoParameters.activeVideoEnd; h++) {
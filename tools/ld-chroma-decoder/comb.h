@@ -33,6 +33,8 @@
 
 #include "lddecodemetadata.h"
 
+#include "bandrunner.h"
+#include "combkernels.h"
 #include "rgb.h"
 #include "rgbframe.h"
 #include "sourcefield.h"
@@ -55,6 +57,10 @@ public:
 
         qreal cNRLevel = 0.0;
         qreal yNRLevel = 1.0;
+
+        // Number of threads to use within each frame (1 = decode each frame
+        // on the calling thread only)
+        qint32 intraFrameThreads = 1;
     };
 
     const Configuration &getConfiguration() const;
@@ -64,6 +70,11 @@ public:
     // Decode two fields to produce an interlaced frame.
     RGBFrame decodeFrame(const SourceField &firstField, const SourceField &secondField);
 
+    // Decode two fields into outputFrame, which must already be the right
+    // size for outputLayout. Only the active area is written.
+    void decodeFrame(const SourceField &firstField, const SourceField &secondField,
+                     const RGBFrameLayout &outputLayout, RGBFrame &outputFrame);
+
 protected:
 
 private:
@@ -78,15 +89,16 @@ private:
     // Calculated frame height
     qint32 frameHeight;
 
-    // Input frame buffer definitions
-    struct PixelLine {
-        qreal pixel[526][911]; // 526 is the maximum allowed field lines, 911 is the maximum field width
-    };
+    // Threads for decoding bands of each frame in parallel
+    BandRunner bandRunner;
 
+    // Input frame buffer definitions
     struct FrameBuffer {
         SourceVideo::Data rawbuffer;
 
-        QVector<PixelLine> clpbuffer; // Unfiltered chroma for the current phase (can be I or Q)
+        // Unfiltered chroma for the current phase (can be I or Q), for the
+        // active area only: [0] is 1D, [1] is 2D, [2] is 3D
+        ChromaPlane clpbuffer[3];
         QVector<qreal> kValues;
         YiqBuffer yiqBuffer; // YIQ values for the frame
 
@@ -100,19 +112,25 @@ private:
     inline qint32 GetFieldID(FrameBuffer *frameBuffer, qint32 lineNumber);
     inline bool GetLinePhase(FrameBuffer *frameBuffer, qint32 lineNumber);
 
-    void split1D(FrameBuffer *frameBuffer);
-    void split2D(FrameBuffer *frameBuffer);
+    // The processing stages below work on the frame lines from startLine to
+    // endLine, so that bands of the frame can be processed in parallel
+    void split1D(FrameBuffer *frameBuffer, qint32 startLine, qint32 endLine);
+    void split2D(FrameBuffer *frameBuffer, qint32 startLine, qint32 endLine);
     void split3D(FrameBuffer *currentFrame, FrameBuffer *previousFrame);
 
-    void filterIQ(YiqBuffer &yiqBuffer);
-    void splitIQ(FrameBuffer *frameBuffer);
+    void filterIQ(YiqBuffer &yiqBuffer, qint32 startLine, qint32 endLine);
+    void splitIQ(FrameBuffer *frameBuffer, qint32 startLine, qint32 endLine);
 
-    void doCNR(YiqBuffer &yiqBuffer);
-    void doYNR(YiqBuffer &yiqBuffer);
+    // The NR filters carry their history from one line to the next. If
+    // previousLine is not null, it is fed through the filters first, so that
+    // the result is the same as if the preceding lines had been processed.
+    void doCNR(YiqBuffer &yiqBuffer, const YiqLine *previousLine, qint32 startLine, qint32 endLine);
+    void doYNR(YiqBuffer &yiqBuffer, const YiqLine *previousLine, qint32 startLine, qint32 endLine);
 
-    RGBFrame yiqToRgbFrame(const YiqBuffer &yiqBuffer);
-    void overlayOpticalFlowMap(const FrameBuffer &frameBuffer, RGBFrame &rgbOutputFrame);
-    void adjustY(FrameBuffer *frameBuffer, YiqBuffer &yiqBuffer);
+    void yiqToRgbFrame(const YiqBuffer &yiqBuffer, qint32 startLine, qint32 endLine,
+                       const RGBFrameLayout &outputLayout, RGBFrame &rgbOutputFrame);
+    void overlayOpticalFlowMap(const FrameBuffer &frameBuffer, const RGBFrameLayout &outputLayout, RGBFrame &rgbOutputFrame);
+    void adjustY(FrameBuffer *frameBuffer, YiqBuffer &yiqBuffer, qint32 startLine, qint32 endLine);
 };
 
 #endif // COMB_H
@@ -0,0 +1,358 @@
+/************************************************************************
+
+    combkernels.cpp
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "combkernels.h"
+
+#include <cmath>
+
+#include "cpufeatures.h"
+
+// Use AVX2 kernels when the CPU supports them.
+//
+// The AVX2 kernels do the same single-precision operations in the same order
+// as the scalar code (and FMA isn't enabled), so the output is identical.
+#ifdef CPUFEATURES_X86
+#include <immintrin.h>
+#endif
+
+// Definitions of static constexpr data members, for compatibility with
+// pre-C++17 compilers
+constexpr qint32 ChromaPlane::PADDING;
+
+// ChromaPlane ------------------------------------------------------------------------------------------------------
+
+// Number of floats in 32 bytes
+static constexpr qint32 ALIGNMENT = 8;
+
+ChromaPlane::ChromaPlane()
+    : width(0), height(0), stride(0)
+{
+}
+
+void ChromaPlane::resize(qint32 _width, qint32 _height)
+{
+    width = _width;
+    height = _height;
+
+    // Round the line length up so every line starts on an aligned boundary
+    stride = ((width + (2 * PADDING) + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+
+    // Allow extra space so the start of the data can be aligned
+    storage.assign((static_cast<size_t>(stride) * height) + ALIGNMENT, 0.0f);
+}
+
+qint32 ChromaPlane::getWidth() const
+{
+    return width;
+}
+
+qint32 ChromaPlane::getHeight() const
+{
+    return height;
+}
+
+float *ChromaPlane::line(qint32 lineNumber)
+{
+    return alignedData() + (lineNumber * stride) + PADDING;
+}
+
+const float *ChromaPlane::line(qint32 lineNumber) const
+{
+    return alignedData() + (lineNumber * stride) + PADDING;
+}
+
+// The aligned position is worked out on each access (rather than stored), so
+// ChromaPlane can be copied safely
+float *ChromaPlane::alignedData()
+{
+    const quintptr address = reinterpret_cast<quintptr>(storage.data());
+    const quintptr alignMask = (ALIGNMENT * sizeof(float)) - 1;
+    return reinterpret_cast<float *>((address + alignMask) & ~alignMask);
+}
+
+const float *ChromaPlane::alignedData() const
+{
+    return const_cast<ChromaPlane *>(this)->alignedData();
+}
+
+// Scalar kernels ---------------------------------------------------------------------------------------------------
+
+static void split1DScalar(const quint16 *input, qint32 count, float *output)
+{
+    for (qint32 n = 0; n < count; n++) {
+        output[n] = static_cast<float>(((input[n + 2] + input[n - 2]) / 2) - input[n]);
+    }
+}
+
+static void split2DScalar(const float *previousLine, const float *currentLine, const float *nextLine,
+                          qint32 count, float p2dRange, float *output)
+{
+    for (qint32 n = 0; n < count; n++) {
+        float kp, kn;
+
+        kp  = fabsf(fabsf(currentLine[n]) - fabsf(previousLine[n]));
+        kp += fabsf(fabsf(currentLine[n - 1]) - fabsf(previousLine[n - 1]));
+        kp -= (fabsf(currentLine[n]) + fabsf(currentLine[n - 1])) * 0.10f;
+        kn  = fabsf(fabsf(currentLine[n]) - fabsf(nextLine[n]));
+        kn += fabsf(fabsf(currentLine[n - 1]) - fabsf(nextLine[n - 1]));
+        kn -= (fabsf(currentLine[n]) + fabsf(nextLine[n - 1])) * 0.10f;
+
+        kp /= 2;
+        kn /= 2;
+
+        kp = qBound(0.0f, 1 - (kp / p2dRange), 1.0f);
+        kn = qBound(0.0f, 1 - (kn / p2dRange), 1.0f);
+
+        float sc = 1.0f;
+
+        if ((kn > 0) || (kp > 0)) {
+            if (kn > (3 * kp)) kp = 0;
+            else if (kp > (3 * kn)) kn = 0;
+
+            sc = (2.0f / (kn + kp));
+            if (sc < 1.0f) sc = 1.0f;
+        } else {
+            if ((fabsf(fabsf(previousLine[n]) - fabsf(nextLine[n])) - fabsf((nextLine[n] + previousLine[n]) * 0.2f)) <= 0) {
+                kn = kp = 1;
+            }
+        }
+
+        float tc1;
+        tc1  = ((currentLine[n] - previousLine[n]) * kp * sc);
+        tc1 += ((currentLine[n] - nextLine[n]) * kn * sc);
+        tc1 /= 8;
+
+        output[n] = tc1;
+    }
+}
+
+// Split count samples starting at the given phase, carrying the most recent
+// I and Q values in si and sq
+static void splitIQScalar(const quint16 *input, const float *chroma, qint32 count, qint32 phase, bool linePhase,
+                          double &si, double &sq, double *output)
+{
+    for (qint32 n = 0; n < count; n++) {
+        double cavg = chroma[n];
+        if (!linePhase) cavg = -cavg;
+
+        switch (phase) {
+            case 0: sq = cavg; break;
+            case 1: si = -cavg; break;
+            case 2: sq = -cavg; break;
+            case 3: si = cavg; break;
+            default: break;
+        }
+
+        *output++ = input[n];
+        *output++ = si;
+        *output++ = sq;
+
+        phase = (phase + 1) % 4;
+    }
+}
+
+// AVX2 kernels -----------------------------------------------------------------------------------------------------
+
+#ifdef CPUFEATURES_X86
+
+// Each kernel returns the number of samples it's processed; the remainder is
+// done by the scalar code.
+
+__attribute__((target("avx2")))
+static qint32 split1DAvx2(const quint16 *input, qint32 count, float *output)
+{
+    qint32 n = 0;
+    for (; n + 8 <= count; n += 8) {
+        const __m256i left = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input + n - 2)));
+        const __m256i centre = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input + n)));
+        const __m256i right = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input + n + 2)));
+
+        // The sum is never negative, so a shift is the same as dividing by 2
+        const __m256i average = _mm256_srli_epi32(_mm256_add_epi32(right, left), 1);
+        _mm256_storeu_ps(output + n, _mm256_cvtepi32_ps(_mm256_sub_epi32(average, centre)));
+    }
+
+    return n;
+}
+
+__attribute__((target("avx2")))
+static inline __m256 absAvx2(__m256 value)
+{
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), value);
+}
+
+__attribute__((target("avx2")))
+static qint32 split2DAvx2(const float *previousLine, const float *currentLine, const float *nextLine,
+                          qint32 count, float p2dRange, float *output)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 three = _mm256_set1_ps(3.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 eighth = _mm256_set1_ps(0.125f);
+    const __m256 tenth = _mm256_set1_ps(0.10f);
+    const __m256 fifth = _mm256_set1_ps(0.2f);
+    const __m256 range = _mm256_set1_ps(p2dRange);
+
+    qint32 n = 0;
+    for (; n + 8 <= count; n += 8) {
+        const __m256 current = _mm256_loadu_ps(currentLine + n);
+        const __m256 previous = _mm256_loadu_ps(previousLine + n);
+        const __m256 next = _mm256_loadu_ps(nextLine + n);
+
+        const __m256 absCurrent = absAvx2(current);
+        const __m256 absCurrentLeft = absAvx2(_mm256_loadu_ps(currentLine + n - 1));
+        const __m256 absPrevious = absAvx2(previous);
+        const __m256 absPreviousLeft = absAvx2(_mm256_loadu_ps(previousLine + n - 1));
+        const __m256 absNext = absAvx2(next);
+        const __m256 absNextLeft = absAvx2(_mm256_loadu_ps(nextLine + n - 1));
+
+        // Similarity to the previous and next lines
+        __m256 kp = _mm256_add_ps(absAvx2(_mm256_sub_ps(absCurrent, absPrevious)),
+                                  absAvx2(_mm256_sub_ps(absCurrentLeft, absPreviousLeft)));
+        kp = _mm256_sub_ps(kp, _mm256_mul_ps(_mm256_add_ps(absCurrent, absCurrentLeft), tenth));
+        __m256 kn = _mm256_add_ps(absAvx2(_mm256_sub_ps(absCurrent, absNext)),
+                                  absAvx2(_mm256_sub_ps(absCurrentLeft, absNextLeft)));
+        kn = _mm256_sub_ps(kn, _mm256_mul_ps(_mm256_add_ps(absCurrent, absNextLeft), tenth));
+
+        kp = _mm256_mul_ps(kp, half);
+        kn = _mm256_mul_ps(kn, half);
+
+        kp = _mm256_max_ps(_mm256_min_ps(one, _mm256_sub_ps(one, _mm256_div_ps(kp, range))), zero);
+        kn = _mm256_max_ps(_mm256_min_ps(one, _mm256_sub_ps(one, _mm256_div_ps(kn, range))), zero);
+
+        // Compute both sides of the branch in the scalar code, and select
+        // between them with a mask
+        const __m256 either = _mm256_or_ps(_mm256_cmp_ps(kn, zero, _CMP_GT_OQ), _mm256_cmp_ps(kp, zero, _CMP_GT_OQ));
+
+        const __m256 knLarger = _mm256_cmp_ps(kn, _mm256_mul_ps(three, kp), _CMP_GT_OQ);
+        const __m256 kpLarger = _mm256_andnot_ps(knLarger, _mm256_cmp_ps(kp, _mm256_mul_ps(three, kn), _CMP_GT_OQ));
+        const __m256 kpEither = _mm256_andnot_ps(knLarger, kp);
+        const __m256 knEither = _mm256_andnot_ps(kpLarger, kn);
+        const __m256 scEither = _mm256_max_ps(one, _mm256_div_ps(two, _mm256_add_ps(knEither, kpEither)));
+
+        const __m256 neitherSimilar = _mm256_cmp_ps(
+            _mm256_sub_ps(absAvx2(_mm256_sub_ps(absPrevious, absNext)),
+                          absAvx2(_mm256_mul_ps(_mm256_add_ps(next, previous), fifth))),
+            zero, _CMP_LE_OQ);
+        const __m256 kNeither = _mm256_and_ps(neitherSimilar, one);
+
+        kp = _mm256_blendv_ps(kNeither, kpEither, either);
+        kn = _mm256_blendv_ps(kNeither, knEither, either);
+        const __m256 sc = _mm256_blendv_ps(one, scEither, either);
+
+        __m256 tc1 = _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(current, previous), kp), sc);
+        tc1 = _mm256_add_ps(tc1, _mm256_mul_ps(_mm256_mul_ps(_mm256_sub_ps(current, next), kn), sc));
+        _mm256_storeu_ps(output + n, _mm256_mul_ps(tc1, eighth));
+    }
+
+    return n;
+}
+
+// Split groups of 4 samples, starting at phase 0
+__attribute__((target("avx2")))
+static qint32 splitIQAvx2(const quint16 *input, const float *chroma, qint32 count, bool linePhase,
+                          double &si, double *output)
+{
+    const __m256d sign = _mm256_set1_pd(linePhase ? 0.0 : -0.0);
+    const __m256d negate = _mm256_set1_pd(-0.0);
+    __m256d previousI = _mm256_set1_pd(si);
+
+    qint32 n = 0;
+    for (; n + 4 <= count; n += 4) {
+        const __m256d y = _mm256_cvtepi32_pd(_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(input + n))));
+        const __m256d c = _mm256_xor_pd(_mm256_cvtps_pd(_mm_loadu_ps(chroma + n)), sign);
+        const __m256d negC = _mm256_xor_pd(c, negate);
+
+        // I = [previous I, -c1, -c1, c3], Q = [c0, c0, -c2, -c2]
+        const __m256d lastI = _mm256_permute4x64_pd(c, 0xFF);
+        const __m256d i = _mm256_blend_pd(_mm256_blend_pd(_mm256_permute4x64_pd(negC, 0x55), lastI, 0x8), previousI, 0x1);
+        const __m256d q = _mm256_blend_pd(_mm256_permute4x64_pd(c, 0x00), _mm256_permute4x64_pd(negC, 0xAA), 0xC);
+        previousI = lastI;
+
+        // Interleave into Y0 I0 Q0 Y1, I1 Q1 Y2 I2, Q2 Y3 I3 Q3
+        const __m256d out0 = _mm256_blend_pd(_mm256_blend_pd(_mm256_permute4x64_pd(y, 0x40),
+                                                             _mm256_permute4x64_pd(i, 0x00), 0x2),
+                                             _mm256_permute4x64_pd(q, 0x00), 0x4);
+        const __m256d out1 = _mm256_blend_pd(_mm256_blend_pd(_mm256_permute4x64_pd(i, 0x95),
+                                                             _mm256_permute4x64_pd(q, 0x55), 0x2),
+                                             _mm256_permute4x64_pd(y, 0xAA), 0x4);
+        const __m256d out2 = _mm256_blend_pd(_mm256_blend_pd(_mm256_permute4x64_pd(q, 0xEA),
+                                                             _mm256_permute4x64_pd(y, 0xFF), 0x2),
+                                             _mm256_permute4x64_pd(i, 0xFF), 0x4);
+
+        double *outputPointer = output + (n * 3);
+        _mm256_storeu_pd(outputPointer, out0);
+        _mm256_storeu_pd(outputPointer + 4, out1);
+        _mm256_storeu_pd(outputPointer + 8, out2);
+    }
+
+    si = _mm256_cvtsd_f64(previousI);
+    return n;
+}
+
+#endif
+
+// Public functions -------------------------------------------------------------------------------------------------
+
+void combSplit1D(const quint16 *input, qint32 count, float *output)
+{
+    qint32 done = 0;
+#ifdef CPUFEATURES_X86
+    if (cpuHasAvx2()) done = split1DAvx2(input, count, output);
+#endif
+
+    split1DScalar(input + done, count - done, output + done);
+}
+
+void combSplit2D(const float *previousLine, const float *currentLine, const float *nextLine,
+                 qint32 count, float p2dRange, float *output)
+{
+    qint32 done = 0;
+#ifdef CPUFEATURES_X86
+    if (cpuHasAvx2()) done = split2DAvx2(previousLine, currentLine, nextLine, count, p2dRange, output);
+#endif
+
+    split2DScalar(previousLine + done, currentLine + done, nextLine + done, count - done, p2dRange, output + done);
+}
+
+void combSplitIQ(const quint16 *input, const float *chroma, qint32 count, qint32 firstPhase, bool linePhase,
+                 double *output)
+{
+    double si = 0, sq = 0;
+
+    // Process samples up to the first phase 0 sample
+    const qint32 head = qMin((4 - firstPhase) % 4, count);
+    splitIQScalar(input, chroma, head, firstPhase, linePhase, si, sq, output);
+    qint32 done = head;
+
+#ifdef CPUFEATURES_X86
+    // Every group of 4 sets Q before using it, so only I needs carrying over
+    if (cpuHasAvx2()) done += splitIQAvx2(input + done, chroma + done, count - done, linePhase, si, output + (done * 3));
+#endif
+
+    splitIQScalar(input + done, chroma + done, count - done, (firstPhase + done) % 4, linePhase, si, sq,
+                  output + (done * 3));
+}
@@ -0,0 +1,87 @@
+/************************************************************************
+
+    combkernels.h
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef COMBKERNELS_H
+#define COMBKERNELS_H
+
+#include <QtGlobal>
+
+#include <vector>
+
+// Per-line kernels for Comb's 1D/2D chroma separation and I/Q splitting.
+//
+// These work in single precision on lines of the active area only. On x86
+// CPUs with AVX2, SIMD versions are selected at runtime; they give the same
+// results as the scalar versions.
+
+// A single-precision plane covering the active area of a frame.
+//
+// Each line has PADDING zero samples before and after it, so the filters can
+// look just outside the active area. The start of each line is 32-byte
+// aligned.
+class ChromaPlane
+{
+public:
+    static constexpr qint32 PADDING = 8;
+
+    ChromaPlane();
+
+    // Resize the plane and set all samples (including padding) to zero
+    void resize(qint32 width, qint32 height);
+
+    qint32 getWidth() const;
+    qint32 getHeight() const;
+
+    float *line(qint32 lineNumber);
+    const float *line(qint32 lineNumber) const;
+
+private:
+    qint32 width;
+    qint32 height;
+    qint32 stride;
+    std::vector<float> storage;
+
+    float *alignedData();
+    const float *alignedData() const;
+};
+
+// 1D filter: for each sample, subtract it from the average of the samples 2
+// either side, using integer arithmetic. input must be readable from
+// input[-2] to input[count + 1].
+void combSplit1D(const quint16 *input, qint32 count, float *output);
+
+// Adaptive 2D filter, combining each sample of currentLine with the lines
+// above and below depending on how similar they are. All three lines must
+// be readable from [-1]. p2dRange is the IRE-scaled similarity threshold.
+void combSplit2D(const float *previousLine, const float *currentLine, const float *nextLine,
+                 qint32 count, float p2dRange, float *output);
+
+// Split a line of separated chroma into I and Q, writing (Y, I, Q) triples
+// to output with Y taken from the composite input. firstPhase is the
+// subcarrier phase (0-3) of the first sample, and linePhase is the line's
+// burst phase as returned by Comb::GetLinePhase.
+void combSplitIQ(const quint16 *input, const float *chroma, qint32 count, qint32 firstPhase, bool linePhase,
+                 double *output);
+
+#endif // COMBKERNELS_H
@@ -36,6 +36,11 @@ qint32 Decoder::getLookAhead() const
     return 0;
 }
 
+qint32 Decoder::getRunLength() const
+{
+    return 0;
+}
+
 void Decoder::setVideoParameters(Decoder::Configuration &config, const LdDecodeMetaData::VideoParameters &videoParameters) {
     config.videoParameters = videoParameters;
     config.topPadLines = 0;
@@ -75,40 +80,32 @@ void Decoder::setVideoParameters(Decoder::Configuration &config, const LdDecodeM
         }
     }
 
+    // Work out which part of the decoded frame is output
+    config.outputLayout.firstColumn = config.videoParameters.activeVideoStart;
+    config.outputLayout.firstLine = config.videoParameters.firstActiveFrameLine - config.topPadLines;
+    config.outputLayout.width = outputWidth;
+    config.outputLayout.height = outputHeight;
+
     // Show output information to the user
     const qint32 frameHeight = (videoParameters.fieldHeight * 2) - 1;
     qInfo() << "Input video of" << config.videoParameters.fieldWidth << "x" << frameHeight <<
                "will be colourised and trimmed to" << outputWidth << "x" << outputHeight << "RGB 16-16-16 frames";
 }
 
-RGBFrame Decoder::cropOutputFrame(const Decoder::Configuration &config, const RGBFrame &outputData) {
-    const qint32 activeVideoStart = config.videoParameters.activeVideoStart;
-    const qint32 activeVideoEnd = config.videoParameters.activeVideoEnd;
-    const qint32 outputLineLength = (activeVideoEnd - activeVideoStart) * 3;
-
-    RGBFrame croppedData;
+void Decoder::prepareOutputFrame(const Decoder::Configuration &config, RGBFrame &outputFrame) {
+    const qint32 frameSize = config.outputLayout.getFrameSize();
 
-    // Insert padding at the top
-    if (config.topPadLines > 0) {
-        croppedData.insert(croppedData.begin(), config.topPadLines * outputLineLength, 0);
+    // The decoders only ever write to the active area, so the padding lines
+    // in a frame we've used before will still be black. If the frame is the
+    // wrong size, or DecoderPool still holds a reference to it (in which case
+    // writing to it would make a copy), start with a new black frame instead.
+    if (outputFrame.size() != frameSize || !outputFrame.isDetached()) {
+        outputFrame = RGBFrame(frameSize, 0);
     }
-
-    // Copy the active region from the decoded image
-    for (qint32 y = config.videoParameters.firstActiveFrameLine; y < config.videoParameters.lastActiveFrameLine; y++) {
-        croppedData.append(outputData.mid((y * config.videoParameters.fieldWidth * 3) + (activeVideoStart * 3),
-                                          outputLineLength));
-    }
-
-    // Insert padding at the bottom
-    if (config.bottomPadLines > 0) {
-        croppedData.insert(croppedData.end(), config.bottomPadLines * outputLineLength, 0);
-    }
-
-    return croppedData;
 }
 
 DecoderThread::DecoderThread(QAtomicInt& _abort, DecoderPool& _decoderPool, QObject *parent)
-    : QThread(parent), abort(_abort), decoderPool(_decoderPool)
+    : QThread(parent), abort(_abort), decoderPool(_decoderPool), isContinuation(false)
 {
 }
 
@@ -118,13 +115,17 @@ void DecoderThread::run()
     QVector<SourceField> inputFields;
     QVector<RGBFrame> outputFrames;
 
+    // The run of frames this thread is working through
+    DecoderPool::InputRun inputRun;
+
     while (!abort) {
         // Get the next batch of fields to process
         qint32 startFrameNumber, startIndex, endIndex;
-        if (!decoderPool.getInputFrames(startFrameNumber, inputFields, startIndex, endIndex)) {
+        if (!decoderPool.getInputFrames(inputRun, startFrameNumber, inputFields, startIndex, endIndex)) {
             // No more input frames -- exit
             break;
         }
+        isContinuation = inputRun.isContinuation;
 
         // Adjust the output to the right size
         outputFrames.resize((endIndex - startIndex) / 2);
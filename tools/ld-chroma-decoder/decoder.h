@@ -73,6 +73,17 @@ public:
     // The default implementation returns 0, which is appropriate for 1D/2D decoders.
     virtual qint32 getLookAhead() const;
 
+    // After configuration, return the number of frames that each worker
+    // thread would like to process as a contiguous run of batches. Decoders
+    // that carry partial results from the end of one batch into the next can
+    // use this to avoid recomputing work at batch boundaries.
+    // The default implementation returns 0, meaning that every batch is
+    // independent.
+    virtual qint32 getRunLength() const;
+
+    // After configuration, return the layout of the output frames
+    virtual const RGBFrameLayout &getOutputLayout() const = 0;
+
     // Construct a new worker thread
     virtual QThread *makeThread(QAtomicInt& abort, DecoderPool& decoderPool) = 0;
 
@@ -83,14 +94,19 @@ public:
         LdDecodeMetaData::VideoParameters videoParameters;
         qint32 topPadLines;
         qint32 bottomPadLines;
+
+        // The region of the input frame that's written to the output
+        RGBFrameLayout outputLayout;
     };
 
     // Compute the output frame size in Configuration, adjusting the active
     // video region as required
     static void setVideoParameters(Configuration &config, const LdDecodeMetaData::VideoParameters &videoParameters);
 
-    // Crop a full decoded frame to the output frame size
-    static RGBFrame cropOutputFrame(const Configuration &config, const RGBFrame &outputData);
+    // Prepare outputFrame to be decoded into, with the output frame layout.
+    // The frame's storage is reused if possible; anything outside the active
+    // area (i.e. the padding lines) is black.
+    static void prepareOutputFrame(const Configuration &config, RGBFrame &outputFrame);
 };
 
 // Abstract base class for chroma decoder worker threads.
@@ -102,13 +118,19 @@ public:
 protected:
     void run() override;
 
-    // Decode a sequence of fields into a sequence of frames
+    // Decode a sequence of fields into a sequence of frames.
+    // outputFrames has already been resized to the number of frames; each
+    // decoder should use Decoder::prepareOutputFrame before writing to a frame.
     virtual void decodeFrames(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
                               QVector<RGBFrame> &outputFrames) = 0;
 
     // Decoder pool
     QAtomicInt& abort;
     DecoderPool& decoderPool;
+
+    // True if the batch being decoded immediately follows the previous batch
+    // given to this thread (only possible if the decoder asked for a run length)
+    bool isContinuation;
 };
 
 #endif
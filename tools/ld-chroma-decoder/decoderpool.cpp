@@ -24,9 +24,40 @@
 
 #include "decoderpool.h"
 
+#include "numaplacement.h"
+
+#include <QSaveFile>
+#include <QStringList>
+#include <QTextStream>
+
 // Definitions of static constexpr data members, for compatibility with
 // pre-C++17 compilers
 constexpr qint32 DecoderPool::DEFAULT_BATCH_SIZE;
+constexpr qint32 DecoderPool::MAX_PENDING_RUN_FRAMES;
+constexpr qint32 DecoderPool::CHECKPOINT_INTERVAL;
+
+// Open an output file for writing.
+//
+// If keepBytes is 0, the file is created or truncated. Otherwise, the file
+// must already contain at least keepBytes bytes (i.e. the frames completed by a
+// previous run); it is truncated to that length, and opened for appending.
+//
+// Returns true on success, false on failure.
+static bool openOutputFile(QFile &file, const QString &fileName, qint64 keepBytes)
+{
+    file.setFileName(fileName);
+    if (keepBytes == 0) {
+        return file.open(QIODevice::WriteOnly);
+    }
+
+    if (file.size() < keepBytes) {
+        qCritical() << fileName << "is" << file.size() << "bytes long, but the checkpoint says"
+                    << keepBytes << "bytes have been written";
+        return false;
+    }
+
+    return file.resize(keepBytes) && file.open(QIODevice::WriteOnly | QIODevice::Append);
+}
 
 DecoderPool::DecoderPool(Decoder &_decoder, QString _inputFileName,
                          LdDecodeMetaData &_ldDecodeMetaData, QString _outputFileName,
@@ -34,8 +65,24 @@ DecoderPool::DecoderPool(Decoder &_decoder, QString _inputFileName,
     : decoder(_decoder), inputFileName(_inputFileName),
       outputFileName(_outputFileName), startFrame(_startFrame),
       length(_length), maxThreads(_maxThreads),
-      abort(false), ldDecodeMetaData(_ldDecodeMetaData)
+      previewScale(1), numaPlacement(false), abort(false), ldDecodeMetaData(_ldDecodeMetaData)
+{
+}
+
+void DecoderPool::setPreviewOutput(QString _previewFileName, qint32 _previewScale)
 {
+    previewFileName = _previewFileName;
+    previewScale = _previewScale;
+}
+
+void DecoderPool::setCheckpointFile(QString _checkpointFileName)
+{
+    checkpointFileName = _checkpointFileName;
+}
+
+void DecoderPool::setNumaPlacement(bool _numaPlacement)
+{
+    numaPlacement = _numaPlacement;
 }
 
 bool DecoderPool::process()
@@ -47,9 +94,11 @@ bool DecoderPool::process()
         return false;
     }
 
-    // Get the decoder's lookbehind/lookahead requirements
+    // Get the decoder's lookbehind/lookahead/run requirements
     decoderLookBehind = decoder.getLookBehind();
     decoderLookAhead = decoder.getLookAhead();
+    decoderRunLength = decoder.getRunLength();
+    outputLayout = decoder.getOutputLayout();
 
     // Open the source video file
     if (!sourceVideo.open(inputFileName, videoParameters.fieldWidth * videoParameters.fieldHeight)) {
@@ -76,6 +125,25 @@ bool DecoderPool::process()
         }
     }
 
+    // Check that the preview scale suits the output size
+    if (!previewFileName.isEmpty()
+        && ((outputLayout.width % previewScale) != 0 || (outputLayout.height % previewScale) != 0)) {
+        qCritical() << "Output size of" << outputLayout.width << "x" << outputLayout.height
+                    << "is not divisible by the preview scale" << previewScale;
+        sourceVideo.close();
+        return false;
+    }
+
+    // If there's a checkpoint from a previous run, find out where it stopped
+    lastFrameNumber = length + (startFrame - 1);
+    checkpointStartFrame = startFrame;
+    qint32 resumeFrame = startFrame;
+    if (!checkpointFileName.isEmpty() && !readCheckpoint(resumeFrame)) {
+        sourceVideo.close();
+        return false;
+    }
+    const qint32 doneFrames = resumeFrame - startFrame;
+
     // Open the output RGB file
     if (outputFileName == "-") {
         // No output filename, use stdout instead
@@ -88,8 +156,7 @@ bool DecoderPool::process()
         qInfo() << "Using stdout as RGB output";
     } else {
         // Open output file
-        targetVideo.setFileName(outputFileName);
-        if (!targetVideo.open(QIODevice::WriteOnly)) {
+        if (!openOutputFile(targetVideo, outputFileName, doneFrames * getOutputFrameBytes())) {
             // Failed to open output file
             qCritical() << "Could not open " << outputFileName << "as RGB output file";
             sourceVideo.close();
@@ -97,23 +164,78 @@ bool DecoderPool::process()
         }
     }
 
+    // Open the preview file, if there is one
+    if (!previewFileName.isEmpty()) {
+        bool opened;
+        if (previewFileName == "-") {
+            opened = previewVideo.open(stdout, QIODevice::WriteOnly);
+        } else {
+            opened = openOutputFile(previewVideo, previewFileName, doneFrames * getPreviewFrameBytes());
+        }
+        if (!opened) {
+            // Failed to open preview file
+            qCritical() << "Could not open " << previewFileName << "as preview output file";
+            sourceVideo.close();
+            targetVideo.close();
+            return false;
+        }
+
+        qInfo() << "Writing" << (outputLayout.width / previewScale) << "x" << (outputLayout.height / previewScale)
+                << "RGB 8-8-8 preview frames to" << previewFileName;
+    }
+
+    // Skip the frames that the previous run completed
+    if (doneFrames != 0) {
+        qInfo() << "Resuming after" << doneFrames << "frames completed by a previous run";
+        startFrame = resumeFrame;
+        length -= doneFrames;
+    }
+    checkpointFrameNumber = startFrame;
+
+    // Find the NUMA nodes to use
+    numaNodes.clear();
+    if (numaPlacement) {
+        numaNodes = NumaPlacement::getNodes();
+        if (numaNodes.size() < 2) {
+            qInfo() << "Only one NUMA node available - not using NUMA placement";
+            numaNodes.clear();
+        }
+    }
+
     qInfo() << "Using" << maxThreads << "threads";
+    if (!numaNodes.isEmpty()) {
+        qInfo() << "Dividing threads between" << numaNodes.size() << "NUMA nodes";
+    }
     qInfo() << "Processing from start frame #" << startFrame << "with a length of" << length << "frames";
 
     // Initialise processing state
     inputFrameNumber = startFrame;
     outputFrameNumber = startFrame;
-    lastFrameNumber = length + (startFrame - 1);
     totalTimer.start();
 
     // Start a vector of filtering threads to process the video
     QVector<QThread *> threads;
     threads.resize(maxThreads);
+    NumaPlacement placement;
     for (qint32 i = 0; i < maxThreads; i++) {
+        // With NUMA placement, each node gets a contiguous group of threads.
+        // The thread is constructed and started while this thread is bound to
+        // its node, so the decoder's per-thread buffers are allocated on that
+        // node, and the new thread inherits the binding.
+        if (!numaNodes.isEmpty()) {
+            const qint32 node = numaNodes[(i * numaNodes.size()) / maxThreads];
+            if (!placement.bindToNode(node)) {
+                qWarning() << "Could not bind thread" << i << "to NUMA node" << node;
+            }
+        }
+
         threads[i] = decoder.makeThread(abort, *this);
         threads[i]->start(QThread::LowPriority);
     }
 
+    // Put this thread back on the CPUs and memory policy it started with
+    placement.restore();
+
     // Wait for the workers to finish
     for (qint32 i = 0; i < maxThreads; i++) {
         threads[i]->wait();
@@ -124,6 +246,7 @@ bool DecoderPool::process()
     if (abort) {
         sourceVideo.close();
         targetVideo.close();
+        previewVideo.close();
         return false;
     }
 
@@ -133,6 +256,7 @@ bool DecoderPool::process()
         qCritical() << "Incorrect state at end of processing";
         sourceVideo.close();
         targetVideo.close();
+        previewVideo.close();
         return false;
     }
 
@@ -145,11 +269,18 @@ bool DecoderPool::process()
 
     // Close the target video
     targetVideo.close();
+    previewVideo.close();
+
+    // The output is complete, so the checkpoint is no longer needed
+    if (!checkpointFileName.isEmpty()) {
+        QFile::remove(checkpointFileName);
+    }
 
     return true;
 }
 
-bool DecoderPool::getInputFrames(qint32 &startFrameNumber, QVector<SourceField> &fields, qint32 &startIndex, qint32 &endIndex)
+bool DecoderPool::getInputFrames(InputRun &run, qint32 &startFrameNumber, QVector<SourceField> &fields,
+                                 qint32 &startIndex, qint32 &endIndex)
 {
     QMutexLocker locker(&inputMutex);
 
@@ -159,31 +290,72 @@ bool DecoderPool::getInputFrames(qint32 &startFrameNumber, QVector<SourceField>
     // reasonable.
     const qint32 maxBatchSize = qMin(DEFAULT_BATCH_SIZE, qMax(1, length / maxThreads));
 
-    // Work out how many frames will be in this batch
-    qint32 batchFrames = qMin(maxBatchSize, lastFrameNumber + 1 - inputFrameNumber);
-    if (batchFrames == 0) {
-        // No more input frames
-        return false;
+    if (run.nextFrameNumber > run.lastFrameNumber) {
+        // This thread has finished its previous run (if any), so start a new one.
+        //
+        // If the decoder wants runs longer than a batch, limit them so that
+        // every thread still gets some work. The writer has to buffer the
+        // output from the other threads while the thread with the oldest run
+        // catches up, so also limit them so that the other threads' runs
+        // don't add up to more than MAX_PENDING_RUN_FRAMES.
+        const qint32 maxPendingRunSize = MAX_PENDING_RUN_FRAMES / qMax(1, maxThreads - 1);
+        const qint32 maxRunSize = qMax(maxBatchSize, qMin(decoderRunLength, qMin(length / maxThreads, maxPendingRunSize)));
+        const qint32 runFrames = qMin(maxRunSize, lastFrameNumber + 1 - inputFrameNumber);
+        if (runFrames == 0) {
+            // No more input frames
+            return false;
+        }
+
+        run.nextFrameNumber = inputFrameNumber;
+        run.lastFrameNumber = inputFrameNumber + runFrames - 1;
+        run.isContinuation = false;
+        inputFrameNumber += runFrames;
+    } else {
+        run.isContinuation = true;
     }
 
+    // Work out how many frames will be in this batch
+    const qint32 batchFrames = qMin(maxBatchSize, run.lastFrameNumber + 1 - run.nextFrameNumber);
+
     // Advance the frame number
-    startFrameNumber = inputFrameNumber;
-    inputFrameNumber += batchFrames;
+    startFrameNumber = run.nextFrameNumber;
+    run.nextFrameNumber += batchFrames;
 
-    // Load the fields
+    // Load the fields, reusing any left over from the previous batch in this run
     SourceField::loadFields(sourceVideo, ldDecodeMetaData,
                             startFrameNumber, batchFrames, decoderLookBehind, decoderLookAhead,
-                            fields, startIndex, endIndex);
+                            fields, startIndex, endIndex,
+                            run.isContinuation ? run.fieldsFrameNumber : -1);
+    run.fieldsFrameNumber = startFrameNumber - decoderLookBehind;
+
+    if (!numaNodes.isEmpty()) {
+        locker.unlock();
+
+        // The field data may be shared with SourceVideo's cache, in memory
+        // allocated by a thread on another node. Copy it into memory local to
+        // this thread, so the decoder doesn't read it across nodes.
+        for (SourceField &field : fields) {
+            field.data.detach();
+        }
+    }
 
     return true;
 }
 
 bool DecoderPool::putOutputFrames(qint32 startFrameNumber, const QVector<RGBFrame> &outputFrames)
 {
+    // Make the preview frames in the worker thread, before taking the lock
+    QVector<PreviewFrame> previewFrames(outputFrames.size());
+    if (previewVideo.isOpen()) {
+        for (qint32 i = 0; i < outputFrames.size(); i++) {
+            makePreviewFrame(outputFrames[i], previewFrames[i]);
+        }
+    }
+
     QMutexLocker locker(&outputMutex);
 
     for (qint32 i = 0; i < outputFrames.size(); i++) {
-        if (!putOutputFrame(startFrameNumber + i, outputFrames[i])) {
+        if (!putOutputFrame(startFrameNumber + i, outputFrames[i], previewFrames[i])) {
             return false;
         }
     }
@@ -199,10 +371,13 @@ bool DecoderPool::putOutputFrames(qint32 startFrameNumber, const QVector<RGBFram
 // whether we can now write some of them out.
 //
 // Returns true on success, false on failure.
-bool DecoderPool::putOutputFrame(qint32 frameNumber, const RGBFrame &outputFrame)
+bool DecoderPool::putOutputFrame(qint32 frameNumber, const RGBFrame &outputFrame, const PreviewFrame &previewFrame)
 {
     // Put this frame into the map
     pendingOutputFrames[frameNumber] = outputFrame;
+    if (previewVideo.isOpen()) {
+        pendingPreviewFrames[frameNumber] = previewFrame;
+    }
 
     // Write out as many frames as possible
     while (pendingOutputFrames.contains(outputFrameNumber)) {
@@ -216,6 +391,19 @@ bool DecoderPool::putOutputFrame(qint32 frameNumber, const RGBFrame &outputFrame
         }
 
         pendingOutputFrames.remove(outputFrameNumber);
+
+        // Save the preview frame, if there is one
+        if (previewVideo.isOpen()) {
+            const PreviewFrame &previewData = pendingPreviewFrames.value(outputFrameNumber);
+            if (previewVideo.write(previewData) != previewData.size()) {
+                // Could not write to preview file
+                qCritical() << "Writing to the preview output file failed";
+                return false;
+            }
+
+            pendingPreviewFrames.remove(outputFrameNumber);
+        }
+
         outputFrameNumber++;
 
         const qint32 outputCount = outputFrameNumber - startFrame;
@@ -226,5 +414,155 @@ bool DecoderPool::putOutputFrame(qint32 frameNumber, const RGBFrame &outputFrame
         }
     }
 
+    // Record how far we've got, if checkpointing is enabled
+    if (!checkpointFileName.isEmpty() && (outputFrameNumber - checkpointFrameNumber) >= CHECKPOINT_INTERVAL) {
+        if (!writeCheckpoint()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Make a downscaled RGB 8-8-8 preview of an output frame.
+//
+// Each preview pixel is the mean of a previewScale x previewScale block of
+// output pixels (a box filter), rounded and converted from 16 to 8 bits.
+void DecoderPool::makePreviewFrame(const RGBFrame &outputFrame, PreviewFrame &previewFrame) const
+{
+    const qint32 previewWidth = outputLayout.width / previewScale;
+    const qint32 previewHeight = outputLayout.height / previewScale;
+    previewFrame.resize(previewWidth * previewHeight * 3);
+
+    // Dividing the sum by this gives an 8-bit mean, since 65535 / 257 = 255
+    const qint32 divisor = previewScale * previewScale * 257;
+
+    QVector<qint32> sums(previewWidth * 3);
+    const quint16 *inputData = outputFrame.data();
+    quint8 *outputData = reinterpret_cast<quint8 *>(previewFrame.data());
+
+    for (qint32 y = 0; y < previewHeight; y++) {
+        // Sum each block of input lines, horizontally then vertically
+        sums.fill(0);
+        for (qint32 line = y * previewScale; line < (y + 1) * previewScale; line++) {
+            const quint16 *inputLine = inputData + (line * outputLayout.width * 3);
+            for (qint32 x = 0; x < previewWidth; x++) {
+                for (qint32 i = 0; i < previewScale * 3; i += 3) {
+                    const quint16 *inputPixel = inputLine + (x * previewScale * 3) + i;
+                    sums[(x * 3)] += inputPixel[0];
+                    sums[(x * 3) + 1] += inputPixel[1];
+                    sums[(x * 3) + 2] += inputPixel[2];
+                }
+            }
+        }
+
+        for (qint32 i = 0; i < previewWidth * 3; i++) {
+            *outputData++ = static_cast<quint8>((sums[i] + (divisor / 2)) / divisor);
+        }
+    }
+}
+
+// Return the size of an output frame in bytes
+qint64 DecoderPool::getOutputFrameBytes() const
+{
+    return static_cast<qint64>(outputLayout.getFrameSize()) * 2;
+}
+
+// Return the size of a preview frame in bytes, or 0 if there's no preview
+qint64 DecoderPool::getPreviewFrameBytes() const
+{
+    if (previewFileName.isEmpty()) {
+        return 0;
+    }
+
+    return static_cast<qint64>(outputLayout.width / previewScale) * (outputLayout.height / previewScale) * 3;
+}
+
+// Read the checkpoint file, if it exists, and set resumeFrame to the first
+// frame that hasn't been written yet. The checkpoint must have been written
+// for the same range of frames and output format.
+//
+// Returns true on success (including if there's no checkpoint file), false on
+// failure.
+bool DecoderPool::readCheckpoint(qint32 &resumeFrame)
+{
+    QFile checkpointFile(checkpointFileName);
+    if (!checkpointFile.exists()) {
+        qInfo() << "No checkpoint file found - starting from the beginning";
+        return true;
+    }
+    if (!checkpointFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qCritical() << "Could not open checkpoint file" << checkpointFileName;
+        return false;
+    }
+
+    // Read the "name value" pairs
+    QMap<QString, qint64> values;
+    QTextStream stream(&checkpointFile);
+    while (!stream.atEnd()) {
+        const QStringList fields = stream.readLine().split(' ');
+        bool ok = fields.size() == 2;
+        if (ok) {
+            values[fields[0]] = fields[1].toLongLong(&ok);
+        }
+        if (!ok) {
+            qCritical() << "Checkpoint file" << checkpointFileName << "is not valid";
+            return false;
+        }
+    }
+    checkpointFile.close();
+
+    // Check that it's from a run with the same parameters
+    if (values.value("startFrame", -1) != checkpointStartFrame || values.value("lastFrame", -1) != lastFrameNumber
+        || values.value("frameBytes", -1) != getOutputFrameBytes()
+        || values.value("previewFrameBytes", -1) != getPreviewFrameBytes()) {
+        qCritical() << "Checkpoint file" << checkpointFileName << "is for a different range of frames or output format";
+        return false;
+    }
+
+    const qint64 nextFrame = values.value("nextFrame", -1);
+    if (nextFrame < startFrame || nextFrame > (lastFrameNumber + 1)) {
+        qCritical() << "Checkpoint file" << checkpointFileName << "has an invalid next frame number" << nextFrame;
+        return false;
+    }
+
+    resumeFrame = static_cast<qint32>(nextFrame);
+    return true;
+}
+
+// Write the checkpoint file, recording that all frames before
+// outputFrameNumber have been written. You must hold outputMutex to call this.
+//
+// Returns true on success, false on failure.
+bool DecoderPool::writeCheckpoint()
+{
+    // Make sure the frames have reached the output files first
+    if (!targetVideo.flush() || (previewVideo.isOpen() && !previewVideo.flush())) {
+        qCritical() << "Flushing the output files failed";
+        return false;
+    }
+
+    // Write the new checkpoint to a temporary file, then replace the old one
+    // with it, so there's always a complete checkpoint file
+    QSaveFile checkpointFile(checkpointFileName);
+    if (!checkpointFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qCritical() << "Could not open checkpoint file" << checkpointFileName;
+        return false;
+    }
+
+    QTextStream stream(&checkpointFile);
+    stream << "startFrame " << checkpointStartFrame << "\n";
+    stream << "lastFrame " << lastFrameNumber << "\n";
+    stream << "frameBytes " << getOutputFrameBytes() << "\n";
+    stream << "previewFrameBytes " << getPreviewFrameBytes() << "\n";
+    stream << "nextFrame " << outputFrameNumber << "\n";
+    stream.flush();
+
+    if (!checkpointFile.commit()) {
+        qCritical() << "Writing checkpoint file" << checkpointFileName << "failed";
+        return false;
+    }
+
+    checkpointFrameNumber = outputFrameNumber;
     return true;
 }
@@ -27,6 +27,7 @@
 
 #include <QObject>
 #include <QAtomicInt>
+#include <QByteArray>
 #include <QElapsedTimer>
 #include <QMap>
 #include <QMutex>
@@ -46,12 +47,49 @@ public:
                          LdDecodeMetaData &ldDecodeMetaData, QString outputFileName,
                          qint32 startFrame, qint32 length, qint32 maxThreads);
 
+    // Also write a downscaled preview of each output frame to previewFileName,
+    // as RGB 8-8-8 frames with each pixel being the mean of a scale x scale
+    // block of output pixels. Call this before process().
+    void setPreviewOutput(QString previewFileName, qint32 previewScale);
+
+    // Record progress in checkpointFileName while decoding, so that an
+    // interrupted run can be resumed. If the checkpoint file already exists,
+    // the output files are truncated to the frames it says were completed, and
+    // decoding continues from the next frame. Call this before process().
+    void setCheckpointFile(QString checkpointFileName);
+
+    // Divide the worker threads into a group for each NUMA node, binding each
+    // thread to its node's CPUs and memory. Call this before process().
+    void setNumaPlacement(bool numaPlacement);
+
     // Decode fields to frames as specified by the constructor args.
     // Returns true on success; on failure, prints a message and returns false.
     bool process();
 
+    // The contiguous run of frames that a worker thread is working through.
+    // Each worker should have its own InputRun, and pass it to every call to
+    // getInputFrames.
+    struct InputRun {
+        // The next frame to return, and the last frame in the run
+        qint32 nextFrameNumber = 0;
+        qint32 lastFrameNumber = -1;
+
+        // The frame number corresponding to fields[0] after the last call,
+        // or -1 if fields doesn't contain anything reusable
+        qint32 fieldsFrameNumber = -1;
+
+        // True if the batch just returned immediately follows the previous
+        // batch returned for this run
+        bool isContinuation = false;
+    };
+
     // For worker threads: get the next batch of data from the input file.
     //
+    // If the Decoder asked for a run length, consecutive calls with the same
+    // run will return consecutive batches until the run is complete, so the
+    // worker can carry state from one batch to the next. Fields that overlap
+    // with the previous batch are reused rather than being read again.
+    //
     // fields will be resized and filled with pairs of SourceFields; entries
     // from startIndex to endIndex are those that should be processed into
     // output frames, with startIndex corresponding to the first field of frame
@@ -64,7 +102,8 @@ public:
     //
     // Returns true if a frame was returned, false if the end of the input has
     // been reached.
-    bool getInputFrames(qint32 &startFrameNumber, QVector<SourceField> &fields, qint32 &startIndex, qint32 &endIndex);
+    bool getInputFrames(InputRun &run, qint32 &startFrameNumber, QVector<SourceField> &fields,
+                        qint32 &startIndex, qint32 &endIndex);
 
     // For worker threads: return decoded frames to write to the output file.
     //
@@ -75,11 +114,26 @@ public:
     bool putOutputFrames(qint32 startFrameNumber, const QVector<RGBFrame> &outputFrames);
 
 private:
-    bool putOutputFrame(qint32 frameNumber, const RGBFrame &outputFrame);
+    // A downscaled preview frame, containing triples of (R, G, B) bytes
+    using PreviewFrame = QByteArray;
+
+    bool putOutputFrame(qint32 frameNumber, const RGBFrame &outputFrame, const PreviewFrame &previewFrame);
+    void makePreviewFrame(const RGBFrame &outputFrame, PreviewFrame &previewFrame) const;
+    qint64 getOutputFrameBytes() const;
+    qint64 getPreviewFrameBytes() const;
+    bool readCheckpoint(qint32 &resumeFrame);
+    bool writeCheckpoint();
 
     // Default batch size, in frames
     static constexpr qint32 DEFAULT_BATCH_SIZE = 16;
 
+    // Maximum number of frames from the other threads' runs that the writer
+    // should have to buffer while the thread with the oldest run catches up
+    static constexpr qint32 MAX_PENDING_RUN_FRAMES = 256;
+
+    // Minimum number of frames to write between checkpoints
+    static constexpr qint32 CHECKPOINT_INTERVAL = 32;
+
     // Parameters
     Decoder& decoder;
     QString inputFileName;
@@ -87,15 +141,26 @@ private:
     qint32 startFrame;
     qint32 length;
     qint32 maxThreads;
+    QString previewFileName;
+    qint32 previewScale;
+    QString checkpointFileName;
+    bool numaPlacement;
+
+    // Output frame layout, from the decoder
+    RGBFrameLayout outputLayout;
 
     // Atomic abort flag shared by worker threads; workers watch this, and shut
     // down as soon as possible if it becomes true
     QAtomicInt abort;
 
+    // The NUMA nodes to place worker threads on
+    QVector<qint32> numaNodes;
+
     // Input stream information (all guarded by inputMutex while threads are running)
     QMutex inputMutex;
     qint32 decoderLookBehind;
     qint32 decoderLookAhead;
+    qint32 decoderRunLength;
     qint32 inputFrameNumber;
     qint32 lastFrameNumber;
     LdDecodeMetaData &ldDecodeMetaData;
@@ -105,7 +170,11 @@ private:
     QMutex outputMutex;
     qint32 outputFrameNumber;
     QMap<qint32, RGBFrame> pendingOutputFrames;
+    QMap<qint32, PreviewFrame> pendingPreviewFrames;
     QFile targetVideo;
+    QFile previewVideo;
+    qint32 checkpointStartFrame;
+    qint32 checkpointFrameNumber;
     QElapsedTimer totalTimer;
 };
 
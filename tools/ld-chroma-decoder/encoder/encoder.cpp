@@ -0,0 +1,264 @@
+/************************************************************************
+
+    encoder.cpp
+
+    ld-chroma-encoder - PAL/NTSC encoder for testing
+    Copyright (C) 2019-2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "encoder.h"
+
+#include <QtConcurrent/QtConcurrent>
+
+#include <cmath>
+
+// Number of frames per thread in each batch read from the input
+static constexpr qint32 BATCH_FRAMES_PER_THREAD = 2;
+
+Encoder::Encoder(QFile &_rgbFile, QFile &_tbcFile, LdDecodeMetaData &_metaData, qint32 _threads)
+    : rgbFile(_rgbFile), tbcFile(_tbcFile), metaData(_metaData), threads(_threads)
+{
+    encodePool.setMaxThreadCount(threads);
+}
+
+// This is a three-stage pipeline: while one batch of frames is being encoded,
+// the next batch is being read and the previous batch is being written in
+// the background. Two input and two output buffers are used alternately.
+// Only one write is in flight at a time, because QFile isn't thread-safe and
+// the batches must be written in order; each batch's write starts only once
+// the previous batch's write has finished, which also means the output
+// buffer being encoded into is never still being written.
+bool Encoder::encode()
+{
+    // The RGB data is triples of 16-bit unsigned numbers in native byte order.
+    rgbFrameBytes = activeWidth * activeHeight * 3 * 2;
+
+    // Each field is fieldHeight lines of fieldWidth samples (including a
+    // dummy line at the end of the second field).
+    fieldSamples = videoParameters.fieldWidth * videoParameters.fieldHeight;
+
+    const qint32 batchFrames = threads * BATCH_FRAMES_PER_THREAD;
+
+    QByteArray inputBuffers[2];
+    QVector<quint16> outputBuffers[2];
+    for (qint32 i = 0; i < 2; i++) {
+        inputBuffers[i].resize(batchFrames * rgbFrameBytes);
+        outputBuffers[i].resize(batchFrames * 2 * fieldSamples);
+    }
+
+    QFuture<bool> writeFuture;
+    bool writePending = false;
+    bool success = true;
+
+    // Start reading the first batch
+    qint32 current = 0;
+    QFuture<qint32> readFuture = QtConcurrent::run(this, &Encoder::readFrames, &inputBuffers[current]);
+
+    qint32 numFrames = 0;
+    while (true) {
+        // Wait for the current batch to be read
+        const qint32 batchSize = readFuture.result();
+        if (batchSize < 0) {
+            success = false;
+            break;
+        }
+        if (batchSize == 0) {
+            break;
+        }
+
+        // A short batch means we've reached the end of the input; otherwise, start reading the next one
+        const bool isComplete = batchSize < batchFrames;
+        if (!isComplete) {
+            readFuture = QtConcurrent::run(this, &Encoder::readFrames, &inputBuffers[current ^ 1]);
+        }
+
+        // Encode the frames in parallel
+        const quint16 *rgbData = reinterpret_cast<const quint16 *>(inputBuffers[current].constData());
+        quint16 *outputData = outputBuffers[current].data();
+        QVector<QFuture<void>> encodeFutures;
+        for (qint32 i = 0; i < batchSize; i++) {
+            encodeFutures.append(QtConcurrent::run(&encodePool, this, &Encoder::encodeFrame, numFrames + i,
+                                                   rgbData + (i * (rgbFrameBytes / 2)),
+                                                   outputData + (i * 2 * fieldSamples)));
+        }
+        for (QFuture<void> &future : encodeFutures) {
+            future.waitForFinished();
+        }
+
+        // Wait for the previous batch's write to finish, then start writing this one
+        if (writePending) {
+            writePending = false;
+            if (!writeFuture.result()) {
+                success = false;
+                break;
+            }
+        }
+        writeFuture = QtConcurrent::run(this, &Encoder::writeFrames, &outputBuffers[current], batchSize);
+        writePending = true;
+
+        // Generate the field metadata, in order
+        for (qint32 i = 0; i < batchSize * 2; i++) {
+            metaData.appendField(makeFieldMetadata((numFrames * 2) + i));
+        }
+        numFrames += batchSize;
+
+        if (isComplete) {
+            break;
+        }
+        current ^= 1;
+    }
+
+    // Wait for any outstanding reads and writes
+    readFuture.waitForFinished();
+    if (writePending && !writeFuture.result()) {
+        success = false;
+    }
+    if (!success) {
+        return false;
+    }
+
+    // Store video parameters, now we've generated all the fields
+    metaData.setVideoParameters(videoParameters);
+
+    return true;
+}
+
+// Read up to a batch of frames from the input into buffer.
+// Returns the number of frames read (0 at EOF); on failure, prints an error and returns -1.
+qint32 Encoder::readFrames(QByteArray *buffer)
+{
+    qint64 remainBytes = buffer->size();
+    qint64 posBytes = 0;
+    while (remainBytes > 0) {
+        qint64 count = rgbFile.read(buffer->data() + posBytes, remainBytes);
+        if (count == 0) {
+            // EOF
+            break;
+        } else if (count < 0) {
+            qCritical() << "Error reading from input file";
+            return -1;
+        }
+        remainBytes -= count;
+        posBytes += count;
+    }
+
+    if ((posBytes % rgbFrameBytes) != 0) {
+        qCritical() << "Unexpected end of input file";
+        return -1;
+    }
+
+    return static_cast<qint32>(posBytes / rgbFrameBytes);
+}
+
+// Write numFrames encoded frames from buffer to the output.
+// Returns true on success; on failure, prints an error and returns false.
+bool Encoder::writeFrames(const QVector<quint16> *buffer, qint32 numFrames)
+{
+    // TBC data is unsigned 16-bit values in native byte order
+    const char *outputData = reinterpret_cast<const char *>(buffer->constData());
+    qint64 remainBytes = static_cast<qint64>(numFrames) * 2 * fieldSamples * 2;
+    qint64 posBytes = 0;
+    while (remainBytes > 0) {
+        qint64 count = tbcFile.write(outputData + posBytes, remainBytes);
+        if (count < 0) {
+            qCritical() << "Error writing to output file";
+            return false;
+        }
+        remainBytes -= count;
+        posBytes += count;
+    }
+
+    return true;
+}
+
+// Encode one frame from rgbData into two fields at outputData.
+void Encoder::encodeFrame(qint32 frameNo, const quint16 *rgbData, quint16 *outputData) const
+{
+    // Encode the two fields -- even-numbered lines, then odd-numbered lines.
+    // In a PAL TBC file, the first field is the one that starts with the
+    // half-line (i.e. frame line 44, when counting from 0); in an NTSC TBC
+    // file, it's the one that ends with the half-line (frame line 524).
+    encodeField(frameNo * 2, rgbData, outputData);
+    encodeField((frameNo * 2) + 1, rgbData, outputData + fieldSamples);
+}
+
+// Encode one field from an RGB frame into outputData.
+void Encoder::encodeField(qint32 fieldNo, const quint16 *rgbData, quint16 *outputData) const
+{
+    const qint32 lineOffset = fieldNo % 2;
+
+    LineBuffers buffers;
+    buffers.Y.resize(videoParameters.fieldWidth);
+    buffers.C1.resize(videoParameters.fieldWidth);
+    buffers.C2.resize(videoParameters.fieldWidth);
+
+    for (qint32 frameLine = 0; frameLine < 2 * videoParameters.fieldHeight; frameLine++) {
+        // Skip lines that aren't in this field
+        if ((frameLine % 2) != lineOffset) {
+            continue;
+        }
+
+        // Encode the line
+        const quint16 *lineData = nullptr;
+        if (frameLine >= activeTop && frameLine < (activeTop + activeHeight)) {
+            lineData = rgbData + ((frameLine - activeTop) * activeWidth * 3);
+        }
+        encodeLine(fieldNo, frameLine, lineData, buffers, outputData + ((frameLine / 2) * videoParameters.fieldWidth));
+    }
+}
+
+// Generate a gate waveform with raised-cosine transitions, with 50% points at given start and end times
+double Encoder::raisedCosineGate(double t, double startTime, double endTime, double halfRiseTime)
+{
+    if (t < startTime - halfRiseTime) {
+        return 0.0;
+    } else if (t < startTime + halfRiseTime) {
+        return 0.5 + (0.5 * sin((M_PI / 2.0) * ((t - startTime) / halfRiseTime)));
+    } else if (t < endTime - halfRiseTime) {
+        return 1.0;
+    } else if (t < endTime + halfRiseTime) {
+        return 0.5 - (0.5 * sin((M_PI / 2.0) * ((t - endTime) / halfRiseTime)));
+    } else {
+        return 0.0;
+    }
+}
+
+// Generate a gate waveform for a sync pulse in one half of a line
+double Encoder::syncPulseGate(double t, double startTime, SyncPulseType type, double linePeriod)
+{
+    // Timings from [Poynton p521]. The 625-line and 525-line systems have the
+    // same pulse widths, to within the tolerances allowed.
+    double length;
+    switch (type) {
+    case NONE:
+        return 0.0;
+    case NORMAL:
+        length = 4.7e-6;
+        break;
+    case EQUALISATION:
+        length = 4.7e-6 / 2.0;
+        break;
+    case BROAD:
+        length = (linePeriod / 2.0) - 4.7e-6;
+        break;
+    }
+
+    return raisedCosineGate(t, startTime, startTime + length, 200.0e-9 / 2.0);
+}
+
@@ -0,0 +1,112 @@
+/************************************************************************
+
+    encoder.h
+
+    ld-chroma-encoder - PAL/NTSC encoder for testing
+    Copyright (C) 2019-2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QThreadPool>
+#include <QVector>
+
+#include "lddecodemetadata.h"
+
+// Abstract base class for composite encoders.
+//
+// This handles reading RGB frames, scheduling the encoding work across
+// threads, and writing the TBC file and metadata. Subclasses set up the video
+// parameters and the position of the input image in their constructors, and
+// implement encodeLine and makeFieldMetadata.
+class Encoder
+{
+public:
+    Encoder(QFile &rgbFile, QFile &tbcFile, LdDecodeMetaData &metaData, qint32 threads = 1);
+    virtual ~Encoder() = default;
+
+    // Encode RGB stream to composite.
+    //
+    // Frames are read and written in batches, with the frames in each batch
+    // encoded in parallel on up to threads threads. The output and metadata
+    // are the same whatever the number of threads.
+    //
+    // Returns true on success; on failure, prints an error and returns false.
+    bool encode();
+
+protected:
+    // Y' and chroma samples for one line (U and V for PAL, I and Q for NTSC)
+    struct LineBuffers {
+        QVector<double> Y;
+        QVector<double> C1;
+        QVector<double> C2;
+    };
+
+    // Encode one line of a field into outputLine. fieldNo counts from 0 at
+    // the start of the output; frameLine is the line number within the frame,
+    // counting from 0. rgbData points to the line's input samples, or is
+    // nullptr if the line is outside the input image.
+    virtual void encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *rgbData, LineBuffers &buffers,
+                            quint16 *outputLine) const = 0;
+
+    // Generate the metadata for one field
+    virtual LdDecodeMetaData::Field makeFieldMetadata(qint32 fieldNo) const = 0;
+
+    // Types of sync pulse [Poynton p521]
+    enum SyncPulseType {
+        NONE = 0,
+        NORMAL,
+        EQUALISATION,
+        BROAD
+    };
+
+    static double raisedCosineGate(double t, double startTime, double endTime, double halfRiseTime);
+    static double syncPulseGate(double t, double startTime, SyncPulseType type, double linePeriod);
+
+    LdDecodeMetaData::VideoParameters videoParameters;
+    double fSC;
+    double sampleRate;
+    qint32 activeWidth;
+    qint32 activeHeight;
+    qint32 activeLeft;
+    qint32 activeTop;
+
+private:
+    qint32 readFrames(QByteArray *buffer);
+    bool writeFrames(const QVector<quint16> *buffer, qint32 numFrames);
+    void encodeFrame(qint32 frameNo, const quint16 *rgbData, quint16 *outputData) const;
+    void encodeField(qint32 fieldNo, const quint16 *rgbData, quint16 *outputData) const;
+
+    QFile &rgbFile;
+    QFile &tbcFile;
+    LdDecodeMetaData &metaData;
+    qint32 threads;
+
+    // Sizes of an input frame in bytes, and an output field in samples
+    qint32 rgbFrameBytes;
+    qint32 fieldSamples;
+
+    // Threads used to encode frames
+    QThreadPool encodePool;
+};
+
+#endif
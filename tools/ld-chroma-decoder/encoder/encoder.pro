@@ -1,4 +1,5 @@
 QT -= gui
+QT += concurrent
 
 CONFIG += c++11 console
 CONFIG -= app_bundle
@@ -17,16 +18,22 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    encoder.cpp \
     main.cpp \
+    ntscencoder.cpp \
     palencoder.cpp \
     ../../library/tbc/lddecodemetadata.cpp \
+    ../../library/tbc/metadatareader.cpp \
     ../../library/tbc/logging.cpp \
     ../../library/tbc/vbidecoder.cpp
 
 HEADERS += \
+    encoder.h \
+    ntscencoder.h \
     palencoder.h \
     ../../library/filter/firfilter.h \
     ../../library/tbc/lddecodemetadata.h \
+    ../../library/tbc/metadatareader.h \
     ../../library/tbc/logging.h \
     ../../library/tbc/vbidecoder.h
 
@@ -2,7 +2,7 @@
 
     main.cpp
 
-    ld-chroma-encoder - PAL encoder for testing
+    ld-chroma-encoder - PAL/NTSC encoder for testing
     Copyright (C) 2019-2020 Adam Sampson
 
     This file is part of ld-decode-tools.
@@ -27,11 +27,13 @@
 #include <QFile>
 #include <QtGlobal>
 #include <QCommandLineParser>
+#include <QThread>
 #include <cstdio>
 
 #include "lddecodemetadata.h"
 #include "logging.h"
 
+#include "ntscencoder.h"
 #include "palencoder.h"
 
 int main(int argc, char *argv[])
@@ -50,7 +52,7 @@ int main(int argc, char *argv[])
     // Set up the command line parser
     QCommandLineParser parser;
     parser.setApplicationDescription(
-                "ld-chroma-encoder - PAL encoder for testing\n"
+                "ld-chroma-encoder - PAL/NTSC encoder for testing\n"
                 "\n"
                 "(c)2019-2020 Adam Sampson\n"
                 "GPLv3 Open-Source - github: https://github.com/happycube/ld-decode");
@@ -62,11 +64,23 @@ int main(int argc, char *argv[])
     // Add the standard debug options --debug and --quiet
     addStandardDebugOptions(parser);
 
+    // Option to select the video system (--system)
+    QCommandLineOption systemOption(QStringList() << "system",
+                                    QCoreApplication::translate("main", "Video system to encode: pal, ntsc (default pal)"),
+                                    QCoreApplication::translate("main", "system"));
+    parser.addOption(systemOption);
+
     // Option to produce subcarrier-locked output (-c)
     QCommandLineOption scLockedOption(QStringList() << "c" << "sc-locked",
                                       QCoreApplication::translate("main", "Output samples are subcarrier-locked (default: line-locked)"));
     parser.addOption(scLockedOption);
 
+    // Option to select the number of threads (-t)
+    QCommandLineOption threadsOption(QStringList() << "t" << "threads",
+                                     QCoreApplication::translate("main", "Specify the number of concurrent threads (default number of logical CPUs)"),
+                                     QCoreApplication::translate("main", "number"));
+    parser.addOption(threadsOption);
+
     // -- Positional arguments --
 
     // Positional argument to specify input video file
@@ -84,6 +98,34 @@ int main(int argc, char *argv[])
     // Get the options from the parser
     const bool scLocked = parser.isSet(scLockedOption);
 
+    QString system = "pal";
+    if (parser.isSet(systemOption)) {
+        system = parser.value(systemOption);
+
+        if (system != "pal" && system != "ntsc") {
+            // Quit with error
+            qCritical() << "Unknown video system" << system;
+            return -1;
+        }
+    }
+
+    if (scLocked && system != "pal") {
+        // Quit with error
+        qCritical("Subcarrier-locked output is only supported for PAL");
+        return -1;
+    }
+
+    qint32 maxThreads = QThread::idealThreadCount();
+    if (parser.isSet(threadsOption)) {
+        maxThreads = parser.value(threadsOption).toInt();
+
+        if (maxThreads < 1) {
+            // Quit with error
+            qCritical("Specified number of threads must be greater than zero");
+            return -1;
+        }
+    }
+
     // Get the arguments from the parser
     QString inputFileName;
     QString outputFileName;
@@ -126,8 +168,15 @@ int main(int argc, char *argv[])
 
     // Encode the data
     LdDecodeMetaData metaData;
-    PALEncoder encoder(rgbFile, tbcFile, metaData, scLocked);
-    if (!encoder.encode()) {
+    bool success;
+    if (system == "ntsc") {
+        NTSCEncoder encoder(rgbFile, tbcFile, metaData, maxThreads);
+        success = encoder.encode();
+    } else {
+        PALEncoder encoder(rgbFile, tbcFile, metaData, scLocked, maxThreads);
+        success = encoder.encode();
+    }
+    if (!success) {
         return -1;
     }
 
@@ -0,0 +1,292 @@
+/************************************************************************
+
+    ntscencoder.cpp
+
+    ld-chroma-encoder - NTSC encoder for testing
+    Copyright (C) 2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+/*!
+    \class NTSCEncoder
+
+    This is a simplistic NTSC encoder for decoder testing, producing output
+    in the same format as ld-decode's NTSC TBC files. As with PALEncoder, the
+    code aims to be accurate rather than fast.
+
+    References:
+
+    [Poynton] "Digital Video and HDTV Algorithms and Interfaces" by Charles
+    Poynton, 2003, first edition, ISBN 1-55860-792-7.
+
+    [SMPTE] "Composite Analog Video Signal -- NTSC for Studio Applications",
+    SMPTE 170M-2004.
+ */
+
+#include "ntscencoder.h"
+
+#include "firfilter.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+NTSCEncoder::NTSCEncoder(QFile &_rgbFile, QFile &_tbcFile, LdDecodeMetaData &_metaData, qint32 _threads)
+    : Encoder(_rgbFile, _tbcFile, _metaData, _threads)
+{
+    // NTSC subcarrier frequency [SMPTE]
+    fSC = 315.0e6 / 88.0;
+
+    // Parameters for 4fSC sampling. In NTSC, each line is exactly 227.5
+    // cycles of the subcarrier long, so line-locked sampling at 4fSC is also
+    // subcarrier-locked.
+    //
+    // Each frame in the TBC file contains 910 x 525 samples. As with
+    // ld-decode's output, this is treated as:
+    // - field 1: 910 x 263 lines (lines 1-263, ending with a half-line)
+    // - field 2: 910 x 262 lines (lines 264-525), plus a dummy line
+    sampleRate = 4 * fSC;
+
+    // 4fSC samples are taken on the I and Q axes, which are 33 degrees ahead
+    // of the subcarrier's zero crossing at 0H (see encodeLine), so 0H falls
+    // 33/90 of a sample after a sample point. ld-chroma-decoder's NTSC
+    // decoder expects the phase at the start of each line that ld-decode
+    // produces, where 0H is a few samples before the start of the line.
+    zeroH = ((33.0 / 90.0) - 3.0) / sampleRate;
+
+    // Burst gate opens 19 cycles after 0H, and closes 9 cycles later. [SMPTE]
+    const double burstStartPos = (zeroH * sampleRate) + (19 * 4);
+    const double burstEndPos = burstStartPos + (9 * 4);
+    videoParameters.colourBurstStart = static_cast<qint32>(lrint(burstStartPos));
+    videoParameters.colourBurstEnd = static_cast<qint32>(lrint(burstEndPos));
+
+    // The active region, based on ld-decode's usual output
+    videoParameters.activeVideoStart = 134;
+    videoParameters.activeVideoEnd = 894;
+
+    videoParameters.isSourcePal = false;
+    videoParameters.isSubcarrierLocked = false;
+    // White level and blanking level, extended to 16 bits, as in ld-decode's
+    // output. There's no 7.5 IRE setup, so black is the same as blanking.
+    videoParameters.white16bIre = 0xC800;
+    videoParameters.black16bIre = 0x3C00;
+    videoParameters.fieldWidth = 910;
+    videoParameters.fieldHeight = 263;
+    // sampleRate and fsc are integers in this struct, so they're not precise;
+    // the code below uses fSC and sampleRate instead
+    videoParameters.sampleRate = static_cast<qint32>(lrint(sampleRate));
+    videoParameters.fsc = static_cast<qint32>(lrint(fSC));
+    videoParameters.isMapped = false;
+    // numberOfSequentialFields will be computed automatically.
+
+    // Compute the location of the input image within the NTSC frame. This
+    // matches the output of ld-chroma-decoder: it uses the whole active
+    // region horizontally, and pads the 485 active lines (frame lines 40 to
+    // 524) to 488 by adding two lines above and one below.
+    activeWidth = videoParameters.activeVideoEnd - videoParameters.activeVideoStart;
+    activeLeft = videoParameters.activeVideoStart;
+    activeTop = 40 - 2;
+    activeHeight = 488;
+}
+
+// Generate the metadata for one field
+LdDecodeMetaData::Field NTSCEncoder::makeFieldMetadata(qint32 fieldNo) const
+{
+    LdDecodeMetaData::Field fieldData;
+    fieldData.isFirstField = (fieldNo % 2) == 0;
+    fieldData.syncConf = 100;
+    // Burst peak-to-peak amplitude is 40 IRE [SMPTE]
+    fieldData.medianBurstIRE = 40.0 / 2.0;
+    // The four fields of the colour sequence are numbered 1-4, as in ld-decode
+    fieldData.fieldPhaseID = (fieldNo % 4) + 1;
+    fieldData.audioSamples = 0;
+
+    return fieldData;
+}
+
+// 1.3 MHz low-pass Gaussian filter for I.
+// Generated by: c = scipy.signal.gaussian(13, 1.15); c / sum(c)
+//
+// The I filter should be < 2 dB down at 1.3 MHz [SMPTE]; this is 1.87 dB down.
+static constexpr std::array<double, 13> iFilterCoeffs {
+    4.258040893283087e-07, 2.7248929813379124e-05, 0.0008186533631722096, 0.011546799590355636, 0.07645998064036029,
+    0.2376937251944782, 0.3469063329554619, 0.2376937251944782, 0.07645998064036029, 0.011546799590355636,
+    0.0008186533631722096, 2.7248929813379124e-05, 4.258040893283087e-07
+};
+static constexpr auto iFilter = makeFIRFilter(iFilterCoeffs);
+
+// 0.4 MHz low-pass Gaussian filter for Q.
+// Generated by: c = scipy.signal.gaussian(29, 3.8); c / sum(c)
+//
+// The Q filter should be < 2 dB down at 0.4 MHz [SMPTE]; this is 1.93 dB down.
+static constexpr std::array<double, 29> qFilterCoeffs {
+    0.00011850998270927008, 0.00030184095705607485, 0.0007173409251318639, 0.0015907328609918168,
+    0.0032914942575984337, 0.0063549648919602785, 0.011448732663121818, 0.0192453528490033, 0.0301869021089919,
+    0.04418098760652447, 0.06033599761133446, 0.07688502871094768, 0.09141790590233558, 0.1014249871749667,
+    0.10499844299465277, 0.1014249871749667, 0.09141790590233558, 0.07688502871094768, 0.06033599761133446,
+    0.04418098760652447, 0.0301869021089919, 0.0192453528490033, 0.011448732663121818, 0.0063549648919602785,
+    0.0032914942575984337, 0.0015907328609918168, 0.0007173409251318639, 0.00030184095705607485,
+    0.00011850998270927008
+};
+static constexpr auto qFilter = makeFIRFilter(qFilterCoeffs);
+
+void NTSCEncoder::encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *rgbData, LineBuffers &buffers,
+                             quint16 *outputLine) const
+{
+    std::fill(outputLine, outputLine + videoParameters.fieldWidth, static_cast<quint16>(videoParameters.black16bIre));
+    if (frameLine == 525) {
+        // Dummy last line
+        return;
+    }
+
+    // The first two lines of the input are padding above the active region
+    // (see above), so they aren't encoded
+    if (frameLine < 40) {
+        rgbData = nullptr;
+    }
+
+    // Which line is this within the field, counting from 0?
+    const bool isSecondField = (frameLine % 2) == 1;
+    const qint32 fieldLine = frameLine / 2;
+
+    // How many complete lines have gone by since the start of the 4-field sequence?
+    const qint32 fieldID = fieldNo % 4;
+    const qint32 prevLines = ((fieldID / 2) * 525) + ((fieldID % 2) * 263) + fieldLine;
+
+    // How many cycles of the subcarrier have gone by at 0H? [SMPTE]
+    const double prevCycles = prevLines * 227.5;
+
+    // Burst peak-to-peak amplitude is 40 IRE [SMPTE]
+    double burstAmplitude = 40.0 / 100.0;
+
+    // Compute colourburst gating times, relative to 0H [SMPTE]
+    const double halfBurstRiseTime = 300.0e-9 / 2.0;
+    const double burstStartTime = 19.0 / fSC;
+    const double burstEndTime = burstStartTime + (9.0 / fSC);
+
+    // Compute luma/chroma gating times, relative to 0H, as in PALEncoder
+    const double halfLumaRiseTime = 2.0 / (4.0 * fSC);
+    const double halfChromaRiseTime = 3.0 / (4.0 * fSC);
+    const double activeStartTime = (videoParameters.activeVideoStart / sampleRate) - zeroH - (2.0 * halfChromaRiseTime);
+    double activeEndTime = (videoParameters.activeVideoEnd / sampleRate) - zeroH + (2.0 * halfChromaRiseTime);
+
+    // Compute sync pulse times and pattern, relative to 0H [SMPTE]
+    // Sync level is -40 IRE, or 0x0400
+    const double linePeriod = videoParameters.fieldWidth / sampleRate;
+    const double syncLevel = -40.0 / 100.0;
+    const double leftSyncStartTime = 0.0;
+    const double rightSyncStartTime = linePeriod / 2.0;
+    SyncPulseType leftSyncType = NORMAL;
+    SyncPulseType rightSyncType = NONE;
+    if (!isSecondField) {
+        // Lines 1-263
+        if (fieldLine < 3) {
+            leftSyncType = rightSyncType = EQUALISATION;
+        } else if (fieldLine < 6) {
+            leftSyncType = rightSyncType = BROAD;
+        } else if (fieldLine < 9) {
+            leftSyncType = rightSyncType = EQUALISATION;
+        } else if (fieldLine == 262) {
+            rightSyncType = EQUALISATION;
+        }
+    } else {
+        // Lines 264-525 (the vertical interval starts halfway through line 263)
+        if (fieldLine < 2) {
+            leftSyncType = rightSyncType = EQUALISATION;
+        } else if (fieldLine == 2) {
+            leftSyncType = EQUALISATION;
+            rightSyncType = BROAD;
+        } else if (fieldLine < 5) {
+            leftSyncType = rightSyncType = BROAD;
+        } else if (fieldLine == 5) {
+            leftSyncType = BROAD;
+            rightSyncType = EQUALISATION;
+        } else if (fieldLine < 8) {
+            leftSyncType = rightSyncType = EQUALISATION;
+        } else if (fieldLine == 8) {
+            leftSyncType = EQUALISATION;
+        }
+    }
+
+    // Line 263 only has picture in its first half
+    if (frameLine == 524) {
+        activeEndTime = rightSyncStartTime - 1.5e-6;
+    }
+
+    // Burst suppression during the vertical interval [SMPTE]
+    if (leftSyncType != NORMAL) {
+        burstAmplitude = 0.0;
+    }
+
+    // Clear Y'IQ buffers. Values in these are scaled so that 0.0 is black and
+    // 1.0 is white.
+    QVector<double> &Y = buffers.Y;
+    QVector<double> &I = buffers.C1;
+    QVector<double> &Q = buffers.C2;
+    Y.fill(0.0);
+    I.fill(0.0);
+    Q.fill(0.0);
+
+    if (rgbData != nullptr) {
+        // Convert the R'G'B' data to Y'IQ form. This is the inverse of the
+        // matrix used in ld-chroma-decoder. [Poynton p367]
+        for (qint32 i = 0; i < activeWidth; i++) {
+            const double R = rgbData[i * 3]       / 65535.0;
+            const double G = rgbData[(i * 3) + 1] / 65535.0;
+            const double B = rgbData[(i * 3) + 2] / 65535.0;
+
+            const qint32 x = activeLeft + i;
+            Y[x] = (R * 0.299)    + (G * 0.587)     + (B * 0.114);
+            I[x] = (R * 0.595901) + (G * -0.274557) + (B * -0.321344);
+            Q[x] = (R * 0.211537) + (G * -0.522736) + (B * 0.311200);
+        }
+
+        // Low-pass filter I to 1.3 MHz and Q to 0.4 MHz [SMPTE]
+        iFilter.apply(I);
+        qFilter.apply(Q);
+    }
+
+    for (qint32 x = 0; x < videoParameters.fieldWidth; x++) {
+        // For this sample, compute time relative to 0H, and subcarrier phase
+        const double t = (x / sampleRate) - zeroH;
+        const double a = 2.0 * M_PI * ((fSC * t) + prevCycles);
+
+        // Generate colourburst, at 180 degrees [SMPTE]
+        const double burst = sin(a + M_PI) * burstAmplitude / 2.0;
+
+        // Encode the chroma signal. I and Q are at 33 degrees to V and U, so
+        // this is equivalent to (U * sin(a)) + (V * cos(a)). [SMPTE]
+        const double chroma = (I[x] * cos(a + (33.0 * M_PI / 180.0))) + (Q[x] * sin(a + (33.0 * M_PI / 180.0)));
+
+        // Combine everything to make up the composite signal
+        const double burstGate = raisedCosineGate(t, burstStartTime, burstEndTime, halfBurstRiseTime);
+        const double lumaGate = raisedCosineGate(t, activeStartTime, activeEndTime, halfLumaRiseTime);
+        const double chromaGate = raisedCosineGate(t, activeStartTime, activeEndTime, halfChromaRiseTime);
+        const double leftSyncGate = syncPulseGate(t, leftSyncStartTime, leftSyncType, linePeriod);
+        const double rightSyncGate = syncPulseGate(t, rightSyncStartTime, rightSyncType, linePeriod);
+        const double composite = (burst * burstGate)
+                                 + qBound(-lumaGate, Y[x], lumaGate)
+                                 + qBound(-chromaGate, chroma, chromaGate)
+                                 + (syncLevel * (leftSyncGate + rightSyncGate));
+
+        // Scale to a 16-bit output sample and limit the excursion to the
+        // permitted sample values, as in PALEncoder
+        const double scaled = (composite * (videoParameters.white16bIre - videoParameters.black16bIre)) + videoParameters.black16bIre;
+        outputLine[x] = qBound(static_cast<double>(0x0100), scaled, static_cast<double>(0xFEFF));
+    }
+}
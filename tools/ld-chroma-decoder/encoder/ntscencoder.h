@@ -0,0 +1,49 @@
+/************************************************************************
+
+    ntscencoder.h
+
+    ld-chroma-encoder - NTSC encoder for testing
+    Copyright (C) 2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef NTSCENCODER_H
+#define NTSCENCODER_H
+
+#include <QFile>
+
+#include "lddecodemetadata.h"
+
+#include "encoder.h"
+
+class NTSCEncoder : public Encoder
+{
+public:
+    NTSCEncoder(QFile &rgbFile, QFile &tbcFile, LdDecodeMetaData &metaData, qint32 threads = 1);
+
+protected:
+    void encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *rgbData, LineBuffers &buffers,
+                    quint16 *outputLine) const override;
+    LdDecodeMetaData::Field makeFieldMetadata(qint32 fieldNo) const override;
+
+private:
+    // Time at which 0H occurs within each line (see the constructor)
+    double zeroH;
+};
+
+#endif
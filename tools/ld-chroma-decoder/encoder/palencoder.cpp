@@ -46,11 +46,12 @@
 
 #include "firfilter.h"
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 
-PALEncoder::PALEncoder(QFile &_rgbFile, QFile &_tbcFile, LdDecodeMetaData &_metaData, bool _scLocked)
-    : rgbFile(_rgbFile), tbcFile(_tbcFile), metaData(_metaData), scLocked(_scLocked)
+PALEncoder::PALEncoder(QFile &_rgbFile, QFile &_tbcFile, LdDecodeMetaData &_metaData, bool _scLocked, qint32 _threads)
+    : Encoder(_rgbFile, _tbcFile, _metaData, _threads), scLocked(_scLocked)
 {
     // PAL subcarrier frequency [Poynton p529] [EBU p5]
     fSC = 4433618.75;
@@ -126,110 +127,11 @@ PALEncoder::PALEncoder(QFile &_rgbFile, QFile &_tbcFile, LdDecodeMetaData &_meta
     activeTop = 44;
     activeHeight = 620 - activeTop;
 
-    // Resize the input buffer.
-    // The RGB data is triples of 16-bit unsigned numbers in native byte order.
-    rgbFrame.resize(activeWidth * activeHeight * 3 * 2);
-
-    // Resize the output buffers.
-    Y.resize(videoParameters.fieldWidth);
-    U.resize(videoParameters.fieldWidth);
-    V.resize(videoParameters.fieldWidth);
-}
-
-bool PALEncoder::encode()
-{
-    // Process frames until EOF
-    qint32 numFrames = 0;
-    while (true) {
-        qint32 result = encodeFrame(numFrames);
-        if (result == -1) {
-            return false;
-        } else if (result == 0) {
-            break;
-        }
-        numFrames++;
-    }
-
-    // Store video parameters, now we've generated all the fields
-    metaData.setVideoParameters(videoParameters);
-
-    return true;
 }
 
-// Read one frame from the input, and write two fields to the output.
-// Returns 0 on EOF, 1 on success; on failure, prints an error and returns -1.
-qint32 PALEncoder::encodeFrame(qint32 frameNo)
+// Generate the metadata for one field
+LdDecodeMetaData::Field PALEncoder::makeFieldMetadata(qint32 fieldNo) const
 {
-    // Read the input frame
-    qint64 remainBytes = rgbFrame.size();
-    qint64 posBytes = 0;
-    while (remainBytes > 0) {
-        qint64 count = rgbFile.read(rgbFrame.data() + posBytes, remainBytes);
-        if (count == 0 && remainBytes == rgbFrame.size()) {
-            // EOF at the start of a frame
-            return 0;
-        } else if (count == 0) {
-            qCritical() << "Unexpected end of input file";
-            return -1;
-        } else if (count < 0) {
-            qCritical() << "Error reading from input file";
-            return -1;
-        }
-        remainBytes -= count;
-        posBytes += count;
-    }
-
-    // Write the two fields -- even-numbered lines, then odd-numbered lines.
-    // In a PAL TBC file, the first field is the one that starts with the
-    // half-line (i.e. frame line 44, when counting from 0).
-    if (!encodeField(frameNo * 2)) {
-        return -1;
-    }
-    if (!encodeField((frameNo * 2) + 1)) {
-        return -1;
-    }
-
-    return 1;
-}
-
-// Encode one field from rgbFrame to the output.
-// Returns true on success; on failure, prints an error and returns false.
-bool PALEncoder::encodeField(qint32 fieldNo)
-{
-    const qint32 lineOffset = fieldNo % 2;
-
-    // TBC data is unsigned 16-bit values in native byte order
-    QVector<quint16> outputLine;
-
-    for (qint32 frameLine = 0; frameLine < 2 * videoParameters.fieldHeight; frameLine++) {
-        // Skip lines that aren't in this field
-        if ((frameLine % 2) != lineOffset) {
-            continue;
-        }
-
-        // Encode the line
-        const quint16 *rgbData = nullptr;
-        if (frameLine >= activeTop && frameLine < (activeTop + activeHeight)) {
-            rgbData = reinterpret_cast<const quint16 *>(rgbFrame.data()) + ((frameLine - activeTop) * activeWidth * 3);
-        }
-        encodeLine(fieldNo, frameLine, rgbData, outputLine);
-
-        // Write the line to the TBC file
-        const char *outputData = reinterpret_cast<const char *>(outputLine.data());
-        qint64 remainBytes = outputLine.size() * 2;
-        qint64 posBytes = 0;
-        while (remainBytes > 0) {
-            qint64 count = tbcFile.write(outputData + posBytes, remainBytes);
-            if (count < 0) {
-                qCritical() << "Error writing to output file";
-                return false;
-            }
-            remainBytes -= count;
-            posBytes += count;
-        }
-    }
-
-    // Generate field metadata
     LdDecodeMetaData::Field fieldData;
     fieldData.isFirstField = (fieldNo % 2) == 0;
     fieldData.syncConf = 100;
@@ -237,55 +139,8 @@ bool PALEncoder::encodeField(qint32 fieldNo)
     fieldData.medianBurstIRE = 100.0 * (3.0 / 7.0) / 2.0;
     fieldData.fieldPhaseID = 0;
     fieldData.audioSamples = 0;
-    metaData.appendField(fieldData);
-
-    return true;
-}
-
-// Generate a gate waveform with raised-cosine transitions, with 50% points at given start and end times
-static double raisedCosineGate(double t, double startTime, double endTime, double halfRiseTime)
-{
-    if (t < startTime - halfRiseTime) {
-        return 0.0;
-    } else if (t < startTime + halfRiseTime) {
-        return 0.5 + (0.5 * sin((M_PI / 2.0) * ((t - startTime) / halfRiseTime)));
-    } else if (t < endTime - halfRiseTime) {
-        return 1.0;
-    } else if (t < endTime + halfRiseTime) {
-        return 0.5 - (0.5 * sin((M_PI / 2.0) * ((t - endTime) / halfRiseTime)));
-    } else {
-        return 0.0;
-    }
-}
-
-// Types of sync pulse [Poynton p521]
-enum SyncPulseType {
-    NONE = 0,
-    NORMAL,
-    EQUALISATION,
-    BROAD
-};
-
-// Generate a gate waveform for a sync pulse in one half of a line
-static double syncPulseGate(double t, double startTime, SyncPulseType type)
-{
-    // Timings from [Poynton p521]
-    double length;
-    switch (type) {
-    case NONE:
-        return 0.0;
-    case NORMAL:
-        length = 4.7e-6;
-        break;
-    case EQUALISATION:
-        length = 4.7e-6 / 2.0;
-        break;
-    case BROAD:
-        length = (64.0e-6 / 2.0) - 4.7e-6;
-        break;
-    }
 
-    return raisedCosineGate(t, startTime, startTime + length, 200.0e-9 / 2.0);
+    return fieldData;
 }
 
 // 1.3 MHz low-pass Gaussian filter, as used in pyctools-pal's coder.
@@ -300,7 +155,8 @@ static constexpr std::array<double, 13> uvFilterCoeffs {
 };
 static constexpr auto uvFilter = makeFIRFilter(uvFilterCoeffs);
 
-void PALEncoder::encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *rgbData, QVector<quint16> &outputLine)
+void PALEncoder::encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *rgbData, LineBuffers &buffers,
+                            quint16 *outputLine) const
 {
     // Resize the output line and fill with black
     qint32 lineLen = videoParameters.fieldWidth;
@@ -311,8 +167,7 @@ void PALEncoder::encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *rgb
     } else if (frameLine == 623 || frameLine == 624) {
         lineLen += 2;
     }
-    outputLine.resize(videoParameters.fieldWidth);
-    outputLine.fill(videoParameters.black16bIre);
+    std::fill(outputLine, outputLine + videoParameters.fieldWidth, static_cast<quint16>(videoParameters.black16bIre));
     if (frameLine == 625) {
         // Dummy last line
         return;
@@ -397,6 +252,9 @@ void PALEncoder::encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *rgb
 
     // Clear Y'UV buffers. Values in these are scaled so that 0.0 is black and
     // 1.0 is white.
+    QVector<double> &Y = buffers.Y;
+    QVector<double> &U = buffers.C1;
+    QVector<double> &V = buffers.C2;
     Y.fill(0.0);
     U.fill(0.0);
     V.fill(0.0);
@@ -422,7 +280,7 @@ void PALEncoder::encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *rgb
         uvFilter.apply(V);
     }
 
-    for (qint32 x = 0; x < outputLine.size(); x++) {
+    for (qint32 x = 0; x < videoParameters.fieldWidth; x++) {
         // For this sample, compute time relative to 0H, and subcarrier phase
         const double t = (x / sampleRate) - zeroH;
         const double a = 2.0 * M_PI * ((fSC * t) + prevCycles);
@@ -437,8 +295,8 @@ void PALEncoder::encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *rgb
         const double burstGate = raisedCosineGate(t, burstStartTime, burstEndTime, halfBurstRiseTime);
         const double lumaGate = raisedCosineGate(t, activeStartTime, activeEndTime, halfLumaRiseTime);
         const double chromaGate = raisedCosineGate(t, activeStartTime, activeEndTime, halfChromaRiseTime);
-        const double leftSyncGate = syncPulseGate(t, leftSyncStartTime, leftSyncType);
-        const double rightSyncGate = syncPulseGate(t, rightSyncStartTime, rightSyncType);
+        const double leftSyncGate = syncPulseGate(t, leftSyncStartTime, leftSyncType, 64.0e-6);
+        const double rightSyncGate = syncPulseGate(t, rightSyncStartTime, rightSyncType, 64.0e-6);
         const double composite = (burst * burstGate)
                                  + qBound(-lumaGate, Y[x], lumaGate)
                                  + qBound(-chromaGate, chroma, chromaGate)
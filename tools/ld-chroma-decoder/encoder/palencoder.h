@@ -25,43 +25,24 @@
 #ifndef PALENCODER_H
 #define PALENCODER_H
 
-#include <QByteArray>
 #include <QFile>
-#include <QVector>
 
 #include "lddecodemetadata.h"
 
-class PALEncoder
+#include "encoder.h"
+
+class PALEncoder : public Encoder
 {
 public:
-    PALEncoder(QFile &rgbFile, QFile &tbcFile, LdDecodeMetaData &metaData, bool scLocked);
+    PALEncoder(QFile &rgbFile, QFile &tbcFile, LdDecodeMetaData &metaData, bool scLocked, qint32 threads = 1);
 
-    // Encode RGB stream to PAL.
-    // Returns true on success; on failure, prints an error and returns false.
-    bool encode();
+protected:
+    void encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *rgbData, LineBuffers &buffers,
+                    quint16 *outputLine) const override;
+    LdDecodeMetaData::Field makeFieldMetadata(qint32 fieldNo) const override;
 
 private:
-    qint32 encodeFrame(qint32 frameNo);
-    bool encodeField(qint32 fieldNo);
-    void encodeLine(qint32 fieldNo, qint32 frameLine, const quint16 *rgbData, QVector<quint16> &outputLine);
-
-    QFile &rgbFile;
-    QFile &tbcFile;
-    LdDecodeMetaData &metaData;
     bool scLocked;
-
-    LdDecodeMetaData::VideoParameters videoParameters;
-    double fSC;
-    double sampleRate;
-    qint32 activeWidth;
-    qint32 activeHeight;
-    qint32 activeLeft;
-    qint32 activeTop;
-
-    QByteArray rgbFrame;
-    QVector<double> Y;
-    QVector<double> U;
-    QVector<double> V;
 };
 
 #endif
@@ -28,8 +28,9 @@
 // pre-C++17 compilers
 constexpr FrameCanvas::RGB FrameCanvas::green;
 
-FrameCanvas::FrameCanvas(RGBFrame &_rgbFrame, const LdDecodeMetaData::VideoParameters &_videoParameters)
-    : rgbData(_rgbFrame.data()), rgbSize(_rgbFrame.size()), videoParameters(_videoParameters)
+FrameCanvas::FrameCanvas(RGBFrame &_rgbFrame, const RGBFrameLayout &_rgbLayout,
+                         const LdDecodeMetaData::VideoParameters &_videoParameters)
+    : rgbData(_rgbFrame.data()), rgbLayout(_rgbLayout), videoParameters(_videoParameters)
 {
 }
 
@@ -60,12 +61,12 @@ FrameCanvas::RGB FrameCanvas::grey(quint16 value)
 
 void FrameCanvas::drawPoint(qint32 x, qint32 y, const RGB& colour)
 {
-    const qint32 offset = ((y * videoParameters.fieldWidth) + x) * 3;
-    if (x < 0 || x >= videoParameters.fieldWidth || offset < 0 || offset >= (rgbSize - 2)) {
-        // Outside the frame
+    if (x < left() || x >= right() || y < top() || y >= bottom() || !rgbLayout.contains(x, y)) {
+        // Outside the active area
         return;
     }
 
+    const qint32 offset = rgbLayout.getOffset(x, y);
     rgbData[offset] = colour.r;
     rgbData[offset + 1] = colour.g;
     rgbData[offset + 2] = colour.b;
@@ -31,12 +31,14 @@
 
 #include "rgbframe.h"
 
-// Context for drawing on top of a full-frame RGB image.
+// Context for drawing on top of an RGB image.
 class FrameCanvas {
 public:
-    // rgbFrame is the frame to draw upon, and videoParameters gives its dimensions.
-    // (Both parameters are captured by reference, not copied.)
-    FrameCanvas(RGBFrame &rgbFrame, const LdDecodeMetaData::VideoParameters &videoParameters);
+    // rgbFrame is the frame to draw upon, rgbLayout gives its layout, and
+    // videoParameters gives the active area. Drawing is clipped to the
+    // active area. (All parameters are captured by reference, not copied.)
+    FrameCanvas(RGBFrame &rgbFrame, const RGBFrameLayout &rgbLayout,
+                const LdDecodeMetaData::VideoParameters &videoParameters);
 
     // Return the edges of the active area.
     qint32 top();
@@ -62,7 +64,7 @@ public:
 
 private:
     quint16 *rgbData;
-    qint32 rgbSize;
+    const RGBFrameLayout &rgbLayout;
     const LdDecodeMetaData::VideoParameters &videoParameters;
 };
 
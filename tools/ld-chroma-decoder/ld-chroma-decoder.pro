@@ -15,36 +15,45 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    bandrunner.cpp \
     comb.cpp \
+    combkernels.cpp \
     decoder.cpp \
     decoderpool.cpp \
     framecanvas.cpp \
     main.cpp \
     monodecoder.cpp \
+    numaplacement.cpp \
     ntscdecoder.cpp \
     palcolour.cpp \
     paldecoder.cpp \
     rgb.cpp \
+    rgbconversion.cpp \
     sourcefield.cpp \
     transformpal.cpp \
     transformpal2d.cpp \
     transformpal3d.cpp \
     yiq.cpp \
     ../library/tbc/lddecodemetadata.cpp \
+    ../library/tbc/metadatareader.cpp \
     ../library/tbc/sourcevideo.cpp \
     ../library/tbc/vbidecoder.cpp \
     ../library/tbc/logging.cpp
 
 HEADERS += \
+    bandrunner.h \
     comb.h \
+    combkernels.h \
     decoder.h \
     decoderpool.h \
     framecanvas.h \
     monodecoder.h \
+    numaplacement.h \
     ntscdecoder.h \
     palcolour.h \
     paldecoder.h \
     rgb.h \
+    rgbconversion.h \
     rgbframe.h \
     sourcefield.h \
     transformpal.h \
@@ -55,7 +64,9 @@ HEADERS += \
     ../library/filter/deemp.h \
     ../library/filter/firfilter.h \
     ../library/filter/iirfilter.h \
+    ../library/tbc/cpufeatures.h \
     ../library/tbc/lddecodemetadata.h \
+    ../library/tbc/metadatareader.h \
     ../library/tbc/sourcevideo.h \
     ../library/tbc/vbidecoder.h \
     ../library/tbc/logging.h
@@ -89,4 +100,13 @@ INCLUDEPATH += "/usr/local/include"
 
 # Normal open-source OS goodness
 LIBS += -L"/usr/local/lib"
-LIBS += -lfftw3
+LIBS += -lfftw3 -lfftw3f
+
+# Use libnuma for NUMA-aware thread placement, if it's available
+unix:!macx {
+    CONFIG += link_pkgconfig
+    packagesExist(numa) {
+        PKGCONFIG += numa
+        DEFINES += USE_LIBNUMA
+    }
+}
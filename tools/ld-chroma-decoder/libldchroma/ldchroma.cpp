@@ -0,0 +1,275 @@
+/************************************************************************
+
+    ldchroma.cpp
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "ldchroma.h"
+
+#include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QScopedPointer>
+#include <algorithm>
+
+#include "lddecodemetadata.h"
+
+#include "comb.h"
+#include "decoder.h"
+#include "monodecoder.h"
+#include "palcolour.h"
+#include "sourcefield.h"
+
+// FFTW's planner isn't thread-safe, and PalColour makes FFTW plans when it's
+// configured and destroys them when it's deleted -- so creating and
+// destroying decoders must be serialised across all threads.
+static QMutex plannerMutex;
+
+struct ldchroma_decoder {
+    ldchroma_decoder_type type;
+    Decoder::Configuration config;
+    qint32 lookBehind;
+    qint32 lookAhead;
+
+    // Only one of these is used, depending on type
+    QScopedPointer<PalColour> palColour;
+    QScopedPointer<Comb> comb;
+
+    // Held while decoding, so that calls from different threads are serialised
+    QMutex mutex;
+
+    // Buffers, kept between calls to avoid reallocating them
+    QVector<SourceField> inputFields;
+    QVector<RGBFrame> outputFrames;
+};
+
+int ldchroma_get_api_version(void)
+{
+    return LDCHROMA_API_VERSION;
+}
+
+void ldchroma_options_init(ldchroma_options *options)
+{
+    const PalColour::Configuration palConfig;
+    const Comb::Configuration combConfig;
+
+    options->chroma_gain = palConfig.chromaGain;
+    options->threads = palConfig.intraFrameThreads;
+    options->simple_pal = palConfig.simplePAL ? 1 : 0;
+    options->transform_threshold = palConfig.transformThreshold;
+    options->transform_single_precision = palConfig.transformSinglePrecision ? 1 : 0;
+    options->white_point_75 = combConfig.whitePoint75 ? 1 : 0;
+    options->luma_nr_level = combConfig.yNRLevel;
+    options->chroma_nr_level = combConfig.cNRLevel;
+}
+
+ldchroma_decoder *ldchroma_decoder_create(ldchroma_decoder_type type,
+                                          const ldchroma_video_parameters *video_parameters,
+                                          const ldchroma_options *options)
+{
+    ldchroma_options defaultOptions;
+    if (options == nullptr) {
+        ldchroma_options_init(&defaultOptions);
+        options = &defaultOptions;
+    }
+
+    // Convert the video parameters, and work out the active region
+    LdDecodeMetaData::VideoParameters videoParameters {};
+    videoParameters.isSourcePal = video_parameters->is_source_pal != 0;
+    videoParameters.colourBurstStart = video_parameters->colour_burst_start;
+    videoParameters.colourBurstEnd = video_parameters->colour_burst_end;
+    videoParameters.activeVideoStart = video_parameters->active_video_start;
+    videoParameters.activeVideoEnd = video_parameters->active_video_end;
+    videoParameters.white16bIre = video_parameters->white_16b_ire;
+    videoParameters.black16bIre = video_parameters->black_16b_ire;
+    videoParameters.fieldWidth = video_parameters->field_width;
+    videoParameters.fieldHeight = video_parameters->field_height;
+    videoParameters.sampleRate = video_parameters->sample_rate;
+    videoParameters.fsc = video_parameters->fsc;
+    LdDecodeMetaData::setActiveLineRange(videoParameters);
+
+    if (options->threads < 1) {
+        qCritical() << "ldchroma_decoder_create: number of threads must be greater than zero";
+        return nullptr;
+    }
+
+    QScopedPointer<ldchroma_decoder> decoder(new ldchroma_decoder);
+    decoder->type = type;
+    decoder->lookBehind = 0;
+    decoder->lookAhead = 0;
+
+    QMutexLocker locker(&plannerMutex);
+
+    switch (type) {
+    case LDCHROMA_DECODER_PAL2D:
+    case LDCHROMA_DECODER_TRANSFORM2D:
+    case LDCHROMA_DECODER_TRANSFORM3D: {
+        if (!videoParameters.isSourcePal) {
+            qCritical() << "This decoder is for PAL video sources only";
+            return nullptr;
+        }
+
+        PalColour::Configuration palConfig;
+        palConfig.chromaGain = options->chroma_gain;
+        palConfig.intraFrameThreads = options->threads;
+        palConfig.simplePAL = options->simple_pal != 0;
+        palConfig.transformThreshold = options->transform_threshold;
+        palConfig.transformSinglePrecision = options->transform_single_precision != 0;
+        if (type == LDCHROMA_DECODER_TRANSFORM2D) {
+            palConfig.chromaFilter = PalColour::transform2DFilter;
+        } else if (type == LDCHROMA_DECODER_TRANSFORM3D) {
+            palConfig.chromaFilter = PalColour::transform3DFilter;
+        }
+
+        Decoder::setVideoParameters(decoder->config, videoParameters);
+        decoder->lookBehind = palConfig.getLookBehind();
+        decoder->lookAhead = palConfig.getLookAhead();
+
+        decoder->palColour.reset(new PalColour);
+        decoder->palColour->updateConfiguration(decoder->config.videoParameters, palConfig);
+        break;
+    }
+    case LDCHROMA_DECODER_NTSC2D:
+    case LDCHROMA_DECODER_NTSC3D: {
+        if (videoParameters.isSourcePal) {
+            qCritical() << "This decoder is for NTSC video sources only";
+            return nullptr;
+        }
+
+        Comb::Configuration combConfig;
+        combConfig.chromaGain = options->chroma_gain;
+        combConfig.intraFrameThreads = options->threads;
+        combConfig.whitePoint75 = options->white_point_75 != 0;
+        combConfig.yNRLevel = options->luma_nr_level;
+        combConfig.cNRLevel = options->chroma_nr_level;
+        if (type == LDCHROMA_DECODER_NTSC3D) {
+            // In 3D mode, we need to see the previous frame (as NtscDecoder)
+            combConfig.use3D = true;
+            decoder->lookBehind = 1;
+        }
+
+        Decoder::setVideoParameters(decoder->config, videoParameters);
+
+        decoder->comb.reset(new Comb);
+        decoder->comb->updateConfiguration(decoder->config.videoParameters, combConfig);
+        break;
+    }
+    case LDCHROMA_DECODER_MONO:
+        Decoder::setVideoParameters(decoder->config, videoParameters);
+        break;
+    default:
+        qCritical() << "ldchroma_decoder_create: unknown decoder type" << type;
+        return nullptr;
+    }
+
+    return decoder.take();
+}
+
+void ldchroma_decoder_destroy(ldchroma_decoder *decoder)
+{
+    QMutexLocker locker(&plannerMutex);
+
+    delete decoder;
+}
+
+int32_t ldchroma_decoder_get_look_behind(const ldchroma_decoder *decoder)
+{
+    return decoder->lookBehind;
+}
+
+int32_t ldchroma_decoder_get_look_ahead(const ldchroma_decoder *decoder)
+{
+    return decoder->lookAhead;
+}
+
+void ldchroma_decoder_get_output_size(const ldchroma_decoder *decoder, int32_t *width, int32_t *height)
+{
+    *width = decoder->config.outputLayout.width;
+    *height = decoder->config.outputLayout.height;
+}
+
+int ldchroma_decoder_decode(ldchroma_decoder *decoder,
+                            const ldchroma_field *fields, int32_t num_fields,
+                            int32_t start_index, int32_t end_index,
+                            uint16_t *output)
+{
+    // Check that the fields include the look-behind and look-ahead frames
+    if ((start_index % 2) != 0 || (end_index % 2) != 0 || start_index >= end_index
+        || start_index < 2 * decoder->lookBehind || end_index + (2 * decoder->lookAhead) > num_fields) {
+        qCritical() << "ldchroma_decoder_decode: invalid field range" << start_index << "to" << end_index
+                    << "of" << num_fields << "fields";
+        return -1;
+    }
+
+    QMutexLocker locker(&decoder->mutex);
+
+    const Decoder::Configuration &config = decoder->config;
+    const qint32 fieldLength = config.videoParameters.fieldWidth * config.videoParameters.fieldHeight;
+
+    // Copy the input fields. Only the metadata that the decoders use is set.
+    decoder->inputFields.resize(num_fields);
+    for (qint32 i = 0; i < num_fields; i++) {
+        SourceField &field = decoder->inputFields[i];
+        field.field.isFirstField = fields[i].is_first_field != 0;
+        field.field.fieldPhaseID = fields[i].field_phase_id;
+        field.data.resize(fieldLength);
+        std::copy(fields[i].data, fields[i].data + fieldLength, field.data.begin());
+    }
+
+    // Decode the frames
+    QVector<RGBFrame> &outputFrames = decoder->outputFrames;
+    outputFrames.resize((end_index - start_index) / 2);
+    for (qint32 i = 0; i < outputFrames.size(); i++) {
+        Decoder::prepareOutputFrame(config, outputFrames[i]);
+    }
+
+    const QVector<SourceField> &inputFields = decoder->inputFields;
+    switch (decoder->type) {
+    case LDCHROMA_DECODER_PAL2D:
+    case LDCHROMA_DECODER_TRANSFORM2D:
+    case LDCHROMA_DECODER_TRANSFORM3D:
+        decoder->palColour->decodeFrames(inputFields, start_index, end_index, config.outputLayout, outputFrames);
+        break;
+    case LDCHROMA_DECODER_NTSC2D:
+    case LDCHROMA_DECODER_NTSC3D:
+        // Decode look-behind fields, discarding the result (as NtscThread)
+        for (qint32 i = start_index - (2 * decoder->lookBehind); i < start_index; i += 2) {
+            decoder->comb->decodeFrame(inputFields[i], inputFields[i + 1], config.outputLayout, outputFrames[0]);
+        }
+        for (qint32 i = start_index, j = 0; i < end_index; i += 2, j++) {
+            decoder->comb->decodeFrame(inputFields[i], inputFields[i + 1], config.outputLayout, outputFrames[j]);
+        }
+        break;
+    case LDCHROMA_DECODER_MONO:
+        for (qint32 i = start_index, j = 0; i < end_index; i += 2, j++) {
+            MonoDecoder::decodeFrame(config, inputFields[i], inputFields[i + 1], outputFrames[j]);
+        }
+        break;
+    }
+
+    // Copy the frames to the caller's buffer
+    const qint32 frameSize = config.outputLayout.getFrameSize();
+    for (qint32 i = 0; i < outputFrames.size(); i++) {
+        std::copy(outputFrames[i].constBegin(), outputFrames[i].constEnd(), output + (i * frameSize));
+    }
+
+    return 0;
+}
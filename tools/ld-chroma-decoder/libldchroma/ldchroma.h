@@ -0,0 +1,154 @@
+/************************************************************************
+
+    ldchroma.h
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef LDCHROMA_H
+#define LDCHROMA_H
+
+// C interface to ld-chroma-decoder's decoders, so that other programs can
+// decode TBC fields in-process rather than reading ld-chroma-decoder's output
+// through a pipe.
+//
+// A decoder is created for a particular type of decoding and set of video
+// parameters, and can then be used to decode any number of batches of
+// fields. Each batch gives the fields to decode, plus any extra fields
+// before and after them that the decoder needs to see (see
+// ldchroma_decoder_get_look_behind/ahead). The decoded frames are written as
+// RGB 16-16-16 into memory supplied by the caller, in the same format and
+// size as ld-chroma-decoder's output.
+//
+// A decoder may be used from any thread, and calls on the same decoder from
+// several threads are serialised. To decode in parallel, create one decoder
+// per thread, or set ldchroma_options.threads to split each frame across
+// several threads.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The version of this interface. This changes whenever the structures below
+// or the meaning of any function changes incompatibly.
+#define LDCHROMA_API_VERSION 1
+
+// Return the value of LDCHROMA_API_VERSION that the library was built with
+int ldchroma_get_api_version(void);
+
+// The available decoders, as in ld-chroma-decoder's --decoder option
+typedef enum {
+    LDCHROMA_DECODER_PAL2D = 0,
+    LDCHROMA_DECODER_TRANSFORM2D,
+    LDCHROMA_DECODER_TRANSFORM3D,
+    LDCHROMA_DECODER_NTSC2D,
+    LDCHROMA_DECODER_NTSC3D,
+    LDCHROMA_DECODER_MONO
+} ldchroma_decoder_type;
+
+// Video parameters, from the videoParameters object in ld-decode's metadata
+typedef struct {
+    int32_t is_source_pal;
+    int32_t colour_burst_start;
+    int32_t colour_burst_end;
+    int32_t active_video_start;
+    int32_t active_video_end;
+    int32_t white_16b_ire;
+    int32_t black_16b_ire;
+    int32_t field_width;
+    int32_t field_height;
+    int32_t sample_rate;
+    int32_t fsc;
+} ldchroma_video_parameters;
+
+// Decoder options. Use ldchroma_options_init to fill in the defaults.
+typedef struct {
+    // Chroma gain (all decoders except mono)
+    double chroma_gain;
+
+    // Number of threads to use within each frame
+    int32_t threads;
+
+    // PAL: use 1D UV filter (for PALcolour)
+    int32_t simple_pal;
+    // PAL: Transform PAL threshold, from 0 to 1
+    double transform_threshold;
+    // PAL: use single-precision FFTs for Transform PAL
+    int32_t transform_single_precision;
+
+    // NTSC: use 75% white point
+    int32_t white_point_75;
+    // NTSC: luma and chroma noise reduction levels, in IRE
+    double luma_nr_level;
+    double chroma_nr_level;
+} ldchroma_options;
+
+// Fill in options with the same defaults as ld-chroma-decoder
+void ldchroma_options_init(ldchroma_options *options);
+
+// An input field. data points to field_width * field_height samples.
+typedef struct {
+    const uint16_t *data;
+    int32_t is_first_field;
+    int32_t field_phase_id;
+} ldchroma_field;
+
+typedef struct ldchroma_decoder ldchroma_decoder;
+
+// Create a decoder. options may be NULL to use the defaults.
+// Returns NULL if the video parameters aren't suitable for the decoder.
+ldchroma_decoder *ldchroma_decoder_create(ldchroma_decoder_type type,
+                                          const ldchroma_video_parameters *video_parameters,
+                                          const ldchroma_options *options);
+
+// Free a decoder
+void ldchroma_decoder_destroy(ldchroma_decoder *decoder);
+
+// Return the number of frames (each being two fields) that the decoder needs
+// to see before and after the frames being decoded
+int32_t ldchroma_decoder_get_look_behind(const ldchroma_decoder *decoder);
+int32_t ldchroma_decoder_get_look_ahead(const ldchroma_decoder *decoder);
+
+// Get the size of an output frame in pixels. Each frame is width * height
+// RGB triples, i.e. width * height * 3 uint16_t samples.
+void ldchroma_decoder_get_output_size(const ldchroma_decoder *decoder, int32_t *width, int32_t *height);
+
+// Decode fields[start_index] to fields[end_index - 1], writing
+// (end_index - start_index) / 2 frames consecutively into output.
+//
+// fields should contain look-behind frames before start_index and look-ahead
+// frames from end_index. Where these would be beyond the start or end of the
+// input, ld-chroma-decoder uses fields filled with black (black_16b_ire),
+// with the metadata of the first frame. start_index and end_index must be
+// even.
+//
+// Returns 0 on success, or -1 if the arguments are invalid.
+int ldchroma_decoder_decode(ldchroma_decoder *decoder,
+                            const ldchroma_field *fields, int32_t num_fields,
+                            int32_t start_index, int32_t end_index,
+                            uint16_t *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LDCHROMA_H
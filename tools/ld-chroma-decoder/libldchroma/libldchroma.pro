@@ -0,0 +1,98 @@
+QT -= gui
+
+TEMPLATE = lib
+TARGET = ldchroma
+VERSION = 1.0.0
+
+CONFIG += c++11 shared
+
+# The following define makes your compiler emit warnings if you use
+# any feature of Qt which as been marked deprecated (the exact warnings
+# depend on your compiler). Please consult the documentation of the
+# deprecated API in order to know how to port your code away from it.
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+    ldchroma.cpp \
+    ../bandrunner.cpp \
+    ../comb.cpp \
+    ../combkernels.cpp \
+    ../decoder.cpp \
+    ../decoderpool.cpp \
+    ../framecanvas.cpp \
+    ../monodecoder.cpp \
+    ../numaplacement.cpp \
+    ../palcolour.cpp \
+    ../rgb.cpp \
+    ../rgbconversion.cpp \
+    ../sourcefield.cpp \
+    ../transformpal.cpp \
+    ../transformpal2d.cpp \
+    ../transformpal3d.cpp \
+    ../yiq.cpp \
+    ../../library/tbc/lddecodemetadata.cpp \
+    ../../library/tbc/metadatareader.cpp \
+    ../../library/tbc/sourcevideo.cpp \
+    ../../library/tbc/vbidecoder.cpp
+
+HEADERS += \
+    ldchroma.h \
+    ../bandrunner.h \
+    ../comb.h \
+    ../combkernels.h \
+    ../decoder.h \
+    ../decoderpool.h \
+    ../framecanvas.h \
+    ../monodecoder.h \
+    ../numaplacement.h \
+    ../palcolour.h \
+    ../rgb.h \
+    ../rgbconversion.h \
+    ../rgbframe.h \
+    ../sourcefield.h \
+    ../transformpal.h \
+    ../transformpal2d.h \
+    ../transformpal3d.h \
+    ../yiq.h \
+    ../yiqbuffer.h \
+    ../../library/filter/deemp.h \
+    ../../library/filter/firfilter.h \
+    ../../library/filter/iirfilter.h \
+    ../../library/tbc/cpufeatures.h \
+    ../../library/tbc/lddecodemetadata.h \
+    ../../library/tbc/metadatareader.h \
+    ../../library/tbc/sourcevideo.h \
+    ../../library/tbc/vbidecoder.h
+
+# Add external includes to the include path
+INCLUDEPATH += ..
+INCLUDEPATH += ../../library/filter
+INCLUDEPATH += ../../library/tbc
+
+# Rules for installation
+isEmpty(PREFIX) {
+    PREFIX = /usr/local
+}
+unix:!android: target.path = $$PREFIX/lib/
+!isEmpty(target.path): INSTALLS += target
+headers.files = ldchroma.h
+headers.path = $$PREFIX/include/
+INSTALLS += headers
+
+# Additional include paths to support MacOS compilation
+macx {
+INCLUDEPATH += "/usr/local/include"
+}
+
+# Normal open-source OS goodness
+LIBS += -L"/usr/local/lib"
+LIBS += -lfftw3 -lfftw3f
+
+# Use libnuma for NUMA-aware thread placement, if it's available
+unix:!macx {
+    CONFIG += link_pkgconfig
+    packagesExist(numa) {
+        PKGCONFIG += numa
+        DEFINES += USE_LIBNUMA
+    }
+}
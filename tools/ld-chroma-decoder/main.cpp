@@ -169,6 +169,34 @@ int main(int argc, char *argv[])
                                         QCoreApplication::translate("main", "number"));
     parser.addOption(threadsOption);
 
+    // Option to select the number of threads used within each frame
+    QCommandLineOption frameThreadsOption(QStringList() << "frame-threads",
+                                          QCoreApplication::translate("main", "Specify the number of threads to use within each frame (default 1, or more if there are fewer frames than threads)"),
+                                          QCoreApplication::translate("main", "number"));
+    parser.addOption(frameThreadsOption);
+
+    // Option to place threads on NUMA nodes
+    QCommandLineOption numaOption(QStringList() << "numa",
+                                  QCoreApplication::translate("main", "Divide threads between NUMA nodes, keeping each thread's memory on its own node (requires libnuma)"));
+    parser.addOption(numaOption);
+
+    // Option to write a downscaled preview alongside the main output
+    QCommandLineOption previewOption(QStringList() << "preview",
+                                     QCoreApplication::translate("main", "Also write a downscaled RGB 8-8-8 preview to the specified file (- for piped output)"),
+                                     QCoreApplication::translate("main", "filename"));
+    parser.addOption(previewOption);
+
+    // Option to select the preview scale
+    QCommandLineOption previewScaleOption(QStringList() << "preview-scale",
+                                          QCoreApplication::translate("main", "Specify the preview downscaling factor (2 or 4; default 2)"),
+                                          QCoreApplication::translate("main", "number"));
+    parser.addOption(previewScaleOption);
+
+    // Option to checkpoint the output, and resume from a previous checkpoint
+    QCommandLineOption resumeOption(QStringList() << "resume",
+                                    QCoreApplication::translate("main", "Record progress in a checkpoint file (output.checkpoint) so that an interrupted run can be resumed, and resume if the checkpoint exists (use the same options for each run)"));
+    parser.addOption(resumeOption);
+
     // -- NTSC decoder options --
 
     // Option to show the optical flow map (-o)
@@ -206,6 +234,11 @@ int main(int argc, char *argv[])
                                                  QCoreApplication::translate("main", "file"));
     parser.addOption(transformThresholdsOption);
 
+    // Option to use single-precision FFTs
+    QCommandLineOption transformFloatOption(QStringList() << "transform-float",
+                                            QCoreApplication::translate("main", "Transform: Use single-precision FFTs (faster, but output differs slightly)"));
+    parser.addOption(transformFloatOption);
+
     // Option to overlay the FFTs
     QCommandLineOption showFFTsOption(QStringList() << "show-ffts",
                                       QCoreApplication::translate("main", "Transform: Overlay the input and output FFTs"));
@@ -252,9 +285,43 @@ int main(int argc, char *argv[])
         return -1;
     }
 
+    QString previewFileName;
+    qint32 previewScale = 2;
+    if (parser.isSet(previewOption)) {
+        previewFileName = parser.value(previewOption);
+
+        if (previewFileName == inputFileName || previewFileName == outputFileName) {
+            // Quit with error
+            qCritical("The preview file must be different from the input and output files");
+            return -1;
+        }
+    }
+
+    if (parser.isSet(previewScaleOption)) {
+        previewScale = parser.value(previewScaleOption).toInt();
+
+        if (previewScale != 2 && previewScale != 4) {
+            // Quit with error
+            qCritical("Preview scale must be 2 or 4");
+            return -1;
+        }
+    }
+
+    QString checkpointFileName;
+    if (parser.isSet(resumeOption)) {
+        if (outputFileName == "-" || previewFileName == "-") {
+            // Quit with error
+            qCritical("Resuming is only possible when writing to files");
+            return -1;
+        }
+
+        checkpointFileName = outputFileName + ".checkpoint";
+    }
+
     qint32 startFrame = -1;
     qint32 length = -1;
     qint32 maxThreads = QThread::idealThreadCount();
+    qint32 frameThreads = 1;
     PalColour::Configuration palConfig;
     Comb::Configuration combConfig;
 
@@ -288,6 +355,23 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (parser.isSet(frameThreadsOption)) {
+        frameThreads = parser.value(frameThreadsOption).toInt();
+
+        if (frameThreads < 1) {
+            // Quit with error
+            qCritical("Specified number of frame threads must be greater than zero");
+            return -1;
+        }
+    } else if (length != -1 && length < maxThreads) {
+        // There aren't enough frames to keep all the threads busy, so use the
+        // spare threads within each frame instead
+        frameThreads = maxThreads / length;
+        maxThreads = length;
+    }
+    palConfig.intraFrameThreads = frameThreads;
+    combConfig.intraFrameThreads = frameThreads;
+
     if (parser.isSet(chromaGainOption)) {
         const double value = parser.value(chromaGainOption).toDouble();
         palConfig.chromaGain = value;
@@ -341,6 +425,10 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (parser.isSet(transformFloatOption)) {
+        palConfig.transformSinglePrecision = true;
+    }
+
     if (parser.isSet(showFFTsOption)) {
         palConfig.showFFTs = true;
     }
@@ -353,7 +441,7 @@ int main(int argc, char *argv[])
 
     // Load the source video metadata
     LdDecodeMetaData metaData;
-    if (!metaData.read(inputJsonFileName)) {
+    if (!metaData.read(inputJsonFileName, true)) {
         qInfo() << "Unable to open ld-decode metadata file";
         return -1;
     }
@@ -416,6 +504,15 @@ int main(int argc, char *argv[])
 
     // Perform the processing
     DecoderPool decoderPool(*decoder, inputFileName, metaData, outputFileName, startFrame, length, maxThreads);
+    if (!previewFileName.isEmpty()) {
+        decoderPool.setPreviewOutput(previewFileName, previewScale);
+    }
+    if (!checkpointFileName.isEmpty()) {
+        decoderPool.setCheckpointFile(checkpointFileName);
+    }
+    if (parser.isSet(numaOption)) {
+        decoderPool.setNumaPlacement(true);
+    }
     if (!decoderPool.process()) {
         return -1;
     }
@@ -37,48 +37,53 @@ bool MonoDecoder::configure(const LdDecodeMetaData::VideoParameters &videoParame
     return true;
 }
 
+const RGBFrameLayout &MonoDecoder::getOutputLayout() const {
+    return config.outputLayout;
+}
+
 QThread *MonoDecoder::makeThread(QAtomicInt& abort, DecoderPool& decoderPool) {
     return new MonoThread(abort, decoderPool, config);
 }
 
+void MonoDecoder::decodeFrame(const Configuration &config, const SourceField &firstField, const SourceField &secondField,
+                              RGBFrame &outputFrame)
+{
+    // Work out black-white scaling factors
+    const LdDecodeMetaData::VideoParameters &videoParameters = config.videoParameters;
+    const quint16 blackOffset = videoParameters.black16bIre;
+    const double whiteScale = 65535.0 / (videoParameters.white16bIre - videoParameters.black16bIre);
+
+    // Interlace the active lines of the two input fields to produce an output frame
+    for (qint32 y = config.videoParameters.firstActiveFrameLine; y < config.videoParameters.lastActiveFrameLine; y++) {
+        const SourceVideo::Data &inputFieldData = (y % 2) == 0 ? firstField.data : secondField.data;
+
+        // Each quint16 input becomes three quint16 outputs
+        const quint16 *inputLine = inputFieldData.data() + ((y / 2) * videoParameters.fieldWidth);
+        quint16 *outputLine = outputFrame.data() + config.outputLayout.getOffset(videoParameters.activeVideoStart, y);
+
+        for (qint32 x = videoParameters.activeVideoStart; x < videoParameters.activeVideoEnd; x++) {
+            const quint16 value = static_cast<quint16>(qBound(0.0, (inputLine[x] - blackOffset) * whiteScale, 65535.0));
+
+            const qint32 outputPos = (x - videoParameters.activeVideoStart) * 3;
+            outputLine[outputPos] = value;
+            outputLine[outputPos + 1] = value;
+            outputLine[outputPos + 2] = value;
+        }
+    }
+}
+
 MonoThread::MonoThread(QAtomicInt& _abort, DecoderPool& _decoderPool,
                      const MonoDecoder::Configuration &_config, QObject *parent)
     : DecoderThread(_abort, _decoderPool, parent), config(_config)
 {
-    // Resize and clear the output buffer
-    const qint32 frameHeight = (config.videoParameters.fieldHeight * 2) - 1;
-    outputFrame.resize(config.videoParameters.fieldWidth * frameHeight * 3);
-    outputFrame.fill(0);
 }
 
 void MonoThread::decodeFrames(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
                               QVector<RGBFrame> &outputFrames)
 {
-    // Work out black-white scaling factors
-    const LdDecodeMetaData::VideoParameters &videoParameters = config.videoParameters;
-    const quint16 blackOffset = videoParameters.black16bIre;
-    const double whiteScale = 65535.0 / (videoParameters.white16bIre - videoParameters.black16bIre);
-
     for (qint32 fieldIndex = startIndex, frameIndex = 0; fieldIndex < endIndex; fieldIndex += 2, frameIndex++) {
-        // Interlace the active lines of the two input fields to produce an output frame
-        for (qint32 y = config.videoParameters.firstActiveFrameLine; y < config.videoParameters.lastActiveFrameLine; y++) {
-            const SourceVideo::Data &inputFieldData = (y % 2) == 0 ? inputFields[fieldIndex].data : inputFields[fieldIndex + 1].data;
-
-            // Each quint16 input becomes three quint16 outputs
-            const quint16 *inputLine = inputFieldData.data() + ((y / 2) * videoParameters.fieldWidth);
-            quint16 *outputLine = outputFrame.data() + (y * videoParameters.fieldWidth * 3);
-
-            for (qint32 x = videoParameters.activeVideoStart; x < videoParameters.activeVideoEnd; x++) {
-                const quint16 value = static_cast<quint16>(qBound(0.0, (inputLine[x] - blackOffset) * whiteScale, 65535.0));
-
-                const qint32 outputPos = x * 3;
-                outputLine[outputPos] = value;
-                outputLine[outputPos + 1] = value;
-                outputLine[outputPos + 2] = value;
-            }
-        }
-
-        // Crop the frame to just the active area
-        outputFrames[frameIndex] = MonoDecoder::cropOutputFrame(config, outputFrame);
+        RGBFrame &outputFrame = outputFrames[frameIndex];
+        MonoDecoder::prepareOutputFrame(config, outputFrame);
+        MonoDecoder::decodeFrame(config, inputFields[fieldIndex], inputFields[fieldIndex + 1], outputFrame);
     }
 }
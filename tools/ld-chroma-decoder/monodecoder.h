@@ -42,8 +42,14 @@ class DecoderPool;
 class MonoDecoder : public Decoder {
 public:
     bool configure(const LdDecodeMetaData::VideoParameters &videoParameters) override;
+    const RGBFrameLayout &getOutputLayout() const override;
     QThread *makeThread(QAtomicInt& abort, DecoderPool& decoderPool) override;
 
+    // Decode two fields into outputFrame, which must already have been
+    // prepared with prepareOutputFrame
+    static void decodeFrame(const Configuration &config, const SourceField &firstField, const SourceField &secondField,
+                            RGBFrame &outputFrame);
+
 private:
     Configuration config;
 };
@@ -63,9 +69,6 @@ protected:
 private:
     // Settings
     const MonoDecoder::Configuration &config;
-
-    // The frame being assembled
-    RGBFrame outputFrame;
 };
 
 #endif // MONODECODER
@@ -56,6 +56,11 @@ qint32 NtscDecoder::getLookBehind() const
     return 0;
 }
 
+const RGBFrameLayout &NtscDecoder::getOutputLayout() const
+{
+    return config.outputLayout;
+}
+
 QThread *NtscDecoder::makeThread(QAtomicInt& abort, DecoderPool& decoderPool)
 {
     return new NtscThread(abort, decoderPool, config);
@@ -72,17 +77,18 @@ NtscThread::NtscThread(QAtomicInt& _abort, DecoderPool &_decoderPool,
 void NtscThread::decodeFrames(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
                               QVector<RGBFrame> &outputFrames)
 {
-    // Decode lookahead fields, discarding the result
+    for (qint32 j = 0; j < outputFrames.size(); j++) {
+        NtscDecoder::prepareOutputFrame(config, outputFrames[j]);
+    }
+
+    // Decode lookahead fields, discarding the result (the first output frame
+    // is overwritten below)
     for (qint32 i = 0; i < startIndex; i += 2) {
-        comb.decodeFrame(inputFields[i], inputFields[i + 1]);
+        comb.decodeFrame(inputFields[i], inputFields[i + 1], config.outputLayout, outputFrames[0]);
     }
 
-    // Decode real fields to frames
+    // Decode real fields straight into the output frames
     for (qint32 i = startIndex, j = 0; i < endIndex; i += 2, j++) {
-        // Filter the frame
-        RGBFrame outputData = comb.decodeFrame(inputFields[i], inputFields[i + 1]);
-
-        // The NTSC filter outputs the whole frame, so here we crop it to the required dimensions
-        outputFrames[j] = NtscDecoder::cropOutputFrame(config, outputData);
+        comb.decodeFrame(inputFields[i], inputFields[i + 1], config.outputLayout, outputFrames[j]);
     }
 }
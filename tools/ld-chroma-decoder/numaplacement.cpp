@@ -0,0 +1,126 @@
+/************************************************************************
+
+    numaplacement.cpp
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "numaplacement.h"
+
+#ifdef USE_LIBNUMA
+#include <numa.h>
+#include <numaif.h>
+#endif
+
+NumaPlacement::NumaPlacement()
+    : savedCpus(nullptr), savedPolicyNodes(nullptr), savedPolicy(0)
+{
+}
+
+NumaPlacement::~NumaPlacement()
+{
+#ifdef USE_LIBNUMA
+    if (savedCpus != nullptr) numa_free_cpumask(savedCpus);
+    if (savedPolicyNodes != nullptr) numa_free_nodemask(savedPolicyNodes);
+#endif
+}
+
+QVector<qint32> NumaPlacement::getNodes()
+{
+    QVector<qint32> nodes;
+
+#ifdef USE_LIBNUMA
+    if (numa_available() >= 0) {
+        // Find the nodes we're allowed to allocate memory on
+        for (qint32 node = 0; node <= numa_max_node(); node++) {
+            if (numa_bitmask_isbitset(numa_all_nodes_ptr, node)) {
+                nodes.append(node);
+            }
+        }
+    }
+#endif
+
+    if (nodes.isEmpty()) {
+        // No NUMA support, so treat the system as a single node
+        nodes.append(0);
+    }
+
+    return nodes;
+}
+
+bool NumaPlacement::bindToNode(qint32 node)
+{
+#ifdef USE_LIBNUMA
+    if (numa_available() < 0) {
+        return false;
+    }
+
+    // Save the original settings before changing them for the first time
+    if (savedCpus == nullptr && !save()) {
+        return false;
+    }
+
+    if (numa_run_on_node(node) != 0) {
+        return false;
+    }
+    numa_set_preferred(node);
+
+    return true;
+#else
+    Q_UNUSED(node);
+
+    return false;
+#endif
+}
+
+void NumaPlacement::restore()
+{
+#ifdef USE_LIBNUMA
+    if (savedCpus == nullptr) {
+        return;
+    }
+
+    numa_sched_setaffinity(0, savedCpus);
+    set_mempolicy(savedPolicy, savedPolicyNodes->maskp, savedPolicyNodes->size + 1);
+#endif
+}
+
+// Save the calling thread's CPU affinity and memory policy.
+// Returns true on success, false on failure.
+bool NumaPlacement::save()
+{
+#ifdef USE_LIBNUMA
+    savedCpus = numa_allocate_cpumask();
+    savedPolicyNodes = numa_allocate_nodemask();
+
+    if (numa_sched_getaffinity(0, savedCpus) < 0
+        || get_mempolicy(&savedPolicy, savedPolicyNodes->maskp, savedPolicyNodes->size + 1, nullptr, 0) != 0) {
+        numa_free_cpumask(savedCpus);
+        numa_free_nodemask(savedPolicyNodes);
+        savedCpus = nullptr;
+        savedPolicyNodes = nullptr;
+        return false;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,74 @@
+/************************************************************************
+
+    numaplacement.h
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef NUMAPLACEMENT_H
+#define NUMAPLACEMENT_H
+
+#include <QtGlobal>
+#include <QVector>
+
+// libnuma's CPU and node mask type
+struct bitmask;
+
+// Placement of threads and memory on NUMA nodes.
+//
+// On a machine with several NUMA nodes (e.g. a multi-socket system), memory
+// attached to another node is slower to access, so it helps to keep each
+// thread and the memory it uses on the same node.
+//
+// This uses libnuma if it was available at build time (USE_LIBNUMA);
+// otherwise, the system is treated as having a single node.
+class NumaPlacement {
+public:
+    NumaPlacement();
+    ~NumaPlacement();
+
+    // Return the IDs of the NUMA nodes that this process can use. If NUMA
+    // isn't supported, this returns a single node.
+    static QVector<qint32> getNodes();
+
+    // Restrict the calling thread to the CPUs of node, and make it allocate
+    // memory from node where possible. Threads created by the calling thread
+    // inherit these settings.
+    //
+    // The first call saves the calling thread's original CPU affinity and
+    // memory policy (e.g. as set by taskset or numactl), so that restore()
+    // can put them back.
+    // Returns true on success, false on failure.
+    bool bindToNode(qint32 node);
+
+    // Restore the calling thread's CPU affinity and memory policy to what
+    // they were before the first call to bindToNode
+    void restore();
+
+private:
+    bool save();
+
+    // The original settings, or nullptr if they haven't been saved
+    struct bitmask *savedCpus;
+    struct bitmask *savedPolicyNodes;
+    int savedPolicy;
+};
+
+#endif // NUMAPLACEMENT_H
@@ -32,6 +32,8 @@
 
 #include "palcolour.h"
 
+#include "rgbconversion.h"
+
 #include "transformpal2d.h"
 #include "transformpal3d.h"
 
@@ -76,9 +78,9 @@ PalColour::PalColour(QObject *parent)
 qint32 PalColour::Configuration::getThresholdsSize() const
 {
     if (chromaFilter == transform2DFilter) {
-        return TransformPal2D::getThresholdsSize();
+        return TransformPal2D<double>::getThresholdsSize();
     } else if (chromaFilter == transform3DFilter) {
-        return TransformPal3D::getThresholdsSize();
+        return TransformPal3D<double>::getThresholdsSize();
     } else {
         return 0;
     }
@@ -87,7 +89,7 @@ qint32 PalColour::Configuration::getThresholdsSize() const
 qint32 PalColour::Configuration::getLookBehind() const
 {
     if (chromaFilter == transform3DFilter) {
-        return TransformPal3D::getLookBehind();
+        return TransformPal3D<double>::getLookBehind();
     } else {
         return 0;
     }
@@ -96,7 +98,16 @@ qint32 PalColour::Configuration::getLookBehind() const
 qint32 PalColour::Configuration::getLookAhead() const
 {
     if (chromaFilter == transform3DFilter) {
-        return TransformPal3D::getLookAhead();
+        return TransformPal3D<double>::getLookAhead();
+    } else {
+        return 0;
+    }
+}
+
+qint32 PalColour::Configuration::getRunLength() const
+{
+    if (chromaFilter == transform3DFilter) {
+        return TransformPal3D<double>::getRunLength();
     } else {
         return 0;
     }
@@ -117,12 +128,22 @@ void PalColour::updateConfiguration(const LdDecodeMetaData::VideoParameters &_vi
     // Build the look-up tables
     buildLookUpTables();
 
+    bandRunner.setThreads(configuration.intraFrameThreads);
+
     if (configuration.chromaFilter == transform2DFilter || configuration.chromaFilter == transform3DFilter) {
         // Create the Transform PAL filter
         if (configuration.chromaFilter == transform2DFilter) {
-            transformPal.reset(new TransformPal2D);
+            if (configuration.transformSinglePrecision) {
+                transformPal.reset(new TransformPal2D<float>);
+            } else {
+                transformPal.reset(new TransformPal2D<double>);
+            }
         } else {
-            transformPal.reset(new TransformPal3D);
+            if (configuration.transformSinglePrecision) {
+                transformPal.reset(new TransformPal3D<float>);
+            } else {
+                transformPal.reset(new TransformPal3D<double>);
+            }
         }
 
         // Configure the filter
@@ -245,15 +266,17 @@ void PalColour::buildLookUpTables()
 RGBFrame PalColour::decodeFrame(const SourceField &firstField, const SourceField &secondField)
 {
     QVector<SourceField> inputFields {firstField, secondField};
-    QVector<RGBFrame> outputFrames(1);
+    const RGBFrameLayout outputLayout = RGBFrameLayout::fullFrame(videoParameters);
+    QVector<RGBFrame> outputFrames(1, RGBFrame(outputLayout.getFrameSize(), 0));
 
-    decodeFrames(inputFields, 0, 2, outputFrames);
+    decodeFrames(inputFields, 0, 2, outputLayout, outputFrames);
 
     return outputFrames[0];
 }
 
 void PalColour::decodeFrames(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
-                             QVector<RGBFrame> &outputFrames)
+                             const RGBFrameLayout &outputLayout, QVector<RGBFrame> &outputFrames,
+                             bool isContinuation)
 {
     assert(configurationSet);
     assert((outputFrames.size() * 2) == (endIndex - startIndex));
@@ -261,37 +284,43 @@ void PalColour::decodeFrames(const QVector<SourceField> &inputFields, qint32 sta
     QVector<const double *> chromaData(endIndex - startIndex);
     if (configuration.chromaFilter != palColourFilter) {
         // Use Transform PAL filter to extract chroma
-        transformPal->filterFields(inputFields, startIndex, endIndex, chromaData);
-    }
-
-    // Resize and clear the output buffers
-    const qint32 frameHeight = (videoParameters.fieldHeight * 2) - 1;
-    for (qint32 i = 0; i < outputFrames.size(); i++) {
-        outputFrames[i].resize(videoParameters.fieldWidth * frameHeight * 3);
-        outputFrames[i].fill(0);
+        transformPal->filterFields(inputFields, startIndex, endIndex, isContinuation, bandRunner, chromaData);
     }
 
     const double chromaGain = configuration.chromaGain;
     for (qint32 i = startIndex, j = 0, k = 0; i < endIndex; i += 2, j += 2, k++) {
-        decodeField(inputFields[i], chromaData[j], chromaGain, outputFrames[k]);
-        decodeField(inputFields[i + 1], chromaData[j + 1], chromaGain, outputFrames[k]);
+        assert(outputFrames[k].size() == outputLayout.getFrameSize());
+
+        // Each line is decoded independently, so the two fields can be
+        // divided into bands of lines and decoded in parallel
+        const SourceField &firstField = inputFields[i];
+        const SourceField &secondField = inputFields[i + 1];
+        const qint32 firstLine = qMin(firstField.getFirstActiveLine(videoParameters), secondField.getFirstActiveLine(videoParameters));
+        const qint32 lastLine = qMax(firstField.getLastActiveLine(videoParameters), secondField.getLastActiveLine(videoParameters));
+
+        bandRunner.run(firstLine, lastLine, 1, [&](qint32, qint32 startLine, qint32 endLine) {
+            decodeField(firstField, chromaData[j], chromaGain, startLine, endLine, outputLayout, outputFrames[k]);
+            decodeField(secondField, chromaData[j + 1], chromaGain, startLine, endLine, outputLayout, outputFrames[k]);
+        });
     }
 
     if (configuration.showFFTs && configuration.chromaFilter != palColourFilter) {
         // Overlay the FFT visualisation
         transformPal->overlayFFT(configuration.showPositionX, configuration.showPositionY,
-                                 inputFields, startIndex, endIndex, outputFrames);
+                                 inputFields, startIndex, endIndex, outputLayout, outputFrames);
     }
 }
 
-// Decode one field into outputFrame
-void PalColour::decodeField(const SourceField &inputField, const double *chromaData, double chromaGain, RGBFrame &outputFrame)
+// Decode the field lines from startLine to endLine of one field into outputFrame
+void PalColour::decodeField(const SourceField &inputField, const double *chromaData, double chromaGain,
+                            qint32 startLine, qint32 endLine,
+                            const RGBFrameLayout &outputLayout, RGBFrame &outputFrame)
 {
     // Pointer to the composite signal data
     const quint16 *compPtr = inputField.data.data();
 
-    const qint32 firstLine = inputField.getFirstActiveLine(videoParameters);
-    const qint32 lastLine = inputField.getLastActiveLine(videoParameters);
+    const qint32 firstLine = qMax(inputField.getFirstActiveLine(videoParameters), startLine);
+    const qint32 lastLine = qMin(inputField.getLastActiveLine(videoParameters), endLine);
     for (qint32 fieldLine = firstLine; fieldLine < lastLine; fieldLine++) {
         LineInfo line(fieldLine);
 
@@ -300,10 +329,10 @@ void PalColour::decodeField(const SourceField &inputField, const double *chromaD
 
         if (configuration.chromaFilter == palColourFilter) {
             // Decode chroma and luma from the composite signal
-            decodeLine<quint16, false>(inputField, compPtr, line, chromaGain, outputFrame);
+            decodeLine<quint16, false>(inputField, compPtr, line, chromaGain, outputLayout, outputFrame);
         } else {
             // Decode chroma and luma from the Transform PAL output
-            decodeLine<double, true>(inputField, chromaData, line, chromaGain, outputFrame);
+            decodeLine<double, true>(inputField, chromaData, line, chromaGain, outputLayout, outputFrame);
         }
     }
 }
@@ -388,7 +417,7 @@ void PalColour::detectBurst(LineInfo &line, const quint16 *inputData)
 // inputField, or it may be pre-filtered down to chroma.
 template <typename ChromaSample, bool PREFILTERED_CHROMA>
 void PalColour::decodeLine(const SourceField &inputField, const ChromaSample *chromaData, const LineInfo &line, double chromaGain,
-                           RGBFrame &outputFrame)
+                           const RGBFrameLayout &outputLayout, RGBFrame &outputFrame)
 {
     // Dummy black line, used when the filter needs to look outside the active region.
     static constexpr ChromaSample blackLine[MAX_WIDTH] = {0};
@@ -518,7 +547,9 @@ void PalColour::decodeLine(const SourceField &inputField, const ChromaSample *ch
     const quint16 *comp = inputField.data.data() + (line.number * videoParameters.fieldWidth);
 
     // Define scan line pointer to output buffer using 16 bit unsigned words
-    quint16 *ptr = outputFrame.data() + (((line.number * 2) + inputField.getOffset()) * videoParameters.fieldWidth * 3);
+    // (pointing at the start of the active area)
+    const qint32 frameLine = (line.number * 2) + inputField.getOffset();
+    quint16 *ptr = outputFrame.data() + outputLayout.getOffset(videoParameters.activeVideoStart, frameLine);
 
     // Gain for the Y component, to put reference black at 0 and reference white at 65535
     const double scaledContrast = 65535.0 / (videoParameters.white16bIre - videoParameters.black16bIre);
@@ -529,39 +560,42 @@ void PalColour::decodeLine(const SourceField &inputField, const ChromaSample *ch
     // burst-based correction applied.
     const double scaledSaturation = 2.0 * scaledContrast * chromaGain;
 
+    // Rotate the p&q components (at the arbitrary sine/cosine reference
+    // phase) backwards by the burst phase (relative to the reference phase),
+    // in order to recover U and V. The Vswitch is applied to flip the V-phase
+    // on alternate lines for PAL.
+    double yLine[MAX_WIDTH], uLine[MAX_WIDTH], vLine[MAX_WIDTH];
     for (qint32 i = videoParameters.activeVideoStart; i < videoParameters.activeVideoEnd; i++) {
         // Compute luma by...
-        double rY;
         if (PREFILTERED_CHROMA) {
             // ... subtracting pre-filtered chroma from the composite input
-            rY = comp[i] - in0[i];
+            yLine[i] = comp[i] - in0[i];
         } else {
             // ... resynthesising the chroma signal that the Y filter
             // extracted (at half amplitude), and subtracting it from the
             // composite input
-            rY = comp[i] - ((py[i] * sine[i] + qy[i] * cosine[i]) * 2.0);
+            yLine[i] = comp[i] - ((py[i] * sine[i] + qy[i] * cosine[i]) * 2.0);
         }
 
-        // Scale to 16-bit output
-        rY = qBound(0.0, (rY - videoParameters.black16bIre) * scaledContrast, 65535.0);
-
-        // Rotate the p&q components (at the arbitrary sine/cosine
-        // reference phase) backwards by the burst phase (relative to the
-        // reference phase), in order to recover U and V. The Vswitch is
-        // applied to flip the V-phase on alternate lines for PAL.
-        const double rU =            -(pu[i] * line.bp + qu[i] * line.bq) * scaledSaturation;
-        const double rV = line.Vsw * -(qv[i] * line.bp - pv[i] * line.bq) * scaledSaturation;
-
-        // Convert YUV to RGB, saturating levels at 0-65535 to prevent overflow.
-        // Coefficients from Poynton, "Digital Video and HDTV" first edition, p337 eq 28.6.
-        const double R = qBound(0.0, rY                    + (1.139883 * rV),  65535.0);
-        const double G = qBound(0.0, rY + (-0.394642 * rU) + (-0.580622 * rV), 65535.0);
-        const double B = qBound(0.0, rY + (2.032062 * rU),                     65535.0);
-
-        // Pack the data back into the RGB 16/16/16 buffer
-        const qint32 pp = i * 3; // 3 words per pixel
-        ptr[pp + 0] = static_cast<quint16>(R);
-        ptr[pp + 1] = static_cast<quint16>(G);
-        ptr[pp + 2] = static_cast<quint16>(B);
+        uLine[i] =            -(pu[i] * line.bp + qu[i] * line.bq);
+        vLine[i] = line.Vsw * -(qv[i] * line.bp - pv[i] * line.bq);
     }
+
+    // Scale to 16-bit output, convert YUV to RGB (saturating levels at
+    // 0-65535 to prevent overflow), and pack into the RGB 16/16/16 buffer.
+    // Coefficients from Poynton, "Digital Video and HDTV" first edition, p337 eq 28.6.
+    RGBConversion conversion;
+    conversion.yOffset = videoParameters.black16bIre;
+    conversion.yScale = scaledContrast;
+    conversion.cScale = scaledSaturation;
+    conversion.matrix[0][0] = 0.0;
+    conversion.matrix[0][1] = 1.139883;
+    conversion.matrix[1][0] = -0.394642;
+    conversion.matrix[1][1] = -0.580622;
+    conversion.matrix[2][0] = 2.032062;
+    conversion.matrix[2][1] = 0.0;
+
+    const qint32 start = videoParameters.activeVideoStart;
+    convertPlanarToRGB48(conversion, &yLine[start], &uLine[start], &vLine[start],
+                         videoParameters.activeVideoEnd - start, ptr);
 }
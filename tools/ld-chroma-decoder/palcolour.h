@@ -34,6 +34,7 @@
 
 #include "lddecodemetadata.h"
 
+#include "bandrunner.h"
 #include "rgbframe.h"
 #include "sourcefield.h"
 #include "transformpal.h"
@@ -62,13 +63,19 @@ public:
         TransformPal::TransformMode transformMode = TransformPal::thresholdMode;
         double transformThreshold = 0.4;
         QVector<double> transformThresholds;
+        bool transformSinglePrecision = false;
         bool showFFTs = false;
         qint32 showPositionX = 200;
         qint32 showPositionY = 200;
 
+        // Number of threads to use within each frame (1 = decode each frame
+        // on the calling thread only)
+        qint32 intraFrameThreads = 1;
+
         qint32 getThresholdsSize() const;
         qint32 getLookBehind() const;
         qint32 getLookAhead() const;
+        qint32 getRunLength() const;
     };
 
     const Configuration &getConfiguration() const;
@@ -78,9 +85,16 @@ public:
     // Decode two fields to produce an interlaced frame.
     RGBFrame decodeFrame(const SourceField &firstField, const SourceField &secondField);
 
-    // Decode a sequence of fields into a sequence of interlaced frames
+    // Decode a sequence of fields into a sequence of interlaced frames.
+    //
+    // The output frames must already be the right size for outputLayout;
+    // only the active area of each frame is written.
+    //
+    // isContinuation should be true if the field at startIndex is the one
+    // that was at endIndex in the previous call; see TransformPal::filterFields.
     void decodeFrames(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
-                      QVector<RGBFrame> &outputFrames);
+                      const RGBFrameLayout &outputLayout, QVector<RGBFrame> &outputFrames,
+                      bool isContinuation = false);
 
     // Maximum frame size, based on PAL
     static constexpr qint32 MAX_WIDTH = 1135;
@@ -96,11 +110,13 @@ private:
     };
 
     void buildLookUpTables();
-    void decodeField(const SourceField &inputField, const double *chromaData, double chromaGain, RGBFrame &outputFrame);
+    void decodeField(const SourceField &inputField, const double *chromaData, double chromaGain,
+                     qint32 startLine, qint32 endLine,
+                     const RGBFrameLayout &outputLayout, RGBFrame &outputFrame);
     void detectBurst(LineInfo &line, const quint16 *inputData);
     template <typename ChromaSample, bool PREFILTERED_CHROMA>
     void decodeLine(const SourceField &inputField, const ChromaSample *chromaData, const LineInfo &line, double chromaGain,
-                    RGBFrame &outputFrame);
+                    const RGBFrameLayout &outputLayout, RGBFrame &outputFrame);
 
     // Configuration parameters
     bool configurationSet;
@@ -110,6 +126,9 @@ private:
     // Transform PAL filter
     QScopedPointer<TransformPal> transformPal;
 
+    // Threads for decoding bands of each frame in parallel
+    BandRunner bandRunner;
+
     // The subcarrier reference signal
     double sine[MAX_WIDTH], cosine[MAX_WIDTH];
 
@@ -55,6 +55,16 @@ qint32 PalDecoder::getLookAhead() const
     return config.pal.getLookAhead();
 }
 
+qint32 PalDecoder::getRunLength() const
+{
+    return config.pal.getRunLength();
+}
+
+const RGBFrameLayout &PalDecoder::getOutputLayout() const
+{
+    return config.outputLayout;
+}
+
 QThread *PalDecoder::makeThread(QAtomicInt& abort, DecoderPool& decoderPool) {
     return new PalThread(abort, decoderPool, config);
 }
@@ -70,13 +80,10 @@ PalThread::PalThread(QAtomicInt& _abort, DecoderPool& _decoderPool,
 void PalThread::decodeFrames(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
                              QVector<RGBFrame> &outputFrames)
 {
-    QVector<RGBFrame> decodedFrames(outputFrames.size());
-
-    // Perform the PALcolour filtering
-    palColour.decodeFrames(inputFields, startIndex, endIndex, decodedFrames);
-
     for (qint32 i = 0; i < outputFrames.size(); i++) {
-        // Crop the frame to just the active area
-        outputFrames[i] = PalDecoder::cropOutputFrame(config, decodedFrames[i]);
+        PalDecoder::prepareOutputFrame(config, outputFrames[i]);
     }
+
+    // Perform the PALcolour filtering, straight into the output frames
+    palColour.decodeFrames(inputFields, startIndex, endIndex, config.outputLayout, outputFrames, isContinuation);
 }
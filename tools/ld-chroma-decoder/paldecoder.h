@@ -47,6 +47,8 @@ public:
     bool configure(const LdDecodeMetaData::VideoParameters &videoParameters) override;
     qint32 getLookBehind() const override;
     qint32 getLookAhead() const override;
+    qint32 getRunLength() const override;
+    const RGBFrameLayout &getOutputLayout() const override;
     QThread *makeThread(QAtomicInt& abort, DecoderPool& decoderPool) override;
 
     // Parameters used by PalDecoder and PalThread
@@ -25,6 +25,8 @@
 
 #include "rgb.h"
 
+#include "rgbconversion.h"
+
 RGB::RGB(double _whiteIreLevel, double _blackIreLevel, bool _whitePoint75, double _chromaGain)
     : whiteIreLevel(_whiteIreLevel), blackIreLevel(_blackIreLevel), whitePoint75(_whitePoint75),
       chromaGain(_chromaGain)
@@ -50,32 +52,20 @@ void RGB::convertLine(const YIQ *begin, const YIQ *end, quint16 *out)
         yScale *= 125.0 / 100.0;
     }
 
-    for (const YIQ *yiq = begin; yiq < end; yiq++) {
-        double y = yiq->y;
-        double i = yiq->i;
-        double q = yiq->q;
-
-        // Scale the Y to 0-65535 where 0 = blackIreLevel and 65535 = whiteIreLevel
-        y = (y - yBlackLevel) * yScale;
-        y = qBound(0.0, y, 65535.0);
-
-        // Scale the I & Q components
-        i *= iqScale;
-        q *= iqScale;
-
-        // Y'IQ to R'G'B' colour-space conversion.
-        // Coefficients from Poynton, "Digital Video and HDTV" first edition, p367 eq 30.3.
-        double r = y + (0.955986 * i) + (0.620825 * q);
-        double g = y - (0.272013 * i) - (0.647204 * q);
-        double b = y - (1.106740 * i) + (1.704230 * q);
-
-        r = qBound(0.0, r, 65535.0);
-        g = qBound(0.0, g, 65535.0);
-        b = qBound(0.0, b, 65535.0);
-
-        // Place the 16-bit RGB values in the output array
-        *out++ = static_cast<quint16>(r);
-        *out++ = static_cast<quint16>(g);
-        *out++ = static_cast<quint16>(b);
-    }
+    // Y'IQ to R'G'B' colour-space conversion.
+    // Coefficients from Poynton, "Digital Video and HDTV" first edition, p367 eq 30.3.
+    RGBConversion conversion;
+    conversion.yOffset = yBlackLevel;
+    conversion.yScale = yScale;
+    conversion.cScale = iqScale;
+    conversion.matrix[0][0] = 0.955986;
+    conversion.matrix[0][1] = 0.620825;
+    conversion.matrix[1][0] = -0.272013;
+    conversion.matrix[1][1] = -0.647204;
+    conversion.matrix[2][0] = -1.106740;
+    conversion.matrix[2][1] = 1.704230;
+
+    // YIQ is a plain triple of qreals, so the conversion can read it directly
+    static_assert(sizeof(YIQ) == 3 * sizeof(double), "YIQ must be three doubles");
+    convertInterleavedToRGB48(conversion, &begin->y, static_cast<qint32>(end - begin), out);
 }
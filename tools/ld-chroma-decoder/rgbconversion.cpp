@@ -0,0 +1,235 @@
+/************************************************************************
+
+    rgbconversion.cpp
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "rgbconversion.h"
+
+#include "cpufeatures.h"
+
+// Use SSE4.1 or AVX2 kernels when the CPU supports them.
+//
+// The SIMD kernels do the same double-precision operations in the same order
+// as the scalar code (and FMA isn't enabled), so the output is identical.
+#ifdef CPUFEATURES_X86
+#include <immintrin.h>
+#endif
+
+// Scalar kernel ----------------------------------------------------------------------------------------------------
+
+// Convert count pixels, where the samples for pixel n are at y[n * stride] etc.
+static void convertScalar(const RGBConversion &conversion, const double *y, const double *c1, const double *c2,
+                          qint32 stride, qint32 count, quint16 *output)
+{
+    for (qint32 n = 0; n < count; n++) {
+        // Scale Y to 0-65535
+        double rY = (y[n * stride] - conversion.yOffset) * conversion.yScale;
+        rY = qBound(0.0, rY, 65535.0);
+
+        // Scale the chroma components
+        const double rC1 = c1[n * stride] * conversion.cScale;
+        const double rC2 = c2[n * stride] * conversion.cScale;
+
+        // Convert to RGB, saturating levels at 0-65535
+        const double r = qBound(0.0, rY + (conversion.matrix[0][0] * rC1) + (conversion.matrix[0][1] * rC2), 65535.0);
+        const double g = qBound(0.0, rY + (conversion.matrix[1][0] * rC1) + (conversion.matrix[1][1] * rC2), 65535.0);
+        const double b = qBound(0.0, rY + (conversion.matrix[2][0] * rC1) + (conversion.matrix[2][1] * rC2), 65535.0);
+
+        *output++ = static_cast<quint16>(r);
+        *output++ = static_cast<quint16>(g);
+        *output++ = static_cast<quint16>(b);
+    }
+}
+
+// SIMD kernels -----------------------------------------------------------------------------------------------------
+
+#ifdef CPUFEATURES_X86
+
+// Both kernels convert 4 pixels per iteration, and return the number of
+// pixels they've converted; the remainder is done by the scalar code.
+
+// Pack 4 R, G and B values (as 32-bit integers, already clamped to 0-65535)
+// into 12 interleaved 16-bit output samples
+__attribute__((target("sse4.1")))
+static inline void packRGB48(__m128i r, __m128i g, __m128i b, quint16 *output)
+{
+    // rg = r0 r1 r2 r3 g0 g1 g2 g3, bb = b0 b1 b2 b3 b0 b1 b2 b3
+    const __m128i rg = _mm_packus_epi32(r, g);
+    const __m128i bb = _mm_packus_epi32(b, b);
+
+    // Output samples 0-7: r0 g0 b0 r1 g1 b1 r2 g2
+    const __m128i first = _mm_or_si128(
+        _mm_shuffle_epi8(rg, _mm_setr_epi8(0, 1, 8, 9, -1, -1, 2, 3, 10, 11, -1, -1, 4, 5, 12, 13)),
+        _mm_shuffle_epi8(bb, _mm_setr_epi8(-1, -1, -1, -1, 0, 1, -1, -1, -1, -1, 2, 3, -1, -1, -1, -1)));
+    // Output samples 8-11: b2 r3 g3 b3
+    const __m128i second = _mm_or_si128(
+        _mm_shuffle_epi8(rg, _mm_setr_epi8(-1, -1, 6, 7, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(bb, _mm_setr_epi8(4, 5, -1, -1, -1, -1, 6, 7, -1, -1, -1, -1, -1, -1, -1, -1)));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output), first);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(output + 8), second);
+}
+
+// Load 2 pixels from (Y, C1, C2) triples
+__attribute__((target("sse4.1")))
+static inline void loadInterleaved2(const double *ycc, __m128d &y, __m128d &c1, __m128d &c2)
+{
+    // a = y0 c1_0, b = c2_0 y1, c = c1_1 c2_1
+    const __m128d a = _mm_loadu_pd(ycc);
+    const __m128d b = _mm_loadu_pd(ycc + 2);
+    const __m128d c = _mm_loadu_pd(ycc + 4);
+
+    y = _mm_shuffle_pd(a, b, 2);
+    c1 = _mm_shuffle_pd(a, c, 1);
+    c2 = _mm_shuffle_pd(b, c, 2);
+}
+
+template <bool INTERLEAVED>
+__attribute__((target("sse4.1")))
+static qint32 convertSse41(const RGBConversion &conversion, const double *y, const double *c1, const double *c2,
+                           qint32 count, quint16 *output)
+{
+    const __m128d yOffset = _mm_set1_pd(conversion.yOffset);
+    const __m128d yScale = _mm_set1_pd(conversion.yScale);
+    const __m128d cScale = _mm_set1_pd(conversion.cScale);
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d maxValue = _mm_set1_pd(65535.0);
+    __m128d matrix[3][2];
+    for (qint32 i = 0; i < 3; i++) {
+        for (qint32 j = 0; j < 2; j++) {
+            matrix[i][j] = _mm_set1_pd(conversion.matrix[i][j]);
+        }
+    }
+
+    qint32 n = 0;
+    for (; n + 4 <= count; n += 4) {
+        __m128i rgb[3][2];
+
+        for (qint32 half = 0; half < 2; half++) {
+            const qint32 pos = n + (half * 2);
+
+            __m128d vy, vc1, vc2;
+            if (INTERLEAVED) {
+                loadInterleaved2(y + (pos * 3), vy, vc1, vc2);
+            } else {
+                vy = _mm_loadu_pd(y + pos);
+                vc1 = _mm_loadu_pd(c1 + pos);
+                vc2 = _mm_loadu_pd(c2 + pos);
+            }
+
+            vy = _mm_max_pd(zero, _mm_min_pd(_mm_mul_pd(_mm_sub_pd(vy, yOffset), yScale), maxValue));
+            vc1 = _mm_mul_pd(vc1, cScale);
+            vc2 = _mm_mul_pd(vc2, cScale);
+
+            for (qint32 i = 0; i < 3; i++) {
+                __m128d value = _mm_add_pd(_mm_add_pd(vy, _mm_mul_pd(matrix[i][0], vc1)), _mm_mul_pd(matrix[i][1], vc2));
+                value = _mm_max_pd(zero, _mm_min_pd(value, maxValue));
+                rgb[i][half] = _mm_cvttpd_epi32(value);
+            }
+        }
+
+        packRGB48(_mm_unpacklo_epi64(rgb[0][0], rgb[0][1]),
+                  _mm_unpacklo_epi64(rgb[1][0], rgb[1][1]),
+                  _mm_unpacklo_epi64(rgb[2][0], rgb[2][1]),
+                  output + (n * 3));
+    }
+
+    return n;
+}
+
+template <bool INTERLEAVED>
+__attribute__((target("avx2")))
+static qint32 convertAvx2(const RGBConversion &conversion, const double *y, const double *c1, const double *c2,
+                          qint32 count, quint16 *output)
+{
+    const __m256d yOffset = _mm256_set1_pd(conversion.yOffset);
+    const __m256d yScale = _mm256_set1_pd(conversion.yScale);
+    const __m256d cScale = _mm256_set1_pd(conversion.cScale);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d maxValue = _mm256_set1_pd(65535.0);
+    __m256d matrix[3][2];
+    for (qint32 i = 0; i < 3; i++) {
+        for (qint32 j = 0; j < 2; j++) {
+            matrix[i][j] = _mm256_set1_pd(conversion.matrix[i][j]);
+        }
+    }
+
+    qint32 n = 0;
+    for (; n + 4 <= count; n += 4) {
+        __m256d vy, vc1, vc2;
+        if (INTERLEAVED) {
+            __m128d yLow, c1Low, c2Low, yHigh, c1High, c2High;
+            loadInterleaved2(y + (n * 3), yLow, c1Low, c2Low);
+            loadInterleaved2(y + (n * 3) + 6, yHigh, c1High, c2High);
+            vy = _mm256_insertf128_pd(_mm256_castpd128_pd256(yLow), yHigh, 1);
+            vc1 = _mm256_insertf128_pd(_mm256_castpd128_pd256(c1Low), c1High, 1);
+            vc2 = _mm256_insertf128_pd(_mm256_castpd128_pd256(c2Low), c2High, 1);
+        } else {
+            vy = _mm256_loadu_pd(y + n);
+            vc1 = _mm256_loadu_pd(c1 + n);
+            vc2 = _mm256_loadu_pd(c2 + n);
+        }
+
+        vy = _mm256_max_pd(zero, _mm256_min_pd(_mm256_mul_pd(_mm256_sub_pd(vy, yOffset), yScale), maxValue));
+        vc1 = _mm256_mul_pd(vc1, cScale);
+        vc2 = _mm256_mul_pd(vc2, cScale);
+
+        __m128i rgb[3];
+        for (qint32 i = 0; i < 3; i++) {
+            __m256d value = _mm256_add_pd(_mm256_add_pd(vy, _mm256_mul_pd(matrix[i][0], vc1)), _mm256_mul_pd(matrix[i][1], vc2));
+            value = _mm256_max_pd(zero, _mm256_min_pd(value, maxValue));
+            rgb[i] = _mm256_cvttpd_epi32(value);
+        }
+
+        packRGB48(rgb[0], rgb[1], rgb[2], output + (n * 3));
+    }
+
+    return n;
+}
+
+#endif
+
+// Public functions -------------------------------------------------------------------------------------------------
+
+void convertPlanarToRGB48(const RGBConversion &conversion, const double *y, const double *c1, const double *c2,
+                          qint32 count, quint16 *output)
+{
+    qint32 done = 0;
+#ifdef CPUFEATURES_X86
+    if (cpuHasAvx2()) done = convertAvx2<false>(conversion, y, c1, c2, count, output);
+    else if (cpuHasSse41()) done = convertSse41<false>(conversion, y, c1, c2, count, output);
+#endif
+
+    convertScalar(conversion, y + done, c1 + done, c2 + done, 1, count - done, output + (done * 3));
+}
+
+void convertInterleavedToRGB48(const RGBConversion &conversion, const double *ycc, qint32 count, quint16 *output)
+{
+    qint32 done = 0;
+#ifdef CPUFEATURES_X86
+    if (cpuHasAvx2()) done = convertAvx2<true>(conversion, ycc, nullptr, nullptr, count, output);
+    else if (cpuHasSse41()) done = convertSse41<true>(conversion, ycc, nullptr, nullptr, count, output);
+#endif
+
+    const double *remaining = ycc + (done * 3);
+    convertScalar(conversion, remaining, remaining + 1, remaining + 2, 3, count - done, output + (done * 3));
+}
@@ -0,0 +1,55 @@
+/************************************************************************
+
+    rgbconversion.h
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef RGBCONVERSION_H
+#define RGBCONVERSION_H
+
+#include <QtGlobal>
+
+// Conversion of a line of luma/chroma samples (Y'IQ or Y'UV) to packed
+// RGB 16-16-16 output.
+//
+// For each pixel, with C1/C2 being I/Q or U/V:
+//   Y' = clamp((Y - yOffset) * yScale)
+//   R = clamp(Y' + (matrix[0][0] * C1 * cScale) + (matrix[0][1] * C2 * cScale))
+// and likewise for G (matrix[1]) and B (matrix[2]), where clamp limits the
+// value to 0-65535. The result is truncated to 16 bits.
+//
+// On x86 CPUs with AVX2 or SSE4.1, this uses SIMD kernels (selected at
+// runtime); the results are identical to the scalar code.
+struct RGBConversion {
+    double yOffset;
+    double yScale;
+    double cScale;
+    double matrix[3][2];
+};
+
+// Convert count pixels from separate Y, C1 and C2 arrays
+void convertPlanarToRGB48(const RGBConversion &conversion, const double *y, const double *c1, const double *c2,
+                          qint32 count, quint16 *output);
+
+// Convert count pixels from an array of (Y, C1, C2) triples (e.g. YIQ objects)
+void convertInterleavedToRGB48(const RGBConversion &conversion, const double *ycc, qint32 count, quint16 *output);
+
+#endif // RGBCONVERSION_H
@@ -28,7 +28,44 @@
 #include <QtGlobal>
 #include <QVector>
 
+#include "lddecodemetadata.h"
+
 // A decoded frame, containing triples of (R, G, B) samples
 using RGBFrame = QVector<quint16>;
 
+// The region of the interlaced input frame that an RGBFrame holds.
+//
+// This may be the whole frame (as ld-analyse displays), or just the region
+// that ld-chroma-decoder writes out: the active area, plus any padding lines
+// needed to make the height a multiple of 8 (see Decoder::setVideoParameters).
+// Positions are always given in input frame coordinates, so firstLine is
+// negative if there are padding lines at the top.
+struct RGBFrameLayout {
+    qint32 firstColumn;
+    qint32 firstLine;
+    qint32 width;
+    qint32 height;
+
+    // Return the layout of a whole frame
+    static RGBFrameLayout fullFrame(const LdDecodeMetaData::VideoParameters &videoParameters) {
+        return RGBFrameLayout {0, 0, videoParameters.fieldWidth, (videoParameters.fieldHeight * 2) - 1};
+    }
+
+    // Return the number of samples in a frame with this layout
+    qint32 getFrameSize() const {
+        return width * height * 3;
+    }
+
+    // Return true if the input position (x, y) is within the layout
+    bool contains(qint32 x, qint32 y) const {
+        return x >= firstColumn && x < firstColumn + width && y >= firstLine && y < firstLine + height;
+    }
+
+    // Return the index of the first sample for input position (x, y), which
+    // must be within the layout
+    qint32 getOffset(qint32 x, qint32 y) const {
+        return (((y - firstLine) * width) + (x - firstColumn)) * 3;
+    }
+};
+
 #endif // RGBFRAME_H
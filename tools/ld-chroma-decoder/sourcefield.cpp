@@ -29,10 +29,18 @@
 void SourceField::loadFields(SourceVideo &sourceVideo, LdDecodeMetaData &ldDecodeMetaData,
                              qint32 firstFrameNumber, qint32 numFrames,
                              qint32 lookBehindFrames, qint32 lookAheadFrames,
-                             QVector<SourceField> &fields, qint32 &startIndex, qint32 &endIndex)
+                             QVector<SourceField> &fields, qint32 &startIndex, qint32 &endIndex,
+                             qint32 previousFrameNumber)
 {
     const LdDecodeMetaData::VideoParameters &videoParameters = ldDecodeMetaData.getVideoParameters();
 
+    // Keep the previous fields, so we can reuse them.
+    // (This is cheap, as the field data is implicitly shared.)
+    QVector<SourceField> previousFields;
+    if (previousFrameNumber != -1) {
+        previousFields = fields;
+    }
+
     // Work out indexes.
     // fields will contain {lookbehind fields... [startIndex] real fields... [endIndex] lookahead fields...}.
     startIndex = 2 * lookBehindFrames;
@@ -44,6 +52,16 @@ void SourceField::loadFields(SourceVideo &sourceVideo, LdDecodeMetaData &ldDecod
     qint32 frameNumber = firstFrameNumber - lookBehindFrames;
     for (qint32 i = 0; i < fields.size(); i += 2) {
 
+        // Was this frame loaded by the previous call? If so, reuse it.
+        const qint32 previousIndex = previousFrameNumber == -1 ? -1 : 2 * (frameNumber - previousFrameNumber);
+        if (previousIndex >= 0 && previousIndex < previousFields.size()) {
+            fields[i] = previousFields[previousIndex];
+            fields[i + 1] = previousFields[previousIndex + 1];
+
+            frameNumber++;
+            continue;
+        }
+
         // Is this frame outside the bounds of the input file?
         // If so, use real metadata (from frame 1) and black fields.
         const bool useBlankFrame = frameNumber < 1 || frameNumber > numInputFrames;
@@ -37,10 +37,15 @@ struct SourceField {
     //
     // fields will contain {lookbehind fields... [startIndex] real fields... [endIndex] lookahead fields...}.
     // Fields requested outside the bounds of the file will have dummy metadata and black data.
+    //
+    // If previousFrameNumber is not -1, fields must contain the result of a
+    // previous call whose first (lookbehind) frame was previousFrameNumber;
+    // any frames that overlap are reused rather than being loaded again.
     static void loadFields(SourceVideo &sourceVideo, LdDecodeMetaData &ldDecodeMetaData,
                            qint32 firstFrameNumber, qint32 numFrames,
                            qint32 lookBehindFrames, qint32 lookAheadFrames,
-                           QVector<SourceField> &fields, qint32 &startIndex, qint32 &endIndex);
+                           QVector<SourceField> &fields, qint32 &startIndex, qint32 &endIndex,
+                           qint32 previousFrameNumber = -1);
 
     // Return the vertical offset of this field within the interlaced frame
     // (i.e. 0 for the top field, 1 for the bottom field).
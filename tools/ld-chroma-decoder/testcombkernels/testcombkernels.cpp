@@ -0,0 +1,350 @@
+/************************************************************************
+
+    testcombkernels.cpp
+
+    ld-chroma-decoder - Colourisation filter for ld-decode
+    Copyright (C) 2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-chroma-decoder is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using std::cerr;
+using std::string;
+using std::vector;
+
+#include "combkernels.h"
+
+// Frame geometry, similar to an NTSC 4fsc TBC file
+static constexpr int FIELD_WIDTH = 910;
+static constexpr int FRAME_HEIGHT = 525;
+static constexpr int ACTIVE_START = 134;
+static constexpr int ACTIVE_END = 894;
+static constexpr int FIRST_LINE = 40;
+static constexpr int LAST_LINE = 525;
+static constexpr double IRE_SCALE = (51200 - 15360) / 100.0;
+
+// Make a synthetic composite frame: a luma ramp with bars of subcarrier at
+// varying amplitudes and phases, some vertical detail, and noise
+static vector<uint16_t> makeFrame(unsigned seed)
+{
+    vector<uint16_t> frame(FIELD_WIDTH * FRAME_HEIGHT);
+    srand(seed);
+
+    for (int y = 0; y < FRAME_HEIGHT; y++) {
+        for (int x = 0; x < FIELD_WIDTH; x++) {
+            const int bar = x / 60;
+            const double luma = 15360 + (x * 30) + ((y / 50) % 2) * 4000;
+            const double amplitude = (bar % 4) * 2500.0 + ((y % 37) == 0 ? 3000.0 : 0.0);
+            const double phase = (bar * 0.7) + ((y % 2) ? M_PI : 0.0);
+            const double chroma = amplitude * sin(((x % 4) * M_PI / 2) + phase);
+            const double noise = (rand() % 201) - 100;
+            frame[(y * FIELD_WIDTH) + x] = static_cast<uint16_t>(luma + chroma + noise);
+        }
+    }
+
+    return frame;
+}
+
+// The original double-precision Comb::split1D/split2D/splitIQ code, over
+// full-frame arrays, for comparison
+
+static void referenceSplit1D(const vector<uint16_t> &frame, vector<double> &clp1D)
+{
+    for (int lineNumber = FIRST_LINE; lineNumber < LAST_LINE; lineNumber++) {
+        const uint16_t *line = frame.data() + (lineNumber * FIELD_WIDTH);
+
+        for (int h = ACTIVE_START; h < ACTIVE_END; h++) {
+            clp1D[(lineNumber * FIELD_WIDTH) + h] = (((line[h + 2] + line[h - 2]) / 2) - line[h]);
+        }
+    }
+}
+
+static void referenceSplit2D(const vector<double> &clp1D, vector<double> &clp2D)
+{
+    static const double blackLine[911] = {0};
+
+    for (int lineNumber = FIRST_LINE; lineNumber < LAST_LINE; lineNumber++) {
+        const double *previousLine = blackLine;
+        if (lineNumber - 2 >= FIRST_LINE) previousLine = clp1D.data() + ((lineNumber - 2) * FIELD_WIDTH);
+        const double *currentLine = clp1D.data() + (lineNumber * FIELD_WIDTH);
+        const double *nextLine = blackLine;
+        if (lineNumber + 2 < LAST_LINE) nextLine = clp1D.data() + ((lineNumber + 2) * FIELD_WIDTH);
+
+        for (int h = ACTIVE_START; h < ACTIVE_END; h++) {
+            double tc1, kp, kn;
+
+            kp  = fabs(fabs(currentLine[h]) - fabs(previousLine[h]));
+            kp += fabs(fabs(currentLine[h - 1]) - fabs(previousLine[h - 1]));
+            kp -= (fabs(currentLine[h]) + fabs(currentLine[h - 1])) * .10;
+            kn  = fabs(fabs(currentLine[h]) - fabs(nextLine[h]));
+            kn += fabs(fabs(currentLine[h - 1]) - fabs(nextLine[h - 1]));
+            kn -= (fabs(currentLine[h]) + fabs(nextLine[h - 1])) * .10;
+
+            kp /= 2;
+            kn /= 2;
+
+            double p_2drange = 45 * IRE_SCALE;
+            kp = std::max(0.0, std::min(1 - (kp / p_2drange), 1.0));
+            kn = std::max(0.0, std::min(1 - (kn / p_2drange), 1.0));
+
+            double sc = 1.0;
+
+            if ((kn > 0) || (kp > 0)) {
+                if (kn > (3 * kp)) kp = 0;
+                else if (kp > (3 * kn)) kn = 0;
+
+                sc = (2.0 / (kn + kp));
+                if (sc < 1.0) sc = 1.0;
+            } else {
+                if ((fabs(fabs(previousLine[h]) - fabs(nextLine[h])) - fabs((nextLine[h] + previousLine[h]) * .2)) <= 0) {
+                    kn = kp = 1;
+                }
+            }
+
+            tc1  = ((currentLine[h] - previousLine[h]) * kp * sc);
+            tc1 += ((currentLine[h] - nextLine[h]) * kn * sc);
+            tc1 /= 8;
+
+            clp2D[(lineNumber * FIELD_WIDTH) + h] = tc1;
+        }
+    }
+}
+
+static void referenceSplitIQLine(const uint16_t *line, const double *chroma, int start, int end, bool linePhase,
+                                 double *output)
+{
+    double si = 0, sq = 0;
+    for (int h = start; h < end; h++) {
+        int phase = h % 4;
+
+        double cavg = chroma[h];
+        if (!linePhase) cavg = -cavg;
+
+        switch (phase) {
+            case 0: sq = cavg; break;
+            case 1: si = -cavg; break;
+            case 2: sq = -cavg; break;
+            case 3: si = cavg; break;
+            default: break;
+        }
+
+        *output++ = line[h];
+        *output++ = si;
+        *output++ = sq;
+    }
+}
+
+// Run the new kernels over a frame, in the same way as Comb
+static void kernelSplit(const vector<uint16_t> &frame, ChromaPlane &plane1D, ChromaPlane &plane2D)
+{
+    static const float blackLineData[911] = {0};
+    const float *blackLine = blackLineData + 1;
+
+    const int activeWidth = ACTIVE_END - ACTIVE_START;
+    plane1D.resize(activeWidth, LAST_LINE - FIRST_LINE);
+    plane2D.resize(activeWidth, LAST_LINE - FIRST_LINE);
+
+    for (int lineNumber = FIRST_LINE; lineNumber < LAST_LINE; lineNumber++) {
+        combSplit1D(frame.data() + (lineNumber * FIELD_WIDTH) + ACTIVE_START, activeWidth,
+                    plane1D.line(lineNumber - FIRST_LINE));
+    }
+
+    for (int lineNumber = FIRST_LINE; lineNumber < LAST_LINE; lineNumber++) {
+        const int bufferLine = lineNumber - FIRST_LINE;
+        const float *previousLine = (lineNumber - 2 >= FIRST_LINE) ? plane1D.line(bufferLine - 2) : blackLine;
+        const float *nextLine = (lineNumber + 2 < LAST_LINE) ? plane1D.line(bufferLine + 2) : blackLine;
+        combSplit2D(previousLine, plane1D.line(bufferLine), nextLine, activeWidth,
+                    static_cast<float>(45 * IRE_SCALE), plane2D.line(bufferLine));
+    }
+}
+
+// Check that ChromaPlane lines are aligned and padded with zeros
+static void testChromaPlane()
+{
+    cerr << "Testing ChromaPlane\n";
+
+    ChromaPlane plane;
+    plane.resize(ACTIVE_END - ACTIVE_START, 10);
+    ChromaPlane copy = plane;
+
+    for (int y = 0; y < 10; y++) {
+        for (const ChromaPlane *p: {&plane, &copy}) {
+            const float *line = p->line(y);
+            if ((reinterpret_cast<uintptr_t>(line) % 32) != 0) {
+                cerr << "ChromaPlane line " << y << " is not aligned\n";
+                exit(1);
+            }
+            for (int x = -ChromaPlane::PADDING; x < 0; x++) {
+                if (line[x] != 0 || line[p->getWidth() - 1 - x] != 0) {
+                    cerr << "ChromaPlane line " << y << " padding is not zero\n";
+                    exit(1);
+                }
+            }
+        }
+    }
+}
+
+// Check that combSplit1D matches the original code exactly, and that
+// combSplit2D matches it within the precision of single-precision floats
+static void testSplit(unsigned seed)
+{
+    cerr << "Testing combSplit1D/combSplit2D with seed " << seed << "\n";
+
+    const vector<uint16_t> frame = makeFrame(seed);
+    vector<double> ref1D(FIELD_WIDTH * FRAME_HEIGHT), ref2D(FIELD_WIDTH * FRAME_HEIGHT);
+    referenceSplit1D(frame, ref1D);
+    referenceSplit2D(ref1D, ref2D);
+
+    ChromaPlane plane1D, plane2D;
+    kernelSplit(frame, plane1D, plane2D);
+
+    // The adaptive filter switches between weightings at thresholds, so a
+    // tiny rounding difference can occasionally change a sample's weighting
+    // completely. Allow a small number of those, and require the rest to
+    // agree to within a fraction of a 16-bit level.
+    const double tolerance = 0.01;
+    const int maxOutliers = 4;
+    int outliers = 0;
+    double maxError = 0;
+
+    for (int lineNumber = FIRST_LINE; lineNumber < LAST_LINE; lineNumber++) {
+        const float *line1D = plane1D.line(lineNumber - FIRST_LINE);
+        const float *line2D = plane2D.line(lineNumber - FIRST_LINE);
+
+        for (int h = ACTIVE_START; h < ACTIVE_END; h++) {
+            const double expected1D = ref1D[(lineNumber * FIELD_WIDTH) + h];
+            if (line1D[h - ACTIVE_START] != expected1D) {
+                cerr << "Mismatch on split1D at " << lineNumber << "/" << h << ": "
+                     << line1D[h - ACTIVE_START] << ", " << expected1D << "\n";
+                exit(1);
+            }
+
+            const double error = fabs(line2D[h - ACTIVE_START] - ref2D[(lineNumber * FIELD_WIDTH) + h]);
+            if (error > tolerance) outliers++;
+            else maxError = std::max(maxError, error);
+        }
+    }
+
+    cerr << "  split2D: max error " << maxError << ", " << outliers << " outliers\n";
+    if (outliers > maxOutliers) {
+        cerr << "Too many split2D outliers\n";
+        exit(1);
+    }
+}
+
+// Check that combSplitIQ matches the original code exactly, for all starting
+// phases and for lengths that exercise the vector code's remainder handling
+static void testSplitIQ()
+{
+    cerr << "Testing combSplitIQ\n";
+
+    const vector<uint16_t> frame = makeFrame(1);
+    const uint16_t *line = frame.data() + (100 * FIELD_WIDTH);
+
+    vector<float> chroma(FIELD_WIDTH);
+    vector<double> chromaDouble(FIELD_WIDTH);
+    for (int h = 0; h < FIELD_WIDTH; h++) {
+        chroma[h] = static_cast<float>((h * 37 % 101) - 50) * 1.5f;
+        chromaDouble[h] = chroma[h];
+    }
+
+    for (int start = 16; start < 20; start++) {
+        for (int length = 0; length < 40; length++) {
+            for (bool linePhase: {false, true}) {
+                const int end = start + length;
+                vector<double> expected(length * 3), output(length * 3);
+                referenceSplitIQLine(line, chromaDouble.data(), start, end, linePhase, expected.data());
+                combSplitIQ(line + start, chroma.data() + start, length, start % 4, linePhase, output.data());
+
+                for (int i = 0; i < length * 3; i++) {
+                    if (output[i] != expected[i]) {
+                        cerr << "Mismatch on splitIQ start " << start << " length " << length << " phase " << linePhase
+                             << " at " << i << ": " << output[i] << ", " << expected[i] << "\n";
+                        exit(1);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Measure how long a function takes to run repeatedly, in ms per frame
+template <typename F>
+double timeFrame(F fn)
+{
+    const int repeats = 20;
+
+    const auto startTime = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++) {
+        fn();
+    }
+    const auto endTime = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(endTime - startTime).count() / repeats;
+}
+
+// Compare the kernels' speed against the original code. This isn't part of
+// the test; run "testcombkernels --benchmark" to include it.
+static void benchmarkSplit()
+{
+    const vector<uint16_t> frame = makeFrame(1);
+    vector<double> ref1D(FIELD_WIDTH * FRAME_HEIGHT), ref2D(FIELD_WIDTH * FRAME_HEIGHT);
+    vector<double> refYiq(FIELD_WIDTH * 3), yiq(FIELD_WIDTH * 3);
+    ChromaPlane plane1D, plane2D;
+
+    const double reference = timeFrame([&] {
+        referenceSplit1D(frame, ref1D);
+        referenceSplit2D(ref1D, ref2D);
+        for (int lineNumber = FIRST_LINE; lineNumber < LAST_LINE; lineNumber++) {
+            referenceSplitIQLine(frame.data() + (lineNumber * FIELD_WIDTH), ref2D.data() + (lineNumber * FIELD_WIDTH),
+                                 ACTIVE_START, ACTIVE_END, true, refYiq.data());
+        }
+    });
+    const double kernels = timeFrame([&] {
+        kernelSplit(frame, plane1D, plane2D);
+        for (int lineNumber = FIRST_LINE; lineNumber < LAST_LINE; lineNumber++) {
+            combSplitIQ(frame.data() + (lineNumber * FIELD_WIDTH) + ACTIVE_START, plane2D.line(lineNumber - FIRST_LINE),
+                        ACTIVE_END - ACTIVE_START, ACTIVE_START % 4, true, yiq.data());
+        }
+    });
+
+    cerr << "Benchmark split1D/split2D/splitIQ: " << reference << " ms/frame original, "
+         << kernels << " ms/frame kernels (" << reference / kernels << "x)\n";
+}
+
+int main(int argc, char *argv[])
+{
+    testChromaPlane();
+    for (unsigned seed = 1; seed <= 4; seed++) {
+        testSplit(seed);
+    }
+    testSplitIQ();
+
+    if (argc > 1 && string(argv[1]) == "--benchmark") {
+        benchmarkSplit();
+    }
+
+    return 0;
+}
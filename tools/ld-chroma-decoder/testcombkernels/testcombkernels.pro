@@ -0,0 +1,16 @@
+CONFIG += c++11 testcase
+CONFIG -= app_bundle
+
+SOURCES += \
+    testcombkernels.cpp \
+    ../combkernels.cpp
+
+HEADERS += \
+    ../combkernels.h \
+    ../../library/tbc/cpufeatures.h
+
+INCLUDEPATH += \
+    .. \
+    ../../library/tbc
+
+target.CONFIG += no_default_install
@@ -47,7 +47,7 @@ void TransformPal::updateConfiguration(const LdDecodeMetaData::VideoParameters &
     mode = _mode;
 
     // Resize thresholds to match the number of FFT bins we will consider in
-    // applyFilter. The x loop there doesn't need to look at every bin.
+    // buildBinPairs. The x loop there doesn't need to look at every bin.
     const qint32 thresholdsSize = ((xComplex / 4) + 1) * yComplex * zComplex;
 
     if (_thresholds.size() == 0) {
@@ -62,21 +62,24 @@ void TransformPal::updateConfiguration(const LdDecodeMetaData::VideoParameters &
         }
     }
 
+    buildBinPairs();
+
     configurationSet = true;
 }
 
 void TransformPal::overlayFFT(qint32 positionX, qint32 positionY,
                               const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
-                              QVector<RGBFrame> &rgbFrames)
+                              const RGBFrameLayout &rgbLayout, QVector<RGBFrame> &rgbFrames)
 {
     // Visualise the first field for each output frame
     for (int fieldIndex = startIndex, outputIndex = 0; fieldIndex < endIndex; fieldIndex += 2, outputIndex++) {
-        overlayFFTFrame(positionX, positionY, inputFields, fieldIndex, rgbFrames[outputIndex]);
+        overlayFFTFrame(positionX, positionY, inputFields, fieldIndex, rgbLayout, rgbFrames[outputIndex]);
     }
 }
 
 // Overlay the input and output FFT arrays, in either 2D or 3D
-void TransformPal::overlayFFTArrays(const fftw_complex *fftIn, const fftw_complex *fftOut,
+template <typename Complex>
+void TransformPal::overlayFFTArrays(const Complex *fftIn, const Complex *fftOut,
                                     FrameCanvas &canvas)
 {
     // How many pixels to draw for each bin
@@ -87,15 +90,15 @@ void TransformPal::overlayFFTArrays(const fftw_complex *fftIn, const fftw_comple
     // Work out a scaling factor to make all values visible.
     double maxValue = 0;
     for (qint32 i = 0; i < xComplex * yComplex * zComplex; i++) {
-        maxValue = qMax(maxValue, fabs(fftIn[i][0]));
-        maxValue = qMax(maxValue, fabs(fftOut[i][0]));
+        maxValue = qMax(maxValue, fabs(static_cast<double>(fftIn[i][0])));
+        maxValue = qMax(maxValue, fabs(static_cast<double>(fftOut[i][0])));
     }
     const double valueScale = 65535.0 / log2(maxValue);
 
     // Draw each 2D plane of the array
     for (qint32 z = 0; z < zComplex; z++) {
         for (qint32 column = 0; column < 2; column++) {
-            const fftw_complex *fftData = column == 0 ? fftIn : fftOut;
+            const Complex *fftData = column == 0 ? fftIn : fftOut;
 
             // Work out where this 2D array starts
             const qint32 yStart = canvas.top() + (z * ((yScale * yComplex) + 1));
@@ -107,7 +110,7 @@ void TransformPal::overlayFFTArrays(const fftw_complex *fftIn, const fftw_comple
             // Draw the bins in the array
             for (qint32 y = 0; y < yComplex; y++) {
                 for (qint32 x = 0; x < xComplex; x++) {
-                    const double value = fabs(fftData[(((z * yComplex) + y) * xComplex) + x][0]);
+                    const double value = fabs(static_cast<double>(fftData[(((z * yComplex) + y) * xComplex) + x][0]));
                     const double shade = value <= 0 ? 0 : log2(value) * valueScale;
                     const quint16 shade16 = static_cast<quint16>(qBound(0.0, shade, 65535.0));
                     canvas.fillRectangle(xStart + (x * xScale) + 1, yStart + (y * yScale) + 1, xScale, yScale, canvas.grey(shade16));
@@ -116,3 +119,8 @@ void TransformPal::overlayFFTArrays(const fftw_complex *fftIn, const fftw_comple
         }
     }
 }
+
+template void TransformPal::overlayFFTArrays<fftw_complex>(const fftw_complex *fftIn, const fftw_complex *fftOut,
+                                                           FrameCanvas &canvas);
+template void TransformPal::overlayFFTArrays<fftwf_complex>(const fftwf_complex *fftIn, const fftwf_complex *fftOut,
+                                                            FrameCanvas &canvas);
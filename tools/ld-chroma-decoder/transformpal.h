@@ -33,10 +33,74 @@
 
 #include "lddecodemetadata.h"
 
+#include "bandrunner.h"
 #include "framecanvas.h"
 #include "rgbframe.h"
 #include "sourcefield.h"
 
+// Wrappers around FFTW's double- and single-precision interfaces, so that the
+// Transform PAL filters can be instantiated for either.
+template <typename T>
+struct FFTW;
+
+template <>
+struct FFTW<double> {
+    typedef fftw_complex Complex;
+    typedef fftw_plan Plan;
+
+    static double *allocReal(size_t n) { return fftw_alloc_real(n); }
+    static Complex *allocComplex(size_t n) { return fftw_alloc_complex(n); }
+    static void free(void *p) { fftw_free(p); }
+
+    static Plan planR2C2D(int n0, int n1, double *in, Complex *out, unsigned flags) {
+        return fftw_plan_dft_r2c_2d(n0, n1, in, out, flags);
+    }
+    static Plan planC2R2D(int n0, int n1, Complex *in, double *out, unsigned flags) {
+        return fftw_plan_dft_c2r_2d(n0, n1, in, out, flags);
+    }
+    static Plan planR2C3D(int n0, int n1, int n2, double *in, Complex *out, unsigned flags) {
+        return fftw_plan_dft_r2c_3d(n0, n1, n2, in, out, flags);
+    }
+    static Plan planC2R3D(int n0, int n1, int n2, Complex *in, double *out, unsigned flags) {
+        return fftw_plan_dft_c2r_3d(n0, n1, n2, in, out, flags);
+    }
+    // Execute a plan on arrays other than the ones it was planned with, which
+    // must have the same alignment. These are safe to call from several
+    // threads at once, unlike planning.
+    static void executeR2C(const Plan plan, double *in, Complex *out) { fftw_execute_dft_r2c(plan, in, out); }
+    static void executeC2R(const Plan plan, Complex *in, double *out) { fftw_execute_dft_c2r(plan, in, out); }
+    static void destroyPlan(Plan plan) { fftw_destroy_plan(plan); }
+};
+
+template <>
+struct FFTW<float> {
+    typedef fftwf_complex Complex;
+    typedef fftwf_plan Plan;
+
+    static float *allocReal(size_t n) { return fftwf_alloc_real(n); }
+    static Complex *allocComplex(size_t n) { return fftwf_alloc_complex(n); }
+    static void free(void *p) { fftwf_free(p); }
+
+    static Plan planR2C2D(int n0, int n1, float *in, Complex *out, unsigned flags) {
+        return fftwf_plan_dft_r2c_2d(n0, n1, in, out, flags);
+    }
+    static Plan planC2R2D(int n0, int n1, Complex *in, float *out, unsigned flags) {
+        return fftwf_plan_dft_c2r_2d(n0, n1, in, out, flags);
+    }
+    static Plan planR2C3D(int n0, int n1, int n2, float *in, Complex *out, unsigned flags) {
+        return fftwf_plan_dft_r2c_3d(n0, n1, n2, in, out, flags);
+    }
+    static Plan planC2R3D(int n0, int n1, int n2, Complex *in, float *out, unsigned flags) {
+        return fftwf_plan_dft_c2r_3d(n0, n1, n2, in, out, flags);
+    }
+    // Execute a plan on arrays other than the ones it was planned with, which
+    // must have the same alignment. These are safe to call from several
+    // threads at once, unlike planning.
+    static void executeR2C(const Plan plan, float *in, Complex *out) { fftwf_execute_dft_r2c(plan, in, out); }
+    static void executeC2R(const Plan plan, Complex *in, float *out) { fftwf_execute_dft_c2r(plan, in, out); }
+    static void destroyPlan(Plan plan) { fftwf_destroy_plan(plan); }
+};
+
 // Abstract base class for Transform PAL filters.
 class TransformPal {
 public:
@@ -68,26 +132,40 @@ public:
     // For each input frame between startFieldIndex and endFieldIndex, a
     // pointer will be placed in outputFields to an array of the same size
     // (owned by this object) containing the chroma signal.
+    //
+    // isContinuation should be true if the field at startIndex is the one
+    // that was at endIndex in the previous call, in which case filters that
+    // keep partial results between calls may reuse them.
+    //
+    // bandRunner is used to divide the work for each field or frame into
+    // bands that are filtered in parallel.
     virtual void filterFields(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
+                              bool isContinuation, BandRunner &bandRunner,
                               QVector<const double *> &outputFields) = 0;
 
     // Draw a visualisation of the FFT over RGB output frames.
     //
     // The FFT is computed for each field, so this visualises only the first
     // field in each frame. positionX/Y specify the location to visualise in
-    // frame coordinates.
+    // frame coordinates; rgbLayout gives the layout of the output frames.
     void overlayFFT(qint32 positionX, qint32 positionY,
                     const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
-                    QVector<RGBFrame> &rgbFrames);
+                    const RGBFrameLayout &rgbLayout, QVector<RGBFrame> &rgbFrames);
 
 protected:
+    // Precompute the list of bins that the frequency-domain filter will
+    // compare. Called by updateConfiguration once the thresholds are known.
+    virtual void buildBinPairs() = 0;
+
     // Overlay a visualisation of one field's FFT.
     // Calls back to overlayFFTArrays to draw the arrays.
     virtual void overlayFFTFrame(qint32 positionX, qint32 positionY,
                                  const QVector<SourceField> &inputFields, qint32 fieldIndex,
-                                 RGBFrame &rgbFrame) = 0;
+                                 const RGBFrameLayout &rgbLayout, RGBFrame &rgbFrame) = 0;
 
-    void overlayFFTArrays(const fftw_complex *fftIn, const fftw_complex *fftOut,
+    // (Complex is fftw_complex or fftwf_complex.)
+    template <typename Complex>
+    void overlayFFTArrays(const Complex *fftIn, const Complex *fftOut,
                           FrameCanvas &canvas);
 
     // FFT size
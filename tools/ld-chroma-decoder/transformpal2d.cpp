@@ -28,8 +28,10 @@
 #include "transformpal2d.h"
 
 #include <QtMath>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstring>
 
 /*!
     \class TransformPal2D
@@ -44,12 +46,18 @@
 
 // Definitions of static constexpr data members, for compatibility with
 // pre-C++17 compilers
-constexpr qint32 TransformPal2D::YTILE;
-constexpr qint32 TransformPal2D::HALFYTILE;
-constexpr qint32 TransformPal2D::XTILE;
-constexpr qint32 TransformPal2D::HALFXTILE;
-constexpr qint32 TransformPal2D::YCOMPLEX;
-constexpr qint32 TransformPal2D::XCOMPLEX;
+template <typename FFTSample>
+constexpr qint32 TransformPal2D<FFTSample>::YTILE;
+template <typename FFTSample>
+constexpr qint32 TransformPal2D<FFTSample>::HALFYTILE;
+template <typename FFTSample>
+constexpr qint32 TransformPal2D<FFTSample>::XTILE;
+template <typename FFTSample>
+constexpr qint32 TransformPal2D<FFTSample>::HALFXTILE;
+template <typename FFTSample>
+constexpr qint32 TransformPal2D<FFTSample>::YCOMPLEX;
+template <typename FFTSample>
+constexpr qint32 TransformPal2D<FFTSample>::XCOMPLEX;
 
 // Compute one value of the window function, applied to the data blocks before
 // the FFT to reduce edge effects. This is a symmetrical raised-cosine
@@ -60,7 +68,8 @@ static double computeWindow(qint32 element, qint32 limit)
     return 0.5 - (0.5 * cos((2 * M_PI * (element + 0.5)) / limit));
 }
 
-TransformPal2D::TransformPal2D()
+template <typename FFTSample>
+TransformPal2D<FFTSample>::TransformPal2D()
     : TransformPal(XCOMPLEX, YCOMPLEX, 1)
 {
     // Compute the window function.
@@ -72,36 +81,59 @@ TransformPal2D::TransformPal2D()
         }
     }
 
-    // Allocate buffers for FFTW. These must be allocated using FFTW's own
-    // functions so they're properly aligned for SIMD operations.
-    fftReal = fftw_alloc_real(YTILE * XTILE);
-    fftComplexIn = fftw_alloc_complex(YCOMPLEX * XCOMPLEX);
-    fftComplexOut = fftw_alloc_complex(YCOMPLEX * XCOMPLEX);
+    // Allocate buffers for the first thread
+    allocateWorkspaces(1);
 
     // Plan FFTW operations
-    forwardPlan = fftw_plan_dft_r2c_2d(YTILE, XTILE, fftReal, fftComplexIn, FFTW_MEASURE);
-    inversePlan = fftw_plan_dft_c2r_2d(YTILE, XTILE, fftComplexOut, fftReal, FFTW_MEASURE);
+    Workspace &workspace = workspaces[0];
+    forwardPlan = FFTW<FFTSample>::planR2C2D(YTILE, XTILE, workspace.fftReal, workspace.fftComplexIn, FFTW_MEASURE);
+    inversePlan = FFTW<FFTSample>::planC2R2D(YTILE, XTILE, workspace.fftComplexOut, workspace.fftReal, FFTW_MEASURE);
 }
 
-TransformPal2D::~TransformPal2D()
+template <typename FFTSample>
+TransformPal2D<FFTSample>::~TransformPal2D()
 {
     // Free FFTW plans and buffers
-    fftw_destroy_plan(forwardPlan);
-    fftw_destroy_plan(inversePlan);
-    fftw_free(fftReal);
-    fftw_free(fftComplexIn);
-    fftw_free(fftComplexOut);
+    FFTW<FFTSample>::destroyPlan(forwardPlan);
+    FFTW<FFTSample>::destroyPlan(inversePlan);
+    for (Workspace &workspace : workspaces) {
+        FFTW<FFTSample>::free(workspace.fftReal);
+        FFTW<FFTSample>::free(workspace.fftComplexIn);
+        FFTW<FFTSample>::free(workspace.fftComplexOut);
+    }
+}
+
+// Make sure there are at least count sets of FFT buffers
+template <typename FFTSample>
+void TransformPal2D<FFTSample>::allocateWorkspaces(qint32 count)
+{
+    while (workspaces.size() < count) {
+        // These must be allocated using FFTW's own functions so they're
+        // properly aligned for SIMD operations (and so that all of them have
+        // the same alignment as the ones the plans were made with).
+        Workspace workspace;
+        workspace.fftReal = FFTW<FFTSample>::allocReal(YTILE * XTILE);
+        workspace.fftComplexIn = FFTW<FFTSample>::allocComplex(YCOMPLEX * XCOMPLEX);
+        workspace.fftComplexOut = FFTW<FFTSample>::allocComplex(YCOMPLEX * XCOMPLEX);
+        workspaces.push_back(workspace);
+    }
 }
 
-qint32 TransformPal2D::getThresholdsSize()
+template <typename FFTSample>
+qint32 TransformPal2D<FFTSample>::getThresholdsSize()
 {
     // On the X axis, include only the bins we actually use in applyFilter
     return YCOMPLEX * ((XCOMPLEX / 4) + 1);
 }
 
-void TransformPal2D::filterFields(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
+template <typename FFTSample>
+void TransformPal2D<FFTSample>::filterFields(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
+                                  bool, BandRunner &bandRunner,
                                   QVector<const double *> &outputFields)
 {
+    // Each field is filtered independently, so there's nothing to carry
+    // between calls and isContinuation is ignored.
+
     assert(configurationSet);
 
     // Check we have a valid vector of input fields, and a matching output vector
@@ -120,44 +152,67 @@ void TransformPal2D::filterFields(const QVector<SourceField> &inputFields, qint3
         outputFields[i] = chromaBuf[i].data();
     }
 
+    allocateWorkspaces(bandRunner.getThreads());
+
     for (qint32 i = startIndex, j = 0; i < endIndex; i++, j++) {
-        filterField(inputFields[i], j);
+        const SourceField &inputField = inputFields[i];
+        bandRunner.run(inputField.getFirstActiveLine(videoParameters), inputField.getLastActiveLine(videoParameters),
+                       HALFYTILE, [&](qint32 band, qint32 startLine, qint32 endLine) {
+            filterField(inputField, startLine, endLine, workspaces[band], j);
+        });
     }
 }
 
-// Process one field, writing the reuslt into chromaBuf[outputIndex]
-void TransformPal2D::filterField(const SourceField& inputField, qint32 outputIndex)
+// Process the lines from startLine to endLine of one field, writing the result
+// into chromaBuf[outputIndex]
+template <typename FFTSample>
+void TransformPal2D<FFTSample>::filterField(const SourceField& inputField, qint32 startLine, qint32 endLine,
+                                            Workspace &workspace, qint32 outputIndex)
 {
     const qint32 firstFieldLine = inputField.getFirstActiveLine(videoParameters);
     const qint32 lastFieldLine = inputField.getLastActiveLine(videoParameters);
 
     // Iterate through the overlapping tile positions, covering the active area.
     // (See TransformPal2D member variable documentation for how the tiling works.)
+    //
+    // Only the tiles that overlap the band are computed, and only the lines
+    // within the band are written. Each output line still gets the same tiles
+    // added in the same order, so the result doesn't depend on the banding.
     for (qint32 tileY = firstFieldLine - HALFYTILE; tileY < lastFieldLine; tileY += HALFYTILE) {
+        if (tileY + YTILE <= startLine || tileY >= endLine) continue;
+
         // Work out which lines of these tiles are within the active region
         const qint32 startY = qMax(firstFieldLine - tileY, 0);
         const qint32 endY = qMin(lastFieldLine - tileY, YTILE);
 
+        // ... and which of those are within the band
+        const qint32 startBandY = qMax(startLine - tileY, startY);
+        const qint32 endBandY = qMin(endLine - tileY, endY);
+
         for (qint32 tileX = videoParameters.activeVideoStart - HALFXTILE; tileX < videoParameters.activeVideoEnd; tileX += HALFXTILE) {
             // Compute the forward FFT
-            forwardFFTTile(tileX, tileY, startY, endY, inputField);
+            forwardFFTTile(tileX, tileY, startY, endY, inputField, workspace);
 
             // Apply the frequency-domain filter in the appropriate mode
             if (mode == levelMode) {
-                applyFilter<levelMode>();
+                applyFilter<levelMode>(workspace);
             } else {
-                applyFilter<thresholdMode>();
+                applyFilter<thresholdMode>(workspace);
             }
 
             // Compute the inverse FFT
-            inverseFFTTile(tileX, tileY, startY, endY, outputIndex);
+            inverseFFTTile(tileX, tileY, startBandY, endBandY, workspace, outputIndex);
         }
     }
 }
 
 // Apply the forward FFT to an input tile, populating fftComplexIn
-void TransformPal2D::forwardFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, const SourceField &inputField)
+template <typename FFTSample>
+void TransformPal2D<FFTSample>::forwardFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, const SourceField &inputField,
+                                               Workspace &workspace)
 {
+    FFTSample *fftReal = workspace.fftReal;
+
     // Copy the input signal into fftReal, applying the window function
     const quint16 *inputPtr = inputField.data.data();
     for (qint32 y = 0; y < YTILE; y++) {
@@ -177,18 +232,22 @@ void TransformPal2D::forwardFFTTile(qint32 tileX, qint32 tileY, qint32 startY, q
     }
 
     // Convert time domain in fftReal to frequency domain in fftComplexIn
-    fftw_execute(forwardPlan);
+    FFTW<FFTSample>::executeR2C(forwardPlan, fftReal, workspace.fftComplexIn);
 }
 
 // Apply the inverse FFT to fftComplexOut, overlaying the result into chromaBuf[outputIndex]
-void TransformPal2D::inverseFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, qint32 outputIndex)
+template <typename FFTSample>
+void TransformPal2D<FFTSample>::inverseFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, Workspace &workspace,
+                                               qint32 outputIndex)
 {
+    FFTSample *fftReal = workspace.fftReal;
+
     // Work out what X range of this tile is inside the active area
     const qint32 startX = qMax(videoParameters.activeVideoStart - tileX, 0);
     const qint32 endX = qMin(videoParameters.activeVideoEnd - tileX, XTILE);
 
     // Convert frequency domain in fftComplexOut back to time domain in fftReal
-    fftw_execute(inversePlan);
+    FFTW<FFTSample>::executeC2R(inversePlan, workspace.fftComplexOut, fftReal);
 
     // Overlay the result, normalising the FFTW output, into chromaBuf
     double *outputPtr = chromaBuf[outputIndex].data();
@@ -200,27 +259,20 @@ void TransformPal2D::inverseFFTTile(qint32 tileX, qint32 tileY, qint32 startY, q
     }
 }
 
-// Return the absolute value squared of an fftw_complex
-static inline double fftwAbsSq(const fftw_complex &value)
+// Return the absolute value squared of an fftw_complex or fftwf_complex
+template <typename T>
+static inline T fftwAbsSq(const T (&value)[2])
 {
     return (value[0] * value[0]) + (value[1] * value[1]);
 }
 
-// Apply the frequency-domain filter.
-// (Templated so that the inner loop gets specialised for each mode.)
-template <TransformPal::TransformMode MODE>
-void TransformPal2D::applyFilter()
+// Work out which bins the frequency-domain filter should compare.
+template <typename FFTSample>
+void TransformPal2D<FFTSample>::buildBinPairs()
 {
     // Get pointer to squared threshold values
     const double *thresholdsPtr = thresholds.data();
 
-    // Clear fftComplexOut. We discard values by default; the filter only
-    // copies values that look like chroma.
-    for (qint32 i = 0; i < XCOMPLEX * YCOMPLEX; i++) {
-        fftComplexOut[i][0] = 0.0;
-        fftComplexOut[i][1] = 0.0;
-    }
-
     // This is a direct translation of transform_filter from pyctools-pal.
     // The main simplification is that we don't need to worry about
     // conjugates, because FFTW only returns half the result in the first
@@ -235,19 +287,21 @@ void TransformPal2D::applyFilter()
     //
     // The Y axis covers 0 to 288 c/aph;  72 c/aph is 1/4 * YTILE.
     // The X axis covers 0 to 4fSC Hz;    fSC HZ   is 1/4 * XTILE.
+    //
+    // The reflections only depend on the bin positions, so rather than
+    // working them out for every tile, we list the pairs here and applyFilter
+    // just works through the list.
+
+    binPairs.clear();
+    carrierBins.clear();
+
+    // For each bin, the index in binPairs of the pair it's the first bin of
+    QVector<qint32> pairIndex(YCOMPLEX * XCOMPLEX, -1);
 
     for (qint32 y = 0; y < YTILE; y++) {
         // Reflect around 72 c/aph vertically.
         const qint32 y_ref = ((YTILE / 2) + YTILE - y) % YTILE;
 
-        // Input data for this line and its reflection
-        const fftw_complex *bi = fftComplexIn + (y * XCOMPLEX);
-        const fftw_complex *bi_ref = fftComplexIn + (y_ref * XCOMPLEX);
-
-        // Output data for this line and its reflection
-        fftw_complex *bo = fftComplexOut + (y * XCOMPLEX);
-        fftw_complex *bo_ref = fftComplexOut + (y_ref * XCOMPLEX);
-
         // We only need to look at horizontal frequencies that might be chroma (0.5fSC to 1.5fSC).
         for (qint32 x = XTILE / 8; x <= XTILE / 4; x++) {
             // Reflect around fSC horizontally
@@ -256,51 +310,25 @@ void TransformPal2D::applyFilter()
             // Get the threshold for this bin
             const double threshold_sq = *thresholdsPtr++;
 
-            const fftw_complex &in_val = bi[x];
-            const fftw_complex &ref_val = bi_ref[x_ref];
+            const qint32 in = (y * XCOMPLEX) + x;
+            const qint32 ref = (y_ref * XCOMPLEX) + x_ref;
 
-            if (x == x_ref && y == y_ref) {
+            if (in == ref) {
                 // This bin is its own reflection (i.e. it's a carrier). Keep it!
-                bo[x][0] = in_val[0];
-                bo[x][1] = in_val[1];
-                continue;
-            }
-
-            // Get the squares of the magnitudes (to minimise the number of sqrts)
-            const double m_in_sq = fftwAbsSq(in_val);
-            const double m_ref_sq = fftwAbsSq(ref_val);
-
-            if (MODE == levelMode) {
-                // Compare the magnitudes of the two values, and scale the
-                // larger one down so its magnitude is the same as the
-                // smaller one.
-                const double factor = sqrt(m_in_sq / m_ref_sq);
-                if (m_in_sq > m_ref_sq) {
-                    // Reduce in_val, keep ref_val as is
-                    bo[x][0] = in_val[0] / factor;
-                    bo[x][1] = in_val[1] / factor;
-                    bo_ref[x_ref][0] = ref_val[0];
-                    bo_ref[x_ref][1] = ref_val[1];
-                } else {
-                    // Reduce ref_val, keep in_val as is
-                    bo[x][0] = in_val[0];
-                    bo[x][1] = in_val[1];
-                    bo_ref[x_ref][0] = ref_val[0] * factor;
-                    bo_ref[x_ref][1] = ref_val[1] * factor;
-                }
+                carrierBins.push_back(in);
+            } else if (pairIndex[ref] != -1) {
+                // We've already seen this pair the other way round. The
+                // comparison is symmetrical, so we only need to do it once --
+                // but the bins are kept if they're within either bin's
+                // threshold, so use the smaller one. (Swapping the pair makes
+                // the result bit-identical to comparing each bin in turn,
+                // where this comparison would come last.)
+                BinPair &pair = binPairs[pairIndex[ref]];
+                pair.thresholdSq = qMin(pair.thresholdSq, static_cast<FFTSample>(threshold_sq));
+                std::swap(pair.in, pair.ref);
             } else {
-                // Compare the magnitudes of the two values, and discard both
-                // if they are more different than the threshold for this
-                // bin.
-                if (m_in_sq < m_ref_sq * threshold_sq || m_ref_sq < m_in_sq * threshold_sq) {
-                    // Probably not a chroma signal; throw it away.
-                } else {
-                    // They're similar. Keep it!
-                    bo[x][0] = in_val[0];
-                    bo[x][1] = in_val[1];
-                    bo_ref[x_ref][0] = ref_val[0];
-                    bo_ref[x_ref][1] = ref_val[1];
-                }
+                pairIndex[in] = binPairs.size();
+                binPairs.push_back(BinPair {in, ref, static_cast<FFTSample>(threshold_sq)});
             }
         }
     }
@@ -308,9 +336,71 @@ void TransformPal2D::applyFilter()
     assert(thresholdsPtr == thresholds.data() + thresholds.size());
 }
 
-void TransformPal2D::overlayFFTFrame(qint32 positionX, qint32 positionY,
+// Apply the frequency-domain filter.
+// (Templated so that the inner loop gets specialised for each mode.)
+template <typename FFTSample>
+template <TransformPal::TransformMode MODE>
+void TransformPal2D<FFTSample>::applyFilter(Workspace &workspace)
+{
+    const FFTComplex *fftComplexIn = workspace.fftComplexIn;
+    FFTComplex *fftComplexOut = workspace.fftComplexOut;
+
+    // Clear fftComplexOut. We discard values by default; the filter only
+    // copies values that look like chroma. Although the filter only writes
+    // the bins in binPairs, FFTW's multidimensional inverse transforms
+    // overwrite their input, so the whole array must be cleared every time.
+    memset(fftComplexOut, 0, YCOMPLEX * XCOMPLEX * sizeof(FFTComplex));
+
+    // Keep the carriers
+    for (qint32 bin : carrierBins) {
+        fftComplexOut[bin][0] = fftComplexIn[bin][0];
+        fftComplexOut[bin][1] = fftComplexIn[bin][1];
+    }
+
+    // Compare each pair of bins. Every bin in the list is written without
+    // branching, so the compiler can vectorise this loop.
+    const BinPair *pairs = binPairs.constData();
+    const qint32 numPairs = binPairs.size();
+    for (qint32 i = 0; i < numPairs; i++) {
+        const FFTComplex &in_val = fftComplexIn[pairs[i].in];
+        const FFTComplex &ref_val = fftComplexIn[pairs[i].ref];
+        FFTComplex &out_val = fftComplexOut[pairs[i].in];
+        FFTComplex &out_ref = fftComplexOut[pairs[i].ref];
+
+        // Get the squares of the magnitudes (to minimise the number of sqrts)
+        const FFTSample m_in_sq = fftwAbsSq(in_val);
+        const FFTSample m_ref_sq = fftwAbsSq(ref_val);
+
+        if (MODE == levelMode) {
+            // Compare the magnitudes of the two values, and scale the
+            // larger one down so its magnitude is the same as the
+            // smaller one.
+            const FFTSample factor = std::sqrt(m_in_sq / m_ref_sq);
+            const FFTSample inDivisor = m_in_sq > m_ref_sq ? factor : 1;
+            const FFTSample refScale = m_in_sq > m_ref_sq ? 1 : factor;
+            out_val[0] = in_val[0] / inDivisor;
+            out_val[1] = in_val[1] / inDivisor;
+            out_ref[0] = ref_val[0] * refScale;
+            out_ref[1] = ref_val[1] * refScale;
+        } else {
+            // Compare the magnitudes of the two values, and discard both
+            // if they are more different than the threshold for this
+            // pair -- otherwise they're probably chroma, so keep them.
+            const FFTSample threshold_sq = pairs[i].thresholdSq;
+            const bool keep = !(m_in_sq < m_ref_sq * threshold_sq || m_ref_sq < m_in_sq * threshold_sq);
+            const FFTSample scale = keep ? 1 : 0;
+            out_val[0] = in_val[0] * scale;
+            out_val[1] = in_val[1] * scale;
+            out_ref[0] = ref_val[0] * scale;
+            out_ref[1] = ref_val[1] * scale;
+        }
+    }
+}
+
+template <typename FFTSample>
+void TransformPal2D<FFTSample>::overlayFFTFrame(qint32 positionX, qint32 positionY,
                                      const QVector<SourceField> &inputFields, qint32 fieldIndex,
-                                     RGBFrame &rgbFrame)
+                                     const RGBFrameLayout &rgbLayout, RGBFrame &rgbFrame)
 {
     // Do nothing if the tile isn't within the frame
     if (positionX < 0 || positionX + XTILE > videoParameters.fieldWidth
@@ -327,21 +417,26 @@ void TransformPal2D::overlayFFTFrame(qint32 positionX, qint32 positionY,
     const qint32 endY = qMin(lastFieldLine - tileY, YTILE);
 
     // Compute the forward FFT
-    forwardFFTTile(positionX, tileY, startY, endY, inputField);
+    Workspace &workspace = workspaces[0];
+    forwardFFTTile(positionX, tileY, startY, endY, inputField, workspace);
 
     // Apply the frequency-domain filter in the appropriate mode
     if (mode == levelMode) {
-        applyFilter<levelMode>();
+        applyFilter<levelMode>(workspace);
     } else {
-        applyFilter<thresholdMode>();
+        applyFilter<thresholdMode>(workspace);
     }
 
     // Create a canvas
-    FrameCanvas canvas(rgbFrame, videoParameters);
+    FrameCanvas canvas(rgbFrame, rgbLayout, videoParameters);
 
     // Outline the selected tile
     canvas.drawRectangle(positionX - 1, positionY + inputField.getOffset() - 1, XTILE + 1, (YTILE * 2) + 1, FrameCanvas::green);
 
     // Draw the arrays
-    overlayFFTArrays(fftComplexIn, fftComplexOut, canvas);
+    overlayFFTArrays(workspace.fftComplexIn, workspace.fftComplexOut, canvas);
 }
+
+// Instantiate the filter for both supported precisions
+template class TransformPal2D<double>;
+template class TransformPal2D<float>;
@@ -35,6 +35,8 @@
 #include "sourcefield.h"
 #include "transformpal.h"
 
+// FFTSample is the precision used for the FFTs: double, or float for speed.
+template <typename FFTSample>
 class TransformPal2D : public TransformPal {
 public:
     TransformPal2D();
@@ -44,17 +46,25 @@ public:
     static qint32 getThresholdsSize();
 
     void filterFields(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
+                      bool isContinuation, BandRunner &bandRunner,
                       QVector<const double *> &outputFields) override;
 
 protected:
-    void filterField(const SourceField& inputField, qint32 outputIndex);
-    void forwardFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, const SourceField &inputField);
-    void inverseFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, qint32 outputIndex);
+    struct Workspace;
+
+    void allocateWorkspaces(qint32 count);
+    void filterField(const SourceField& inputField, qint32 startLine, qint32 endLine,
+                     Workspace &workspace, qint32 outputIndex);
+    void forwardFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, const SourceField &inputField,
+                        Workspace &workspace);
+    void inverseFFTTile(qint32 tileX, qint32 tileY, qint32 startY, qint32 endY, Workspace &workspace,
+                        qint32 outputIndex);
+    void buildBinPairs() override;
     template <TransformMode MODE>
-    void applyFilter();
+    void applyFilter(Workspace &workspace);
     void overlayFFTFrame(qint32 positionX, qint32 positionY,
                          const QVector<SourceField> &inputFields, qint32 fieldIndex,
-                         RGBFrame &rgbFrame) override;
+                         const RGBFrameLayout &rgbLayout, RGBFrame &rgbFrame) override;
 
     // FFT input and output sizes.
     // The input field is divided into tiles of XTILE x YTILE, with adjacent
@@ -72,15 +82,35 @@ protected:
     static constexpr qint32 XCOMPLEX = (XTILE / 2) + 1;
 
     // Window function applied before the FFT
-    double windowFunction[YTILE][XTILE];
-
-    // FFT input/output buffers
-    double *fftReal;
-    fftw_complex *fftComplexIn;
-    fftw_complex *fftComplexOut;
+    FFTSample windowFunction[YTILE][XTILE];
+
+    // FFT input/output buffers.
+    // Each thread filtering a band of the field needs its own set, so there
+    // is one Workspace per thread; the plans are made using the first one.
+    typedef typename FFTW<FFTSample>::Complex FFTComplex;
+    struct Workspace {
+        FFTSample *fftReal;
+        FFTComplex *fftComplexIn;
+        FFTComplex *fftComplexOut;
+    };
+    QVector<Workspace> workspaces;
 
     // FFT plans
-    fftw_plan forwardPlan, inversePlan;
+    typename FFTW<FFTSample>::Plan forwardPlan, inversePlan;
+
+    // A pair of bins in fftComplexIn that should be symmetrical around the
+    // carriers, and the squared similarity threshold to use when comparing them
+    struct BinPair {
+        qint32 in;
+        qint32 ref;
+        FFTSample thresholdSq;
+    };
+
+    // The pairs of bins that applyFilter compares, built by buildBinPairs
+    QVector<BinPair> binPairs;
+
+    // The bins that are their own reflections (i.e. the carriers)
+    QVector<qint32> carrierBins;
 
     // The combined result of all the FFT processing for each input field.
     // Inverse-FFT results are accumulated into these buffers.
@@ -28,6 +28,7 @@
 #include "transformpal3d.h"
 
 #include <QtMath>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstring>
@@ -47,15 +48,26 @@
 
 // Definitions of static constexpr data members, for compatibility with
 // pre-C++17 compilers
-constexpr qint32 TransformPal3D::ZTILE;
-constexpr qint32 TransformPal3D::HALFZTILE;
-constexpr qint32 TransformPal3D::YTILE;
-constexpr qint32 TransformPal3D::HALFYTILE;
-constexpr qint32 TransformPal3D::XTILE;
-constexpr qint32 TransformPal3D::HALFXTILE;
-constexpr qint32 TransformPal3D::ZCOMPLEX;
-constexpr qint32 TransformPal3D::YCOMPLEX;
-constexpr qint32 TransformPal3D::XCOMPLEX;
+template <typename FFTSample>
+constexpr qint32 TransformPal3D<FFTSample>::ZTILE;
+template <typename FFTSample>
+constexpr qint32 TransformPal3D<FFTSample>::HALFZTILE;
+template <typename FFTSample>
+constexpr qint32 TransformPal3D<FFTSample>::YTILE;
+template <typename FFTSample>
+constexpr qint32 TransformPal3D<FFTSample>::HALFYTILE;
+template <typename FFTSample>
+constexpr qint32 TransformPal3D<FFTSample>::XTILE;
+template <typename FFTSample>
+constexpr qint32 TransformPal3D<FFTSample>::HALFXTILE;
+template <typename FFTSample>
+constexpr qint32 TransformPal3D<FFTSample>::ZCOMPLEX;
+template <typename FFTSample>
+constexpr qint32 TransformPal3D<FFTSample>::YCOMPLEX;
+template <typename FFTSample>
+constexpr qint32 TransformPal3D<FFTSample>::XCOMPLEX;
+template <typename FFTSample>
+constexpr qint32 TransformPal3D<FFTSample>::RUN_LENGTH;
 
 // Compute one value of the window function, applied to the data blocks before
 // the FFT to reduce edge effects. This is a symmetrical raised-cosine
@@ -66,8 +78,9 @@ static double computeWindow(qint32 element, qint32 limit)
     return 0.5 - (0.5 * cos((2 * M_PI * (element + 0.5)) / limit));
 }
 
-TransformPal3D::TransformPal3D()
-    : TransformPal(XCOMPLEX, YCOMPLEX, ZCOMPLEX)
+template <typename FFTSample>
+TransformPal3D<FFTSample>::TransformPal3D()
+    : TransformPal(XCOMPLEX, YCOMPLEX, ZCOMPLEX), chromaBufOutput(0), chromaBufCarried(0), nextTileOffset(0)
 {
     // Compute the window function.
     for (qint32 z = 0; z < ZTILE; z++) {
@@ -81,46 +94,75 @@ TransformPal3D::TransformPal3D()
         }
     }
 
-    // Allocate buffers for FFTW. These must be allocated using FFTW's own
-    // functions so they're properly aligned for SIMD operations.
-    fftReal = fftw_alloc_real(ZTILE * YTILE * XTILE);
-    fftComplexIn = fftw_alloc_complex(ZCOMPLEX * YCOMPLEX * XCOMPLEX);
-    fftComplexOut = fftw_alloc_complex(ZCOMPLEX * YCOMPLEX * XCOMPLEX);
+    // Allocate buffers for the first thread
+    allocateWorkspaces(1);
 
     // Plan FFTW operations
-    forwardPlan = fftw_plan_dft_r2c_3d(ZTILE, YTILE, XTILE, fftReal, fftComplexIn, FFTW_MEASURE);
-    inversePlan = fftw_plan_dft_c2r_3d(ZTILE, YTILE, XTILE, fftComplexOut, fftReal, FFTW_MEASURE);
+    Workspace &workspace = workspaces[0];
+    forwardPlan = FFTW<FFTSample>::planR2C3D(ZTILE, YTILE, XTILE, workspace.fftReal, workspace.fftComplexIn, FFTW_MEASURE);
+    inversePlan = FFTW<FFTSample>::planC2R3D(ZTILE, YTILE, XTILE, workspace.fftComplexOut, workspace.fftReal, FFTW_MEASURE);
 }
 
-TransformPal3D::~TransformPal3D()
+template <typename FFTSample>
+TransformPal3D<FFTSample>::~TransformPal3D()
 {
     // Free FFTW plans and buffers
-    fftw_destroy_plan(forwardPlan);
-    fftw_destroy_plan(inversePlan);
-    fftw_free(fftReal);
-    fftw_free(fftComplexIn);
-    fftw_free(fftComplexOut);
+    FFTW<FFTSample>::destroyPlan(forwardPlan);
+    FFTW<FFTSample>::destroyPlan(inversePlan);
+    for (Workspace &workspace : workspaces) {
+        FFTW<FFTSample>::free(workspace.fftReal);
+        FFTW<FFTSample>::free(workspace.fftComplexIn);
+        FFTW<FFTSample>::free(workspace.fftComplexOut);
+    }
+}
+
+// Make sure there are at least count sets of FFT buffers
+template <typename FFTSample>
+void TransformPal3D<FFTSample>::allocateWorkspaces(qint32 count)
+{
+    while (workspaces.size() < count) {
+        // These must be allocated using FFTW's own functions so they're
+        // properly aligned for SIMD operations.
+        Workspace workspace;
+        workspace.fftReal = FFTW<FFTSample>::allocReal(ZTILE * YTILE * XTILE);
+        workspace.fftComplexIn = FFTW<FFTSample>::allocComplex(ZCOMPLEX * YCOMPLEX * XCOMPLEX);
+        workspace.fftComplexOut = FFTW<FFTSample>::allocComplex(ZCOMPLEX * YCOMPLEX * XCOMPLEX);
+        workspaces.push_back(workspace);
+    }
 }
 
-qint32 TransformPal3D::getThresholdsSize()
+template <typename FFTSample>
+qint32 TransformPal3D<FFTSample>::getThresholdsSize()
 {
     // On the X axis, include only the bins we actually use in applyFilter
     return ZCOMPLEX * YCOMPLEX * ((XCOMPLEX / 4) + 1);
 }
 
-qint32 TransformPal3D::getLookBehind()
+template <typename FFTSample>
+qint32 TransformPal3D<FFTSample>::getLookBehind()
 {
     // We overlap at most half a tile (in frames) into the past...
     return (HALFZTILE + 1) / 2;
 }
 
-qint32 TransformPal3D::getLookAhead()
+template <typename FFTSample>
+qint32 TransformPal3D<FFTSample>::getLookAhead()
 {
     // ... and at most a tile minus one bin into the future.
     return (ZTILE - 1 + 1) / 2;
 }
 
-void TransformPal3D::filterFields(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
+template <typename FFTSample>
+qint32 TransformPal3D<FFTSample>::getRunLength()
+{
+    // Longer runs save more work, but increase the number of output frames
+    // that DecoderPool needs to buffer.
+    return RUN_LENGTH;
+}
+
+template <typename FFTSample>
+void TransformPal3D<FFTSample>::filterFields(const QVector<SourceField> &inputFields, qint32 startIndex, qint32 endIndex,
+                                  bool isContinuation, BandRunner &bandRunner,
                                   QVector<const double *> &outputFields)
 {
     assert(configurationSet);
@@ -132,46 +174,100 @@ void TransformPal3D::filterFields(const QVector<SourceField> &inputFields, qint3
     }
     assert(outputFields.size() == (endIndex - startIndex));
 
+    // Work out where the first tile should be, and which of the chroma
+    // buffers already contain partial results.
+    // (See TransformPal3D member variable documentation for how the tiling works;
+    // if you change the Z tiling here, also review getLookBehind/getLookAhead above.)
+    qint32 firstTileZ;
+    qint32 numCarried;
+    if (isContinuation) {
+        // Carry on from where the last call finished. The buffers returned
+        // last time can be reused; move the partial results to the front.
+        std::rotate(chromaBuf.begin(), chromaBuf.begin() + chromaBufOutput, chromaBuf.end());
+        numCarried = chromaBufCarried;
+        firstTileZ = startIndex + nextTileOffset;
+    } else {
+        // Start from scratch, with the first tile overlapping the fields
+        // we're interested in by half a tile
+        numCarried = 0;
+        firstTileZ = startIndex - HALFZTILE;
+    }
+
+    // Work out the position of the first tile after the ones we'll compute,
+    // and how many fields the computed tiles will cover
+    qint32 endTileZ = firstTileZ;
+    while (endTileZ < endIndex) {
+        endTileZ += HALFZTILE;
+    }
+    const qint32 endBufIndex = qMax(qMax(endIndex, startIndex + numCarried), endTileZ - HALFZTILE + ZTILE);
+
     // Check that we've been given enough surrounding fields to compute FFTs
     // that overlap the fields we're actually interested in by half a tile
-    assert(startIndex >= HALFZTILE);
-    assert((inputFields.size() - endIndex) >= HALFZTILE);
-
-    // Allocate and clear output buffers
-    chromaBuf.resize(endIndex - startIndex);
-    for (qint32 i = 0; i < chromaBuf.size(); i++) {
-        chromaBuf[i].resize(videoParameters.fieldWidth * videoParameters.fieldHeight);
-        chromaBuf[i].fill(0.0);
+    assert(firstTileZ >= 0);
+    assert(endBufIndex <= inputFields.size());
 
+    // Allocate and clear the buffers that don't contain partial results
+    const qint32 numBufs = endBufIndex - startIndex;
+    if (chromaBuf.size() < numBufs) {
+        chromaBuf.resize(numBufs);
+    }
+    for (qint32 i = 0; i < numBufs; i++) {
+        if (i >= numCarried) {
+            chromaBuf[i].resize(videoParameters.fieldWidth * videoParameters.fieldHeight);
+            chromaBuf[i].fill(0.0);
+        }
+    }
+    for (qint32 i = 0; i < outputFields.size(); i++) {
         outputFields[i] = chromaBuf[i].data();
     }
 
+    allocateWorkspaces(bandRunner.getThreads());
+
     // Iterate through the overlapping tile positions, covering the active area.
-    // (See TransformPal3D member variable documentation for how the tiling works;
-    // if you change the Z tiling here, also review getLookBehind/getLookAhead above.)
-    for (qint32 tileZ = startIndex - HALFZTILE; tileZ < endIndex; tileZ += HALFZTILE) {
-        for (qint32 tileY = videoParameters.firstActiveFrameLine - HALFYTILE; tileY < videoParameters.lastActiveFrameLine; tileY += HALFYTILE) {
-            for (qint32 tileX = videoParameters.activeVideoStart - HALFXTILE; tileX < videoParameters.activeVideoEnd; tileX += HALFXTILE) {
-                // Compute the forward FFT
-                forwardFFTTile(tileX, tileY, tileZ, inputFields);
-
-                // Apply the frequency-domain filter in the appropriate mode
-                if (mode == levelMode) {
-                    applyFilter<levelMode>();
-                } else {
-                    applyFilter<thresholdMode>();
-                }
+    //
+    // The frame is divided into bands of frame lines. Each band computes only
+    // the tiles that overlap it, and writes only its own lines; each output
+    // line still gets the same tiles added in the same order, so the result
+    // doesn't depend on the banding.
+    bandRunner.run(videoParameters.firstActiveFrameLine, videoParameters.lastActiveFrameLine,
+                   HALFYTILE, [&](qint32 band, qint32 startLine, qint32 endLine) {
+        Workspace &workspace = workspaces[band];
+
+        for (qint32 tileZ = firstTileZ; tileZ < endIndex; tileZ += HALFZTILE) {
+            for (qint32 tileY = videoParameters.firstActiveFrameLine - HALFYTILE; tileY < videoParameters.lastActiveFrameLine; tileY += HALFYTILE) {
+                if (tileY + YTILE <= startLine || tileY >= endLine) continue;
+
+                for (qint32 tileX = videoParameters.activeVideoStart - HALFXTILE; tileX < videoParameters.activeVideoEnd; tileX += HALFXTILE) {
+                    // Compute the forward FFT
+                    forwardFFTTile(tileX, tileY, tileZ, inputFields, workspace);
+
+                    // Apply the frequency-domain filter in the appropriate mode
+                    if (mode == levelMode) {
+                        applyFilter<levelMode>(workspace);
+                    } else {
+                        applyFilter<thresholdMode>(workspace);
+                    }
 
-                // Compute the inverse FFT
-                inverseFFTTile(tileX, tileY, tileZ, startIndex, endIndex);
+                    // Compute the inverse FFT
+                    inverseFFTTile(tileX, tileY, tileZ, startIndex, endBufIndex, startLine, endLine, workspace);
+                }
             }
         }
-    }
+    });
+
+    // Remember what we've left in chromaBuf for the next call
+    chromaBufOutput = outputFields.size();
+    chromaBufCarried = endBufIndex - endIndex;
+    nextTileOffset = endTileZ - endIndex;
 }
 
 // Apply the forward FFT to an input tile, populating fftComplexIn
-void TransformPal3D::forwardFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, const QVector<SourceField> &inputFields)
+template <typename FFTSample>
+void TransformPal3D<FFTSample>::forwardFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, const QVector<SourceField> &inputFields,
+                                               Workspace &workspace)
 {
+    FFTSample *fftReal = workspace.fftReal;
+
     // Work out which lines of this tile are within the active region
     const qint32 startY = qMax(videoParameters.firstActiveFrameLine - tileY, 0);
     const qint32 endY = qMin(videoParameters.lastActiveFrameLine - tileY, YTILE);
@@ -202,22 +298,27 @@ void TransformPal3D::forwardFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, co
     }
 
     // Convert time domain in fftReal to frequency domain in fftComplexIn
-    fftw_execute(forwardPlan);
+    FFTW<FFTSample>::executeR2C(forwardPlan, fftReal, workspace.fftComplexIn);
 }
 
-// Apply the inverse FFT to fftComplexOut, overlaying the result into chromaBuf
-void TransformPal3D::inverseFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, qint32 startIndex, qint32 endIndex)
+// Apply the inverse FFT to fftComplexOut, overlaying the frame lines from
+// startLine to endLine of the result into chromaBuf
+template <typename FFTSample>
+void TransformPal3D<FFTSample>::inverseFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, qint32 startIndex, qint32 endIndex,
+                                               qint32 startLine, qint32 endLine, Workspace &workspace)
 {
-    // Work out what portion of this tile is inside the active area
+    FFTSample *fftReal = workspace.fftReal;
+
+    // Work out what portion of this tile is inside the active area (and the band)
     const qint32 startX = qMax(videoParameters.activeVideoStart - tileX, 0);
     const qint32 endX = qMin(videoParameters.activeVideoEnd - tileX, XTILE);
-    const qint32 startY = qMax(videoParameters.firstActiveFrameLine - tileY, 0);
-    const qint32 endY = qMin(videoParameters.lastActiveFrameLine - tileY, YTILE);
+    const qint32 startY = qMax(qMax(videoParameters.firstActiveFrameLine, startLine) - tileY, 0);
+    const qint32 endY = qMin(qMin(videoParameters.lastActiveFrameLine, endLine) - tileY, YTILE);
     const qint32 startZ = qMax(startIndex - tileZ, 0);
     const qint32 endZ = qMin(endIndex - tileZ, ZTILE);
 
     // Convert frequency domain in fftComplexOut back to time domain in fftReal
-    fftw_execute(inversePlan);
+    FFTW<FFTSample>::executeC2R(inversePlan, workspace.fftComplexOut, fftReal);
 
     // Overlay the result, normalising the FFTW output, into the chroma buffers
     for (qint32 z = startZ; z < endZ; z++) {
@@ -239,27 +340,20 @@ void TransformPal3D::inverseFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, qi
     }
 }
 
-// Return the absolute value squared of an fftw_complex
-static inline double fftwAbsSq(const fftw_complex &value)
+// Return the absolute value squared of an fftw_complex or fftwf_complex
+template <typename T>
+static inline T fftwAbsSq(const T (&value)[2])
 {
     return (value[0] * value[0]) + (value[1] * value[1]);
 }
 
-// Apply the frequency-domain filter.
-// (Templated so that the inner loop gets specialised for each mode.)
-template <TransformPal::TransformMode MODE>
-void TransformPal3D::applyFilter()
+// Work out which bins the frequency-domain filter should compare.
+template <typename FFTSample>
+void TransformPal3D<FFTSample>::buildBinPairs()
 {
     // Get pointer to squared threshold values
     const double *thresholdsPtr = thresholds.data();
 
-    // Clear fftComplexOut. We discard values by default; the filter only
-    // copies values that look like chroma.
-    for (qint32 i = 0; i < ZCOMPLEX * YCOMPLEX * XCOMPLEX; i++) {
-        fftComplexOut[i][0] = 0.0;
-        fftComplexOut[i][1] = 0.0;
-    }
-
     // This is a direct translation of transform_filter from pyctools-pal, with
     // an extra loop added to extend it to 3D. The main simplification is that
     // we don't need to worry about conjugates, because FFTW only returns half
@@ -275,6 +369,16 @@ void TransformPal3D::applyFilter()
     // The Z axis covers 0 to 50 Hz;      18.75 Hz is 3/8 * ZTILE.
     // The Y axis covers 0 to 576 c/aph;  72 c/aph is 1/8 * YTILE.
     // The X axis covers 0 to 4fSC Hz;    fSC HZ   is 1/4 * XTILE.
+    //
+    // The reflections only depend on the bin positions, so rather than
+    // working them out for every tile, we list the pairs here and applyFilter
+    // just works through the list.
+
+    binPairs.clear();
+    carrierBins.clear();
+
+    // For each bin, the index in binPairs of the pair it's the first bin of
+    QVector<qint32> pairIndex(ZCOMPLEX * YCOMPLEX * XCOMPLEX, -1);
 
     for (qint32 z = 0; z < ZTILE; z++) {
         // Reflect around 18.75 Hz temporally.
@@ -285,14 +389,6 @@ void TransformPal3D::applyFilter()
             // Reflect around 72 c/aph vertically.
             const qint32 y_ref = ((YTILE / 4) + YTILE - y) % YTILE;
 
-            // Input data for this line and its reflection
-            const fftw_complex *bi = fftComplexIn + (((z * YCOMPLEX) + y) * XCOMPLEX);
-            const fftw_complex *bi_ref = fftComplexIn + (((z_ref * YCOMPLEX) + y_ref) * XCOMPLEX);
-
-            // Output data for this line and its reflection
-            fftw_complex *bo = fftComplexOut + (((z * YCOMPLEX) + y) * XCOMPLEX);
-            fftw_complex *bo_ref = fftComplexOut + (((z_ref * YCOMPLEX) + y_ref) * XCOMPLEX);
-
             // We only need to look at horizontal frequencies that might be chroma (0.5fSC to 1.5fSC).
             for (qint32 x = XTILE / 8; x <= XTILE / 4; x++) {
                 // Reflect around fSC horizontally
@@ -301,51 +397,25 @@ void TransformPal3D::applyFilter()
                 // Get the threshold for this bin
                 const double threshold_sq = *thresholdsPtr++;
 
-                const fftw_complex &in_val = bi[x];
-                const fftw_complex &ref_val = bi_ref[x_ref];
+                const qint32 in = (((z * YCOMPLEX) + y) * XCOMPLEX) + x;
+                const qint32 ref = (((z_ref * YCOMPLEX) + y_ref) * XCOMPLEX) + x_ref;
 
-                if (x == x_ref && y == y_ref && z == z_ref) {
+                if (in == ref) {
                     // This bin is its own reflection (i.e. it's a carrier). Keep it!
-                    bo[x][0] = in_val[0];
-                    bo[x][1] = in_val[1];
-                    continue;
-                }
-
-                // Get the squares of the magnitudes (to minimise the number of sqrts)
-                const double m_in_sq = fftwAbsSq(in_val);
-                const double m_ref_sq = fftwAbsSq(ref_val);
-
-                if (MODE == levelMode) {
-                    // Compare the magnitudes of the two values, and scale the
-                    // larger one down so its magnitude is the same as the
-                    // smaller one.
-                    const double factor = sqrt(m_in_sq / m_ref_sq);
-                    if (m_in_sq > m_ref_sq) {
-                        // Reduce in_val, keep ref_val as is
-                        bo[x][0] = in_val[0] / factor;
-                        bo[x][1] = in_val[1] / factor;
-                        bo_ref[x_ref][0] = ref_val[0];
-                        bo_ref[x_ref][1] = ref_val[1];
-                    } else {
-                        // Reduce ref_val, keep in_val as is
-                        bo[x][0] = in_val[0];
-                        bo[x][1] = in_val[1];
-                        bo_ref[x_ref][0] = ref_val[0] * factor;
-                        bo_ref[x_ref][1] = ref_val[1] * factor;
-                    }
+                    carrierBins.push_back(in);
+                } else if (pairIndex[ref] != -1) {
+                    // We've already seen this pair the other way round. The
+                    // comparison is symmetrical, so we only need to do it
+                    // once -- but the bins are kept if they're within either
+                    // bin's threshold, so use the smaller one. (Swapping the
+                    // pair makes the result bit-identical to comparing each
+                    // bin in turn, where this comparison would come last.)
+                    BinPair &pair = binPairs[pairIndex[ref]];
+                    pair.thresholdSq = qMin(pair.thresholdSq, static_cast<FFTSample>(threshold_sq));
+                    std::swap(pair.in, pair.ref);
                 } else {
-                    // Compare the magnitudes of the two values, and discard
-                    // both if they are more different than the threshold for
-                    // this bin.
-                    if (m_in_sq < m_ref_sq * threshold_sq || m_ref_sq < m_in_sq * threshold_sq) {
-                        // Probably not a chroma signal; throw it away.
-                    } else {
-                        // They're similar. Keep it!
-                        bo[x][0] = in_val[0];
-                        bo[x][1] = in_val[1];
-                        bo_ref[x_ref][0] = ref_val[0];
-                        bo_ref[x_ref][1] = ref_val[1];
-                    }
+                    pairIndex[in] = binPairs.size();
+                    binPairs.push_back(BinPair {in, ref, static_cast<FFTSample>(threshold_sq)});
                 }
             }
         }
@@ -354,9 +424,71 @@ void TransformPal3D::applyFilter()
     assert(thresholdsPtr == thresholds.data() + thresholds.size());
 }
 
-void TransformPal3D::overlayFFTFrame(qint32 positionX, qint32 positionY,
+// Apply the frequency-domain filter.
+// (Templated so that the inner loop gets specialised for each mode.)
+template <typename FFTSample>
+template <TransformPal::TransformMode MODE>
+void TransformPal3D<FFTSample>::applyFilter(Workspace &workspace)
+{
+    const FFTComplex *fftComplexIn = workspace.fftComplexIn;
+    FFTComplex *fftComplexOut = workspace.fftComplexOut;
+
+    // Clear fftComplexOut. We discard values by default; the filter only
+    // copies values that look like chroma. Although the filter only writes
+    // the bins in binPairs, FFTW's multidimensional inverse transforms
+    // overwrite their input, so the whole array must be cleared every time.
+    memset(fftComplexOut, 0, ZCOMPLEX * YCOMPLEX * XCOMPLEX * sizeof(FFTComplex));
+
+    // Keep the carriers
+    for (qint32 bin : carrierBins) {
+        fftComplexOut[bin][0] = fftComplexIn[bin][0];
+        fftComplexOut[bin][1] = fftComplexIn[bin][1];
+    }
+
+    // Compare each pair of bins. Every bin in the list is written without
+    // branching, so the compiler can vectorise this loop.
+    const BinPair *pairs = binPairs.constData();
+    const qint32 numPairs = binPairs.size();
+    for (qint32 i = 0; i < numPairs; i++) {
+        const FFTComplex &in_val = fftComplexIn[pairs[i].in];
+        const FFTComplex &ref_val = fftComplexIn[pairs[i].ref];
+        FFTComplex &out_val = fftComplexOut[pairs[i].in];
+        FFTComplex &out_ref = fftComplexOut[pairs[i].ref];
+
+        // Get the squares of the magnitudes (to minimise the number of sqrts)
+        const FFTSample m_in_sq = fftwAbsSq(in_val);
+        const FFTSample m_ref_sq = fftwAbsSq(ref_val);
+
+        if (MODE == levelMode) {
+            // Compare the magnitudes of the two values, and scale the
+            // larger one down so its magnitude is the same as the
+            // smaller one.
+            const FFTSample factor = std::sqrt(m_in_sq / m_ref_sq);
+            const FFTSample inDivisor = m_in_sq > m_ref_sq ? factor : 1;
+            const FFTSample refScale = m_in_sq > m_ref_sq ? 1 : factor;
+            out_val[0] = in_val[0] / inDivisor;
+            out_val[1] = in_val[1] / inDivisor;
+            out_ref[0] = ref_val[0] * refScale;
+            out_ref[1] = ref_val[1] * refScale;
+        } else {
+            // Compare the magnitudes of the two values, and discard both
+            // if they are more different than the threshold for this
+            // pair -- otherwise they're probably chroma, so keep them.
+            const FFTSample threshold_sq = pairs[i].thresholdSq;
+            const bool keep = !(m_in_sq < m_ref_sq * threshold_sq || m_ref_sq < m_in_sq * threshold_sq);
+            const FFTSample scale = keep ? 1 : 0;
+            out_val[0] = in_val[0] * scale;
+            out_val[1] = in_val[1] * scale;
+            out_ref[0] = ref_val[0] * scale;
+            out_ref[1] = ref_val[1] * scale;
+        }
+    }
+}
+
+template <typename FFTSample>
+void TransformPal3D<FFTSample>::overlayFFTFrame(qint32 positionX, qint32 positionY,
                                      const QVector<SourceField> &inputFields, qint32 fieldIndex,
-                                     RGBFrame &rgbFrame)
+                                     const RGBFrameLayout &rgbLayout, RGBFrame &rgbFrame)
 {
     // Do nothing if the tile isn't within the frame
     if (positionX < 0 || positionX + XTILE > videoParameters.fieldWidth
@@ -365,21 +497,26 @@ void TransformPal3D::overlayFFTFrame(qint32 positionX, qint32 positionY,
     }
 
     // Compute the forward FFT
-    forwardFFTTile(positionX, positionY, fieldIndex, inputFields);
+    Workspace &workspace = workspaces[0];
+    forwardFFTTile(positionX, positionY, fieldIndex, inputFields, workspace);
 
     // Apply the frequency-domain filter in the appropriate mode
     if (mode == levelMode) {
-        applyFilter<levelMode>();
+        applyFilter<levelMode>(workspace);
     } else {
-        applyFilter<thresholdMode>();
+        applyFilter<thresholdMode>(workspace);
     }
 
     // Create a canvas
-    FrameCanvas canvas(rgbFrame, videoParameters);
+    FrameCanvas canvas(rgbFrame, rgbLayout, videoParameters);
 
     // Outline the selected tile
     canvas.drawRectangle(positionX - 1, positionY - 1, XTILE + 1, YTILE + 1, FrameCanvas::green);
 
     // Draw the arrays
-    overlayFFTArrays(fftComplexIn, fftComplexOut, canvas);
+    overlayFFTArrays(workspace.fftComplexIn, workspace.fftComplexOut, canvas);
 }
+
+// Instantiate the filter for both supported precisions
+template class TransformPal3D<double>;
+template class TransformPal3D<float>;
@@ -35,6 +35,8 @@
 #include "sourcefield.h"
 #include "transformpal.h"
 
+// FFTSample is the precision used for the FFTs: double, or float for speed.
+template <typename FFTSample>
 class TransformPal3D : public TransformPal {
 public:
     TransformPal3D();
@@ -48,17 +50,28 @@ public:
     static qint32 getLookBehind();
     static qint32 getLookAhead();
 
+    // Return the number of frames that a worker thread should process
+    // contiguously, so that partial results can be carried between batches.
+    static qint32 getRunLength();
+
     void filterFields(const QVector<SourceField> &inputFields, qint32 startFieldIndex, qint32 endFieldIndex,
+                      bool isContinuation, BandRunner &bandRunner,
                       QVector<const double *> &outputFields) override;
 
 protected:
-    void forwardFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, const QVector<SourceField> &inputFields);
-    void inverseFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, qint32 startFieldIndex, qint32 endFieldIndex);
+    struct Workspace;
+
+    void allocateWorkspaces(qint32 count);
+    void forwardFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, const QVector<SourceField> &inputFields,
+                        Workspace &workspace);
+    void inverseFFTTile(qint32 tileX, qint32 tileY, qint32 tileZ, qint32 startFieldIndex, qint32 endFieldIndex,
+                        qint32 startLine, qint32 endLine, Workspace &workspace);
+    void buildBinPairs() override;
     template <TransformMode MODE>
-    void applyFilter();
+    void applyFilter(Workspace &workspace);
     void overlayFFTFrame(qint32 positionX, qint32 positionY,
                          const QVector<SourceField> &inputFields, qint32 fieldIndex,
-                         RGBFrame &rgbFrame) override;
+                         const RGBFrameLayout &rgbLayout, RGBFrame &rgbFrame) override;
 
     // FFT input and output sizes.
     //
@@ -85,19 +98,55 @@ protected:
     static constexpr qint32 XCOMPLEX = (XTILE / 2) + 1;
 
     // Window function applied before the FFT
-    double windowFunction[ZTILE][YTILE][XTILE];
+    FFTSample windowFunction[ZTILE][YTILE][XTILE];
 
-    // FFT input/output buffers
-    double *fftReal;
-    fftw_complex *fftComplexIn;
-    fftw_complex *fftComplexOut;
+    // FFT input/output buffers, one set per thread (see TransformPal2D)
+    typedef typename FFTW<FFTSample>::Complex FFTComplex;
+    struct Workspace {
+        FFTSample *fftReal;
+        FFTComplex *fftComplexIn;
+        FFTComplex *fftComplexOut;
+    };
+    QVector<Workspace> workspaces;
 
     // FFT plans
-    fftw_plan forwardPlan, inversePlan;
+    typename FFTW<FFTSample>::Plan forwardPlan, inversePlan;
+
+    // A pair of bins in fftComplexIn that should be symmetrical around the
+    // carriers, and the squared similarity threshold to use when comparing them
+    struct BinPair {
+        qint32 in;
+        qint32 ref;
+        FFTSample thresholdSq;
+    };
+
+    // The pairs of bins that applyFilter compares, built by buildBinPairs
+    QVector<BinPair> binPairs;
+
+    // The bins that are their own reflections (i.e. the carriers)
+    QVector<qint32> carrierBins;
+
+    // Number of frames in a run; see getRunLength
+    static constexpr qint32 RUN_LENGTH = 64;
 
     // The combined result of all the FFT processing for each input field.
     // Inverse-FFT results are accumulated into these buffers.
+    //
+    // The last tiles computed by filterFields extend past endIndex. Rather
+    // than discarding their results, we keep them in the buffers following
+    // the output fields, so that if the next call continues from this one, it
+    // can start with these partial results rather than computing those tiles
+    // again.
     QVector<QVector<double>> chromaBuf;
+
+    // Number of buffers in chromaBuf that were returned by the last call
+    qint32 chromaBufOutput;
+
+    // Number of buffers after those that hold partial results
+    qint32 chromaBufCarried;
+
+    // Z position of the next tile to compute, relative to the end of the last call
+    qint32 nextTileOffset;
 };
 
 #endif
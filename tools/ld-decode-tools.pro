@@ -5,6 +5,8 @@ SUBDIRS = \
     ld-analyse \
     ld-chroma-decoder \
     ld-chroma-decoder/encoder \
+    ld-chroma-decoder/libldchroma \
+    ld-chroma-decoder/testcombkernels \
     ld-diffdod \
     ld-discmap \
     ld-dropout-correct \
@@ -12,5 +14,6 @@ SUBDIRS = \
     ld-lds-converter \
     ld-process-efm \
     ld-process-vbi \
+    library/filter/benchfilter \
     library/filter/testfilter \
     library/tbc/testvbidecoder
@@ -16,6 +16,7 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES += \
     ../library/tbc/lddecodemetadata.cpp \
+    ../library/tbc/metadatareader.cpp \
     ../library/tbc/sourcevideo.cpp \
     ../library/tbc/vbidecoder.cpp \
     ../library/tbc/filters.cpp \
@@ -27,6 +28,7 @@ SOURCES += \
 HEADERS += \
     ../library/filter/firfilter.h \
     ../library/tbc/lddecodemetadata.h \
+    ../library/tbc/metadatareader.h \
     ../library/tbc/sourcevideo.h \
     ../library/tbc/vbidecoder.h \
     ../library/tbc/filters.h \
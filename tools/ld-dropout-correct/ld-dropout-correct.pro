@@ -20,6 +20,7 @@ SOURCES += \
     dropoutcorrect.cpp \
     ../library/tbc/filters.cpp \
     ../library/tbc/lddecodemetadata.cpp \
+    ../library/tbc/metadatareader.cpp \
     ../library/tbc/sourcevideo.cpp \
     ../library/tbc/vbidecoder.cpp \
     ../library/tbc/logging.cpp
@@ -30,6 +31,7 @@ HEADERS += \
     ../library/filter/firfilter.h \
     ../library/tbc/filters.h \
     ../library/tbc/lddecodemetadata.h \
+    ../library/tbc/metadatareader.h \
     ../library/tbc/sourcevideo.h \
     ../library/tbc/vbidecoder.h \
     ../library/tbc/logging.h
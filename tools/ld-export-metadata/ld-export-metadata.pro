@@ -19,6 +19,7 @@ SOURCES += \
     ffmetadata.cpp \
     main.cpp \
     ../library/tbc/lddecodemetadata.cpp \
+    ../library/tbc/metadatareader.cpp \
     ../library/tbc/vbidecoder.cpp \
     ../library/tbc/logging.cpp
 
@@ -26,6 +27,7 @@ HEADERS += \
     csv.h \
     ffmetadata.h \
     ../library/tbc/lddecodemetadata.h \
+    ../library/tbc/metadatareader.h \
     ../library/tbc/vbidecoder.h \
     ../library/tbc/logging.h
 
@@ -101,7 +101,7 @@ int main(int argc, char *argv[])
 
     // Load the source video metadata
     LdDecodeMetaData metaData;
-    if (!metaData.read(inputFileName)) {
+    if (!metaData.read(inputFileName, true)) {
         qInfo() << "Unable to read JSON file";
         return 1;
     }
@@ -23,6 +23,16 @@
 ************************************************************************/
 
 #include "dataconverter.h"
+#include "ldspacking.h"
+
+#include <QtConcurrent/QtConcurrent>
+
+// Size of each chunk of input data. This must be divisible by both 5 bytes
+// (a packed group) and 8 bytes (an unpacked group).
+static constexpr qint32 FILE_CHUNK_BYTES = 5 * 4 * 1024 * 1024; // = 20MiBytes
+// When streaming through stdin/stdout, use smaller chunks so that the
+// consumer (e.g. ld-decode) sees data promptly
+static constexpr qint32 STREAM_CHUNK_BYTES = 5 * 4 * 64 * 1024; // = 1.25MiBytes
 
 DataConverter::DataConverter(QString inputFileNameParam, QString outputFileNameParam, bool isPackingParam, QObject *parent) : QObject(parent)
 {
@@ -30,6 +40,10 @@ DataConverter::DataConverter(QString inputFileNameParam, QString outputFileNameP
     inputFileName = inputFileNameParam;
     outputFileName = outputFileNameParam;
     isPacking = isPackingParam;
+    isStreaming = inputFileName.isEmpty() || outputFileName.isEmpty();
+
+    inputFileHandle = nullptr;
+    outputFileHandle = nullptr;
 }
 
 // Method to process the conversion of the file
@@ -47,9 +61,8 @@ bool DataConverter::process(void)
         return false;
     }
 
-    // Packing or unpacking?
-    if (isPacking) packFile();
-    else unpackFile();
+    // Perform the conversion
+    bool success = convertFile();
 
     // Close the input file
     closeInputFile();
@@ -57,8 +70,7 @@ bool DataConverter::process(void)
     // Close the output file
     closeOutputFile();
 
-    // Exit with success
-    return true;
+    return success;
 }
 
 // Method to open the input file for reading
@@ -145,160 +157,127 @@ void DataConverter::closeOutputFile(void)
     outputFileHandle = nullptr;
 }
 
-// Method to pack 16-bit data into 10-bit data
-void DataConverter::packFile(void)
+// Method to convert the input file to the output file.
+//
+// This is a three-stage pipeline: while one chunk is being converted on
+// this thread, the next chunk is being read and the previous chunk is
+// being written in the background. Two input and two output buffers are
+// used alternately. Only one write is in flight at a time, because QFile
+// isn't thread-safe and the chunks must be written in order; by the time a
+// write starts, the write from the same output buffer two chunks earlier has
+// always finished, so the buffer is free to reuse.
+bool DataConverter::convertFile(void)
 {
-    qDebug() << "DataConverter::packFile(): Packing";
-    QByteArray inputBuffer;
-    QByteArray outputBuffer;
-    bool isComplete = false;
-
-    while(!isComplete) {
-        // Input buffer must be divisible by 5 bytes due to 10-bit data format
-        qint32 bufferSizeInBytes = (20 * 1024 * 1024); // = 20MiBytes
-        inputBuffer.resize(bufferSizeInBytes);
-
-        // Every 4 input words (8 bytes) is 5 output bytes
-        outputBuffer.resize((bufferSizeInBytes / 8) * 5);
-
-        // Fill the input buffer with data
-        qint64 receivedBytes = 0;
-        qint32 totalReceivedBytes = 0;
-        do {
-            receivedBytes = inputFileHandle->read(reinterpret_cast<char *>(inputBuffer.data() + totalReceivedBytes), inputBuffer.size() - totalReceivedBytes);
-            if (receivedBytes > 0) totalReceivedBytes += receivedBytes;
-        } while (receivedBytes > 0 && totalReceivedBytes < bufferSizeInBytes);
-
-        // Check for end of file
-        if (receivedBytes == 0) isComplete = true;
-
-        if (totalReceivedBytes != 0) {
-            // If we didn't fill the input buffer, resize it
-            if (bufferSizeInBytes != totalReceivedBytes) {
-                inputBuffer.resize(totalReceivedBytes);
-                outputBuffer.resize((totalReceivedBytes / 8) * 5);
-            }
-            qDebug() << "DataConverter::packFile(): Got" << totalReceivedBytes << "bytes from input file";
+    if (isPacking) qDebug() << "DataConverter::convertFile(): Packing";
+    else qDebug() << "DataConverter::convertFile(): Unpacking";
 
-            qint32 word0, word1, word2, word3;
-            qint32 outputBufferPointer = 0;
+    const qint32 chunkSizeInBytes = isStreaming ? STREAM_CHUNK_BYTES : FILE_CHUNK_BYTES;
 
-            qint16 *input = reinterpret_cast<qint16 *>(inputBuffer.data());
+    // Input groups are 8 bytes when packing and 5 bytes when unpacking
+    const qint32 inputGroupBytes = isPacking ? (LDS_UNPACKED_GROUP_SAMPLES * 2) : LDS_PACKED_GROUP_BYTES;
+    const qint32 outputGroupBytes = isPacking ? LDS_PACKED_GROUP_BYTES : (LDS_UNPACKED_GROUP_SAMPLES * 2);
 
-            for (qint32 wordPointer = 0; wordPointer < (totalReceivedBytes / 2); wordPointer += 4) {
+    QByteArray inputBuffers[2];
+    QByteArray outputBuffers[2];
+    for (qint32 i = 0; i < 2; i++) {
+        inputBuffers[i].resize(chunkSizeInBytes);
+        outputBuffers[i].resize((chunkSizeInBytes / inputGroupBytes) * outputGroupBytes);
+    }
 
-                word0 = (input[wordPointer + 0] / 64) + 512;
-                word1 = (input[wordPointer + 1] / 64) + 512;
-                word2 = (input[wordPointer + 2] / 64) + 512;
-                word3 = (input[wordPointer + 3] / 64) + 512;
+    QFuture<bool> writeFuture;
+    bool writePending = false;
+    bool success = true;
+
+    // Start reading the first chunk
+    qint32 current = 0;
+    QFuture<qint64> readFuture = QtConcurrent::run(this, &DataConverter::readChunk, &inputBuffers[current]);
+
+    while (true) {
+        // Wait for the current chunk to be read
+        const qint64 receivedBytes = readFuture.result();
+        if (receivedBytes < 0) {
+            qCritical("Could not read from input file!");
+            success = false;
+            break;
+        }
+        if (receivedBytes == 0) {
+            qDebug() << "DataConverter::convertFile(): Got zero bytes from input file";
+            break;
+        }
+        qDebug() << "DataConverter::convertFile(): Got" << receivedBytes << "bytes from input file";
 
-                outputBuffer[outputBufferPointer + 0]  = static_cast<char>((word0 & 0x03FC) >> 2);
-                outputBuffer[outputBufferPointer + 1]  = static_cast<char>(((word0 & 0x0003) << 6) + ((word1 & 0x03F0) >> 4));
-                outputBuffer[outputBufferPointer + 2]  = static_cast<char>(((word1 & 0x000F) << 4) + ((word2 & 0x03C0) >> 6));
-                outputBuffer[outputBufferPointer + 3]  = static_cast<char>(((word2 & 0x003F) << 2) + ((word3 & 0x0300) >> 8));
-                outputBuffer[outputBufferPointer + 4]  = static_cast<char>(word3 & 0x00FF);
+        // A short chunk means we've reached the end of the input; otherwise, start reading the next one
+        const bool isComplete = receivedBytes < chunkSizeInBytes;
+        if (!isComplete) {
+            readFuture = QtConcurrent::run(this, &DataConverter::readChunk, &inputBuffers[current ^ 1]);
+        }
 
-                // Increment the packed sample buffer pointer
-                outputBufferPointer += 5;
-            }
+        // Convert the chunk, ignoring any incomplete group at the end of the input
+        const qint64 numGroups = receivedBytes / inputGroupBytes;
+        if ((receivedBytes % inputGroupBytes) != 0) {
+            qDebug() << "DataConverter::convertFile(): Ignoring" << (receivedBytes % inputGroupBytes) << "bytes at end of input file";
+        }
 
-            // Write the output buffer to the output file
-            if (!outputFileHandle->write(reinterpret_cast<char *>(outputBuffer.data()),
-                                         outputBuffer.size())) {
-                // File write failed
-                qCritical("Could not write to output file!");
-            }
-            qDebug() << "DataConverter::packFile(): Wrote" << outputBuffer.size() << "bytes to output file";
+        QByteArray &outputBuffer = outputBuffers[current];
+        outputBuffer.resize(static_cast<qint32>(numGroups * outputGroupBytes));
+        if (isPacking) {
+            packLds(reinterpret_cast<const qint16 *>(inputBuffers[current].constData()),
+                    reinterpret_cast<quint8 *>(outputBuffer.data()), numGroups);
         } else {
-            // Input file is empty
-            qDebug() << "DataConverter::packFile(): Got zero bytes from input file";
-            isComplete = true;
+            unpackLds(reinterpret_cast<const quint8 *>(inputBuffers[current].constData()),
+                      reinterpret_cast<qint16 *>(outputBuffer.data()), numGroups);
+        }
+
+        // Wait for the previous chunk's write to finish, then start writing this one
+        if (writePending) {
+            writePending = false;
+            if (!writeFuture.result()) {
+                success = false;
+                break;
+            }
         }
+        writeFuture = QtConcurrent::run(this, &DataConverter::writeChunk, &outputBuffers[current]);
+        writePending = true;
+
+        if (isComplete) break;
+        current ^= 1;
     }
+
+    // Wait for any outstanding reads and writes to finish
+    readFuture.waitForFinished();
+    if (writePending && !writeFuture.result()) success = false;
+
+    return success;
 }
 
-// Method to unpack 10-bit data into 16-bit data
-void DataConverter::unpackFile(void)
+// Method to fill a buffer from the input file.
+// Returns the number of bytes read, which is less than the buffer size only at
+// the end of the input, or -1 on error.
+qint64 DataConverter::readChunk(QByteArray *buffer)
 {
-    qDebug() << "DataConversion::unpackFile(): Unpacking";
-    QByteArray inputBuffer;
-    QByteArray outputBuffer;
-    bool isComplete = false;
-
-    while(!isComplete) {
-        // Input buffer must be divisible by 5 bytes due to 10-bit data format
-        qint32 bufferSizeInBytes = (5 * 1024 * 1024) * 4; // 5MiB * 4 = 20MiBytes
-        inputBuffer.resize(bufferSizeInBytes);
-
-        // Every 5 input bytes is 4 output words (8 bytes)
-        outputBuffer.resize((bufferSizeInBytes / 5) * 8);
-
-        // Fill the input buffer with data
-        qint64 receivedBytes = 0;
-        qint32 totalReceivedBytes = 0;
-        do {
-            receivedBytes = inputFileHandle->read(reinterpret_cast<char *>(inputBuffer.data() + totalReceivedBytes), bufferSizeInBytes - totalReceivedBytes);
-            if (receivedBytes > 0) totalReceivedBytes += receivedBytes;
-        } while (receivedBytes > 0 && totalReceivedBytes < bufferSizeInBytes);
-
-        // Check for end of file
-        if (receivedBytes == 0) isComplete = true;
-
-        if (totalReceivedBytes != 0) {
-            // If we didn't fill the input buffer, resize it
-            if (bufferSizeInBytes != totalReceivedBytes) {
-                inputBuffer.resize(totalReceivedBytes);
-                outputBuffer.resize((totalReceivedBytes / 5) * 8);
-            }
-            qDebug() << "DataConverter::unpackFile(): Got" << totalReceivedBytes << "bytes from input file";
-
-            char byte0, byte1, byte2, byte3, byte4;
-            qint32 word0, word1, word2, word3;
-            qint32 outputBufferPointer = 0;
-
-            qint16 *output = reinterpret_cast<qint16 *>(outputBuffer.data());
-
-            for (qint32 bytePointer = 0; bytePointer < totalReceivedBytes; bytePointer += 5) {
-                // Unpack the 5 bytes into 4x 10-bit values
-
-                // Unpacked:                 Packed:
-                // 0: xxxx xx00 0000 0000    0: 0000 0000 0011 1111
-                // 1: xxxx xx11 1111 1111    2: 1111 2222 2222 2233
-                // 2: xxxx xx22 2222 2222    4: 3333 3333
-                // 3: xxxx xx33 3333 3333
-
-                byte0 = inputBuffer[bytePointer + 0];
-                byte1 = inputBuffer[bytePointer + 1];
-                byte2 = inputBuffer[bytePointer + 2];
-                byte3 = inputBuffer[bytePointer + 3];
-                byte4 = inputBuffer[bytePointer + 4];
-
-                // Use multiplication instead of left-shift to avoid implicit conversion issues
-                word0  = ((byte0 & 0xFF) *   4) + ((byte1 & 0xC0) >> 6);
-                word1  = ((byte1 & 0x3F) *  16) + ((byte2 & 0xF0) >> 4);
-                word2  = ((byte2 & 0x0F) *  64) + ((byte3 & 0xFC) >> 2);
-                word3  = ((byte3 & 0x03) * 256) + ((byte4 & 0xFF)     );
-
-                output[outputBufferPointer + 0] = static_cast<qint16>((word0 - 512) * 64);
-                output[outputBufferPointer + 1] = static_cast<qint16>((word1 - 512) * 64);
-                output[outputBufferPointer + 2] = static_cast<qint16>((word2 - 512) * 64);
-                output[outputBufferPointer + 3] = static_cast<qint16>((word3 - 512) * 64);
-
-                // Increment the sample buffer pointer
-                outputBufferPointer += 4;
-            }
+    qint64 receivedBytes = 0;
+    qint64 totalReceivedBytes = 0;
+    do {
+        receivedBytes = inputFileHandle->read(buffer->data() + totalReceivedBytes, buffer->size() - totalReceivedBytes);
+        if (receivedBytes > 0) totalReceivedBytes += receivedBytes;
+    } while (receivedBytes > 0 && totalReceivedBytes < buffer->size());
+
+    if (receivedBytes < 0) return -1;
+    return totalReceivedBytes;
+}
 
-            // Write the output buffer to the output file
-            if (!outputFileHandle->write(reinterpret_cast<char *>(outputBuffer.data()),
-                                         outputBuffer.size())) {
-                // File write failed
-                qCritical("Could not write to output file!");
-            }
-            qDebug() << "DataConverter::unpackFile(): Wrote" << outputBuffer.size() << "bytes to output file";
-        } else {
-            // Input file is empty
-            qDebug() << "DataConverter::unpackFile(): Got zero bytes from input file";
-            isComplete = true;
-        }
+// Method to write a buffer to the output file
+bool DataConverter::writeChunk(const QByteArray *buffer)
+{
+    if (outputFileHandle->write(buffer->constData(), buffer->size()) != buffer->size()) {
+        // File write failed
+        qCritical("Could not write to output file!");
+        return false;
     }
+
+    // When streaming, make sure the data reaches the consumer promptly
+    if (isStreaming) outputFileHandle->flush();
+
+    qDebug() << "DataConverter::writeChunk(): Wrote" << buffer->size() << "bytes to output file";
+    return true;
 }
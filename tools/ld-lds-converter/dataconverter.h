@@ -28,6 +28,7 @@
 #include <QObject>
 #include <QDebug>
 #include <QFile>
+#include <QByteArray>
 
 class DataConverter : public QObject
 {
@@ -44,6 +45,7 @@ private:
     QString inputFileName;
     QString outputFileName;
     bool isPacking;
+    bool isStreaming;
 
     QFile *inputFileHandle;
     QFile *outputFileHandle;
@@ -53,8 +55,9 @@ private:
     void closeInputFile(void);
     bool openOutputFile(void);
     void closeOutputFile(void);
-    void packFile(void);
-    void unpackFile(void);
+    bool convertFile(void);
+    qint64 readChunk(QByteArray *buffer);
+    bool writeChunk(const QByteArray *buffer);
 };
 
 #endif // DATACONVERTER_H
@@ -1,4 +1,5 @@
 QT -= gui
+QT += concurrent
 
 CONFIG += c++11 console
 CONFIG -= app_bundle
@@ -16,11 +17,14 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES += \
     dataconverter.cpp \
+    ldspacking.cpp \
     main.cpp \
     ../library/tbc/logging.cpp
 
 HEADERS += \
     dataconverter.h \
+    ldspacking.h \
+    ../library/tbc/cpufeatures.h \
     ../library/tbc/logging.h
 
 # Add external includes to the include path
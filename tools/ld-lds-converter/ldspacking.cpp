@@ -0,0 +1,153 @@
+/************************************************************************
+
+    ldspacking.cpp
+
+    ld-lds-converter - 10-bit to 16-bit .lds converter for ld-decode
+    Copyright (C) 2019 Simon Inns
+
+    This file is part of ld-decode-tools.
+
+    ld-lds-converter is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "ldspacking.h"
+
+#include "cpufeatures.h"
+
+// Use SSSE3 shuffles when the CPU supports them
+#ifdef CPUFEATURES_X86
+#include <tmmintrin.h>
+#endif
+
+// Scalar kernels ---------------------------------------------------------------------------------------------------
+
+static void packLdsScalar(const qint16 *input, quint8 *output, qint64 numGroups)
+{
+    for (qint64 group = 0; group < numGroups; group++) {
+        // Convert each sample to 10 bits
+        const quint32 word0 = static_cast<quint32>((input[0] / 64) + 512);
+        const quint32 word1 = static_cast<quint32>((input[1] / 64) + 512);
+        const quint32 word2 = static_cast<quint32>((input[2] / 64) + 512);
+        const quint32 word3 = static_cast<quint32>((input[3] / 64) + 512);
+
+        output[0] = static_cast<quint8>(word0 >> 2);
+        output[1] = static_cast<quint8>((word0 << 6) | (word1 >> 4));
+        output[2] = static_cast<quint8>((word1 << 4) | (word2 >> 6));
+        output[3] = static_cast<quint8>((word2 << 2) | (word3 >> 8));
+        output[4] = static_cast<quint8>(word3);
+
+        input += LDS_UNPACKED_GROUP_SAMPLES;
+        output += LDS_PACKED_GROUP_BYTES;
+    }
+}
+
+static void unpackLdsScalar(const quint8 *input, qint16 *output, qint64 numGroups)
+{
+    for (qint64 group = 0; group < numGroups; group++) {
+        const qint32 word0 = (input[0] << 2) | (input[1] >> 6);
+        const qint32 word1 = ((input[1] & 0x3F) << 4) | (input[2] >> 4);
+        const qint32 word2 = ((input[2] & 0x0F) << 6) | (input[3] >> 2);
+        const qint32 word3 = ((input[3] & 0x03) << 8) | input[4];
+
+        output[0] = static_cast<qint16>((word0 - 512) * 64);
+        output[1] = static_cast<qint16>((word1 - 512) * 64);
+        output[2] = static_cast<qint16>((word2 - 512) * 64);
+        output[3] = static_cast<qint16>((word3 - 512) * 64);
+
+        input += LDS_PACKED_GROUP_BYTES;
+        output += LDS_UNPACKED_GROUP_SAMPLES;
+    }
+}
+
+// SSSE3 kernels ----------------------------------------------------------------------------------------------------
+
+#ifdef CPUFEATURES_X86
+
+// Each iteration converts two groups (8 samples, 10 bytes). The packed side
+// is accessed with 16-byte loads and stores, so the loops stop while there
+// are still at least 4 groups left and the remainder is done by the scalar
+// code.
+
+__attribute__((target("ssse3")))
+static qint64 packLdsSsse3(const qint16 *input, quint8 *output, qint64 numGroups)
+{
+    // Select the high and low bytes of each 16-bit lane into the packed bytes
+    const __m128i highBytes = _mm_setr_epi8(1, 3, 5, 7, -1, 9, 11, 13, 15, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i lowBytes = _mm_setr_epi8(-1, 0, 2, 4, 6, -1, 8, 10, 12, 14, -1, -1, -1, -1, -1, -1);
+    // Shift each 10-bit value to its position within its pair of bytes
+    const __m128i shifts = _mm_setr_epi16(64, 16, 4, 1, 64, 16, 4, 1);
+
+    qint64 group = 0;
+    for (; group + 4 <= numGroups; group += 2) {
+        const __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + (group * LDS_UNPACKED_GROUP_SAMPLES)));
+
+        // Divide by 64, rounding towards zero, then offset by 512
+        const __m128i bias = _mm_and_si128(_mm_srai_epi16(samples, 15), _mm_set1_epi16(63));
+        __m128i words = _mm_srai_epi16(_mm_add_epi16(samples, bias), 6);
+        words = _mm_and_si128(_mm_xor_si128(words, _mm_set1_epi16(0x200)), _mm_set1_epi16(0x3FF));
+
+        const __m128i shifted = _mm_mullo_epi16(words, shifts);
+        const __m128i packed = _mm_or_si128(_mm_shuffle_epi8(shifted, highBytes), _mm_shuffle_epi8(shifted, lowBytes));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + (group * LDS_PACKED_GROUP_BYTES)), packed);
+    }
+
+    return group;
+}
+
+__attribute__((target("ssse3")))
+static qint64 unpackLdsSsse3(const quint8 *input, qint16 *output, qint64 numGroups)
+{
+    // Gather the pair of bytes containing each 10-bit value into a 16-bit lane
+    const __m128i pairs = _mm_setr_epi8(1, 0, 2, 1, 3, 2, 4, 3, 6, 5, 7, 6, 8, 7, 9, 8);
+    // Shift each value up to the top of its lane
+    const __m128i shifts = _mm_setr_epi16(1, 4, 16, 64, 1, 4, 16, 64);
+
+    qint64 group = 0;
+    for (; group + 4 <= numGroups; group += 2) {
+        const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input + (group * LDS_PACKED_GROUP_BYTES)));
+        const __m128i shifted = _mm_mullo_epi16(_mm_shuffle_epi8(packed, pairs), shifts);
+
+        // (word - 512) * 64 is the top 10 bits with the sign bit flipped
+        const __m128i samples = _mm_xor_si128(_mm_and_si128(shifted, _mm_set1_epi16(static_cast<short>(0xFFC0))),
+                                              _mm_set1_epi16(static_cast<short>(0x8000)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + (group * LDS_UNPACKED_GROUP_SAMPLES)), samples);
+    }
+
+    return group;
+}
+
+#endif
+
+// Public functions -------------------------------------------------------------------------------------------------
+
+void packLds(const qint16 *input, quint8 *output, qint64 numGroups)
+{
+    qint64 done = 0;
+#ifdef CPUFEATURES_X86
+    if (cpuHasSsse3()) done = packLdsSsse3(input, output, numGroups);
+#endif
+
+    packLdsScalar(input + (done * LDS_UNPACKED_GROUP_SAMPLES), output + (done * LDS_PACKED_GROUP_BYTES), numGroups - done);
+}
+
+void unpackLds(const quint8 *input, qint16 *output, qint64 numGroups)
+{
+    qint64 done = 0;
+#ifdef CPUFEATURES_X86
+    if (cpuHasSsse3()) done = unpackLdsSsse3(input, output, numGroups);
+#endif
+
+    unpackLdsScalar(input + (done * LDS_PACKED_GROUP_BYTES), output + (done * LDS_UNPACKED_GROUP_SAMPLES), numGroups - done);
+}
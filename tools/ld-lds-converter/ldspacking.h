@@ -0,0 +1,53 @@
+/************************************************************************
+
+    ldspacking.h
+
+    ld-lds-converter - 10-bit to 16-bit .lds converter for ld-decode
+    Copyright (C) 2019 Simon Inns
+
+    This file is part of ld-decode-tools.
+
+    ld-lds-converter is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef LDSPACKING_H
+#define LDSPACKING_H
+
+#include <QtGlobal>
+
+// Conversion between 16-bit signed samples and packed 10-bit .lds data.
+//
+// The packed format stores each group of 4 10-bit samples in 5 bytes,
+// most significant bits first. A 10-bit value w corresponds to the 16-bit
+// sample (w - 512) * 64.
+//
+// Packed:                   Unpacked:
+// 0: 0000 0000              0: xxxx xx00 0000 0000
+// 1: 0011 1111              1: xxxx xx11 1111 1111
+// 2: 1111 2222              2: xxxx xx22 2222 2222
+// 3: 2222 2233              3: xxxx xx33 3333 3333
+// 4: 3333 3333
+
+// Number of bytes in a packed group, and samples in an unpacked group
+static constexpr qint32 LDS_PACKED_GROUP_BYTES = 5;
+static constexpr qint32 LDS_UNPACKED_GROUP_SAMPLES = 4;
+
+// Pack numGroups groups of 4 samples from input into 5-byte groups in output
+void packLds(const qint16 *input, quint8 *output, qint64 numGroups);
+
+// Unpack numGroups 5-byte groups from input into groups of 4 samples in output
+void unpackLds(const quint8 *input, qint16 *output, qint64 numGroups);
+
+#endif // LDSPACKING_H
@@ -104,7 +104,7 @@ int main(int argc, char *argv[])
     DataConverter dataConverter(inputFileName, outputFileName, !modeUnpack);
 
     // Process the data conversion
-    dataConverter.process();
+    if (!dataConverter.process()) return 1;
 
     // Quit with success
     return 0;
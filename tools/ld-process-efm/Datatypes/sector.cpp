@@ -24,6 +24,24 @@
 
 #include "sector.h"
 
+// Check whether a CD-ROM P or Q Reed-Solomon codeword is free of errors.
+//
+// Both codes have generator roots alpha^0 and alpha^1 over GF(2^8) with
+// polynomial 0x11D, so the two syndromes are the XOR of all the symbols,
+// and the codeword polynomial evaluated at alpha (using Horner's rule).
+// Multiplying by alpha is a shift and a conditional XOR, so no tables are
+// needed. If both syndromes are zero, there's nothing for the decoder to do.
+static inline bool isCodewordClean(const uchar *codeword, qint32 length)
+{
+    uchar s0 = 0;
+    uchar s1 = 0;
+    for (qint32 i = 0; i < length; i++) {
+        s0 ^= codeword[i];
+        s1 = static_cast<uchar>((s1 << 1) ^ ((s1 & 0x80) ? 0x1D : 0x00)) ^ codeword[i];
+    }
+    return s0 == 0 && s1 == 0;
+}
+
 Sector::Sector()
 {
     valid = false;
@@ -208,7 +226,7 @@ bool Sector::isCorrected()
 void Sector::performQParityECC(uchar *uF1Data, uchar *uF1Erasures)
 {
     // Initialise the RS error corrector
-    QRS<255,255-2> qrs; // Up to 251 symbols data load with 2 symbols parity RS(45,43)
+    static const QRS<255,255-2> qrs; // Up to 251 symbols data load with 2 symbols parity RS(45,43)
 
     // Keep track of the number of successful corrections
     qint32 successfulCorrections = 0;
@@ -227,9 +245,9 @@ void Sector::performQParityECC(uchar *uF1Data, uchar *uF1Erasures)
     uF1Erasures += 12;
 
     // Store the data and erasures in the form expected by the ezpwd library
-    std::vector<uchar> qField;
+    std::array<uchar, 45> qField; // 43 + 2 parity bytes = 45
     std::vector<int> qFieldErasures;
-    qField.resize(45); // 43 + 2 parity bytes = 45
+    qFieldErasures.reserve(43);
 
     // evenOdd = 0 = LSBs / evenOdd = 1 = MSBs
     for (qint32 evenOdd = 0; evenOdd < 2; evenOdd++) {
@@ -251,11 +269,16 @@ void Sector::performQParityECC(uchar *uF1Data, uchar *uF1Erasures)
             qField[43] = uF1Data[qParityByte0 + 2236];
             qField[44] = uF1Data[qParityByte1 + 2236];
 
+            // If the syndromes are zero, the codeword is already correct
+            if (isCodewordClean(qField.data(), 45)) {
+                successfulCorrections++;
+                continue;
+            }
+
             // Perform RS decode/correction
             if (qFieldErasures.size() > 2) qFieldErasures.clear();
-            std::vector<int> position;
             int fixed = -1;
-            fixed = qrs.decode(qField, qFieldErasures, &position);
+            fixed = qrs.decode(qField, 0, qFieldErasures);
 
             // If correction was successful add to success counter
             // and copy back the corrected data
@@ -290,7 +313,7 @@ void Sector::performQParityECC(uchar *uF1Data, uchar *uF1Erasures)
 void Sector::performPParityECC(uchar *uF1Data, uchar *uF1Erasures)
 {
     // Initialise the RS error corrector
-    QRS<255,255-2> prs; // Up to 251 symbols data load with 2 symbols parity RS(26,24)
+    static const QRS<255,255-2> prs; // Up to 251 symbols data load with 2 symbols parity RS(26,24)
 
     // Keep track of the number of successful corrections
     qint32 successfulCorrections = 0;
@@ -309,9 +332,9 @@ void Sector::performPParityECC(uchar *uF1Data, uchar *uF1Erasures)
     uF1Erasures += 12;
 
     // Store the data and erasures in the form expected by the ezpwd library
-    std::vector<uchar> pField;
+    std::array<uchar, 26> pField; // 24 + 2 parity bytes = 26
     std::vector<int> pFieldErasures;
-    pField.resize(26); // 24 + 2 parity bytes = 26
+    pFieldErasures.reserve(26);
 
     // evenOdd = 0 = LSBs / evenOdd = 1 = MSBs
     for (qint32 evenOdd = 0; evenOdd < 2; evenOdd++) {
@@ -326,11 +349,16 @@ void Sector::performPParityECC(uchar *uF1Data, uchar *uF1Erasures)
                 if (uF1Erasures[Vp] == 1) pFieldErasures.push_back(Mp);
             }
 
+            // If the syndromes are zero, the codeword is already correct
+            if (isCodewordClean(pField.data(), 26)) {
+                successfulCorrections++;
+                continue;
+            }
+
             // Perform RS decode/correction
             if (pFieldErasures.size() > 2) pFieldErasures.clear();
-            std::vector<int> position;
             int fixed = -1;
-            fixed = prs.decode(pField, pFieldErasures, &position);
+            fixed = prs.decode(pField, 0, pFieldErasures);
 
             // If correction was successful add to success counter
             // and copy back the corrected data
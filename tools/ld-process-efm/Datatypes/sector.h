@@ -25,6 +25,8 @@
 #ifndef SECTOR_H
 #define SECTOR_H
 
+#include <array>
+
 #include <ezpwd/rs_base>
 #include <ezpwd/rs>
 
@@ -24,25 +24,19 @@
 
 #include "f1todata.h"
 
+#include <cstring>
+
+// The sector sync pattern
+static const char syncPattern[12] = {
+    static_cast<char>(0x00), static_cast<char>(0xFF), static_cast<char>(0xFF), static_cast<char>(0xFF),
+    static_cast<char>(0xFF), static_cast<char>(0xFF), static_cast<char>(0xFF), static_cast<char>(0xFF),
+    static_cast<char>(0xFF), static_cast<char>(0xFF), static_cast<char>(0xFF), static_cast<char>(0x00)
+};
+
 F1ToData::F1ToData()
 {
     debugOn = false;
     reset();
-
-    // Set the sector sync pattern
-    syncPattern.clear();
-    syncPattern.append(static_cast<char>(0x00));
-    syncPattern.append(static_cast<char>(0xFF));
-    syncPattern.append(static_cast<char>(0xFF));
-    syncPattern.append(static_cast<char>(0xFF));
-    syncPattern.append(static_cast<char>(0xFF));
-    syncPattern.append(static_cast<char>(0xFF));
-    syncPattern.append(static_cast<char>(0xFF));
-    syncPattern.append(static_cast<char>(0xFF));
-    syncPattern.append(static_cast<char>(0xFF));
-    syncPattern.append(static_cast<char>(0xFF));
-    syncPattern.append(static_cast<char>(0xFF));
-    syncPattern.append(static_cast<char>(0x00));
 }
 
 // Public methods -----------------------------------------------------------------------------------------------------
@@ -58,15 +52,7 @@ QByteArray F1ToData::process(QVector<F1Frame> f1FramesIn, bool debugState)
     if (f1FramesIn.isEmpty()) return dataOutputBuffer;
 
     // Append input data to the processing buffer
-    for (qint32 i = 0; i < f1FramesIn.size(); i++) {
-        f1DataBuffer.append(reinterpret_cast<char*>(f1FramesIn[i].getDataSymbols()), 24);
-
-        // Each validity flag covers 24 bytes of data symbols
-        for (qint32 p = 0; p < 24; p++) {
-            f1IsCorruptBuffer.append(f1FramesIn[i].isCorrupt());
-            f1IsMissingBuffer.append(f1FramesIn[i].isMissing());
-        }
-    }
+    appendFrames(f1FramesIn);
 
     waitingForData = false;
     while (!waitingForData) {
@@ -122,8 +108,8 @@ void F1ToData::reportStatistics()
 void F1ToData::reset()
 {
     f1DataBuffer.clear();
-    f1IsCorruptBuffer.clear();
-    f1IsMissingBuffer.clear();
+    f1FlagBuffer.clear();
+    readPosition = 0;
     dataOutputBuffer.clear();
 
     waitingForData = false;
@@ -150,6 +136,64 @@ void F1ToData::clearStatistics()
     statistics.currentAddress.setTime(0, 0, 0);
 }
 
+// Method to append F1 frames to the processing buffer
+void F1ToData::appendFrames(QVector<F1Frame> &f1FramesIn)
+{
+    // Discard the data that has already been consumed
+    if (readPosition != 0) {
+        const qint32 remaining = bufferedSize();
+        memmove(f1DataBuffer.data(), f1DataBuffer.constData() + readPosition, static_cast<size_t>(remaining));
+        memmove(f1FlagBuffer.data(), f1FlagBuffer.constData() + readPosition, static_cast<size_t>(remaining));
+        f1DataBuffer.resize(remaining);
+        f1FlagBuffer.resize(remaining);
+        readPosition = 0;
+    }
+
+    const qint32 oldSize = f1DataBuffer.size();
+    f1DataBuffer.resize(oldSize + (f1FramesIn.size() * 24));
+    f1FlagBuffer.resize(f1DataBuffer.size());
+    char *data = f1DataBuffer.data() + oldSize;
+    char *flags = f1FlagBuffer.data() + oldSize;
+
+    for (qint32 i = 0; i < f1FramesIn.size(); i++) {
+        memcpy(data, f1FramesIn[i].getDataSymbols(), 24);
+
+        // Each frame's flags cover its 24 bytes of data symbols
+        char flag = 0;
+        if (f1FramesIn[i].isCorrupt()) flag |= flag_corrupt;
+        if (f1FramesIn[i].isMissing()) flag |= flag_missing;
+        memset(flags, flag, 24);
+
+        data += 24;
+        flags += 24;
+    }
+}
+
+// Method to get the number of bytes waiting to be processed
+qint32 F1ToData::bufferedSize() const
+{
+    return f1DataBuffer.size() - readPosition;
+}
+
+// Method to find the first sector sync pattern in the unprocessed data.
+// Returns the position relative to readPosition, or -1 if there isn't one.
+qint32 F1ToData::findSync() const
+{
+    const char *start = f1DataBuffer.constData() + readPosition;
+    const char *end = f1DataBuffer.constData() + f1DataBuffer.size();
+
+    // Use memchr (which is vectorised) to find candidates for the leading 0x00
+    const char *candidate = start;
+    while ((end - candidate) >= 12) {
+        candidate = static_cast<const char *>(memchr(candidate, 0x00, static_cast<size_t>((end - candidate) - 11)));
+        if (candidate == nullptr) break;
+        if (memcmp(candidate, syncPattern, 12) == 0) return static_cast<qint32>(candidate - start);
+        candidate++;
+    }
+
+    return -1;
+}
+
 // State-machine methods ----------------------------------------------------------------------------------------------
 
 F1ToData::StateMachine F1ToData::sm_state_initial()
@@ -167,21 +211,19 @@ F1ToData::StateMachine F1ToData::sm_state_initial()
 F1ToData::StateMachine F1ToData::sm_state_getInitialSync()
 {
     // Look for the sector sync pattern in the F1 frame data
-    qint32 syncPosition = f1DataBuffer.indexOf(syncPattern);
+    qint32 syncPosition = findSync();
 
     // Was a sync pattern found?
     if (syncPosition == -1) {
-        // No sync found
-        f1DataBuffer.clear();
-        f1IsCorruptBuffer.clear();
-        f1IsMissingBuffer.clear();
+        // No sync found. Keep the last 11 bytes, as they could be the start of a sync pattern
+        readPosition = qMax(readPosition, f1DataBuffer.size() - 11);
         waitingForData = true;
         //if (debugOn) qDebug() << "F1ToData::sm_state_getInitialSync(): No sync found";
         return state_getInitialSync;
     }
 
     if (debugOn) qDebug() << "F1ToData::sm_state_getInitialSync(): Initial sync found at position" << syncPosition;
-    f1DataBuffer.remove(0, syncPosition);
+    readPosition += syncPosition;
     return state_processFrame;
 }
 
@@ -189,7 +231,7 @@ F1ToData::StateMachine F1ToData::sm_state_getInitialSync()
 F1ToData::StateMachine F1ToData::sm_state_getNextSync()
 {
     // Ensure we have enough data to detect a sync
-    if (f1DataBuffer.size() < 12) {
+    if (bufferedSize() < 12) {
         // We need more data
         waitingForData = true;
         return state_getNextSync;
@@ -197,8 +239,7 @@ F1ToData::StateMachine F1ToData::sm_state_getNextSync()
 
     // Once the initial sync is found and the buffer is aligned, the sync should always
     // be at the start of the input buffer
-    qint32 syncPosition = f1DataBuffer.indexOf(syncPattern);
-    if (syncPosition != 0) {
+    if (memcmp(f1DataBuffer.constData() + readPosition, syncPattern, 12) != 0) {
         // Sector has no sync pattern
         return state_noSync;
     }
@@ -210,28 +251,25 @@ F1ToData::StateMachine F1ToData::sm_state_getNextSync()
 F1ToData::StateMachine F1ToData::sm_state_processFrame()
 {
     // Ensure we have enough data to process an entire sector
-    if (f1DataBuffer.size() < 2352) {
+    if (bufferedSize() < 2352) {
         // We need more data
         waitingForData = true;
         return state_processFrame;
     }
 
     // Create a sector object from the sector data
-    bool sectorValidity = true;
-    bool sectorBufferCorrupt = false;
-    bool sectorBufferMissing = false;
+    const char *sectorFlags = f1FlagBuffer.constData() + readPosition;
+    char combinedFlags = 0;
     for (qint32 i = 0; i < 2352; i++) {
-        if (f1IsCorruptBuffer[i] == static_cast<char>(0)) sectorBufferCorrupt = true;
-        if (f1IsMissingBuffer[i] == static_cast<char>(0)) sectorBufferMissing = true;
-        if (sectorBufferCorrupt || sectorBufferMissing) break;
+        combinedFlags |= sectorFlags[i];
     }
-    if (sectorBufferCorrupt || sectorBufferMissing) sectorValidity = false;
-    Sector sector(f1DataBuffer.mid(0, 2352), sectorValidity);
+    const bool sectorBufferCorrupt = (combinedFlags & flag_corrupt) != 0;
+    const bool sectorBufferMissing = (combinedFlags & flag_missing) != 0;
+    const bool sectorValidity = !(sectorBufferCorrupt || sectorBufferMissing);
+    Sector sector(QByteArray(f1DataBuffer.constData() + readPosition, 2352), sectorValidity);
 
-    // Remove the sector data from the input F1 buffer
-    f1DataBuffer.remove(0, 2352);
-    f1IsCorruptBuffer.remove(0, 2352);
-    f1IsMissingBuffer.remove(0, 2352);
+    // Consume the sector data from the input F1 buffer
+    readPosition += 2352;
 
     // Verify the sector is valid
     if (!sector.isValid()) {
@@ -293,23 +331,25 @@ F1ToData::StateMachine F1ToData::sm_state_processFrame()
 // Sector sync has been lost
 F1ToData::StateMachine F1ToData::sm_state_noSync()
 {
-    statistics.missingSync++;
-
     // The current sector has no sync.  Here we need to determine if the sector is corrupt, or if it's just missing
     // (due to a gap in the EFM rather than errors in the EFM)
 
-    // If the f1DataBuffer is less than the minium sector size, we have to resize it to avoid
-    // unwanted errors
-    if (f1DataBuffer.size() < 2352) f1DataBuffer.resize(2352);
-    Sector sector(f1DataBuffer.mid(0, 2352), true);
+    // Ensure we have enough data to examine an entire sector
+    if (bufferedSize() < 2352) {
+        // We need more data
+        waitingForData = true;
+        return state_noSync;
+    }
+
+    statistics.missingSync++;
+
+    Sector sector(QByteArray(f1DataBuffer.constData() + readPosition, 2352), true);
 
     if (sector.isMissing()) {
         if (debugOn) qDebug() << "F1ToData::sm_state_syncLost(): Sector sync has been lost and sector looks like it's missing.  Hunting for next valid sync";
 
-        // Remove the sector data from the input F1 buffer
-        f1DataBuffer.remove(0, 2352);
-        f1IsCorruptBuffer.remove(0, 2352);
-        f1IsMissingBuffer.remove(0, 2352);
+        // Consume the sector data from the input F1 buffer
+        readPosition += 2352;
 
         return state_getInitialSync;
     }
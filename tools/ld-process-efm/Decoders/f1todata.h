@@ -58,13 +58,21 @@ private:
     bool debugOn;
     Statistics statistics;
 
+    // F1 data symbols waiting to be processed, with a flag byte for each symbol.
+    // Bytes before readPosition have been consumed; they're discarded when more
+    // data is appended, so consuming a sector doesn't move the buffer contents.
     QByteArray f1DataBuffer;
-    QByteArray f1IsCorruptBuffer;
-    QByteArray f1IsMissingBuffer;
+    QByteArray f1FlagBuffer;
+    qint32 readPosition;
+
+    // Flag bits in f1FlagBuffer
+    enum F1Flags {
+        flag_corrupt = 1,
+        flag_missing = 2
+    };
 
     QByteArray dataOutputBuffer;
     bool waitingForData;
-    QByteArray syncPattern;
     qint32 missingSyncCount;
 
     TrackTime lastAddress;
@@ -86,6 +94,10 @@ private:
     StateMachine sm_state_getNextSync();
     StateMachine sm_state_processFrame();
     StateMachine sm_state_noSync();
+
+    void appendFrames(QVector<F1Frame> &f1FramesIn);
+    qint32 bufferedSize() const;
+    qint32 findSync() const;
 };
 
 #endif // F1TOSECTORS_H
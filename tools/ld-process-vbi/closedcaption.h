@@ -25,8 +25,8 @@
 #ifndef CLOSEDCAPTION_H
 #define CLOSEDCAPTION_H
 
-#include "sourcevideo.h"
 #include "lddecodemetadata.h"
+#include "transitionmap.h"
 
 class ClosedCaption
 {
@@ -37,11 +37,12 @@ public:
         bool isValid;
     };
 
-    CcData getData(const SourceVideo::Data &lineData, LdDecodeMetaData::VideoParameters videoParameters);
+    CcData getData(const quint16 *lineData, LdDecodeMetaData::VideoParameters videoParameters);
 
 private:
+    TransitionMap transitionMap;
+
     bool isEvenParity(uchar data);
-    QVector<bool> getTransitionMap(const SourceVideo::Data &lineData, qint32 zcPoint);
 };
 
 #endif // CLOSEDCAPTION_H
@@ -24,6 +24,10 @@
 
 #include "decoderpool.h"
 
+// Definitions of static constexpr data members, for compatibility with
+// pre-C++17 compilers
+constexpr qint32 DecoderPool::DEFAULT_BATCH_SIZE;
+
 DecoderPool::DecoderPool(QString _inputFilename, QString _outputJsonFilename,
                          qint32 _maxThreads, LdDecodeMetaData &_ldDecodeMetaData)
     : inputFilename(_inputFilename), outputJsonFilename(_outputJsonFilename),
@@ -96,29 +100,45 @@ bool DecoderPool::process()
     return true;
 }
 
-// Get the next field that needs processing from the input.
+// Get the next batch of fields that need processing from the input.
+//
+// fieldVideoData receives the VBI lines (VbiLineDecoder::startFieldLine to
+// endFieldLine) of each field in the batch, one after another, and
+// fieldMetadata receives the metadata for each field.
 //
-// Returns true if a field was returned, false if the end of the input has been
+// Returns true if a batch was returned, false if the end of the input has been
 // reached.
-bool DecoderPool::getInputField(qint32 &fieldNumber, SourceVideo::Data &fieldVideoData,
-                                LdDecodeMetaData::Field &fieldMetadata, LdDecodeMetaData::VideoParameters &videoParameters)
+bool DecoderPool::getInputFields(qint32 &startFieldNumber, SourceVideo::Data &fieldVideoData,
+                                 QVector<LdDecodeMetaData::Field> &fieldMetadata,
+                                 LdDecodeMetaData::VideoParameters &videoParameters)
 {
     QMutexLocker locker(&inputMutex);
 
-    if (inputFieldNumber > lastFieldNumber) {
+    // Work out a reasonable batch size to provide work for all threads.
+    // Processing a field is cheap, so fetching fields in batches keeps the
+    // threads from queueing for the input, and lets SourceVideo read the
+    // lines for the whole batch together.
+    const qint32 maxBatchSize = qMin(DEFAULT_BATCH_SIZE, qMax(1, lastFieldNumber / maxThreads));
+    const qint32 batchFields = qMin(maxBatchSize, lastFieldNumber + 1 - inputFieldNumber);
+
+    if (batchFields <= 0) {
         // No more input fields
         return false;
     }
 
-    fieldNumber = inputFieldNumber;
-    inputFieldNumber++;
+    startFieldNumber = inputFieldNumber;
+    inputFieldNumber += batchFields;
 
     // Show what we are about to process
-    qDebug() << "DecoderPool::process(): Processing field number" << fieldNumber;
+    qDebug() << "DecoderPool::process(): Processing fields" << startFieldNumber << "to" << inputFieldNumber - 1;
 
     // Fetch the input data
-    fieldVideoData = sourceVideo.getVideoField(fieldNumber, VbiLineDecoder::startFieldLine, VbiLineDecoder::endFieldLine);
-    fieldMetadata = ldDecodeMetaData.getField(fieldNumber);
+    fieldVideoData = sourceVideo.getVideoFields(startFieldNumber, batchFields,
+                                                VbiLineDecoder::startFieldLine, VbiLineDecoder::endFieldLine);
+    fieldMetadata.resize(batchFields);
+    for (qint32 i = 0; i < batchFields; i++) {
+        fieldMetadata[i] = ldDecodeMetaData.getField(startFieldNumber + i);
+    }
     videoParameters = ldDecodeMetaData.getVideoParameters();
 
     return true;
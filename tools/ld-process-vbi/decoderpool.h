@@ -43,10 +43,14 @@ public:
     bool process();
 
     // Member functions used by worker threads
-    bool getInputField(qint32 &fieldNumber, SourceVideo::Data &fieldVideoData, LdDecodeMetaData::Field &fieldMetadata, LdDecodeMetaData::VideoParameters &videoParameters);
+    bool getInputFields(qint32 &startFieldNumber, SourceVideo::Data &fieldVideoData, QVector<LdDecodeMetaData::Field> &fieldMetadata,
+                        LdDecodeMetaData::VideoParameters &videoParameters);
     bool setOutputField(qint32 fieldNumber, LdDecodeMetaData::Field fieldMetadata);
 
 private:
+    // Default batch size, in fields
+    static constexpr qint32 DEFAULT_BATCH_SIZE = 64;
+
     QString inputFilename;
     QString outputJsonFilename;
     qint32 maxThreads;
@@ -24,8 +24,9 @@
 
 #include "fmcode.h"
 
-// Public method to read a 40-bit FM coded signal from a field line
-FmCode::FmDecode FmCode::fmDecoder(const SourceVideo::Data &lineData, LdDecodeMetaData::VideoParameters videoParameters)
+// Public method to read a 40-bit FM coded signal from a field line.
+// lineData points to the start of the field line.
+FmCode::FmDecode FmCode::fmDecoder(const quint16 *lineData, LdDecodeMetaData::VideoParameters videoParameters)
 {
     FmDecode fmDecode;
     fmDecode.receiverClockSyncBits = 0;
@@ -40,7 +41,8 @@ FmCode::FmDecode FmCode::fmDecoder(const SourceVideo::Data &lineData, LdDecodeMe
     // Determine the 16-bit zero-crossing point
     qint32 zcPoint = videoParameters.white16bIre - videoParameters.black16bIre;
 
-    QVector<bool> fmData = getTransitionMap(lineData, zcPoint);
+    if (lineData == nullptr) return fmDecode;
+    fmData.build(lineData + videoParameters.activeVideoStart, videoParameters.activeVideoEnd - videoParameters.activeVideoStart, zcPoint);
 
     // Get the number of samples for 0.75us
     qreal fSamples = (videoParameters.sampleRate / 1000000) * 0.75;
@@ -66,6 +68,7 @@ FmCode::FmDecode FmCode::fmDecoder(const SourceVideo::Data &lineData, LdDecodeMe
             {
                 x++;
             }
+            if (x >= fmData.size()) break; // Check for overflow
 
             lastState = fmData[x];
 
@@ -168,30 +171,3 @@ bool FmCode::isEvenParity(quint64 data)
 
     return true;
 }
-
-// Private method to get the map of transitions across the sample and reject noise
-QVector<bool> FmCode::getTransitionMap(const SourceVideo::Data &lineData, qint32 zcPoint)
-{
-    // First read the data into a boolean array using debounce to remove transition noise
-    bool previousState = false;
-    bool currentState = false;
-    qint32 debounce = 0;
-    QVector<bool> fmData;
-
-    qint32 fmPointer = 0;
-    for (qint32 xPoint = 0; xPoint < lineData.size(); xPoint++) {
-        if (lineData[xPoint] > zcPoint) currentState = true; else currentState = false;
-
-        if (currentState != previousState) debounce++;
-
-        if (debounce > 3) {
-            debounce = 0;
-            previousState = currentState;
-        }
-
-        fmData.append(previousState);
-        fmPointer++;
-    }
-
-    return fmData;
-}
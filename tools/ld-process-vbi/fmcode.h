@@ -25,8 +25,8 @@
 #ifndef FMCODE_H
 #define FMCODE_H
 
-#include "sourcevideo.h"
 #include "lddecodemetadata.h"
+#include "transitionmap.h"
 
 class FmCode
 {
@@ -40,11 +40,12 @@ public:
         quint64 trailingDataRecognitionBits;
     };
 
-    FmCode::FmDecode fmDecoder(const SourceVideo::Data &lineData, LdDecodeMetaData::VideoParameters videoParameters);
+    FmCode::FmDecode fmDecoder(const quint16 *lineData, LdDecodeMetaData::VideoParameters videoParameters);
 
 private:
+    TransitionMap fmData;
+
     bool isEvenParity(quint64 data);
-    QVector<bool> getTransitionMap(const SourceVideo::Data &lineData, qint32 zcPoint);
 };
 
 #endif // FMCODE_H
@@ -19,9 +19,11 @@ SOURCES += \
     decoderpool.cpp \
     main.cpp \
     fmcode.cpp \
+    transitionmap.cpp \
     vbilinedecoder.cpp \
     whiteflag.cpp \
     ../library/tbc/lddecodemetadata.cpp \
+    ../library/tbc/metadatareader.cpp \
     ../library/tbc/sourcevideo.cpp \
     ../library/tbc/vbidecoder.cpp \
     ../library/tbc/logging.cpp
@@ -30,9 +32,11 @@ HEADERS += \
     closedcaption.h \
     decoderpool.h \
     fmcode.h \
+    transitionmap.h \
     vbilinedecoder.h \
     whiteflag.h \
     ../library/tbc/lddecodemetadata.h \
+    ../library/tbc/metadatareader.h \
     ../library/tbc/sourcevideo.h \
     ../library/tbc/vbidecoder.h \
     ../library/tbc/logging.h
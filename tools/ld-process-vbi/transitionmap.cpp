@@ -0,0 +1,53 @@
+/************************************************************************
+
+    transitionmap.cpp
+
+    ld-process-vbi - VBI and IEC NTSC specific processor for ld-decode
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of ld-decode-tools.
+
+    ld-process-vbi is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "transitionmap.h"
+
+// Build the map of transitions across the sample and reject noise
+void TransitionMap::build(const quint16 *lineData, qint32 length, qint32 zcPoint)
+{
+    if (states.size() < length) states.resize(length);
+    mapSize = length;
+    quint8 *statesPtr = states.data();
+
+    // First threshold the data. This loop has no dependencies between
+    // samples, so the compiler can vectorise it.
+    for (qint32 xPoint = 0; xPoint < length; xPoint++) {
+        statesPtr[xPoint] = lineData[xPoint] > zcPoint ? 1 : 0;
+    }
+
+    // Then debounce it in place to remove transition noise
+    quint8 previousState = 0;
+    qint32 debounce = 0;
+    for (qint32 xPoint = 0; xPoint < length; xPoint++) {
+        if (statesPtr[xPoint] != previousState) debounce++;
+
+        if (debounce > 3) {
+            debounce = 0;
+            previousState = statesPtr[xPoint];
+        }
+
+        statesPtr[xPoint] = previousState;
+    }
+}
@@ -0,0 +1,55 @@
+/************************************************************************
+
+    transitionmap.h
+
+    ld-process-vbi - VBI and IEC NTSC specific processor for ld-decode
+    Copyright (C) 2018-2019 Simon Inns
+
+    This file is part of ld-decode-tools.
+
+    ld-process-vbi is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef TRANSITIONMAP_H
+#define TRANSITIONMAP_H
+
+#include <QVector>
+
+// A map of the (debounced) signal state across a field line, for the
+// decoders that slice a line into bits.
+//
+// The buffer is kept between lines, so once it has reached the length of a
+// line, building a map doesn't allocate any memory.
+class TransitionMap
+{
+public:
+    // Build the map for length samples from lineData, treating samples above
+    // zcPoint as high
+    void build(const quint16 *lineData, qint32 length, qint32 zcPoint);
+
+    qint32 size() const {
+        return mapSize;
+    }
+
+    bool operator[](qint32 x) const {
+        return states[x] != 0;
+    }
+
+private:
+    QVector<quint8> states;
+    qint32 mapSize = 0;
+};
+
+#endif // TRANSITIONMAP_H
@@ -39,116 +39,122 @@ VbiLineDecoder::VbiLineDecoder(QAtomicInt& _abort, DecoderPool& _decoderPool, QO
 // Thread main processing method
 void VbiLineDecoder::run()
 {
-    qint32 fieldNumber;
+    qint32 startFieldNumber;
 
     // Input data buffers
     SourceVideo::Data sourceFieldData;
-    LdDecodeMetaData::Field fieldMetadata;
+    QVector<LdDecodeMetaData::Field> batchMetadata;
     LdDecodeMetaData::VideoParameters videoParameters;
 
+    // Number of field lines per field in sourceFieldData
+    const qint32 batchFieldLines = endFieldLine - startFieldLine + 1;
+
     while(!abort) {
-        // Get the next field to process from the input file
-        if (!decoderPool.getInputField(fieldNumber, sourceFieldData, fieldMetadata, videoParameters)) {
+        // Get the next batch of fields to process from the input file
+        if (!decoderPool.getInputFields(startFieldNumber, sourceFieldData, batchMetadata, videoParameters)) {
             // No more input fields -- exit
             break;
         }
 
-        FmCode fmCode;
-        FmCode::FmDecode fmDecode;
-
-        bool isWhiteFlag = false;
-        WhiteFlag whiteFlag;
+        for (qint32 batchIndex = 0; batchIndex < batchMetadata.size() && !abort; batchIndex++) {
+            const qint32 fieldNumber = startFieldNumber + batchIndex;
+            LdDecodeMetaData::Field &fieldMetadata = batchMetadata[batchIndex];
 
-        ClosedCaption closedCaption;
-        ClosedCaption::CcData ccData;
+            // The lines for this field start this many lines into sourceFieldData
+            const qint32 lineOffset = batchIndex * batchFieldLines;
 
-        if (fieldMetadata.isFirstField) qDebug() << "VbiDecoder::process(): Getting metadata for field" << fieldNumber << "(first)";
-        else  qDebug() << "VbiDecoder::process(): Getting metadata for field" << fieldNumber << "(second)";
+            FmCode::FmDecode fmDecode;
+            bool isWhiteFlag = false;
+            ClosedCaption::CcData ccData;
 
-        // Determine the 16-bit zero-crossing point
-        qint32 zcPoint = videoParameters.white16bIre - videoParameters.black16bIre;
+            if (fieldMetadata.isFirstField) qDebug() << "VbiDecoder::process(): Getting metadata for field" << fieldNumber << "(first)";
+            else  qDebug() << "VbiDecoder::process(): Getting metadata for field" << fieldNumber << "(second)";
 
-        // Get the VBI data from field lines 16-18
-        qDebug() << "VbiDecoder::process(): Getting field-lines for field" << fieldNumber;
-        for (qint32 i = 0; i < 3; i++) {
-            fieldMetadata.vbi.vbiData[i] = manchesterDecoder(getActiveVideoLine(sourceFieldData, i + 16 - startFieldLine, videoParameters),
-                                                             zcPoint, videoParameters);
-            if (fieldMetadata.vbi.vbiData[i] == 0) qDebug() << "VbiDecoder::process(): No VBI present on line" << i + 16;
-        }
+            // Determine the 16-bit zero-crossing point
+            qint32 zcPoint = videoParameters.white16bIre - videoParameters.black16bIre;
 
-        // Show the VBI data as hexadecimal (for every 1000th field)
-        if (fieldNumber % 1000 == 0) {
-            qInfo() << "Processing field" << fieldNumber;
-        }
+            // Get the VBI data from field lines 16-18
+            qDebug() << "VbiDecoder::process(): Getting field-lines for field" << fieldNumber;
+            for (qint32 i = 0; i < 3; i++) {
+                fieldMetadata.vbi.vbiData[i] = manchesterDecoder(getFieldLine(sourceFieldData, i + 16 - startFieldLine + lineOffset, videoParameters),
+                                                                 zcPoint, videoParameters);
+                if (fieldMetadata.vbi.vbiData[i] == 0) qDebug() << "VbiDecoder::process(): No VBI present on line" << i + 16;
+            }
 
-        // Process NTSC specific data if source type is NTSC
-        if (!videoParameters.isSourcePal) {
-            // Get the 40-bit FM coded data from field line 10
-            fmDecode = fmCode.fmDecoder(getActiveVideoLine(sourceFieldData, 10 - startFieldLine, videoParameters), videoParameters);
-
-            // Get the white flag from field line 11
-            isWhiteFlag = whiteFlag.getWhiteFlag(getActiveVideoLine(sourceFieldData, 11 - startFieldLine, videoParameters), videoParameters);
-
-            // Get the closed captioning from field line 21
-            ccData = closedCaption.getData(getActiveVideoLine(sourceFieldData, 21 - startFieldLine, videoParameters), videoParameters);
-
-            // Update the metadata
-            if (fmDecode.receiverClockSyncBits != 0) {
-                fieldMetadata.ntsc.isFmCodeDataValid = true;
-                fieldMetadata.ntsc.fmCodeData = static_cast<qint32>(fmDecode.data);
-                if (fmDecode.videoFieldIndicator == 1) fieldMetadata.ntsc.fieldFlag = true;
-                else fieldMetadata.ntsc.fieldFlag = false;
-            } else {
-                fieldMetadata.ntsc.isFmCodeDataValid = false;
-                fieldMetadata.ntsc.fmCodeData = -1;
-                fieldMetadata.ntsc.fieldFlag = false;
+            // Show the VBI data as hexadecimal (for every 1000th field)
+            if (fieldNumber % 1000 == 0) {
+                qInfo() << "Processing field" << fieldNumber;
             }
 
-            fieldMetadata.ntsc.whiteFlag = isWhiteFlag;
-            fieldMetadata.ntsc.inUse = true;
+            // Process NTSC specific data if source type is NTSC
+            if (!videoParameters.isSourcePal) {
+                // Get the 40-bit FM coded data from field line 10
+                fmDecode = fmCode.fmDecoder(getFieldLine(sourceFieldData, 10 - startFieldLine + lineOffset, videoParameters), videoParameters);
+
+                // Get the white flag from field line 11
+                isWhiteFlag = whiteFlag.getWhiteFlag(getFieldLine(sourceFieldData, 11 - startFieldLine + lineOffset, videoParameters), videoParameters);
+
+                // Get the closed captioning from field line 21
+                ccData = closedCaption.getData(getFieldLine(sourceFieldData, 21 - startFieldLine + lineOffset, videoParameters), videoParameters);
+
+                // Update the metadata
+                if (fmDecode.receiverClockSyncBits != 0) {
+                    fieldMetadata.ntsc.isFmCodeDataValid = true;
+                    fieldMetadata.ntsc.fmCodeData = static_cast<qint32>(fmDecode.data);
+                    if (fmDecode.videoFieldIndicator == 1) fieldMetadata.ntsc.fieldFlag = true;
+                    else fieldMetadata.ntsc.fieldFlag = false;
+                } else {
+                    fieldMetadata.ntsc.isFmCodeDataValid = false;
+                    fieldMetadata.ntsc.fmCodeData = -1;
+                    fieldMetadata.ntsc.fieldFlag = false;
+                }
 
-            if (ccData.isValid) {
-                fieldMetadata.ntsc.ccData0 = ccData.byte0;
-                fieldMetadata.ntsc.ccData1 = ccData.byte1;
-            } else {
-                fieldMetadata.ntsc.ccData0 = -1;
-                fieldMetadata.ntsc.ccData1 = -1;
+                fieldMetadata.ntsc.whiteFlag = isWhiteFlag;
+                fieldMetadata.ntsc.inUse = true;
+
+                if (ccData.isValid) {
+                    fieldMetadata.ntsc.ccData0 = ccData.byte0;
+                    fieldMetadata.ntsc.ccData1 = ccData.byte1;
+                } else {
+                    fieldMetadata.ntsc.ccData0 = -1;
+                    fieldMetadata.ntsc.ccData1 = -1;
+                }
             }
-        }
 
-        // Update the metadata for the field
-        fieldMetadata.vbi.inUse = true;
+            // Update the metadata for the field
+            fieldMetadata.vbi.inUse = true;
 
-        // Write the result to the output metadata
-        if (!decoderPool.setOutputField(fieldNumber, fieldMetadata)) {
-            abort = true;
-            break;
+            // Write the result to the output metadata
+            if (!decoderPool.setOutputField(fieldNumber, fieldMetadata)) {
+                abort = true;
+                break;
+            }
         }
     }
 }
 
-// Private method to get a single scanline of greyscale data
-SourceVideo::Data VbiLineDecoder::getActiveVideoLine(const SourceVideo::Data &sourceField, qint32 fieldLine,
-                                                     LdDecodeMetaData::VideoParameters videoParameters)
+// Private method to get a pointer to the start of a single scanline of
+// greyscale data (or nullptr if the line isn't available)
+const quint16 *VbiLineDecoder::getFieldLine(const SourceVideo::Data &sourceField, qint32 fieldLine,
+                                            LdDecodeMetaData::VideoParameters videoParameters)
 {
     // Range-check the scan line
-    if (fieldLine < 0 || fieldLine >= videoParameters.fieldHeight) {
+    if (fieldLine < 0 || (fieldLine + 1) * videoParameters.fieldWidth > sourceField.size()) {
         qWarning() << "Cannot generate field-line data, line number is out of bounds! Scan line =" << fieldLine;
-        return SourceVideo::Data();
+        return nullptr;
     }
 
-    qint32 startPointer = (fieldLine * videoParameters.fieldWidth) + videoParameters.activeVideoStart;
-    qint32 length = videoParameters.activeVideoEnd - videoParameters.activeVideoStart;
-
-    return sourceField.mid(startPointer, length);
+    return sourceField.constData() + (fieldLine * videoParameters.fieldWidth);
 }
 
-// Private method to read a 24-bit biphase coded signal (manchester code) from a field line
-qint32 VbiLineDecoder::manchesterDecoder(const SourceVideo::Data &lineData, qint32 zcPoint,
+// Private method to read a 24-bit biphase coded signal (manchester code) from a field line.
+// lineData points to the start of the field line.
+qint32 VbiLineDecoder::manchesterDecoder(const quint16 *lineData, qint32 zcPoint,
                                          LdDecodeMetaData::VideoParameters videoParameters)
 {
     qint32 result = 0;
-    QVector<bool> manchesterData = getTransitionMap(lineData, zcPoint);
+    if (lineData == nullptr) return result;
+    manchesterData.build(lineData + videoParameters.activeVideoStart, videoParameters.activeVideoEnd - videoParameters.activeVideoStart, zcPoint);
 
     // Get the number of samples for 1.5us
     qreal fJumpSamples = (videoParameters.sampleRate / 1000000) * 1.5;
@@ -203,28 +209,3 @@ qint32 VbiLineDecoder::manchesterDecoder(const SourceVideo::Data &lineData, qint
 
     return result;
 }
-
-// Private method to get the map of transitions across the sample and reject noise
-QVector<bool> VbiLineDecoder::getTransitionMap(const SourceVideo::Data &lineData, qint32 zcPoint)
-{
-    // First read the data into a boolean array using debounce to remove transition noise
-    bool previousState = false;
-    bool currentState = false;
-    qint32 debounce = 0;
-    QVector<bool> manchesterData;
-
-    for (qint32 xPoint = 0; xPoint < lineData.size(); xPoint++) {
-        if (lineData[xPoint] > zcPoint) currentState = true; else currentState = false;
-
-        if (currentState != previousState) debounce++;
-
-        if (debounce > 3) {
-            debounce = 0;
-            previousState = currentState;
-        }
-
-        manchesterData.append(previousState);
-    }
-
-    return manchesterData;
-}
@@ -35,6 +35,7 @@
 #include "fmcode.h"
 #include "whiteflag.h"
 #include "closedcaption.h"
+#include "transitionmap.h"
 
 class DecoderPool;
 
@@ -59,11 +60,16 @@ private:
     // Temporary output buffer
     LdDecodeMetaData::Field outputData;
 
-    SourceVideo::Data getActiveVideoLine(const SourceVideo::Data& sourceFrame, qint32 scanLine,
-                                         LdDecodeMetaData::VideoParameters videoParameters);
-    qint32 manchesterDecoder(const SourceVideo::Data& lineData, qint32 zcPoint,
+    // Line decoders (kept between fields, so they can reuse their buffers)
+    FmCode fmCode;
+    WhiteFlag whiteFlag;
+    ClosedCaption closedCaption;
+    TransitionMap manchesterData;
+
+    const quint16 *getFieldLine(const SourceVideo::Data& sourceField, qint32 fieldLine,
+                                LdDecodeMetaData::VideoParameters videoParameters);
+    qint32 manchesterDecoder(const quint16 *lineData, qint32 zcPoint,
                              LdDecodeMetaData::VideoParameters videoParameters);
-    QVector<bool> getTransitionMap(const SourceVideo::Data& lineData, qint32 zcPoint);
 };
 
 #endif // VBILINEDECODER_H
@@ -24,9 +24,12 @@
 
 #include "whiteflag.h"
 
-// Public method to read the white flag status from a field-line
-bool WhiteFlag::getWhiteFlag(const SourceVideo::Data &lineData, LdDecodeMetaData::VideoParameters videoParameters)
+// Public method to read the white flag status from a field-line.
+// lineData points to the start of the field line.
+bool WhiteFlag::getWhiteFlag(const quint16 *lineData, LdDecodeMetaData::VideoParameters videoParameters)
 {
+    if (lineData == nullptr) return false;
+
     // Determine the 16-bit zero-crossing point
     qint32 zcPoint = videoParameters.white16bIre - videoParameters.black16bIre;
 
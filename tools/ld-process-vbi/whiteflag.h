@@ -25,13 +25,12 @@
 #ifndef WHITEFLAG_H
 #define WHITEFLAG_H
 
-#include "sourcevideo.h"
 #include "lddecodemetadata.h"
 
 class WhiteFlag
 {
 public:
-    bool getWhiteFlag(const SourceVideo::Data &lineData, LdDecodeMetaData::VideoParameters videoParameters);
+    bool getWhiteFlag(const quint16 *lineData, LdDecodeMetaData::VideoParameters videoParameters);
 };
 
 #endif // WHITEFLAG_H
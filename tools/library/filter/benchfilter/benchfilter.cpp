@@ -0,0 +1,187 @@
+/************************************************************************
+
+    benchfilter.cpp
+
+    ld-decode-tools filter library
+    Copyright (C) 2019-2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+// Microbenchmark comparing FIRFilter against the original implementation.
+// This isn't run as part of the tests; run it by hand when changing
+// FIRFilter.
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using std::array;
+using std::cerr;
+using std::string;
+using std::vector;
+
+#include "deemp.h"
+#include "firfilter.h"
+
+// This is the original FIRFilter from firfilter.h, before it was specialised.
+template <typename Coeffs>
+class SimpleFIRFilter
+{
+public:
+    constexpr SimpleFIRFilter(const Coeffs &coeffs_)
+        : coeffs(coeffs_)
+    {
+    }
+
+    template <typename InputSample, typename OutputSample>
+    void apply(const InputSample *inputData, OutputSample *outputData, int numSamples) const
+    {
+        const int numTaps = coeffs.size();
+        const int overlap = numTaps / 2;
+
+        assert((numTaps % 2) == 1);
+
+        const int leftPos = std::min(overlap, numSamples);
+        for (int i = 0; i < leftPos; i++) {
+            typename Coeffs::value_type v = 0;
+            for (int j = 0, k = i - overlap; j < numTaps; j++, k++) {
+                if (k >= 0 && k < numSamples) {
+                    v += coeffs[j] * inputData[k];
+                }
+            }
+            outputData[i] = v;
+        }
+
+        const int rightPos = std::max(numSamples - overlap, leftPos);
+        for (int i = leftPos; i < rightPos; i++) {
+            typename Coeffs::value_type v = 0;
+            for (int j = 0, k = i - overlap; j < numTaps; j++, k++) {
+                v += coeffs[j] * inputData[k];
+            }
+            outputData[i] = v;
+        }
+
+        for (int i = rightPos; i < numSamples; i++) {
+            typename Coeffs::value_type v = 0;
+            for (int j = 0, k = i - overlap; j < numTaps; j++, k++) {
+                if (k < numSamples) {
+                    v += coeffs[j] * inputData[k];
+                }
+            }
+            outputData[i] = v;
+        }
+    }
+
+    template <typename InputContainer, typename OutputContainer>
+    void apply(const InputContainer &inputData, OutputContainer &outputData) const
+    {
+        assert(inputData.size() == outputData.size());
+        apply(inputData.data(), outputData.data(), inputData.size());
+    }
+
+    template <typename Container>
+    void apply(Container &data) const
+    {
+        Container tmp(data.size());
+        apply(data, tmp);
+        data = tmp;
+    }
+
+private:
+    const Coeffs &coeffs;
+};
+
+// Measure how long a function takes to run, in ns per sample. This takes the
+// fastest of several trials, to reduce the effect of other activity on the
+// machine.
+template <typename F>
+double timeFilter(F fn, int numSamples)
+{
+    const int trials = 10;
+    const int repeats = 50;
+
+    double best = 0;
+    for (int trial = 0; trial < trials; trial++) {
+        const auto startTime = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; i++) {
+            fn();
+        }
+        const auto endTime = std::chrono::steady_clock::now();
+
+        const double elapsed = std::chrono::duration<double, std::nano>(endTime - startTime).count();
+        if (trial == 0 || elapsed < best) best = elapsed;
+    }
+
+    return best / (static_cast<double>(repeats) * numSamples);
+}
+
+// Compare FIRFilter's speed against SimpleFIRFilter on field-line-sized data
+template <typename Coeffs>
+void benchmarkFIRFilter(const string &name, const Coeffs &coeffs)
+{
+    const auto f = makeFIRFilter(coeffs);
+    const SimpleFIRFilter<Coeffs> g(coeffs);
+    const int numSamples = 1135 * 16;
+
+    vector<uint16_t> input16(numSamples);
+    vector<double> input(numSamples), output(numSamples);
+    for (int i = 0; i < numSamples; i++) {
+        input16[i] = static_cast<uint16_t>((i * 7919) % 65536);
+        input[i] = input16[i];
+    }
+
+    const double simple16 = timeFilter([&] { g.apply(input16, output); }, numSamples);
+    const double fir16 = timeFilter([&] { f.apply(input16, output); }, numSamples);
+    const double simpleSeparate = timeFilter([&] { g.apply(input, output); }, numSamples);
+    const double firSeparate = timeFilter([&] { f.apply(input, output); }, numSamples);
+    const double simpleInPlace = timeFilter([&] { g.apply(input); }, numSamples);
+    const double firInPlace = timeFilter([&] { f.apply(input); }, numSamples);
+
+    cerr << "Benchmark FIRFilter: " << name << "\n"
+         << "  uint16_t->double: " << simple16 << " ns/sample simple, " << fir16 << " ns/sample FIRFilter ("
+         << simple16 / fir16 << "x)\n"
+         << "  double->double:   " << simpleSeparate << " ns/sample simple, " << firSeparate << " ns/sample FIRFilter ("
+         << simpleSeparate / firSeparate << "x)\n"
+         << "  double in-place:  " << simpleInPlace << " ns/sample simple, " << firInPlace << " ns/sample FIRFilter ("
+         << simpleInPlace / firInPlace << "x)\n";
+}
+
+int main()
+{
+    // PalColour's UV filter
+    const array<double, 17> uvFilter {
+        0.0008, 0.0025, 0.0080, 0.0207, 0.0433, 0.0740, 0.1045, 0.1264,
+        0.1345,
+        0.1264, 0.1045, 0.0740, 0.0433, 0.0207, 0.0080, 0.0025, 0.0008
+    };
+    benchmarkFIRFilter("17-tap symmetrical", uvFilter);
+
+    // The luma filters in filters.cpp
+    const array<double, 5> shortFilter {0.032, 0.221, 0.494, 0.221, 0.032};
+    benchmarkFIRFilter("5-tap symmetrical", shortFilter);
+
+    benchmarkFIRFilter("nr (25-tap asymmetrical)", c_nr_b);
+    benchmarkFIRFilter("a500_44k (17-tap asymmetrical)", c_a500_44k_b);
+
+    return 0;
+}
@@ -0,0 +1,15 @@
+CONFIG += c++11
+CONFIG -= app_bundle
+
+SOURCES += \
+    benchfilter.cpp
+
+HEADERS += \
+    ../deemp.h \
+    ../firfilter.h \
+    ../iirfilter.h
+
+INCLUDEPATH += \
+    ..
+
+target.CONFIG += no_default_install
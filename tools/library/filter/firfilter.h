@@ -26,10 +26,15 @@
 #define FIRFILTER_H
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 
 // A FIR filter with arbitrary coefficients. The number of taps must be odd.
 //
+// Coeffs must be a std::array (or something else that std::tuple_size works
+// on), so that the number of taps is known at compile time and the inner
+// loops can be fully unrolled and vectorised by the compiler.
+//
 // Coeffs::value_type will be used to accumulate the results, so if you provide
 // float coefficients, the filter will work at float precision internally.
 template <typename Coeffs>
@@ -51,12 +56,8 @@ public:
         // To minimise tests in the loops below, we divide the data into
         // three parts, based on how far we might need to read outside the
         // input data.
-        const int numTaps = coeffs.size();
-        const int overlap = numTaps / 2;
-
-        // Check that the number of taps is odd. (If it was even, then the
-        // output would be delayed by half a sample.)
-        assert((numTaps % 2) == 1);
+        const int numTaps = NUM_TAPS;
+        const int overlap = OVERLAP;
 
         // At the left end of the input, we definitely overlap to the left.
         // We might overlap to the right too if numSamples < numTaps, in which
@@ -75,13 +76,7 @@ public:
         // In the middle of the input, we definitely don't overlap -- and for
         // typical input this is where we do most of the work.
         const int rightPos = std::max(numSamples - overlap, leftPos);
-        for (int i = leftPos; i < rightPos; i++) {
-            typename Coeffs::value_type v = 0;
-            for (int j = 0, k = i - overlap; j < numTaps; j++, k++) {
-                v += coeffs[j] * inputData[k];
-            }
-            outputData[i] = v;
-        }
+        applyMiddle(inputData, outputData, leftPos, rightPos);
 
         // At the right end of the input, we definitely overlap to the right.
         for (int i = rightPos; i < numSamples; i++) {
@@ -109,15 +104,163 @@ public:
     template <typename Container>
     void apply(Container &data) const
     {
-        Container tmp(data.size());
-        apply(data, tmp);
-        data = tmp;
+        applyInPlace(data.data(), data.size());
+    }
+
+    // Apply the filter to a range of samples of length numSamples, writing
+    // the result back into the same range. This doesn't allocate any memory.
+    template <typename Sample>
+    void applyInPlace(Sample *data, int numSamples) const
+    {
+        // Each output sample depends on the original values of the OVERLAP
+        // samples before it, which will already have been overwritten. So we
+        // work through the data in blocks, copying each block and the
+        // samples either side of it into a buffer, and filtering from there.
+        // The buffer is zero-padded at the ends, so the filter doesn't need
+        // to check the bounds.
+        const int overlap = OVERLAP;
+        Sample buffer[OVERLAP + IN_PLACE_BLOCK + OVERLAP];
+        Sample *blockBuffer = buffer + overlap;
+
+        std::fill(buffer, blockBuffer, Sample(0));
+        for (int blockStart = 0; blockStart < numSamples; blockStart += IN_PLACE_BLOCK) {
+            const int blockLength = std::min(static_cast<int>(IN_PLACE_BLOCK), numSamples - blockStart);
+
+            // Copy this block and the samples after it
+            const int copyLength = std::min(blockLength + overlap, numSamples - blockStart);
+            std::copy(data + blockStart, data + blockStart + copyLength, blockBuffer);
+            std::fill(blockBuffer + copyLength, blockBuffer + blockLength + overlap, Sample(0));
+
+            applyMiddle(blockBuffer, data + blockStart, 0, blockLength);
+
+            // Keep the last OVERLAP samples for the start of the next block
+            std::copy(buffer + blockLength, buffer + blockLength + overlap, buffer);
+        }
     }
 
 private:
+    // The number of taps, and the number of samples either side of the
+    // centre tap
+    static constexpr int NUM_TAPS = std::tuple_size<Coeffs>::value;
+    static constexpr int OVERLAP = NUM_TAPS / 2;
+
+    // Check that the number of taps is odd. (If it was even, then the output
+    // would be delayed by half a sample.)
+    static_assert((NUM_TAPS % 2) == 1, "FIRFilter must have an odd number of taps");
+
+    // Number of samples to filter at a time in applyInPlace
+    static constexpr int IN_PLACE_BLOCK = 256;
+
+    // Number of output samples to compute together in applyMiddleSymmetric
+    static constexpr int CHUNK_SIZE = 64;
+
     const Coeffs &coeffs;
+
+    // Return true if the coefficients are symmetrical around the centre tap
+    // (which they are for a linear-phase filter).
+    bool isSymmetric() const
+    {
+        for (int j = 0; j < OVERLAP; j++) {
+            if (coeffs[j] != coeffs[NUM_TAPS - 1 - j]) return false;
+        }
+        return true;
+    }
+
+    // Apply the filter to samples startPos to endPos of inputData, where all
+    // the input samples needed are available.
+    template <typename InputSample, typename OutputSample>
+    void applyMiddle(const InputSample *inputData, OutputSample *outputData, int startPos, int endPos) const
+    {
+        if (isSymmetric()) {
+            applyMiddleSymmetric(inputData, outputData, startPos, endPos);
+        } else {
+            applyMiddleAsymmetric(inputData, outputData, startPos, endPos);
+        }
+    }
+
+    // For asymmetrical coefficients, compute each output sample in turn. This
+    // is the same loop as the left and right parts of apply() without the
+    // bounds checks, so the results are identical.
+    template <typename InputSample, typename OutputSample>
+    void applyMiddleAsymmetric(const InputSample *inputData, OutputSample *outputData, int startPos, int endPos) const
+    {
+        for (int i = startPos; i < endPos; i++) {
+            typename Coeffs::value_type v = 0;
+            for (int j = 0, k = i - OVERLAP; j < NUM_TAPS; j++, k++) {
+                v += coeffs[j] * inputData[k];
+            }
+            outputData[i] = v;
+        }
+    }
+
+    // For symmetrical coefficients, each pair of samples either side of the
+    // centre shares a coefficient, so add them first and halve the
+    // multiplies.
+    //
+    // Rather than computing each output sample in turn, this works on a
+    // chunk of output samples at a time, applying one tap to every sample in
+    // the chunk before moving on to the next. The samples in a chunk are
+    // independent, so the compiler can vectorise the loops across them. The
+    // sum starts from the centre tap and each pair is added before
+    // multiplying, so the results are only equal to the per-sample loop's up
+    // to rounding error.
+    template <typename InputSample, typename OutputSample>
+    void applyMiddleSymmetric(const InputSample *inputData, OutputSample *outputData, int startPos, int endPos) const
+    {
+        using Value = typename Coeffs::value_type;
+        Value acc[CHUNK_SIZE];
+        Value convertBuffer[OVERLAP + CHUNK_SIZE + OVERLAP];
+
+        for (int chunkStart = startPos; chunkStart < endPos; chunkStart += CHUNK_SIZE) {
+            const int chunkLength = std::min(static_cast<int>(CHUNK_SIZE), endPos - chunkStart);
+            const Value *in = toValues(inputData + chunkStart - OVERLAP, convertBuffer, OVERLAP + chunkLength + OVERLAP);
+
+            for (int k = 0; k < chunkLength; k++) {
+                acc[k] = coeffs[OVERLAP] * in[k + OVERLAP];
+            }
+            for (int j = 0; j < OVERLAP; j++) {
+                const Value c = coeffs[j];
+                const Value *inLeft = in + j;
+                const Value *inRight = in + NUM_TAPS - 1 - j;
+                for (int k = 0; k < chunkLength; k++) {
+                    acc[k] += c * (inLeft[k] + inRight[k]);
+                }
+            }
+
+            for (int k = 0; k < chunkLength; k++) {
+                outputData[chunkStart + k] = acc[k];
+            }
+        }
+    }
+
+    // Get numSamples input samples as Coeffs::value_type. If the input is of
+    // a different type, convert it into buffer once, rather than converting
+    // each sample again for every tap.
+    static const typename Coeffs::value_type *toValues(const typename Coeffs::value_type *inputData,
+                                                       typename Coeffs::value_type *, int)
+    {
+        return inputData;
+    }
+    template <typename InputSample>
+    static const typename Coeffs::value_type *toValues(const InputSample *inputData,
+                                                       typename Coeffs::value_type *buffer, int numSamples)
+    {
+        std::copy(inputData, inputData + numSamples, buffer);
+        return buffer;
+    }
 };
 
+// Definitions of static constexpr data members, for compatibility with
+// pre-C++17 compilers
+template <typename Coeffs>
+constexpr int FIRFilter<Coeffs>::NUM_TAPS;
+template <typename Coeffs>
+constexpr int FIRFilter<Coeffs>::OVERLAP;
+template <typename Coeffs>
+constexpr int FIRFilter<Coeffs>::IN_PLACE_BLOCK;
+template <typename Coeffs>
+constexpr int FIRFilter<Coeffs>::CHUNK_SIZE;
+
 // Helper for declaring FIRFilter instances with auto.
 // e.g. constexpr auto myFilter = makeFIRFilter(myFilterCoeffs);
 template <typename Coeffs>
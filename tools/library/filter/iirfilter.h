@@ -27,6 +27,7 @@
 #ifndef IIRFILTER_H
 #define IIRFILTER_H
 
+#include <algorithm>
 #include <cassert>
 #include <array>
 #include <vector>
@@ -80,6 +81,58 @@ public:
         return y[0];
     }
 
+    // Feed a block of n input values into the filter, writing n output values.
+    // The results are identical to calling feed() on each value in turn, and
+    // the filter's history is updated so that the two can be mixed freely.
+    // in and out must not overlap.
+    //
+    // Rather than shifting the history on every sample, this indexes the
+    // input and output blocks directly, only consulting the saved history
+    // for the first few samples of the block. For a FIR filter (aOrder == 1)
+    // the steady-state loop is a plain convolution over the input.
+    void process(const double *in, double *out, int n) {
+        // The number of samples at the start of the block that need history
+        const int head = std::min(n, static_cast<int>(std::max(bOrder, aOrder)) - 1);
+
+        // Samples before the start of the block come from the history
+        auto inAt = [&](int k) { return k >= 0 ? in[k] : x[-k - 1]; };
+        auto outAt = [&](int k) { return k >= 0 ? out[k] : y[-k - 1]; };
+
+        for (int s = 0; s < head; s++) {
+            double y0 = b[0] * in[s];
+            for (int i = bOrder - 1; i >= 1; i--) {
+                y0 += b[i] * inAt(s - i);
+            }
+            for (int i = aOrder - 1; i >= 1; i--) {
+                y0 -= a[i] * outAt(s - i);
+            }
+            out[s] = y0;
+        }
+
+        for (int s = head; s < n; s++) {
+            double y0 = b[0] * in[s];
+            for (int i = bOrder - 1; i >= 1; i--) {
+                y0 += b[i] * in[s - i];
+            }
+            for (int i = aOrder - 1; i >= 1; i--) {
+                y0 -= a[i] * out[s - i];
+            }
+            out[s] = y0;
+        }
+
+        // Update the history with the most recent values
+        std::array<double, bOrder> newX;
+        for (unsigned i = 0; i < bOrder; i++) {
+            newX[i] = inAt(n - 1 - static_cast<int>(i));
+        }
+        std::array<double, aOrder> newY;
+        for (unsigned i = 0; i < aOrder; i++) {
+            newY[i] = outAt(n - 1 - static_cast<int>(i));
+        }
+        x = newX;
+        y = newY;
+    }
+
 private:
     // Feedforward (input) coefficients
     std::array<double, bOrder> b;
@@ -117,6 +117,39 @@ void testIIRFilter(const char *name, FN& fn, FO& fo)
     }
 }
 
+// Check that IIRFilter's block process() matches feed() exactly,
+// using a mixture of block sizes (including ones shorter than the filter).
+template <typename FN>
+void testIIRFilterProcess(const char *name, const FN& filter)
+{
+    cerr << "Testing IIRFilter::process: " << name << "\n";
+
+    auto fn(filter);
+    auto fo(filter);
+
+    const int blockSizes[] = {1, 3, 100, 2, 37, 500, 7};
+    vector<double> input, output;
+    int i = 0;
+    for (int blockSize: blockSizes) {
+        input.resize(blockSize);
+        output.resize(blockSize);
+        for (int j = 0; j < blockSize; j++) {
+            input[j] = ((i + j) * 37 % 101) - 50;
+        }
+
+        fn.process(input.data(), output.data(), blockSize);
+
+        for (int j = 0; j < blockSize; j++) {
+            double out_o = fo.feed(input[j]);
+            if (output[j] != out_o) {
+                cerr << "Mismatch on " << name << " at " << (i + j) << ": " << input[j] << " -> " << output[j] << ", " << out_o << "\n";
+                exit(1);
+            }
+        }
+        i += blockSize;
+    }
+}
+
 // Test IIRFilter for the sets of coefficients used in the code
 void testIIRFilters()
 {
@@ -143,6 +176,12 @@ void testIIRFilters()
     auto f5(f_a40h_48k);
     SimpleFilter g5(c_a40h_48k_b, c_a40h_48k_a);
     testIIRFilter("a40h_48k", f5, g5);
+
+    testIIRFilterProcess("colorlpi", f_colorlpi);
+    testIIRFilterProcess("colorlpq", f_colorlpq);
+    testIIRFilterProcess("nrc", f_nrc);
+    testIIRFilterProcess("nr", f_nr);
+    testIIRFilterProcess("a500_48k", f_a500_48k);
 }
 
 // Check that FIRFilter's output matches SimpleFilter in FIR mode.
@@ -239,6 +278,21 @@ void testFIRCoeffs(const string &name, const Coeffs &coeffs)
     fill(output.begin(), output.end(), 0);
     f.apply(input16, output);
     testFIRFilter(name + " int16_t->double", input16, output, coeffs);
+
+    // Long vectors, so in-place filtering has to work in several blocks
+
+    input.clear();
+    for (int i = 0; i < 1000; i++) {
+        input.push_back((i * 37) % 101);
+    }
+    output.resize(input.size());
+
+    f.apply(input, output);
+    testFIRFilter(name + " long separate", input, output, coeffs);
+
+    output = input;
+    f.apply(output);
+    testFIRFilter(name + " long in-place", input, output, coeffs);
 }
 
 // Test FIRFilter
@@ -255,6 +309,10 @@ void testFIRFilters()
 
     assert(c_a500_44k_a.size() == 1);
     testFIRCoeffs("a500_44k", c_a500_44k_b);
+
+    // The filters above aren't symmetrical, so also test one that is
+    const array<double, 9> symmetric {0.03, -0.05, 0.1, 0.2, 0.44, 0.2, 0.1, -0.05, 0.03};
+    testFIRCoeffs("symmetric", symmetric);
 }
 
 int main()
@@ -0,0 +1,62 @@
+/************************************************************************
+
+    cpufeatures.h
+
+    ld-decode-tools TBC library
+    Copyright (C) 2020 Adam Sampson
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+// Runtime detection of x86 SIMD instruction sets.
+//
+// On x86 with GCC or Clang, CPUFEATURES_X86 is defined. Code can then provide
+// SIMD kernels alongside its scalar code, compiling each kernel with
+// __attribute__((target("..."))) and only calling it if the matching cpuHas
+// function below returns true. This doesn't need any special compiler flags,
+// so the same binary works everywhere, and the scalar code is used on CPUs
+// without the instructions (and on other architectures and compilers).
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CPUFEATURES_X86
+
+// Each of these checks the CPU the first time it's called, and caches the
+// result.
+
+inline bool cpuHasSsse3()
+{
+    static const bool result = __builtin_cpu_supports("ssse3");
+    return result;
+}
+
+inline bool cpuHasSse41()
+{
+    static const bool result = __builtin_cpu_supports("sse4.1");
+    return result;
+}
+
+inline bool cpuHasAvx2()
+{
+    static const bool result = __builtin_cpu_supports("avx2");
+    return result;
+}
+
+#endif
+
+#endif
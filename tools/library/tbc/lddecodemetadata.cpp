@@ -23,17 +23,43 @@
 ************************************************************************/
 
 #include "lddecodemetadata.h"
+#include "metadatareader.h"
 
 LdDecodeMetaData::LdDecodeMetaData()
 {
     // Set defaults
     isFirstFieldFirst = false;
+    isReadOnly = false;
+    hasVideoParameters = false;
+    hasPcmAudioParameters = false;
 }
 
 // This method opens the JSON metadata file and reads the content into the
 // metadata structure read for use
-bool LdDecodeMetaData::read(QString fileName)
+//
+// If readOnly is true, the file is parsed directly into the metadata structure
+// by MetadataReader, which is much faster for large files; the metadata then
+// cannot be modified or written.
+bool LdDecodeMetaData::read(QString fileName, bool readOnly)
 {
+    isReadOnly = readOnly;
+
+    if (isReadOnly) {
+        qDebug() << "LdDecodeMetaData::read(): Loading JSON file" << fileName << "(read-only)";
+        MetadataReader metadataReader;
+        if (!metadataReader.read(fileName, metaData)) {
+            qCritical("Opening JSON file failed: JSON file cannot be opened/does not exist");
+            return false;
+        }
+        hasVideoParameters = metadataReader.hasVideoParameters();
+        hasPcmAudioParameters = metadataReader.hasPcmAudioParameters();
+
+        // Default to the standard still-frame field order (of first field first)
+        isFirstFieldFirst = true;
+
+        return true;
+    }
+
     // Open the JSON file
     qDebug() << "LdDecodeMetaData::read(): Loading JSON file" << fileName;
     if (!json.loadFile(fileName)) {
@@ -52,6 +78,8 @@ bool LdDecodeMetaData::read(QString fileName)
 // This method copies the metadata structure into a JSON metadata file
 bool LdDecodeMetaData::write(QString fileName)
 {
+    if (!checkWritable("LdDecodeMetaData::write()")) return false;
+
     // Write the JSON object
     qDebug() << "LdDecodeMetaData::write(): Writing JSON metadata to:" << fileName;
     if (!json.saveAs(fileName, JsonWax::Compact)) {
@@ -67,6 +95,17 @@ LdDecodeMetaData::VideoParameters LdDecodeMetaData::getVideoParameters()
 {
     VideoParameters videoParameters;
 
+    if (isReadOnly) {
+        if (!hasVideoParameters) {
+            qCritical("JSON file invalid: videoParameters object is not defined");
+            return metaData.videoParameters;
+        }
+
+        videoParameters = metaData.videoParameters;
+        setActiveLineRange(videoParameters);
+        return videoParameters;
+    }
+
     // Read the video paramters
     if (json.size({"videoParameters"}) > 0) {
         videoParameters.numberOfSequentialFields = json.value({"videoParameters", "numberOfSequentialFields"}).toInt();
@@ -92,7 +131,14 @@ LdDecodeMetaData::VideoParameters LdDecodeMetaData::getVideoParameters()
         return videoParameters;
     }
 
-    // Add in the active field line range psuedo-metadata
+    setActiveLineRange(videoParameters);
+
+    return videoParameters;
+}
+
+// This method adds in the active field line range psuedo-metadata
+void LdDecodeMetaData::setActiveLineRange(LdDecodeMetaData::VideoParameters &videoParameters)
+{
     if (videoParameters.isSourcePal) {
         // PAL
         videoParameters.firstActiveFieldLine = 22;
@@ -112,13 +158,13 @@ LdDecodeMetaData::VideoParameters LdDecodeMetaData::getVideoParameters()
         // Interlaced line 524 is NTSC line 263 (the last active half-line).
         videoParameters.lastActiveFrameLine = 525;
     }
-
-    return videoParameters;
 }
 
 // This method sets the videoParameters metadata
 void LdDecodeMetaData::setVideoParameters (LdDecodeMetaData::VideoParameters _videoParameters)
 {
+    if (!checkWritable("LdDecodeMetaData::setVideoParameters()")) return;
+
     // Write the video parameters
     json.setValue({"videoParameters", "numberOfSequentialFields"}, getNumberOfFields());
     json.setValue({"videoParameters", "isSourcePal"}, _videoParameters.isSourcePal);
@@ -145,6 +191,11 @@ LdDecodeMetaData::PcmAudioParameters LdDecodeMetaData::getPcmAudioParameters()
 {
     PcmAudioParameters pcmAudioParameters;
 
+    if (isReadOnly) {
+        if (!hasPcmAudioParameters) qCritical("JSON file invalid: pcmAudioParameters is not defined");
+        return metaData.pcmAudioParameters;
+    }
+
     if (json.size({"pcmAudioParameters"}) > 0) {
         // Read the PCM audio data
         pcmAudioParameters.sampleRate = json.value({"pcmAudioParameters", "sampleRate"}).toInt();
@@ -162,6 +213,8 @@ LdDecodeMetaData::PcmAudioParameters LdDecodeMetaData::getPcmAudioParameters()
 // This method sets the pcmAudioParameters metadata
 void LdDecodeMetaData::setPcmAudioParameters(LdDecodeMetaData::PcmAudioParameters _pcmAudioParam)
 {
+    if (!checkWritable("LdDecodeMetaData::setPcmAudioParameters()")) return;
+
     json.setValue({"pcmAudioParameters", "sampleRate"}, _pcmAudioParam.sampleRate);
     json.setValue({"pcmAudioParameters", "isLittleEndian"}, _pcmAudioParam.isLittleEndian);
     json.setValue({"pcmAudioParameters", "isSigned"}, _pcmAudioParam.isSigned);
@@ -176,8 +229,14 @@ LdDecodeMetaData::Field LdDecodeMetaData::getField(qint32 sequentialFieldNumber)
 
     if (fieldNumber >= getNumberOfFields() || fieldNumber < 0) {
         qCritical() << "LdDecodeMetaData::getField(): Requested field number" << sequentialFieldNumber << "out of bounds!";
+        if (isReadOnly) {
+            field.vbi.vbiData.resize(3);
+            return field;
+        }
     }
 
+    if (isReadOnly) return metaData.fields.at(fieldNumber);
+
     // Primary field values
     field.seqNo = json.value({"fields", fieldNumber, "seqNo"}).toInt();
     field.isFirstField = json.value({"fields", fieldNumber, "isFirstField"}).toBool();
@@ -212,8 +271,11 @@ LdDecodeMetaData::VitsMetrics LdDecodeMetaData::getFieldVitsMetrics(qint32 seque
 
     if (fieldNumber >= getNumberOfFields() || fieldNumber < 0) {
         qCritical() << "LdDecodeMetaData::getFieldVitsMetrics(): Requested field number" << sequentialFieldNumber << "out of bounds!";
+        if (isReadOnly) return vitsMetrics;
     }
 
+    if (isReadOnly) return metaData.fields.at(fieldNumber).vitsMetrics;
+
     if (json.size({"fields", fieldNumber, "vitsMetrics"}) > 0) {
         vitsMetrics.inUse = true;
         vitsMetrics.wSNR = json.value({"fields", fieldNumber, "vitsMetrics", "wSNR"}).toReal();
@@ -234,8 +296,14 @@ LdDecodeMetaData::Vbi LdDecodeMetaData::getFieldVbi(qint32 sequentialFieldNumber
 
     if (fieldNumber >= getNumberOfFields() || fieldNumber < 0) {
         qCritical() << "LdDecodeMetaData::getFieldVbi(): Requested field number" << sequentialFieldNumber << "out of bounds!";
+        if (isReadOnly) {
+            vbi.vbiData.resize(3);
+            return vbi;
+        }
     }
 
+    if (isReadOnly) return metaData.fields.at(fieldNumber).vbi;
+
     if (json.size({"fields", fieldNumber, "vbi"}) > 0) {
         // Mark VBI as in use
         vbi.inUse = true;
@@ -262,8 +330,11 @@ LdDecodeMetaData::Ntsc LdDecodeMetaData::getFieldNtsc(qint32 sequentialFieldNumb
 
     if (fieldNumber >= getNumberOfFields() || fieldNumber < 0) {
         qCritical() << "LdDecodeMetaData::getFieldNtsc(): Requested field number" << sequentialFieldNumber << "out of bounds!";
+        if (isReadOnly) return ntsc;
     }
 
+    if (isReadOnly) return metaData.fields.at(fieldNumber).ntsc;
+
     if (json.size({"fields", fieldNumber, "ntsc"}) > 0) {
         // Mark as in use
         ntsc.inUse = true;
@@ -290,8 +361,11 @@ LdDecodeMetaData::DropOuts LdDecodeMetaData::getFieldDropOuts(qint32 sequentialF
 
     if (fieldNumber >= getNumberOfFields() || fieldNumber < 0) {
         qCritical() << "LdDecodeMetaData::getFieldDropOuts(): Requested field number" << sequentialFieldNumber << "out of bounds!";
+        if (isReadOnly) return dropOuts;
     }
 
+    if (isReadOnly) return metaData.fields.at(fieldNumber).dropOuts;
+
     // Get the JSON array sizes
     qint32 startxSize = json.size({"fields", fieldNumber, "dropOuts", "startx"});
     qint32 endxSize = json.size({"fields", fieldNumber, "dropOuts", "endx"});
@@ -324,6 +398,8 @@ LdDecodeMetaData::DropOuts LdDecodeMetaData::getFieldDropOuts(qint32 sequentialF
 // This method sets the field metadata for a field
 void LdDecodeMetaData::updateField(LdDecodeMetaData::Field _field, qint32 sequentialFieldNumber)
 {
+    if (!checkWritable("LdDecodeMetaData::updateField()")) return;
+
     if (sequentialFieldNumber < 1) {
         qCritical() << "LdDecodeMetaData::updateFieldVitsMetrics(): Requested field number" << sequentialFieldNumber << "out of bounds!";
     }
@@ -357,6 +433,8 @@ void LdDecodeMetaData::updateField(LdDecodeMetaData::Field _field, qint32 sequen
 // This method sets the field VBI metadata for a field
 void LdDecodeMetaData::updateFieldVitsMetrics(LdDecodeMetaData::VitsMetrics _vitsMetrics, qint32 sequentialFieldNumber)
 {
+    if (!checkWritable("LdDecodeMetaData::updateFieldVitsMetrics()")) return;
+
     qint32 fieldNumber = sequentialFieldNumber - 1;
 
     if (fieldNumber >= getNumberOfFields() + 1 || fieldNumber < 0) {
@@ -372,6 +450,8 @@ void LdDecodeMetaData::updateFieldVitsMetrics(LdDecodeMetaData::VitsMetrics _vit
 // This method sets the field VBI metadata for a field
 void LdDecodeMetaData::updateFieldVbi(LdDecodeMetaData::Vbi _vbi, qint32 sequentialFieldNumber)
 {
+    if (!checkWritable("LdDecodeMetaData::updateFieldVbi()")) return;
+
     qint32 fieldNumber = sequentialFieldNumber - 1;
 
     if (fieldNumber >= getNumberOfFields() + 1 || fieldNumber < 0) {
@@ -397,6 +477,8 @@ void LdDecodeMetaData::updateFieldVbi(LdDecodeMetaData::Vbi _vbi, qint32 sequent
 // This method sets the field NTSC metadata for a field
 void LdDecodeMetaData::updateFieldNtsc(LdDecodeMetaData::Ntsc _ntsc, qint32 sequentialFieldNumber)
 {
+    if (!checkWritable("LdDecodeMetaData::updateFieldNtsc()")) return;
+
     qint32 fieldNumber = sequentialFieldNumber - 1;
 
     if (fieldNumber >= getNumberOfFields() + 1 || fieldNumber < 0) {
@@ -418,6 +500,8 @@ void LdDecodeMetaData::updateFieldNtsc(LdDecodeMetaData::Ntsc _ntsc, qint32 sequ
 // This method sets the field dropout metadata for a field
 void LdDecodeMetaData::updateFieldDropOuts(LdDecodeMetaData::DropOuts _dropOuts, qint32 sequentialFieldNumber)
 {
+    if (!checkWritable("LdDecodeMetaData::updateFieldDropOuts()")) return;
+
     qint32 fieldNumber = sequentialFieldNumber - 1;
 
     if (fieldNumber >= getNumberOfFields() + 1 || fieldNumber < 0) {
@@ -437,6 +521,8 @@ void LdDecodeMetaData::updateFieldDropOuts(LdDecodeMetaData::DropOuts _dropOuts,
 // This method clears the field dropout metadata for a field
 void LdDecodeMetaData::clearFieldDropOuts(qint32 sequentialFieldNumber)
 {
+    if (!checkWritable("LdDecodeMetaData::clearFieldDropOuts()")) return;
+
     qint32 fieldNumber = sequentialFieldNumber - 1;
 
     if (fieldNumber >= getNumberOfFields() + 1 || fieldNumber < 0) {
@@ -461,12 +547,16 @@ void LdDecodeMetaData::appendField(LdDecodeMetaData::Field _field)
 // Method to get the available number of fields (according to the metadata)
 qint32 LdDecodeMetaData::getNumberOfFields()
 {
+    if (isReadOnly) return metaData.fields.size();
+
     return json.size({"fields"});
 }
 
 // Method to set the available number of fields
 void LdDecodeMetaData::setNumberOfFields(qint32 numberOfFields)
 {
+    if (!checkWritable("LdDecodeMetaData::setNumberOfFields()")) return;
+
     json.setValue({"videoParameters", "numberOfSequentialFields"}, numberOfFields);
 }
 
@@ -628,6 +718,18 @@ void LdDecodeMetaData::setIsFirstFieldFirst(bool flag)
     isFirstFieldFirst = flag;
 }
 
+// Check that the metadata can be modified (i.e. it wasn't read with the
+// read-only fast path)
+bool LdDecodeMetaData::checkWritable(const char *methodName)
+{
+    if (isReadOnly) {
+        qCritical() << methodName << "Metadata was opened read-only and cannot be modified!";
+        return false;
+    }
+
+    return true;
+}
+
 // Method to get the isFirstFieldFirst flag
 bool LdDecodeMetaData::getIsFirstFieldFirst()
 {
@@ -154,12 +154,15 @@ public:
     LdDecodeMetaData(const LdDecodeMetaData &) = delete;
     LdDecodeMetaData& operator=(const LdDecodeMetaData &) = delete;
 
-    bool read(QString fileName);
+    bool read(QString fileName, bool readOnly = false);
     bool write(QString fileName);
 
     VideoParameters getVideoParameters();
     void setVideoParameters (VideoParameters _videoParameters);
 
+    // Fill in the active line range pseudo-metadata for a set of video parameters
+    static void setActiveLineRange(VideoParameters &videoParameters);
+
     PcmAudioParameters getPcmAudioParameters();
     void setPcmAudioParameters(PcmAudioParameters _pcmAudioParam);
 
@@ -196,7 +199,14 @@ private:
     JsonWax json;
     bool isFirstFieldFirst;
 
+    // Metadata parsed by the read-only fast path (used instead of json)
+    bool isReadOnly;
+    MetaData metaData;
+    bool hasVideoParameters;
+    bool hasPcmAudioParameters;
+
     qint32 getFieldNumber(qint32 frameNumber, qint32 field);
+    bool checkWritable(const char *methodName);
 };
 
 #endif // LDDECODEMETADATA_H
@@ -0,0 +1,542 @@
+/************************************************************************
+
+    metadatareader.cpp
+
+    ld-decode-tools TBC library
+    Copyright (C) 2020 Simon Inns
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#include "metadatareader.h"
+
+#include <cstring>
+
+// Definitions of static constexpr data members, for compatibility with
+// pre-C++17 compilers
+constexpr qint32 MetadataReader::FIELDS_PER_CHUNK;
+
+// Position within the JSON text. On a syntax error, failed is set and
+// errorPos records where it happened; all further reads then do nothing.
+struct Cursor {
+    const char *pos;
+    const char *end;
+    bool failed;
+    const char *errorPos;
+};
+
+// An object key, pointing into the JSON text (escapes are not decoded)
+struct Key {
+    const char *data;
+    qint32 length;
+};
+
+template <size_t N>
+static inline bool keyIs(const Key &key, const char (&name)[N])
+{
+    return key.length == static_cast<qint32>(N - 1) && memcmp(key.data, name, N - 1) == 0;
+}
+
+static inline void fail(Cursor &c)
+{
+    if (!c.failed) {
+        c.failed = true;
+        c.errorPos = c.pos;
+    }
+    c.pos = c.end;
+}
+
+static inline void skipSpace(Cursor &c)
+{
+    while (c.pos < c.end && (*c.pos == ' ' || *c.pos == '\n' || *c.pos == '\r' || *c.pos == '\t')) c.pos++;
+}
+
+static inline void expect(Cursor &c, char ch)
+{
+    skipSpace(c);
+    if (c.pos < c.end && *c.pos == ch) c.pos++;
+    else fail(c);
+}
+
+// Skip the rest of a string, having already consumed the opening quote
+static inline void skipString(Cursor &c)
+{
+    while (c.pos < c.end) {
+        const char ch = *c.pos++;
+        if (ch == '"') return;
+        if (ch == '\\') c.pos++;
+    }
+    fail(c);
+}
+
+// Check for (and consume) a literal such as "true"
+template <size_t N>
+static inline bool matchLiteral(Cursor &c, const char (&literal)[N])
+{
+    if (c.end - c.pos >= static_cast<qint64>(N - 1) && memcmp(c.pos, literal, N - 1) == 0) {
+        c.pos += N - 1;
+        return true;
+    }
+    return false;
+}
+
+// Skip over any value, including nested objects and arrays
+static void skipValue(Cursor &c)
+{
+    skipSpace(c);
+    if (c.pos >= c.end) {
+        fail(c);
+        return;
+    }
+
+    const char first = *c.pos;
+    if (first == '"') {
+        c.pos++;
+        skipString(c);
+    } else if (first == '{' || first == '[') {
+        qint32 depth = 0;
+        while (c.pos < c.end) {
+            const char ch = *c.pos++;
+            if (ch == '"') {
+                skipString(c);
+            } else if (ch == '{' || ch == '[') {
+                depth++;
+            } else if (ch == '}' || ch == ']') {
+                if (--depth == 0) return;
+            }
+        }
+        fail(c);
+    } else {
+        // Number or literal
+        const char *start = c.pos;
+        while (c.pos < c.end && *c.pos != ',' && *c.pos != '}' && *c.pos != ']'
+               && *c.pos != ' ' && *c.pos != '\n' && *c.pos != '\r' && *c.pos != '\t') c.pos++;
+        if (c.pos == start) fail(c);
+    }
+}
+
+// Begin reading an object or array
+static inline bool begin(Cursor &c, char open)
+{
+    expect(c, open);
+    return !c.failed;
+}
+
+// Move to the next element of an array; returns false at the end of the array
+static inline bool nextElement(Cursor &c, bool &first)
+{
+    if (c.failed) return false;
+
+    skipSpace(c);
+    if (c.pos < c.end && *c.pos == ']') {
+        c.pos++;
+        return false;
+    }
+    if (!first) expect(c, ',');
+    first = false;
+
+    return !c.failed;
+}
+
+// Move to the next member of an object and read its key; returns false at
+// the end of the object
+static inline bool nextMember(Cursor &c, bool &first, Key &key)
+{
+    if (c.failed) return false;
+
+    skipSpace(c);
+    if (c.pos < c.end && *c.pos == '}') {
+        c.pos++;
+        return false;
+    }
+    if (!first) expect(c, ',');
+    first = false;
+
+    expect(c, '"');
+    key.data = c.pos;
+    skipString(c);
+    key.length = static_cast<qint32>(c.pos - key.data - 1);
+    expect(c, ':');
+
+    return !c.failed;
+}
+
+// Read a number. As with JsonWax's QVariants, booleans read as 1/0 and null
+// as 0.
+static double readNumber(Cursor &c)
+{
+    skipSpace(c);
+    if (c.pos >= c.end) {
+        fail(c);
+        return 0;
+    }
+
+    if (matchLiteral(c, "true")) return 1;
+    if (matchLiteral(c, "false")) return 0;
+    if (matchLiteral(c, "null")) return 0;
+
+    // Fast path for integers
+    const char *start = c.pos;
+    bool negative = false;
+    if (*c.pos == '-') {
+        negative = true;
+        c.pos++;
+    }
+    qint64 integer = 0;
+    qint32 digits = 0;
+    while (c.pos < c.end && *c.pos >= '0' && *c.pos <= '9' && digits < 18) {
+        integer = (integer * 10) + (*c.pos - '0');
+        c.pos++;
+        digits++;
+    }
+    if (digits > 0 && (c.pos >= c.end || (*c.pos != '.' && *c.pos != 'e' && *c.pos != 'E'
+                                           && (*c.pos < '0' || *c.pos > '9')))) {
+        return static_cast<double>(negative ? -integer : integer);
+    }
+
+    // Anything else goes through Qt's (locale-independent) conversion
+    c.pos = start;
+    while (c.pos < c.end && ((*c.pos >= '0' && *c.pos <= '9') || *c.pos == '-' || *c.pos == '+'
+                             || *c.pos == '.' || *c.pos == 'e' || *c.pos == 'E')) c.pos++;
+    bool ok = false;
+    const double value = QByteArray::fromRawData(start, static_cast<qint32>(c.pos - start)).toDouble(&ok);
+    if (!ok) {
+        c.pos = start;
+        fail(c);
+        return 0;
+    }
+
+    return value;
+}
+
+static inline qint32 readInt(Cursor &c)
+{
+    return qRound(readNumber(c));
+}
+
+static inline bool readBool(Cursor &c)
+{
+    return readNumber(c) != 0;
+}
+
+static void readIntArray(Cursor &c, QVector<qint32> &values)
+{
+    values.clear();
+    if (!begin(c, '[')) return;
+
+    bool first = true;
+    while (nextElement(c, first)) {
+        values.append(readInt(c));
+    }
+}
+
+static void readVideoParameters(Cursor &c, LdDecodeMetaData::VideoParameters &videoParameters, bool &present)
+{
+    if (!begin(c, '{')) return;
+
+    bool first = true;
+    Key key;
+    while (nextMember(c, first, key)) {
+        present = true;
+
+        if (keyIs(key, "numberOfSequentialFields")) videoParameters.numberOfSequentialFields = readInt(c);
+        else if (keyIs(key, "isSourcePal")) videoParameters.isSourcePal = readBool(c);
+        else if (keyIs(key, "isSubcarrierLocked")) videoParameters.isSubcarrierLocked = readBool(c);
+        else if (keyIs(key, "colourBurstStart")) videoParameters.colourBurstStart = readInt(c);
+        else if (keyIs(key, "colourBurstEnd")) videoParameters.colourBurstEnd = readInt(c);
+        else if (keyIs(key, "activeVideoStart")) videoParameters.activeVideoStart = readInt(c);
+        else if (keyIs(key, "activeVideoEnd")) videoParameters.activeVideoEnd = readInt(c);
+        else if (keyIs(key, "white16bIre")) videoParameters.white16bIre = readInt(c);
+        else if (keyIs(key, "black16bIre")) videoParameters.black16bIre = readInt(c);
+        else if (keyIs(key, "fieldWidth")) videoParameters.fieldWidth = readInt(c);
+        else if (keyIs(key, "fieldHeight")) videoParameters.fieldHeight = readInt(c);
+        else if (keyIs(key, "sampleRate")) videoParameters.sampleRate = readInt(c);
+        else if (keyIs(key, "fsc")) videoParameters.fsc = readInt(c);
+        else if (keyIs(key, "isMapped")) videoParameters.isMapped = readBool(c);
+        else skipValue(c);
+    }
+}
+
+static void readPcmAudioParameters(Cursor &c, LdDecodeMetaData::PcmAudioParameters &pcmAudioParameters, bool &present)
+{
+    if (!begin(c, '{')) return;
+
+    bool first = true;
+    Key key;
+    while (nextMember(c, first, key)) {
+        present = true;
+
+        if (keyIs(key, "sampleRate")) pcmAudioParameters.sampleRate = readInt(c);
+        else if (keyIs(key, "isLittleEndian")) pcmAudioParameters.isLittleEndian = readBool(c);
+        else if (keyIs(key, "isSigned")) pcmAudioParameters.isSigned = readBool(c);
+        else if (keyIs(key, "bits")) pcmAudioParameters.bits = readInt(c);
+        else skipValue(c);
+    }
+}
+
+static void readVitsMetrics(Cursor &c, LdDecodeMetaData::VitsMetrics &vitsMetrics)
+{
+    if (!begin(c, '{')) return;
+
+    bool first = true;
+    Key key;
+    while (nextMember(c, first, key)) {
+        vitsMetrics.inUse = true;
+
+        if (keyIs(key, "wSNR")) vitsMetrics.wSNR = readNumber(c);
+        else if (keyIs(key, "bPSNR")) vitsMetrics.bPSNR = readNumber(c);
+        else skipValue(c);
+    }
+}
+
+static void readVbi(Cursor &c, LdDecodeMetaData::Vbi &vbi)
+{
+    if (!begin(c, '{')) return;
+
+    bool first = true;
+    Key key;
+    while (nextMember(c, first, key)) {
+        vbi.inUse = true;
+
+        if (keyIs(key, "vbiData")) readIntArray(c, vbi.vbiData);
+        else skipValue(c);
+    }
+}
+
+static void readNtsc(Cursor &c, LdDecodeMetaData::Ntsc &ntsc)
+{
+    if (!begin(c, '{')) return;
+
+    bool first = true;
+    Key key;
+    while (nextMember(c, first, key)) {
+        ntsc.inUse = true;
+
+        if (keyIs(key, "isFmCodeDataValid")) ntsc.isFmCodeDataValid = readBool(c);
+        else if (keyIs(key, "fmCodeData")) ntsc.fmCodeData = readInt(c);
+        else if (keyIs(key, "fieldFlag")) ntsc.fieldFlag = readBool(c);
+        else if (keyIs(key, "whiteFlag")) ntsc.whiteFlag = readBool(c);
+        else if (keyIs(key, "ccData0")) ntsc.ccData0 = readInt(c);
+        else if (keyIs(key, "ccData1")) ntsc.ccData1 = readInt(c);
+        else skipValue(c);
+    }
+}
+
+static void readDropOuts(Cursor &c, LdDecodeMetaData::DropOuts &dropOuts)
+{
+    if (!begin(c, '{')) return;
+
+    bool first = true;
+    Key key;
+    while (nextMember(c, first, key)) {
+        if (keyIs(key, "startx")) readIntArray(c, dropOuts.startx);
+        else if (keyIs(key, "endx")) readIntArray(c, dropOuts.endx);
+        else if (keyIs(key, "fieldLine")) readIntArray(c, dropOuts.fieldLine);
+        else skipValue(c);
+    }
+
+    // Consumers index the three arrays together, so make them all the same
+    // size as startx (as LdDecodeMetaData::getFieldDropOuts() did), padding
+    // with zeros if endx or fieldLine is too short
+    const qint32 startxSize = dropOuts.startx.size();
+    if (dropOuts.endx.size() != startxSize || dropOuts.fieldLine.size() != startxSize) {
+        qCritical("JSON file is invalid: Dropouts object is illegal");
+        dropOuts.endx.resize(startxSize);
+        dropOuts.fieldLine.resize(startxSize);
+    }
+}
+
+static void readField(Cursor &c, LdDecodeMetaData::Field &field)
+{
+    if (!begin(c, '{')) return;
+
+    bool first = true;
+    Key key;
+    while (nextMember(c, first, key)) {
+        if (keyIs(key, "seqNo")) field.seqNo = readInt(c);
+        else if (keyIs(key, "isFirstField")) field.isFirstField = readBool(c);
+        else if (keyIs(key, "syncConf")) field.syncConf = readInt(c);
+        else if (keyIs(key, "medianBurstIRE")) field.medianBurstIRE = readNumber(c);
+        else if (keyIs(key, "fieldPhaseID")) field.fieldPhaseID = readInt(c);
+        else if (keyIs(key, "audioSamples")) field.audioSamples = readInt(c);
+        else if (keyIs(key, "vitsMetrics")) readVitsMetrics(c, field.vitsMetrics);
+        else if (keyIs(key, "vbi")) readVbi(c, field.vbi);
+        else if (keyIs(key, "ntsc")) readNtsc(c, field.ntsc);
+        else if (keyIs(key, "dropOuts")) readDropOuts(c, field.dropOuts);
+        else if (keyIs(key, "pad")) field.pad = readBool(c);
+        else skipValue(c);
+    }
+
+    // As with LdDecodeMetaData::getFieldVbi(), there are always three VBI
+    // values, even when VBI isn't in use
+    field.vbi.vbiData.resize(3);
+}
+
+// Parses one chunk of the fields array in a pool thread
+class FieldChunkParser : public QRunnable
+{
+public:
+    FieldChunkParser(const char *const *_fieldStarts, const char *_end, LdDecodeMetaData::Field *_fields,
+                     qint32 _firstField, qint32 _lastField, const char **_errorPos)
+        : fieldStarts(_fieldStarts), end(_end), fields(_fields),
+          firstField(_firstField), lastField(_lastField), errorPos(_errorPos) {}
+
+    void run() override
+    {
+        for (qint32 fieldNumber = firstField; fieldNumber < lastField; fieldNumber++) {
+            Cursor c = {fieldStarts[fieldNumber], end, false, nullptr};
+            readField(c, fields[fieldNumber]);
+
+            if (c.failed) {
+                *errorPos = c.errorPos;
+                return;
+            }
+        }
+    }
+
+private:
+    const char *const *fieldStarts;
+    const char *end;
+    LdDecodeMetaData::Field *fields;
+    qint32 firstField;
+    qint32 lastField;
+    const char **errorPos;
+};
+
+MetadataReader::MetadataReader()
+{
+    videoParametersPresent = false;
+    pcmAudioParametersPresent = false;
+}
+
+// Read the JSON metadata file into metaData. Returns false if the file
+// couldn't be read or parsed.
+bool MetadataReader::read(QString fileName, LdDecodeMetaData::MetaData &metaData)
+{
+    QFile jsonFile(fileName);
+    if (!jsonFile.open(QIODevice::ReadOnly)) {
+        qCritical() << "MetadataReader::read(): Cannot open JSON file" << fileName;
+        return false;
+    }
+
+    // Map the file if possible, to avoid copying it into memory
+    const qint64 length = jsonFile.size();
+    const uchar *mappedData = jsonFile.map(0, length);
+    QByteArray fileData;
+    const char *data;
+    if (mappedData != nullptr) {
+        data = reinterpret_cast<const char *>(mappedData);
+    } else {
+        fileData = jsonFile.readAll();
+        if (fileData.size() != length) {
+            qCritical() << "MetadataReader::read(): Cannot read JSON file" << fileName;
+            return false;
+        }
+        data = fileData.constData();
+    }
+
+    const bool result = parse(data, length, metaData);
+
+    jsonFile.close();
+    return result;
+}
+
+// Returns true if the file contained a (non-empty) videoParameters object
+bool MetadataReader::hasVideoParameters() const
+{
+    return videoParametersPresent;
+}
+
+// Returns true if the file contained a (non-empty) pcmAudioParameters object
+bool MetadataReader::hasPcmAudioParameters() const
+{
+    return pcmAudioParametersPresent;
+}
+
+bool MetadataReader::parse(const char *data, qint64 length, LdDecodeMetaData::MetaData &metaData)
+{
+    Cursor c = {data, data + length, false, nullptr};
+
+    metaData.videoParameters = LdDecodeMetaData::VideoParameters();
+    metaData.pcmAudioParameters = LdDecodeMetaData::PcmAudioParameters();
+    metaData.fields.clear();
+    videoParametersPresent = false;
+    pcmAudioParametersPresent = false;
+
+    // Read the top-level object. The fields aren't parsed here; we just find
+    // where each one starts.
+    QVector<const char *> fieldStarts;
+    if (begin(c, '{')) {
+        bool first = true;
+        Key key;
+        while (nextMember(c, first, key)) {
+            if (keyIs(key, "videoParameters")) {
+                readVideoParameters(c, metaData.videoParameters, videoParametersPresent);
+            } else if (keyIs(key, "pcmAudioParameters")) {
+                readPcmAudioParameters(c, metaData.pcmAudioParameters, pcmAudioParametersPresent);
+            } else if (keyIs(key, "fields")) {
+                fieldStarts.clear();
+                if (!begin(c, '[')) break;
+
+                bool firstField = true;
+                while (nextElement(c, firstField)) {
+                    skipSpace(c);
+                    fieldStarts.append(c.pos);
+                    skipValue(c);
+                }
+            } else {
+                skipValue(c);
+            }
+        }
+    }
+
+    if (c.failed) {
+        qCritical() << "MetadataReader::parse(): JSON syntax error at byte" << (c.errorPos - data);
+        return false;
+    }
+
+    // Parse the fields in parallel
+    const qint32 numberOfFields = fieldStarts.size();
+    metaData.fields.resize(numberOfFields);
+    LdDecodeMetaData::Field *fields = metaData.fields.data();
+
+    const qint32 numberOfChunks = (numberOfFields + FIELDS_PER_CHUNK - 1) / FIELDS_PER_CHUNK;
+    QVector<const char *> chunkErrors(numberOfChunks, nullptr);
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(QThread::idealThreadCount());
+    for (qint32 chunk = 0; chunk < numberOfChunks; chunk++) {
+        const qint32 firstField = chunk * FIELDS_PER_CHUNK;
+        const qint32 lastField = qMin(firstField + FIELDS_PER_CHUNK, numberOfFields);
+
+        threadPool.start(new FieldChunkParser(fieldStarts.constData(), c.end, fields,
+                                              firstField, lastField, &chunkErrors[chunk]));
+    }
+    threadPool.waitForDone();
+
+    for (qint32 chunk = 0; chunk < numberOfChunks; chunk++) {
+        if (chunkErrors[chunk] != nullptr) {
+            qCritical() << "MetadataReader::parse(): JSON syntax error at byte" << (chunkErrors[chunk] - data);
+            metaData.fields.clear();
+            return false;
+        }
+    }
+
+    qDebug() << "MetadataReader::parse(): Read" << numberOfFields << "fields using" << threadPool.maxThreadCount() << "threads";
+
+    return true;
+}
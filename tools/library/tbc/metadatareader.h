@@ -0,0 +1,63 @@
+/************************************************************************
+
+    metadatareader.h
+
+    ld-decode-tools TBC library
+    Copyright (C) 2020 Simon Inns
+
+    This file is part of ld-decode-tools.
+
+    ld-decode-tools is free software: you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+************************************************************************/
+
+#ifndef METADATAREADER_H
+#define METADATAREADER_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QVector>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QDebug>
+
+#include "lddecodemetadata.h"
+
+// Fast, read-only loader for the JSON metadata.
+//
+// Rather than building a JsonWax DOM, this parses the file straight into a
+// LdDecodeMetaData::MetaData structure. The top-level object is scanned
+// once to find the start of each element of the "fields" array; the fields
+// are then parsed in parallel, in chunks of FIELDS_PER_CHUNK.
+class MetadataReader
+{
+public:
+    MetadataReader();
+
+    bool read(QString fileName, LdDecodeMetaData::MetaData &metaData);
+
+    bool hasVideoParameters() const;
+    bool hasPcmAudioParameters() const;
+
+private:
+    static constexpr qint32 FIELDS_PER_CHUNK = 1024;
+
+    bool videoParametersPresent;
+    bool pcmAudioParametersPresent;
+
+    bool parse(const char *data, qint64 length, LdDecodeMetaData::MetaData &metaData);
+};
+
+#endif // METADATAREADER_H
@@ -24,8 +24,14 @@
 
 #include "sourcevideo.h"
 
+#include <cerrno>
 #include <cstdio>
 
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 // Class constructor
 SourceVideo::SourceVideo()
 {
@@ -230,15 +236,79 @@ SourceVideo::Data SourceVideo::getVideoField(qint32 fieldNumber, qint32 startFie
     return outputFieldData;
 }
 
+// Method to retrieve the same range of field lines from several consecutive
+// video fields. The line ranges are returned one after another in a single
+// buffer.
+//
+// This is intended for tools that only need a few lines from each field, and
+// makes one read per field (without seeking) rather than going through
+// getVideoField. Field lines are not cached.
+SourceVideo::Data SourceVideo::getVideoFields(qint32 firstFieldNumber, qint32 numFields, qint32 startFieldLine, qint32 endFieldLine)
+{
+    // Ensure source video is open
+    if (!isSourceVideoOpen) qFatal("Application requested TBC field before opening TBC file - Fatal error");
 
+    // Verify the required range
+    if (fieldLineLength == -1) qFatal("Application did not set field line length when opening TBC file");
+    if (startFieldLine < 1 || endFieldLine < startFieldLine) qFatal("Application requested out-of-bounds field line");
+    if (firstFieldNumber < 1 || numFields < 0) qFatal("Application requested out-of-bounds field");
 
+    const qint64 rangeLength = static_cast<qint64>(endFieldLine - startFieldLine + 1) * static_cast<qint64>(fieldLineLength);
 
+#ifdef Q_OS_UNIX
+    if (availableFields != -1) {
+        // We're reading from a file, so we can use positional reads
 
+        // Calculate the position of the first range; the others follow at
+        // intervals of one field
+        const qint64 firstPosition = (static_cast<qint64>(fieldByteLength) * (firstFieldNumber - 1))
+                                     + (static_cast<qint64>(fieldLineLength) * (startFieldLine - 1));
 
+        // Check the requested fields and lines are valid
+        if (numFields > 0 && firstPosition + (static_cast<qint64>(fieldByteLength) * (numFields - 1)) + rangeLength
+                             > static_cast<qint64>(fieldByteLength) * availableFields) {
+            qFatal("Application requested field line range that exceeds the boundaries of the input TBC file");
+        }
 
+        Data outputData(static_cast<qint32>((rangeLength * numFields) / 2));
+        char *outputPtr = reinterpret_cast<char *>(outputData.data());
+        const int fd = inputFile.handle();
+
+#ifdef POSIX_FADV_WILLNEED
+        // Tell the kernel about all the ranges we're going to read, so it can
+        // queue up the reads for the whole batch rather than waiting for each
+        // one in turn
+        for (qint32 i = 0; i < numFields; i++) {
+            const qint64 position = firstPosition + (static_cast<qint64>(fieldByteLength) * i);
+            posix_fadvise(fd, position, rangeLength, POSIX_FADV_WILLNEED);
+        }
+#endif
+
+        // Read each range directly into the output buffer
+        for (qint32 i = 0; i < numFields; i++) {
+            const qint64 position = firstPosition + (static_cast<qint64>(fieldByteLength) * i);
+            char *rangePtr = outputPtr + (rangeLength * i);
+
+            qint64 totalReceivedBytes = 0;
+            while (totalReceivedBytes < rangeLength) {
+                const ssize_t receivedBytes = pread(fd, rangePtr + totalReceivedBytes, rangeLength - totalReceivedBytes,
+                                                    position + totalReceivedBytes);
+                if (receivedBytes < 0 && errno == EINTR) continue;
+                if (receivedBytes <= 0) qFatal("Could not read field data from input TBC file");
+                totalReceivedBytes += receivedBytes;
+            }
+        }
 
+        return outputData;
+    }
+#endif
 
+    // Otherwise, read each field in turn
+    Data outputData;
+    outputData.reserve(static_cast<qint32>((rangeLength * numFields) / 2));
+    for (qint32 i = 0; i < numFields; i++) {
+        outputData += getVideoField(firstFieldNumber + i, startFieldLine, endFieldLine);
+    }
 
-
-
-
+    return outputData;
+}
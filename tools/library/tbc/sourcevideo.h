@@ -52,6 +52,7 @@ public:
 
     // Field handling methods
     Data getVideoField(qint32 fieldNumber, qint32 startFieldLine = -1, qint32 endFieldLine = -1);
+    Data getVideoFields(qint32 firstFieldNumber, qint32 numFields, qint32 startFieldLine, qint32 endFieldLine);
 
     // Get and set methods
     bool isSourceValid();